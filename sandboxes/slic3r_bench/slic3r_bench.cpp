@@ -0,0 +1,319 @@
+// Benchmark of the FFF slicing pipeline.
+//
+// Loads a set of reference models, runs Print::process() and Print::export_gcode() without the GUI
+// and records the wall time and the process peak resident memory at the end of each PrintObjectStep / PrintStep.
+// PrintObjectSteps of independent PrintObjects may run concurrently, thus the time of a step is recorded both
+// as the sum of the step times of the PrintObjects ("time_s") and as the wall time from the first start
+// to the last finish of the step ("wall_s").
+// The results are written as JSON and optionally compared against a stored baseline, which is a JSON file
+// written by a previous run on the same machine.
+//
+// slic3r_bench [--case <name>] [--repeat <n>] [--threads <n,n,...>] [--output <results.json>] [--baseline <baseline.json>] [--tolerance <percent>]
+//
+// --threads sweeps the number of threads: each case runs in a TBB task arena of each of the listed sizes and it is reported
+// as <case>_t<n>, followed by the speedup of the total and of the support generation against the first thread count.
+//
+// The process peak memory only grows, thus run a single case per process (--case) to get the peak memory of that case.
+// Returns 1 if a case or a step got slower than the baseline by more than the tolerance.
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <boost/nowide/iostream.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <tbb/task_arena.h>
+
+#include "libslic3r/libslic3r.h"
+#include "libslic3r/Model.hpp"
+#include "libslic3r/ModelArrange.hpp"
+#include "libslic3r/Print.hpp"
+#include "libslic3r/PrintConfig.hpp"
+#include "libslic3r/Utils.hpp"
+
+using namespace Slic3r;
+
+namespace {
+
+struct BenchCase
+{
+    std::string                                     name;
+    // Model files relative to the tests/data directory. A file may repeat to fill the bed with copies.
+    std::vector<std::string>                        models;
+    std::vector<std::pair<std::string, std::string>> config;
+};
+
+// Reference models bundled with the unit tests, with configurations exercising the expensive steps.
+static const std::vector<BenchCase> bench_cases {
+    { "cube_gyroid",            { "20mm_cube.obj" },                  { { "fill_density", "40%" }, { "fill_pattern", "gyroid" } } },
+    { "extruder_idler_arachne", { "extruder_idler.obj" },             { { "perimeter_generator", "arachne" }, { "fill_density", "20%" } } },
+    { "frog_legs_supports",     { "frog_legs.obj" },                  { { "support_material", "1" } } },
+    { "overhang_organic",       { "overhang.obj" },                   { { "support_material", "1" }, { "support_material_style", "organic" } } },
+    { "ipadstand_lightning",    { "ipadstand.obj" },                  { { "fill_density", "15%" }, { "fill_pattern", "lightning" } } },
+    { "plate_of_16",            std::vector<std::string>(16, "pyramid.obj"), { { "fill_density", "20%" } } },
+    // Different objects with supports, whose steps run concurrently in the PrintObject flow graph.
+    { "plate_mixed_supports",   { "frog_legs.obj", "overhang.obj", "extruder_idler.obj", "A.obj" }, { { "support_material", "1" }, { "fill_density", "20%" } } },
+};
+
+static const char *print_object_step_names[] = {
+    "posSlice", "posNonplanarDetect", "posPerimeters", "posPrepareInfill",
+    "posInfill", "posIroning", "posSupportSpotsSearch",
+    "posSupportMaterial", "posNonplanarProjection", "posEstimateCurledExtrusions",
+};
+static_assert(std::size(print_object_step_names) == posCount, "print_object_step_names shall match PrintObjectStep");
+
+static const char *print_step_names[] = { "psWipeTower", "psAlertWhenSupportsNeeded", "psSkirtBrim", "psGCodeExport" };
+static_assert(std::size(print_step_names) == psCount, "print_step_names shall match PrintStep");
+
+using Clock = std::chrono::steady_clock;
+
+struct StepResult
+{
+    // Wall time summed over all PrintObjects.
+    double            time     { 0. };
+    // Wall time from the first start to the last finish of the step over all PrintObjects.
+    double            wall     { 0. };
+    // Process peak resident memory at the end of the step.
+    size_t            peak_rss { 0 };
+    Clock::time_point first_started;
+    Clock::time_point last_finished;
+};
+
+struct CaseResult
+{
+    double                            time     { 0. };
+    size_t                            peak_rss { 0 };
+    std::map<std::string, StepResult> steps;
+};
+
+static CaseResult run_case(const BenchCase &bench_case)
+{
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    for (const auto &[key, value] : bench_case.config)
+        config.set_deserialize_strict(key, value);
+
+    Model model;
+    for (const std::string &file : bench_case.models) {
+        Model loaded = Model::read_from_file((boost::filesystem::path(BENCH_DATA_DIR) / file).string());
+        for (ModelObject *mo : loaded.objects)
+            model.add_object(*mo);
+    }
+    arrange_objects(model, InfiniteBed{}, ArrangeParams{ scaled(min_object_distance(config)) });
+    model.center_instances_around_point({ 100, 100 });
+
+    Print print;
+    for (ModelObject *mo : model.objects) {
+        mo->ensure_on_bed();
+        print.auto_assign_extruders(mo);
+    }
+    print.apply(model, config);
+    if (std::string err = print.validate(); ! err.empty())
+        throw Slic3r::RuntimeError(bench_case.name + ": " + err);
+    print.set_status_silent();
+
+    CaseResult result;
+    // Steps of a single PrintObject or of the Print are started and finished in sequence, however steps of different
+    // PrintObjects may run concurrently on worker threads, thus the start times are keyed by (PrintObject, step)
+    // and the callback is serialized.
+    std::mutex                                                          mutex;
+    std::map<std::pair<const PrintObjectBase*, int>, Clock::time_point> started;
+    print.set_step_callback([&result, &started, &mutex](const PrintObjectBase *print_object, int step, bool finished) {
+        const char                  *name = print_object ? print_object_step_names[step] : print_step_names[step];
+        Clock::time_point            now  = Clock::now();
+        std::scoped_lock<std::mutex> lock(mutex);
+        auto                         key  = std::make_pair(print_object, step);
+        if (! finished) {
+            started[key] = now;
+        } else if (auto it = started.find(key); it != started.end()) {
+            auto [it_step, inserted] = result.steps.try_emplace(name);
+            StepResult &step_result = it_step->second;
+            if (inserted || it->second < step_result.first_started)
+                step_result.first_started = it->second;
+            if (inserted || now > step_result.last_finished)
+                step_result.last_finished = now;
+            step_result.time    += std::chrono::duration<double>(now - it->second).count();
+            step_result.wall     = std::chrono::duration<double>(step_result.last_finished - step_result.first_started).count();
+            step_result.peak_rss = std::max(step_result.peak_rss, peak_process_memory());
+            started.erase(it);
+        }
+    });
+
+    boost::filesystem::path gcode_path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slic3r_bench-%%%%-%%%%.gcode");
+    Clock::time_point       t0         = Clock::now();
+    print.process();
+    print.export_gcode(gcode_path.string(), nullptr, nullptr);
+    result.time     = std::chrono::duration<double>(Clock::now() - t0).count();
+    result.peak_rss = peak_process_memory();
+    boost::filesystem::remove(gcode_path);
+    return result;
+}
+
+// Keep the fastest run, it is the least disturbed one.
+static CaseResult run_case_best_of(const BenchCase &bench_case, int repeat)
+{
+    CaseResult best;
+    for (int i = 0; i < repeat; ++ i) {
+        CaseResult r = run_case(bench_case);
+        if (i == 0 || r.time < best.time)
+            best = std::move(r);
+    }
+    return best;
+}
+
+static double to_MB(size_t bytes) { return double(bytes) / (1024. * 1024.); }
+
+// Prints the speedup of the total time and of the support generation with each thread count against the first one.
+static void print_thread_scaling(const std::string &name, const std::vector<int> &threads, const std::map<std::string, CaseResult> &results)
+{
+    auto support_time = [](const CaseResult &r) {
+        auto it = r.steps.find("posSupportMaterial");
+        return it == r.steps.end() ? 0. : it->second.wall;
+    };
+    const CaseResult &first = results.at(name + "_t" + std::to_string(threads.front()));
+    printf("%s thread scaling\n  %8s %10s %8s %12s %8s\n", name.c_str(), "threads", "total_s", "speedup", "supports_s", "speedup");
+    for (int num_threads : threads) {
+        const CaseResult &r = results.at(name + "_t" + std::to_string(num_threads));
+        printf("  %8d %10.4f %7.2fx %12.4f %7.2fx\n", num_threads, r.time, first.time / r.time, support_time(r),
+            support_time(r) > 0. ? support_time(first) / support_time(r) : 0.);
+    }
+}
+
+static void write_json(std::ostream &out, const std::map<std::string, CaseResult> &results)
+{
+    char buf[256];
+    out << "{\n  \"cases\": {";
+    for (auto it_case = results.begin(); it_case != results.end(); ++ it_case) {
+        const CaseResult &r = it_case->second;
+        sprintf(buf, "%s\n    \"%s\": {\n      \"time_s\": %.4f,\n      \"peak_rss_MB\": %.1f,\n      \"steps\": {",
+            it_case == results.begin() ? "" : ",", it_case->first.c_str(), r.time, to_MB(r.peak_rss));
+        out << buf;
+        for (auto it_step = r.steps.begin(); it_step != r.steps.end(); ++ it_step) {
+            sprintf(buf, "%s\n        \"%s\": { \"time_s\": %.4f, \"wall_s\": %.4f, \"peak_rss_MB\": %.1f }",
+                it_step == r.steps.begin() ? "" : ",", it_step->first.c_str(), it_step->second.time, it_step->second.wall, to_MB(it_step->second.peak_rss));
+            out << buf;
+        }
+        out << "\n      }\n    }";
+    }
+    out << "\n  }\n}\n";
+}
+
+// Compares a measured time with the baseline. Differences below 10ms are considered noise.
+static bool check_regression(const std::string &what, double time, const boost::property_tree::ptree &baseline, double tolerance)
+{
+    boost::optional<double> base = baseline.get_optional<double>("time_s");
+    if (! base) {
+        printf("  %-45s %9.4fs  (no baseline)\n", what.c_str(), time);
+        return false;
+    }
+    double ratio      = *base > 0. ? time / *base : 1.;
+    bool   regression = time - *base > 0.01 && ratio > 1. + tolerance;
+    printf("  %-45s %9.4fs  baseline %9.4fs  %+6.1f%%%s\n", what.c_str(), time, *base, (ratio - 1.) * 100., regression ? "  REGRESSION" : "");
+    return regression;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string case_name;
+    std::string output_path = "slic3r_bench.json";
+    std::string baseline_path;
+    int         repeat    = 3;
+    double      tolerance = 0.1;
+    // Empty for the default number of threads.
+    std::vector<int> threads;
+    for (int i = 1; i < argc; ++ i) {
+        std::string arg = argv[i];
+        if (i + 1 == argc) {
+            boost::nowide::cerr << "Missing value of " << arg << std::endl;
+            return 2;
+        }
+        if (arg == "--case")
+            case_name = argv[++ i];
+        else if (arg == "--repeat")
+            repeat = std::max(1, atoi(argv[++ i]));
+        else if (arg == "--threads") {
+            std::string list = argv[++ i];
+            for (size_t begin = 0; begin < list.size();) {
+                size_t end = std::min(list.find(',', begin), list.size());
+                if (int num_threads = atoi(list.substr(begin, end - begin).c_str()); num_threads > 0)
+                    threads.emplace_back(num_threads);
+                begin = end + 1;
+            }
+            if (threads.empty()) {
+                boost::nowide::cerr << "Invalid thread counts " << list << std::endl;
+                return 2;
+            }
+        } else if (arg == "--output")
+            output_path = argv[++ i];
+        else if (arg == "--baseline")
+            baseline_path = argv[++ i];
+        else if (arg == "--tolerance")
+            tolerance = atof(argv[++ i]) * 0.01;
+        else {
+            boost::nowide::cerr << "Unknown argument " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    std::map<std::string, CaseResult> results;
+    for (const BenchCase &bench_case : bench_cases) {
+        if (! case_name.empty() && bench_case.name != case_name)
+            continue;
+        if (threads.empty()) {
+            CaseResult best = run_case_best_of(bench_case, repeat);
+            printf("%-30s %9.4fs  peak memory %s MB\n", bench_case.name.c_str(), best.time, format_memsize_MB(best.peak_rss).c_str());
+            results[bench_case.name] = std::move(best);
+            continue;
+        }
+        for (int num_threads : threads) {
+            const std::string name = bench_case.name + "_t" + std::to_string(num_threads);
+            CaseResult        best;
+            tbb::task_arena(num_threads).execute([&best, &bench_case, repeat]() { best = run_case_best_of(bench_case, repeat); });
+            printf("%-30s %9.4fs  peak memory %s MB\n", name.c_str(), best.time, format_memsize_MB(best.peak_rss).c_str());
+            results[name] = std::move(best);
+        }
+        print_thread_scaling(bench_case.name, threads, results);
+    }
+    if (results.empty()) {
+        boost::nowide::cerr << "Unknown benchmark case " << case_name << std::endl;
+        return 2;
+    }
+
+    boost::nowide::ofstream out(output_path);
+    write_json(out, results);
+    out.close();
+    printf("Results written to %s\n", output_path.c_str());
+
+    if (baseline_path.empty())
+        return 0;
+
+    boost::property_tree::ptree baseline;
+    try {
+        boost::nowide::ifstream in(baseline_path);
+        boost::property_tree::read_json(in, baseline);
+    } catch (const std::exception &ex) {
+        boost::nowide::cerr << "Cannot read baseline " << baseline_path << ": " << ex.what() << std::endl;
+        return 2;
+    }
+    // The case and step names do not contain dots, thus they may be used in property tree paths directly.
+    bool regression = false;
+    for (const auto &[name, r] : results) {
+        boost::property_tree::ptree empty;
+        const boost::property_tree::ptree &base_case = baseline.get_child("cases." + name, empty);
+        printf("%s\n", name.c_str());
+        regression |= check_regression("total", r.time, base_case, tolerance);
+        for (const auto &[step, step_result] : r.steps)
+            regression |= check_regression(step, step_result.time, base_case.get_child("steps." + step, empty), tolerance);
+    }
+    return regression ? 1 : 0;
+}
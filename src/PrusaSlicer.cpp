@@ -39,6 +39,7 @@
 #include "libslic3r/Config.hpp"
 #include "libslic3r/Geometry.hpp"
 #include "libslic3r/GCode/PostProcessor.hpp"
+#include "libslic3r/GCode/BinaryGCode.hpp"
 #include "libslic3r/Model.hpp"
 #include "libslic3r/ModelArrange.hpp"
 #include "libslic3r/Platform.hpp"
@@ -52,6 +53,7 @@
 #include "libslic3r/Format/SL1.hpp"
 #include "libslic3r/Utils.hpp"
 #include "libslic3r/Thread.hpp"
+#include "libslic3r/Trace.hpp"
 #include "libslic3r/BlacklistedLibraryCheck.hpp"
 
 #include "PrusaSlicer.hpp"
@@ -105,6 +107,18 @@ int CLI::run(int argc, char **argv)
 	if (! this->setup(argc, argv))
 		return 1;
 
+    // Record a trace of the slicing steps, saved when leaving this function.
+    const std::string trace_path = m_config.opt_string("trace");
+    if (! trace_path.empty())
+        Trace::start();
+    ScopeGuard trace_guard([&trace_path]() {
+        if (! trace_path.empty()) {
+            Trace::stop();
+            if (! Trace::save(trace_path))
+                boost::nowide::cerr << "Failed to save the trace to " << trace_path << std::endl;
+        }
+    });
+
     m_extra_config.apply(m_config, true);
     m_extra_config.normalize_fdm();
     
@@ -218,6 +232,28 @@ int CLI::run(int argc, char **argv)
     }
 #endif // ENABLE_GL_CORE_PROFILE
 
+    // Convert G-code files between the text and the binary format, there is nothing to slice.
+    if (std::find(m_actions.begin(), m_actions.end(), "convert_gcode") != m_actions.end()) {
+        for (const std::string &file : m_input_files) {
+            try {
+                if (BinaryGCode::is_unsupported_binary_file(file))
+                    throw Slic3r::RuntimeError("Binary G-code of the Prusa printers (.bgcode) is not supported");
+                const bool              binary = BinaryGCode::is_binary_file(file);
+                boost::filesystem::path outfile(file);
+                outfile.replace_extension(binary ? ".gcode" : ".sbgc");
+                if (binary)
+                    BinaryGCode::convert_to_text(file, outfile.string());
+                else
+                    BinaryGCode::convert_to_binary(file, outfile.string());
+                boost::nowide::cout << "G-code " << file << " converted to " << outfile.string() << std::endl;
+            } catch (const std::exception &ex) {
+                boost::nowide::cerr << file << ": " << ex.what() << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
     // Read input file(s) if any.
     for (const std::string& file : m_input_files)
         if (is_gcode_file(file) && boost::filesystem::exists(file)) {
@@ -611,6 +647,8 @@ int CLI::run(int argc, char **argv)
                         }
                         // Run the post-processing scripts if defined.
                         run_post_process_scripts(outfile, fff_print.full_print_config());
+                        if (printer_technology == ptFFF && fff_print.config().binary_gcode)
+                            BinaryGCode::convert_to_binary(outfile, outfile);
                         boost::nowide::cout << "Slicing result exported to " << outfile << std::endl;
                     } catch (const std::exception &ex) {
                         boost::nowide::cerr << ex.what() << std::endl;
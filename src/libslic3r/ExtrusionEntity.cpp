@@ -22,12 +22,43 @@ void ExtrusionPath::subtract_expolygons(const ExPolygons &collection, ExtrusionE
 
 void ExtrusionPath::clip_end(double distance)
 {
-    this->polyline.clip_end(distance);
+    if (this->nonplanar_z.empty()) {
+        this->polyline.clip_end(distance);
+        return;
+    }
+
+    // Same as Polyline::clip_end(), keeping the nonplanar Z coordinates in sync.
+    // The new end point inherits Z of the point preceding it.
+    Points &points = this->polyline.points;
+    assert(this->nonplanar_z.size() == points.size());
+    while (distance > 0) {
+        Vec2d last_point = points.back().cast<double>();
+        points.pop_back();
+        this->nonplanar_z.pop_back();
+        if (points.empty())
+            break;
+        Vec2d  v    = points.back().cast<double>() - last_point;
+        double lsqr = v.squaredNorm();
+        if (lsqr > distance * distance) {
+            points.emplace_back((last_point + v * (distance / sqrt(lsqr))).cast<coord_t>());
+            this->nonplanar_z.emplace_back(this->nonplanar_z.back());
+            return;
+        }
+        distance -= sqrt(lsqr);
+    }
 }
 
 void ExtrusionPath::simplify(double tolerance)
 {
-    this->polyline.simplify(tolerance);
+    if (this->nonplanar_z.empty()) {
+        this->polyline.simplify(tolerance);
+    } else if (std::all_of(this->nonplanar_z.begin(), this->nonplanar_z.end(), [z = this->nonplanar_z.front()](coord_t z2) { return z2 == z; })) {
+        // A nonplanar path lying in a single plane may be simplified in 2D.
+        coord_t z = this->nonplanar_z.front();
+        this->polyline.simplify(tolerance);
+        this->nonplanar_z.assign(this->polyline.size(), z);
+    }
+    // Otherwise don't simplify, the Douglas-Peucker algorithm would drop points defining the nonplanar profile.
 }
 
 double ExtrusionPath::length() const
@@ -159,6 +190,10 @@ bool ExtrusionLoop::split_at_vertex(const Point &point, const double scaled_epsi
                 // just change the order of points
                 path->polyline.points.insert(path->polyline.points.end(), path->polyline.points.begin() + 1, path->polyline.points.begin() + idx + 1);
                 path->polyline.points.erase(path->polyline.points.begin(), path->polyline.points.begin() + idx);
+                if (path->is_nonplanar()) {
+                    path->nonplanar_z.insert(path->nonplanar_z.end(), path->nonplanar_z.begin() + 1, path->nonplanar_z.begin() + idx + 1);
+                    path->nonplanar_z.erase(path->nonplanar_z.begin(), path->nonplanar_z.begin() + idx);
+                }
             } else {
                 // new paths list starts with the second half of current path
                 ExtrusionPaths new_paths;
@@ -166,6 +201,8 @@ bool ExtrusionLoop::split_at_vertex(const Point &point, const double scaled_epsi
                 {
                     ExtrusionPath p = *path;
                     p.polyline.points.erase(p.polyline.points.begin(), p.polyline.points.begin() + idx);
+                    if (p.is_nonplanar())
+                        p.nonplanar_z.erase(p.nonplanar_z.begin(), p.nonplanar_z.begin() + idx);
                     if (p.polyline.is_valid())
                         new_paths.emplace_back(std::move(p));
                 }
@@ -180,6 +217,8 @@ bool ExtrusionLoop::split_at_vertex(const Point &point, const double scaled_epsi
                 {
                     ExtrusionPath &p = *path;
                     p.polyline.points.erase(p.polyline.points.begin() + idx + 1, p.polyline.points.end());
+                    if (p.is_nonplanar())
+                        p.nonplanar_z.erase(p.nonplanar_z.begin() + idx + 1, p.nonplanar_z.end());
                     if (p.polyline.is_valid())
                         new_paths.emplace_back(std::move(p));
                 }
@@ -229,6 +268,9 @@ void ExtrusionLoop::split_at(const Point &point, bool prefer_non_overhang, const
     
     auto [path_idx, segment_idx, p] = get_closest_path_and_point(point, prefer_non_overhang);
 
+    // Z of the split point, taken from the end of segment_idx unless snapped to its start.
+    coord_t z = this->paths[path_idx].z(segment_idx + 1);
+
     // Snap p to start or end of segment_idx if closer than scaled_epsilon.
     {
         const Point *p1 = this->paths[path_idx].polyline.points.data() + segment_idx;
@@ -238,8 +280,10 @@ void ExtrusionLoop::split_at(const Point &point, bool prefer_non_overhang, const
         double d2_2 = (point - *p2).cast<double>().squaredNorm();
         const double thr2 = scaled_epsilon * scaled_epsilon;
         if (d2_1 < d2_2) {
-            if (d2_1 < thr2)
+            if (d2_1 < thr2) {
                 p = *p1;
+                z = this->paths[path_idx].z(segment_idx);
+            }
         } else {
             if (d2_2 < thr2) 
                 p = *p2;
@@ -251,14 +295,31 @@ void ExtrusionLoop::split_at(const Point &point, bool prefer_non_overhang, const
     ExtrusionPath p1(path.role(), path.mm3_per_mm, path.width, path.height);
     ExtrusionPath p2(path.role(), path.mm3_per_mm, path.width, path.height);
     path.polyline.split_at(p, &p1.polyline, &p2.polyline);
+    if (path.is_nonplanar()) {
+        // p1 is a prefix and p2 is a suffix of path, both sharing the split point.
+        if (! p1.polyline.empty()) {
+            p1.nonplanar_z.assign(path.nonplanar_z.begin(), path.nonplanar_z.begin() + (p1.polyline.size() - 1));
+            p1.nonplanar_z.emplace_back(z);
+        }
+        if (! p2.polyline.empty()) {
+            p2.nonplanar_z.emplace_back(z);
+            p2.nonplanar_z.insert(p2.nonplanar_z.end(), path.nonplanar_z.end() - (p2.polyline.size() - 1), path.nonplanar_z.end());
+        }
+    }
     
     if (this->paths.size() == 1) {
         if (p2.polyline.is_valid()) {
-            if (p1.polyline.is_valid())
+            if (p1.polyline.is_valid()) {
                 p2.polyline.points.insert(p2.polyline.points.end(), p1.polyline.points.begin() + 1, p1.polyline.points.end());
+                if (p2.is_nonplanar())
+                    p2.nonplanar_z.insert(p2.nonplanar_z.end(), p1.nonplanar_z.begin() + 1, p1.nonplanar_z.end());
+            }
             this->paths.front().polyline.points = std::move(p2.polyline.points);
-        } else
+            this->paths.front().nonplanar_z     = std::move(p2.nonplanar_z);
+        } else {
             this->paths.front().polyline.points = std::move(p1.polyline.points);
+            this->paths.front().nonplanar_z     = std::move(p1.nonplanar_z);
+        }
     } else {
         // install the two paths
         this->paths.erase(this->paths.begin() + path_idx);
@@ -281,7 +342,7 @@ void ExtrusionLoop::clip_end(double distance, ExtrusionPaths* paths) const
             paths->pop_back();
             distance -= len;
         } else {
-            last.polyline.clip_end(distance);
+            last.clip_end(distance);
             break;
         }
     }
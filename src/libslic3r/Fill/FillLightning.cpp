@@ -26,9 +26,10 @@ void GeneratorDeleter::operator()(Generator *p) {
     delete p;
 }
 
-GeneratorPtr build_generator(const PrintObject &print_object, const coordf_t fill_density, const std::function<void()> &throw_on_cancel_callback)
+GeneratorPtr build_generator(const PrintObject &print_object, const coordf_t fill_density, const std::function<void()> &throw_on_cancel_callback,
+                             const Generator *previous)
 {
-    return GeneratorPtr(new Generator(print_object, fill_density, throw_on_cancel_callback));
+    return GeneratorPtr(new Generator(print_object, fill_density, throw_on_cancel_callback, previous));
 }
 
 } // namespace Slic3r::FillAdaptive
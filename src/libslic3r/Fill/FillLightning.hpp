@@ -14,7 +14,10 @@ class Generator;
 struct GeneratorDeleter { void operator()(Generator *p); };
 using  GeneratorPtr = std::unique_ptr<Generator, GeneratorDeleter>;
 
-GeneratorPtr build_generator(const PrintObject &print_object, const coordf_t fill_density, const std::function<void()> &throw_on_cancel_callback);
+// If a previous generator of the same PrintObject is passed, the trees of its top layers are reused
+// as long as their inputs did not change.
+GeneratorPtr build_generator(const PrintObject &print_object, const coordf_t fill_density, const std::function<void()> &throw_on_cancel_callback,
+                             const Generator *previous = nullptr);
 
 class Filler : public Slic3r::Fill
 {
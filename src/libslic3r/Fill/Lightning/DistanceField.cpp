@@ -75,6 +75,28 @@ DistanceField::DistanceField(const coord_t& radius, const Polygons& current_outl
                (PointHash{}(a.loc) % prime_for_hash) < (PointHash{}(b.loc) % prime_for_hash);
         });
 
+    this->initialize_grid();
+
+#ifdef LIGHTNING_DISTANCE_FIELD_DEBUG_OUTPUT
+    {
+        static int iRun = 0;
+        export_distance_field_to_svg(debug_out_path("FillLightning-DistanceField-%d.svg", iRun++), current_outline, current_overhang, m_unsupported_points);
+    }
+#endif
+}
+
+DistanceField::DistanceField(const DistanceField &parent, const BoundingBox &bbox, std::vector<UnsupportedCell> &&unsupported_points) :
+    m_cell_size(parent.m_cell_size),
+    m_supporting_radius(parent.m_supporting_radius),
+    m_supporting_radius2(parent.m_supporting_radius2),
+    m_unsupported_points(std::move(unsupported_points)),
+    m_unsupported_points_bbox(bbox)
+{
+    this->initialize_grid();
+}
+
+void DistanceField::initialize_grid()
+{
     m_unsupported_points_erased.resize(m_unsupported_points.size());
     std::fill(m_unsupported_points_erased.begin(), m_unsupported_points_erased.end(), false);
 
@@ -83,13 +105,32 @@ DistanceField::DistanceField(const coord_t& radius, const Polygons& current_outl
     // Because the distance between two points is at least one axis equal to m_cell_size, every cell
     // in m_unsupported_points_grid contains exactly one point.
     assert(m_unsupported_points.size() == m_unsupported_points_grid.size());
+}
 
-#ifdef LIGHTNING_DISTANCE_FIELD_DEBUG_OUTPUT
-    {
-        static int iRun = 0;
-        export_distance_field_to_svg(debug_out_path("FillLightning-DistanceField-%d.svg", iRun++), current_outline, current_overhang, m_unsupported_points);
+std::vector<DistanceField> DistanceField::split(const std::vector<BoundingBox> &cluster_bboxes, const std::function<size_t(const Point&)> &cluster_of_point, std::vector<std::vector<size_t>> &out_point_indices) const
+{
+    assert(std::none_of(m_unsupported_points_erased.begin(), m_unsupported_points_erased.end(), [](bool erased) { return erased; }));
+
+    std::vector<std::vector<UnsupportedCell>> cluster_points(cluster_bboxes.size());
+    out_point_indices.assign(cluster_bboxes.size(), {});
+    for (size_t point_idx = 0; point_idx < m_unsupported_points.size(); ++ point_idx) {
+        const size_t cluster_idx = cluster_of_point(m_unsupported_points[point_idx].loc);
+        cluster_points[cluster_idx].emplace_back(m_unsupported_points[point_idx]);
+        out_point_indices[cluster_idx].emplace_back(point_idx);
     }
-#endif
+
+    std::vector<DistanceField> out;
+    out.reserve(cluster_bboxes.size());
+    for (size_t cluster_idx = 0; cluster_idx < cluster_bboxes.size(); ++ cluster_idx) {
+        BoundingBox bbox = cluster_bboxes[cluster_idx];
+        for (const UnsupportedCell &cell : cluster_points[cluster_idx])
+            bbox.merge(cell.loc);
+        // Move the grid origin by whole cells, so that the cells of the cluster are the cells of this field.
+        bbox.min = m_unsupported_points_bbox.min + (bbox.min.cwiseMax(m_unsupported_points_bbox.min) - m_unsupported_points_bbox.min) / m_cell_size * m_cell_size;
+        bbox.max = bbox.max.cwiseMin(m_unsupported_points_bbox.max);
+        out.emplace_back(DistanceField(*this, bbox, std::move(cluster_points[cluster_idx])));
+    }
+    return out;
 }
 
 void DistanceField::update(const Point& to_node, const Point& added_leaf)
@@ -8,6 +8,9 @@
 #include "../../Point.hpp"
 #include "../../Polygon.hpp"
 
+#include <functional>
+#include <vector>
+
 //#define LIGHTNING_DISTANCE_FIELD_DEBUG_OUTPUT
 
 namespace Slic3r::FillLightning
@@ -67,6 +70,23 @@ public:
      */
     void update(const Point& to_node, const Point& added_leaf);
 
+    /*!
+     * Split a field, which was not updated yet, into fields of clusters of
+     * islands of the infill area, so that the clusters could be processed in
+     * parallel.
+     *
+     * The unsupported points of a cluster keep their order and the grid cells
+     * of this field, the grid origin of a cluster is moved by whole cells to
+     * its bounding box. Thus a cluster field is updated the same way as this
+     * field, as long as the branches of a cluster do not reach the unsupported
+     * points of another cluster.
+     * \param cluster_bboxes Disjoint bounding boxes of the clusters.
+     * \param cluster_of_point Index of the cluster of an unsupported point.
+     * \param out_point_indices Indices of the unsupported points of each
+     * cluster in this field.
+     */
+    std::vector<DistanceField> split(const std::vector<BoundingBox> &cluster_bboxes, const std::function<size_t(const Point&)> &cluster_of_point, std::vector<std::vector<size_t>> &out_point_indices) const;
+
 protected:
     /*!
      * Spacing between grid points to consider supporting.
@@ -91,6 +111,13 @@ protected:
         coord_t dist_to_boundary;
     };
 
+    /*!
+     * Construct a field of a cluster, see \ref split.
+     */
+    DistanceField(const DistanceField &parent, const BoundingBox &bbox, std::vector<UnsupportedCell> &&unsupported_points);
+
+    void initialize_grid();
+
     /*!
      * Cells which still need to be supported at some point.
      */
@@ -8,6 +8,12 @@
 #include "../../Layer.hpp"
 #include "../../Print.hpp"
 
+#include <boost/functional/hash.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 /* Possible future tasks/optimizations,etc.:
  * - Improve connecting heuristic to favor connecting to shorter trees
  * - Change which node of a tree is the root when that would be better in reconnectRoots.
@@ -24,7 +30,8 @@
 
 namespace Slic3r::FillLightning {
 
-Generator::Generator(const PrintObject &print_object, const coordf_t fill_density, const std::function<void()> &throw_on_cancel_callback)
+Generator::Generator(const PrintObject &print_object, const coordf_t fill_density, const std::function<void()> &throw_on_cancel_callback,
+                     const Generator *previous)
 {
     const PrintConfig         &print_config         = print_object.print()->config();
     const PrintObjectConfig   &object_config        = print_object.config();
@@ -48,62 +55,118 @@ Generator::Generator(const PrintObject &print_object, const coordf_t fill_densit
     m_prune_length                                    = coord_t(layer_thickness * std::tan(lightning_infill_prune_angle));
     m_straightening_max_distance                      = coord_t(layer_thickness * std::tan(lightning_infill_straightening_angle));
 
-    generateInitialInternalOverhangs(print_object, throw_on_cancel_callback);
-    generateTrees(print_object, throw_on_cancel_callback);
+    std::vector<Polygons> infill_outlines = collectInfillOutlines(print_object, throw_on_cancel_callback);
+    const size_t          num_layers      = infill_outlines.size();
+    m_num_reused_layers = numLayersToReuse(previous);
+    const size_t          num_reused      = m_num_reused_layers;
+    BOOST_LOG_TRIVIAL(debug) << "Lightning infill: reusing trees of " << num_reused << " top layers out of " << num_layers;
+    if (num_reused == num_layers) {
+        // Nothing changed, take over all the trees.
+        if (previous != nullptr) {
+            m_lightning_layers = previous->m_lightning_layers;
+            m_locator_bboxes   = previous->m_locator_bboxes;
+        }
+        return;
+    }
+    const size_t top_layer_id = num_layers - num_reused - 1;
+    generateInitialInternalOverhangs(infill_outlines, top_layer_id, throw_on_cancel_callback);
+    generateTrees(infill_outlines, top_layer_id, previous, throw_on_cancel_callback);
 }
 
-void Generator::generateInitialInternalOverhangs(const PrintObject &print_object, const std::function<void()> &throw_on_cancel_callback)
+static size_t hash_polygons(const Polygons &polygons)
 {
-    m_overhang_per_layer.resize(print_object.layers().size());
-
-    Polygons infill_area_above;
-    // Iterate from top to bottom, to subtract the overhang areas above from the overhang areas on the layer below, to get only overhang in the top layer where it is overhanging.
-    for (int layer_nr = int(print_object.layers().size()) - 1; layer_nr >= 0; --layer_nr) {
-        throw_on_cancel_callback();
-        Polygons infill_area_here;
-        for (const LayerRegion* layerm : print_object.get_layer(layer_nr)->regions())
-            for (const Surface& surface : layerm->fill_surfaces())
-                if (surface.surface_type == stInternal || surface.surface_type == stInternalVoid)
-                    append(infill_area_here, to_polygons(surface.expolygon));
-
-        infill_area_here = union_(infill_area_here);
-        // Remove the part of the infill area that is already supported by the walls.
-        Polygons overhang = diff(offset(infill_area_here, -float(m_wall_supporting_radius)), infill_area_above);
-        // Filter out unprintable polygons and near degenerated polygons (three almost collinear points and so).
-        overhang = opening(overhang, float(SCALED_EPSILON), float(SCALED_EPSILON));
-
-        m_overhang_per_layer[layer_nr] = overhang;
-        infill_area_above = std::move(infill_area_here);
+    size_t seed = polygons.size();
+    for (const Polygon &polygon : polygons) {
+        boost::hash_combine(seed, polygon.points.size());
+        for (const Point &pt : polygon.points) {
+            boost::hash_combine(seed, pt.x());
+            boost::hash_combine(seed, pt.y());
+        }
     }
+    return seed;
 }
 
-const Layer& Generator::getTreesForLayer(const size_t& layer_id) const
+std::vector<Polygons> Generator::collectInfillOutlines(const PrintObject &print_object, const std::function<void()> &throw_on_cancel_callback)
 {
-    assert(layer_id < m_lightning_layers.size());
-    return m_lightning_layers[layer_id];
+    std::vector<Polygons> infill_outlines(print_object.layers().size(), Polygons());
+    m_infill_outlines_hashes.assign(infill_outlines.size(), 0);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, infill_outlines.size()),
+        [&print_object, &infill_outlines, this, &throw_on_cancel_callback](const tbb::blocked_range<size_t> &range) {
+            for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                throw_on_cancel_callback();
+                Polygons &outlines = infill_outlines[layer_id];
+                for (const LayerRegion *layerm : print_object.get_layer(int(layer_id))->regions())
+                    for (const Surface &surface : layerm->fill_surfaces())
+                        if (surface.surface_type == stInternal || surface.surface_type == stInternalVoid)
+                            append(outlines, to_polygons(surface.expolygon));
+                outlines = union_(outlines);
+                m_infill_outlines_hashes[layer_id] = hash_polygons(outlines);
+            }
+        });
+
+    return infill_outlines;
 }
 
-void Generator::generateTrees(const PrintObject &print_object, const std::function<void()> &throw_on_cancel_callback)
+size_t Generator::numLayersToReuse(const Generator *previous) const
 {
-    m_lightning_layers.resize(print_object.layers().size());
+    const size_t num_layers = m_infill_outlines_hashes.size();
+    if (previous == nullptr ||
+        previous->m_supporting_radius != m_supporting_radius || previous->m_wall_supporting_radius != m_wall_supporting_radius ||
+        previous->m_prune_length != m_prune_length || previous->m_straightening_max_distance != m_straightening_max_distance ||
+        previous->m_infill_outlines_hashes.size() != num_layers || previous->m_lightning_layers.size() != num_layers ||
+        previous->m_locator_bboxes.size() != num_layers)
+        return 0;
+
+    // The overhangs and the trees of a layer only depend on the infill areas of the layer itself and of the layers above.
+    size_t num_reused = 0;
+    while (num_reused < num_layers && previous->m_infill_outlines_hashes[num_layers - num_reused - 1] == m_infill_outlines_hashes[num_layers - num_reused - 1])
+        ++ num_reused;
+    return num_reused;
+}
 
-    std::vector<Polygons> infill_outlines(print_object.layers().size(), Polygons());
+void Generator::generateInitialInternalOverhangs(const std::vector<Polygons> &infill_outlines, size_t top_layer_id, const std::function<void()> &throw_on_cancel_callback)
+{
+    m_overhang_per_layer.assign(infill_outlines.size(), Polygons());
+    const Polygons no_infill_area;
+
+    // Subtract the infill area above from the infill area of each layer to get only overhang in the top layer where it is overhanging.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, top_layer_id + 1),
+        [this, &infill_outlines, &no_infill_area, &throw_on_cancel_callback](const tbb::blocked_range<size_t> &range) {
+            for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                throw_on_cancel_callback();
+                // Remove the part of the infill area that is already supported by the walls.
+                const Polygons &infill_area_above = layer_id + 1 < infill_outlines.size() ? infill_outlines[layer_id + 1] : no_infill_area;
+                Polygons        overhang          = diff(offset(infill_outlines[layer_id], -float(m_wall_supporting_radius)), infill_area_above);
+                // Filter out unprintable polygons and near degenerated polygons (three almost collinear points and so).
+                m_overhang_per_layer[layer_id] = opening(overhang, float(SCALED_EPSILON), float(SCALED_EPSILON));
+            }
+        });
+}
 
-    // For-each layer from top to bottom:
-    for (int layer_id = int(print_object.layers().size()) - 1; layer_id >= 0; layer_id--) {
-        throw_on_cancel_callback();
-        for (const LayerRegion *layerm : print_object.get_layer(layer_id)->regions())
-            for (const Surface &surface : layerm->fill_surfaces())
-                if (surface.surface_type == stInternal || surface.surface_type == stInternalVoid)
-                    append(infill_outlines[layer_id], to_polygons(surface.expolygon));
+const Layer& Generator::getTreesForLayer(const size_t& layer_id) const
+{
+    assert(layer_id < m_lightning_layers.size());
+    return m_lightning_layers[layer_id];
+}
 
-        infill_outlines[layer_id] = union_(infill_outlines[layer_id]);
+void Generator::generateTrees(const std::vector<Polygons> &infill_outlines, size_t top_layer_id, const Generator *previous, const std::function<void()> &throw_on_cancel_callback)
+{
+    const size_t num_layers = infill_outlines.size();
+    m_lightning_layers.assign(num_layers, Layer());
+    m_locator_bboxes.assign(num_layers, BoundingBox());
+    if (num_layers == 0)
+        return;
+
+    // The trees above top_layer_id are shared with the previous generator. They are not modified anymore,
+    // they are only deep copied when propagating them to the layer below.
+    for (size_t layer_id = top_layer_id + 1; layer_id < num_layers; ++ layer_id) {
+        m_lightning_layers[layer_id] = previous->m_lightning_layers[layer_id];
+        m_locator_bboxes[layer_id]   = previous->m_locator_bboxes[layer_id];
     }
 
     // For various operations its beneficial to quickly locate nearby features on the polygon:
-    const size_t top_layer_id = print_object.layers().size() - 1;
-    EdgeGrid::Grid outlines_locator(get_extents(infill_outlines[top_layer_id]).inflated(SCALED_EPSILON));
-    outlines_locator.create(infill_outlines[top_layer_id], locator_cell_size);
+    EdgeGrid::Grid outlines_locator;
 
     // For-each layer from top to bottom:
     for (int layer_id = int(top_layer_id); layer_id >= 0; layer_id--) {
@@ -112,30 +175,28 @@ void Generator::generateTrees(const PrintObject &print_object, const std::functi
         const Polygons    &current_outlines        = infill_outlines[layer_id];
         const BoundingBox &current_outlines_bbox   = get_extents(current_outlines);
 
-        // register all trees propagated from the previous layer as to-be-reconnected
-        std::vector<NodeSPtr> to_be_reconnected_tree_roots = current_lightning_layer.tree_roots;
-
-        current_lightning_layer.generateNewTrees(m_overhang_per_layer[layer_id], current_outlines, current_outlines_bbox, outlines_locator, m_supporting_radius, m_wall_supporting_radius, throw_on_cancel_callback);
-        current_lightning_layer.reconnectRoots(to_be_reconnected_tree_roots, current_outlines, current_outlines_bbox, outlines_locator, m_supporting_radius, m_wall_supporting_radius);
-
-        // Initialize trees for next lower layer from the current one.
-        if (layer_id == 0)
-            return;
+        if (layer_id + 1 == int(num_layers)) {
+            outlines_locator.set_bbox(get_extents(current_outlines).inflated(SCALED_EPSILON));
+            outlines_locator.create(current_outlines, locator_cell_size);
+        } else {
+            // Initialize trees for this layer from the layer above.
+            const Layer &above_lightning_layer = m_lightning_layers[layer_id + 1];
+            BoundingBox  outlines_bbox         = get_extents(current_outlines).inflated(SCALED_EPSILON);
+            if (const BoundingBox &above_locator_bbox = m_locator_bboxes[layer_id + 1]; above_locator_bbox.defined)
+                outlines_bbox.merge(above_locator_bbox);
 
-        const Polygons &below_outlines      = infill_outlines[layer_id - 1];
-        BoundingBox     below_outlines_bbox = get_extents(below_outlines).inflated(SCALED_EPSILON);
-        if (const BoundingBox &outlines_locator_bbox = outlines_locator.bbox(); outlines_locator_bbox.defined)
-            below_outlines_bbox.merge(outlines_locator_bbox);
+            if (!above_lightning_layer.tree_roots.empty())
+                outlines_bbox.merge(get_extents(above_lightning_layer.tree_roots).inflated(SCALED_EPSILON));
 
-        if (!current_lightning_layer.tree_roots.empty())
-            below_outlines_bbox.merge(get_extents(current_lightning_layer.tree_roots).inflated(SCALED_EPSILON));
+            outlines_locator.set_bbox(outlines_bbox);
+            outlines_locator.create(current_outlines, locator_cell_size);
 
-        outlines_locator.set_bbox(below_outlines_bbox);
-        outlines_locator.create(below_outlines, locator_cell_size);
+            for (auto& tree : above_lightning_layer.tree_roots)
+                tree->propagateToNextLayer(current_lightning_layer.tree_roots, current_outlines, outlines_locator, m_prune_length, m_straightening_max_distance, locator_cell_size / 2);
+        }
+        m_locator_bboxes[layer_id] = outlines_locator.bbox();
 
-        std::vector<NodeSPtr>& lower_trees = m_lightning_layers[layer_id - 1].tree_roots;
-        for (auto& tree : current_lightning_layer.tree_roots)
-            tree->propagateToNextLayer(lower_trees, below_outlines, outlines_locator, m_prune_length, m_straightening_max_distance, locator_cell_size / 2);
+        current_lightning_layer.generateNewTreesAndReconnectRoots(m_overhang_per_layer[layer_id], current_outlines, current_outlines_bbox, outlines_locator, m_supporting_radius, m_wall_supporting_radius, throw_on_cancel_callback);
     }
 }
 
@@ -43,8 +43,15 @@ public:
      * This generator will pre-compute things in preparation of generating
      * Lightning Infill for the infill areas in that mesh. The infill areas must
      * already be calculated at this point.
+     *
+     * The trees are propagated from the top layer down, thus the trees of the
+     * layers above the topmost layer with changed infill areas stay the same.
+     * If the generator of a previous run over the same object is passed, the
+     * trees of these layers are taken over from it and only the layers below
+     * are regenerated.
      */
-    explicit Generator(const PrintObject &print_object, const coordf_t fill_density, const std::function<void()> &throw_on_cancel_callback);
+    explicit Generator(const PrintObject &print_object, const coordf_t fill_density, const std::function<void()> &throw_on_cancel_callback,
+                       const Generator *previous = nullptr);
 
     /*!
      * Get a tree of paths generated for a certain layer of the mesh.
@@ -59,7 +66,25 @@ public:
 
     float infilll_extrusion_width() const { return m_infill_extrusion_width; }
 
+    /*!
+     * Number of the top layers, whose trees were taken over from the previous
+     * generator passed to the constructor.
+     */
+    size_t numReusedLayers() const { return m_num_reused_layers; }
+
 protected:
+    /*!
+     * Collect the sparse infill areas of all layers and hash them into
+     * \ref m_infill_outlines_hashes.
+     */
+    std::vector<Polygons> collectInfillOutlines(const PrintObject &print_object, const std::function<void()> &throw_on_cancel_callback);
+
+    /*!
+     * Count the top layers, whose trees are the same as in the previous
+     * generator, because neither their infill areas nor the parameters changed.
+     */
+    size_t numLayersToReuse(const Generator *previous) const;
+
     /*!
      * Calculate the overhangs above the infill areas that need to be supported
      * by infill.
@@ -67,13 +92,15 @@ protected:
      * Normally, overhangs are only generated for the outside of the model and
      * only when support is generated. For this pattern, we also need to
      * generate overhang areas for the inside of the model.
+     * Only the layers up to \p top_layer_id are calculated.
      */
-    void generateInitialInternalOverhangs(const PrintObject &print_object, const std::function<void()> &throw_on_cancel_callback);
+    void generateInitialInternalOverhangs(const std::vector<Polygons> &infill_outlines, size_t top_layer_id, const std::function<void()> &throw_on_cancel_callback);
 
     /*!
-     * Calculate the tree structure of all layers.
+     * Calculate the tree structure of the layers up to \p top_layer_id,
+     * the trees of the layers above are taken over from \p previous.
      */
-    void generateTrees(const PrintObject &print_object, const std::function<void()> &throw_on_cancel_callback);
+    void generateTrees(const std::vector<Polygons> &infill_outlines, size_t top_layer_id, const Generator *previous, const std::function<void()> &throw_on_cancel_callback);
 
     float m_infill_extrusion_width;
 
@@ -123,6 +150,25 @@ protected:
      * This is generated by \ref generateTrees.
      */
     std::vector<Layer> m_lightning_layers;
+
+    /*!
+     * For each layer, hash of its infill areas, the only per layer input of
+     * \ref generateInitialInternalOverhangs and \ref generateTrees.
+     */
+    std::vector<size_t> m_infill_outlines_hashes;
+
+    /*!
+     * For each layer, the bounding box of the outlines locator. The locator
+     * bounding box accumulates from the top layer down, it is needed to resume
+     * \ref generateTrees in the middle of the object.
+     */
+    std::vector<BoundingBox> m_locator_bboxes;
+
+    /*!
+     * Number of the top layers taken over from the previous generator, see
+     * \ref numLayersToReuse.
+     */
+    size_t m_num_reused_layers { 0 };
 };
 
 } // namespace FillLightning
@@ -11,8 +11,13 @@
 #include "Utils.hpp"
 
 #include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
 #include <tbb/blocked_range2d.h>
+#include <tbb/task_arena.h>
+#include <algorithm>
 #include <mutex>
+#include <numeric>
+#include <optional>
 
 namespace Slic3r::FillLightning {
 
@@ -55,6 +60,21 @@ void Layer::generateNewTrees
     DistanceField distance_field(supporting_radius, current_outlines, current_outlines_bbox, current_overhang);
     throw_on_cancel_callback();
 
+    this->generateNewTrees(distance_field, current_outlines, current_outlines_bbox, outlines_locator, supporting_radius, wall_supporting_radius, throw_on_cancel_callback);
+}
+
+void Layer::generateNewTrees
+(
+    DistanceField& distance_field,
+    const Polygons& current_outlines,
+    const BoundingBox& current_outlines_bbox,
+    const EdgeGrid::Grid& outlines_locator,
+    const coord_t supporting_radius,
+    const coord_t wall_supporting_radius,
+    const std::function<void()> &throw_on_cancel_callback,
+    std::vector<std::pair<size_t, NodeSPtr>> *out_new_roots
+)
+{
     SparseNodeGrid tree_node_locator;
     fillLocator(tree_node_locator, current_outlines_bbox);
 
@@ -69,7 +89,8 @@ void Layer::generateNewTrees
 
         NodeSPtr new_parent;
         NodeSPtr new_child;
-        this->attach(unsupported_location, grounding_loc, new_child, new_parent);
+        if (this->attach(unsupported_location, grounding_loc, new_child, new_parent) && out_new_roots)
+            out_new_roots->emplace_back(unsupported_cell_idx, new_parent);
         tree_node_locator.insert(std::make_pair(to_grid_point(new_child->getLocation(), current_outlines_bbox), new_child));
         if (new_parent)
             tree_node_locator.insert(std::make_pair(to_grid_point(new_parent->getLocation(), current_outlines_bbox), new_parent));
@@ -224,7 +245,8 @@ void Layer::reconnectRoots
     const BoundingBox& current_outlines_bbox,
     const EdgeGrid::Grid& outline_locator,
     const coord_t supporting_radius,
-    const coord_t wall_supporting_radius
+    const coord_t wall_supporting_radius,
+    std::vector<NodeSPtr> *out_reconnected_roots
 )
 {
     constexpr coord_t tree_connecting_ignore_offset = 100;
@@ -232,9 +254,13 @@ void Layer::reconnectRoots
     SparseNodeGrid tree_node_locator;
     fillLocator(tree_node_locator, current_outlines_bbox);
 
+    if (out_reconnected_roots)
+        out_reconnected_roots->assign(to_be_reconnected_tree_roots.begin(), to_be_reconnected_tree_roots.end());
+
     const coord_t within_max_dist = outline_locator.resolution() * 2;
-    for (const auto &root_ptr : to_be_reconnected_tree_roots)
+    for (size_t root_idx = 0; root_idx < to_be_reconnected_tree_roots.size(); ++ root_idx)
     {
+        const NodeSPtr &root_ptr = to_be_reconnected_tree_roots[root_idx];
         auto old_root_it = std::find(tree_roots.begin(), tree_roots.end(), root_ptr);
 
         if (root_ptr->getLastGroundingLocation())
@@ -251,6 +277,8 @@ void Layer::reconnectRoots
 
                     tree_node_locator.insert(std::make_pair(to_grid_point(new_root->getLocation(), current_outlines_bbox), new_root));
 
+                    if (out_reconnected_roots)
+                        (*out_reconnected_roots)[root_idx] = new_root;
                     *old_root_it = std::move(new_root); // replace old root with new root
                     continue;
                 }
@@ -282,6 +310,8 @@ void Layer::reconnectRoots
             new_root->addChild(attach_ptr);
             tree_node_locator.insert(std::make_pair(to_grid_point(new_root->getLocation(), current_outlines_bbox), new_root));
 
+            if (out_reconnected_roots)
+                (*out_reconnected_roots)[root_idx] = new_root;
             *old_root_it = std::move(new_root); // replace old root with new root
         }
         else
@@ -296,6 +326,233 @@ void Layer::reconnectRoots
 
             ground.tree_node->addChild(attach_ptr);
 
+            // remove old root
+            if (out_reconnected_roots)
+                (*out_reconnected_roots)[root_idx] = nullptr;
+            *old_root_it = std::move(tree_roots.back());
+            tree_roots.pop_back();
+        }
+    }
+}
+
+// Finds the bounding box containing a point among bounding boxes, which do not overlap. The bounding boxes are registered
+// into the cells of a uniform grid of about 4 cells per bounding box, thus a query tests just the few bounding boxes of a cell.
+class BoundingBoxLocator
+{
+public:
+    explicit BoundingBoxLocator(const std::vector<BoundingBox> &bboxes) : m_bboxes(bboxes)
+    {
+        if (bboxes.empty())
+            return;
+        for (const BoundingBox &bbox : bboxes)
+            m_extents.merge(bbox);
+        const Vec2d  size  = m_extents.size().cast<double>() + Vec2d(1., 1.);
+        const double cell  = std::sqrt(size.x() * size.y() / double(4 * bboxes.size()));
+        m_cell_size        = Point(std::max<coord_t>(1, coord_t(std::ceil(std::min(cell, size.x())))), std::max<coord_t>(1, coord_t(std::ceil(std::min(cell, size.y())))));
+        m_cols             = size_t(m_extents.size().x() / m_cell_size.x() + 1);
+        m_rows             = size_t(m_extents.size().y() / m_cell_size.y() + 1);
+        // Bounding boxes of the cells, in compressed row storage.
+        m_cell_starts.assign(m_cols * m_rows + 1, 0);
+        auto for_each_cell = [this](const BoundingBox &bbox, auto fn) {
+            const Point cmin = (bbox.min - m_extents.min).cwiseQuotient(m_cell_size);
+            const Point cmax = (bbox.max - m_extents.min).cwiseQuotient(m_cell_size);
+            for (coord_t row = cmin.y(); row <= cmax.y(); ++ row)
+                for (coord_t col = cmin.x(); col <= cmax.x(); ++ col)
+                    fn(size_t(row) * m_cols + size_t(col));
+        };
+        for (const BoundingBox &bbox : bboxes)
+            for_each_cell(bbox, [this](size_t cell_idx) { ++ m_cell_starts[cell_idx + 1]; });
+        std::partial_sum(m_cell_starts.begin(), m_cell_starts.end(), m_cell_starts.begin());
+        m_cell_bboxes.assign(m_cell_starts.back(), 0);
+        std::vector<size_t> cell_ends(m_cell_starts.begin(), m_cell_starts.end() - 1);
+        for (size_t idx = 0; idx < bboxes.size(); ++ idx)
+            for_each_cell(bboxes[idx], [this, &cell_ends, idx](size_t cell_idx) { m_cell_bboxes[cell_ends[cell_idx] ++] = idx; });
+    }
+
+    // Index of the bounding box containing the point. If there is none, index of the closest bounding box.
+    size_t operator()(const Point &pt) const
+    {
+        if (m_extents.contains(pt)) {
+            const Point  cell     = (pt - m_extents.min).cwiseQuotient(m_cell_size);
+            const size_t cell_idx = size_t(cell.y()) * m_cols + size_t(cell.x());
+            for (size_t i = m_cell_starts[cell_idx]; i < m_cell_starts[cell_idx + 1]; ++ i)
+                if (m_bboxes[m_cell_bboxes[i]].contains(pt))
+                    return m_cell_bboxes[i];
+        }
+        // Rare, the points are mostly inside the bounding boxes.
+        size_t closest_idx = 0;
+        double d2_min      = std::numeric_limits<double>::max();
+        for (size_t idx = 0; idx < m_bboxes.size(); ++ idx)
+            if (const double d2 = (pt.cwiseMax(m_bboxes[idx].min).cwiseMin(m_bboxes[idx].max) - pt).cast<double>().squaredNorm(); d2 < d2_min) {
+                d2_min      = d2;
+                closest_idx = idx;
+            }
+        return closest_idx;
+    }
+
+private:
+    const std::vector<BoundingBox> &m_bboxes;
+    BoundingBox                     m_extents;
+    Point                           m_cell_size;
+    size_t                          m_cols { 0 };
+    size_t                          m_rows { 0 };
+    std::vector<size_t>             m_cell_starts;
+    std::vector<size_t>             m_cell_bboxes;
+};
+
+// Merge the overlapping bounding boxes until none of them overlap, a merged bounding box takes the place of its first member.
+// The overlaps are found by a sweep along X and the overlapping bounding boxes are grouped by union-find. A merged bounding box
+// may overlap another group, thus the merged bounding boxes are swept again until a sweep merges nothing, usually once.
+static void merge_overlapping_bboxes(std::vector<BoundingBox> &bboxes)
+{
+    std::vector<size_t> parent;
+    std::vector<size_t> order;
+    std::vector<size_t> merged_idx;
+    // The root of a group is its lowest index, thus the merged bounding boxes keep the order of their first members.
+    auto find_root = [&parent](size_t idx) {
+        while (parent[idx] != idx)
+            idx = parent[idx] = parent[parent[idx]];
+        return idx;
+    };
+    for (size_t num_bboxes = 0; num_bboxes != bboxes.size();) {
+        num_bboxes = bboxes.size();
+        parent.resize(num_bboxes);
+        std::iota(parent.begin(), parent.end(), 0);
+        order.resize(num_bboxes);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&bboxes](size_t l, size_t r) { return bboxes[l].min.x() < bboxes[r].min.x(); });
+        for (size_t i = 0; i < num_bboxes; ++ i) {
+            const BoundingBox &bbox = bboxes[order[i]];
+            for (size_t j = i + 1; j < num_bboxes && bboxes[order[j]].min.x() <= bbox.max.x(); ++ j)
+                if (bbox.overlap(bboxes[order[j]]))
+                    if (size_t root = find_root(order[i]), other_root = find_root(order[j]); root != other_root)
+                        parent[std::max(root, other_root)] = std::min(root, other_root);
+        }
+        merged_idx.resize(num_bboxes);
+        size_t num_merged = 0;
+        for (size_t idx = 0; idx < num_bboxes; ++ idx)
+            if (size_t root = find_root(idx); root == idx) {
+                merged_idx[idx] = num_merged;
+                bboxes[num_merged ++] = bboxes[idx];
+            } else
+                bboxes[merged_idx[root]].merge(bboxes[idx]);
+        bboxes.resize(num_merged);
+    }
+}
+
+void Layer::generateNewTreesAndReconnectRoots
+(
+    const Polygons& current_overhang,
+    const Polygons& current_outlines,
+    const BoundingBox& current_outlines_bbox,
+    const EdgeGrid::Grid& outline_locator,
+    const coord_t supporting_radius,
+    const coord_t wall_supporting_radius,
+    const std::function<void()> &throw_on_cancel_callback
+)
+{
+    // Cluster the islands, so that the clusters do not share the unsupported points, which a branch supports,
+    // nor the cells of the tree node locator.
+    std::vector<BoundingBox> cluster_bboxes;
+    if (tbb::this_task_arena::max_concurrency() > 1) {
+        for (const ExPolygon &island : union_ex(current_outlines))
+            cluster_bboxes.emplace_back(get_extents(island.contour).inflated(supporting_radius + locator_cell_size));
+        merge_overlapping_bboxes(cluster_bboxes);
+    }
+
+    std::optional<BoundingBoxLocator> cluster_locator;
+    if (cluster_bboxes.size() > 1)
+        cluster_locator.emplace(cluster_bboxes);
+    auto cluster_of_point = [&cluster_locator](const Point &pt) { return (*cluster_locator)(pt); };
+    if (cluster_bboxes.size() > 1) {
+        // Node::realign() only cuts a branch crossing the outlines close to its parent node, thus a tree propagated from the layer above
+        // may still span several clusters. Its nodes would be missing in the tree node locators of the other clusters, which would then
+        // grow different trees than the serial processing. Process such a layer serially.
+        for (const NodeSPtr &tree : tree_roots) {
+            const size_t cluster_idx = cluster_of_point(tree->getLocation());
+            bool         single_cluster = true;
+            tree->visitNodes([&cluster_of_point, cluster_idx, &single_cluster](const NodeSPtr &node) {
+                if (single_cluster && cluster_of_point(node->getLocation()) != cluster_idx)
+                    single_cluster = false;
+            });
+            if (! single_cluster) {
+                cluster_bboxes.clear();
+                break;
+            }
+        }
+    }
+
+    // register all trees propagated from the previous layer as to-be-reconnected
+    std::vector<NodeSPtr> to_be_reconnected_tree_roots = tree_roots;
+    if (cluster_bboxes.size() < 2) {
+        generateNewTrees(current_overhang, current_outlines, current_outlines_bbox, outline_locator, supporting_radius, wall_supporting_radius, throw_on_cancel_callback);
+        reconnectRoots(to_be_reconnected_tree_roots, current_outlines, current_outlines_bbox, outline_locator, supporting_radius, wall_supporting_radius);
+        return;
+    }
+
+    const size_t num_clusters = cluster_bboxes.size();
+
+    // Distribute the outlines and the trees propagated from the previous layer to the clusters, keeping their order.
+    std::vector<Layer>                     cluster_layers(num_clusters);
+    std::vector<Polygons>                  cluster_outlines(num_clusters);
+    std::vector<std::pair<size_t, size_t>> tree_root_cluster_indices;
+    tree_root_cluster_indices.reserve(tree_roots.size());
+    for (const NodeSPtr &tree : tree_roots) {
+        Layer &cluster_layer = cluster_layers[cluster_of_point(tree->getLocation())];
+        tree_root_cluster_indices.emplace_back(&cluster_layer - cluster_layers.data(), cluster_layer.tree_roots.size());
+        cluster_layer.tree_roots.emplace_back(tree);
+    }
+    for (const Polygon &outline : current_outlines)
+        if (! outline.empty())
+            cluster_outlines[cluster_of_point(outline.front())].emplace_back(outline);
+
+    // The distance field of the whole layer orders the unsupported points of all the clusters.
+    std::vector<std::vector<size_t>> cluster_point_indices;
+    std::vector<DistanceField>       cluster_distance_fields = DistanceField(supporting_radius, current_outlines, current_outlines_bbox, current_overhang)
+        .split(cluster_bboxes, cluster_of_point, cluster_point_indices);
+    throw_on_cancel_callback();
+
+    // The outline locator is shared, it is only queried for collisions with all the outlines of the layer.
+    std::vector<std::vector<std::pair<size_t, NodeSPtr>>> cluster_new_roots(num_clusters);
+    std::vector<std::vector<NodeSPtr>>                    cluster_reconnected_roots(num_clusters);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_clusters, 1), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t cluster_idx = range.begin(); cluster_idx < range.end(); ++ cluster_idx) {
+            throw_on_cancel_callback();
+            // Move the origin of the tree node locator by whole cells of the tree node locator of the layer.
+            BoundingBox tree_node_locator_bbox = cluster_bboxes[cluster_idx];
+            tree_node_locator_bbox.min = current_outlines_bbox.min +
+                (tree_node_locator_bbox.min.cwiseMax(current_outlines_bbox.min) - current_outlines_bbox.min) / locator_cell_size * locator_cell_size;
+            Layer                &cluster_layer = cluster_layers[cluster_idx];
+            std::vector<NodeSPtr> cluster_to_be_reconnected_tree_roots = cluster_layer.tree_roots;
+            cluster_layer.generateNewTrees(cluster_distance_fields[cluster_idx], cluster_outlines[cluster_idx], tree_node_locator_bbox, outline_locator,
+                supporting_radius, wall_supporting_radius, throw_on_cancel_callback, &cluster_new_roots[cluster_idx]);
+            cluster_layer.reconnectRoots(cluster_to_be_reconnected_tree_roots, cluster_outlines[cluster_idx], tree_node_locator_bbox, outline_locator,
+                supporting_radius, wall_supporting_radius, &cluster_reconnected_roots[cluster_idx]);
+        }
+    });
+
+    // Replay the changes of the roots in the order of the serial processing: New roots are added in the order of the unsupported
+    // points of the layer, then the trees propagated from the previous layer are reconnected in their order.
+    std::vector<std::pair<size_t, NodeSPtr>> new_roots;
+    for (size_t cluster_idx = 0; cluster_idx < num_clusters; ++ cluster_idx)
+        for (std::pair<size_t, NodeSPtr> &new_root : cluster_new_roots[cluster_idx])
+            new_roots.emplace_back(cluster_point_indices[cluster_idx][new_root.first], std::move(new_root.second));
+    std::sort(new_roots.begin(), new_roots.end(), [](const auto &l, const auto &r) { return l.first < r.first; });
+    tree_roots.reserve(tree_roots.size() + new_roots.size());
+    for (std::pair<size_t, NodeSPtr> &new_root : new_roots)
+        tree_roots.emplace_back(std::move(new_root.second));
+
+    for (size_t root_idx = 0; root_idx < to_be_reconnected_tree_roots.size(); ++ root_idx) {
+        const NodeSPtr &root_ptr      = to_be_reconnected_tree_roots[root_idx];
+        const auto     [cluster_idx, cluster_root_idx] = tree_root_cluster_indices[root_idx];
+        NodeSPtr       &reconnected   = cluster_reconnected_roots[cluster_idx][cluster_root_idx];
+        if (reconnected == root_ptr)
+            continue;
+        auto old_root_it = std::find(tree_roots.begin(), tree_roots.end(), root_ptr);
+        if (reconnected) {
+            // replace old root with new root
+            *old_root_it = std::move(reconnected);
+        } else {
             // remove old root
             *old_root_it = std::move(tree_roots.back());
             tree_roots.pop_back();
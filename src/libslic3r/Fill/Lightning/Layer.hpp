@@ -16,6 +16,7 @@
 namespace Slic3r::FillLightning
 {
 
+class DistanceField;
 class Node;
 using NodeSPtr = std::shared_ptr<Node>;
 using SparseNodeGrid = std::unordered_multimap<Point, std::weak_ptr<Node>, PointHash>;
@@ -48,6 +49,26 @@ public:
         const std::function<void()> &throw_on_cancel_callback
     );
 
+    /*!
+     * Generate the new trees supporting the unsupported points of a prepared
+     * distance field, see \ref generateNewTrees.
+     * \param tree_node_locator_bbox Bounding box, to which the cells of the
+     * tree node locator are aligned.
+     * \param[out] out_new_roots If not null, the new roots with the indices of
+     * the unsupported points they were created for.
+     */
+    void generateNewTrees
+    (
+        DistanceField& distance_field,
+        const Polygons& current_outlines,
+        const BoundingBox& tree_node_locator_bbox,
+        const EdgeGrid::Grid& outline_locator,
+        coord_t supporting_radius,
+        coord_t wall_supporting_radius,
+        const std::function<void()> &throw_on_cancel_callback,
+        std::vector<std::pair<size_t, NodeSPtr>> *out_new_roots = nullptr
+    );
+
     /*! Determine & connect to connection point in tree/outline.
      * \param min_dist_from_boundary_for_tree If the unsupported point is closer to the boundary than this then don't consider connecting it to a tree
      */
@@ -70,6 +91,11 @@ public:
      */
     bool attach(const Point& unsupported_location, const GroundingLocation& ground, NodeSPtr& new_child, NodeSPtr& new_root);
 
+    /*!
+     * \param[out] out_reconnected_roots If not null, for each of the
+     * \p to_be_reconnected_tree_roots the root it was replaced with, or null
+     * if it was connected to another tree.
+     */
     void reconnectRoots
     (
         std::vector<NodeSPtr>& to_be_reconnected_tree_roots,
@@ -77,7 +103,33 @@ public:
         const BoundingBox& current_outlines_bbox,
         const EdgeGrid::Grid& outline_locator,
         coord_t supporting_radius,
-        coord_t wall_supporting_radius
+        coord_t wall_supporting_radius,
+        std::vector<NodeSPtr> *out_reconnected_roots = nullptr
+    );
+
+    /*!
+     * Generate the new trees and reconnect the trees propagated from the layer
+     * above, see \ref generateNewTrees and \ref reconnectRoots.
+     *
+     * Clusters of islands of the infill area, which are further apart than the
+     * supporting radius, are processed in parallel. A tree of one island never
+     * connects to a tree or to the outline of another island, as the connecting
+     * line would cross the outlines separating them. The distance field of the
+     * layer is split into the clusters and each cluster has its own tree node
+     * locator aligned to the cells of the layer, thus the trees and their
+     * order are the same as if the layer was processed serially. If a tree
+     * propagated from the layer above spans several clusters, the layer is
+     * processed serially.
+     */
+    void generateNewTreesAndReconnectRoots
+    (
+        const Polygons& current_overhang,
+        const Polygons& current_outlines,
+        const BoundingBox& current_outlines_bbox,
+        const EdgeGrid::Grid& outline_locator,
+        coord_t supporting_radius,
+        coord_t wall_supporting_radius,
+        const std::function<void()> &throw_on_cancel_callback
     );
 
     Polylines convertToLines(const Polygons& limit_to_outline, coord_t line_overlap) const;
@@ -15,6 +15,7 @@
 #include "ShortestPath.hpp"
 #include "Print.hpp"
 #include "Thread.hpp"
+#include "Trace.hpp"
 #include "Utils.hpp"
 #include "ClipperUtils.hpp"
 #include "libslic3r.h"
@@ -22,6 +23,7 @@
 #include "libslic3r/format.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <chrono>
 #include <math.h>
@@ -41,6 +43,7 @@
 #include "SVG.hpp"
 
 #include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 
 // Intel redesigned some TBB interface considerably when merging TBB with their oneAPI set of libraries, see GH #7332.
 // We are using quite an old TBB 2017 U7. Before we update our build servers, let's use the old API, which is deprecated in up to date TBB.
@@ -812,6 +815,7 @@ void GCode::do_export(Print* print, const char* path, GCodeProcessorResult* resu
 
     // Enabled and either not done, or marked as done while the output file is missing.
     print->set_started(psGCodeExport);
+    SLIC3R_TRACE_SCOPE("GCode", "do_export");
 
     // check if any custom gcode contains keywords used by the gcode processor to
     // produce time estimation and gcode toolpaths
@@ -875,7 +879,10 @@ void GCode::do_export(Print* print, const char* path, GCodeProcessorResult* resu
 
     BOOST_LOG_TRIVIAL(debug) << "Start processing gcode, " << log_memory_info();
     // Post-process the G-code to update time stamps.
-    m_processor.finalize(true);
+    {
+        SLIC3R_TRACE_SCOPE("GCode", "GCodeProcessor::finalize");
+        m_processor.finalize(true);
+    }
 //    DoExport::update_print_estimated_times_stats(m_processor, print->m_print_statistics);
     DoExport::update_print_estimated_stats(m_processor, m_writer.extruders(), print->m_print_statistics);
     if (result != nullptr) {
@@ -1255,6 +1262,13 @@ void GCode::_do_export(Print& print, GCodeOutputStream &file, ThumbnailsGenerato
     }
     print.throw_if_canceled();
 
+    // The color changes and pauses are emitted by process_layer() for a non-sequential print only.
+    m_processor.set_printer_stops_count(print.config().complete_objects.value ? 0 :
+        std::count_if(tool_ordering.layer_tools().begin(), tool_ordering.layer_tools().end(), [](const LayerTools &layer_tools) {
+            return layer_tools.custom_gcode != nullptr && (layer_tools.custom_gcode->type == CustomGCode::ColorChange ||
+                layer_tools.custom_gcode->type == CustomGCode::ToolChange || layer_tools.custom_gcode->type == CustomGCode::PausePrint);
+        }));
+
     m_cooling_buffer = make_unique<CoolingBuffer>(*this);
     m_cooling_buffer->set_current_extruder(initial_extruder_id);
 
@@ -1486,6 +1500,9 @@ void GCode::_do_export(Print& print, GCodeOutputStream &file, ThumbnailsGenerato
 
     print.throw_if_canceled();
 
+    // The filament stats and the placeholders below are replaced by GCodeProcessor::post_process().
+    m_processor.begin_footer();
+
     // Get filament stats.
     file.write(DoExport::update_print_stats_and_format_filament_stats(
     	// Const inputs
@@ -1515,6 +1532,57 @@ void GCode::_do_export(Print& print, GCodeOutputStream &file, ThumbnailsGenerato
     print.throw_if_canceled();
 }
 
+namespace ProcessLayers {
+
+#if TBB_VERSION_MAJOR >= 2021
+    template<typename InputType, typename OutputType>
+    using Filter = tbb::filter<InputType, OutputType>;
+#else
+    template<typename InputType, typename OutputType>
+    using Filter = tbb::filter_t<InputType, OutputType>;
+#endif
+
+    // Wall time spent by the worker threads inside a single stage of the process_layers() pipeline.
+    // Summed over all threads, thus for a parallel stage the time may exceed the wall time of the whole pipeline.
+    struct StageTiming {
+        explicit StageTiming(const char *name) : name(name) {}
+
+        const char                       *name;
+        std::atomic<int64_t>              time_ns { 0 };
+        std::atomic<size_t>               calls { 0 };
+    };
+
+    // Wraps a filter body to accumulate its run time into timing.
+    template<typename InputType, typename OutputType, typename Body>
+    Filter<InputType, OutputType> make_timed_filter(slic3r_tbb_filtermode mode, StageTiming &timing, Body body)
+    {
+        return tbb::make_filter<InputType, OutputType>(mode, [&timing, body](auto&&... args) -> OutputType {
+            struct Measure {
+                StageTiming                                   &timing;
+                std::chrono::steady_clock::time_point          start { std::chrono::steady_clock::now() };
+                ~Measure() {
+                    timing.time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                    ++ timing.calls;
+                }
+            } measure { timing };
+            Trace::Scope trace("process_layers", timing.name);
+            return body(std::forward<decltype(args)>(args)...);
+        });
+    }
+
+    // Number of layers being processed by the pipeline at the same time.
+    // Two layers per thread keep all the threads busy while the serial stages wait for each other,
+    // while the memory_limit bounds the G-code of the layers in flight, layer_bytes being the largest layer seen so far.
+    size_t max_tokens(size_t threads, size_t memory_limit, size_t layer_bytes)
+    {
+        size_t tokens = std::max<size_t>(2 * threads, 2);
+        if (memory_limit > 0 && layer_bytes > 0)
+            tokens = std::clamp<size_t>(memory_limit / layer_bytes, 1, tokens);
+        return tokens;
+    }
+
+} // namespace ProcessLayers
+
 // Process all layers of all objects (non-sequential mode) with a parallel pipeline:
 // Generate G-code, run the filters (vase mode, cooling buffer), run the G-code analyser
 // and export G-code into file.
@@ -1525,79 +1593,15 @@ void GCode::process_layers(
     const std::vector<std::pair<coordf_t, ObjectsLayerToPrint>>         &layers_to_print,
     GCodeOutputStream                                                   &output_stream)
 {
-    // The pipeline is variable: The vase mode filter is optional.
-    size_t layer_to_print_idx = 0;
-    const auto generator = tbb::make_filter<void, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> LayerResult {
-            if (layer_to_print_idx >= layers_to_print.size()) {
-                if ((!m_pressure_equalizer && layer_to_print_idx == layers_to_print.size()) || (m_pressure_equalizer && layer_to_print_idx == (layers_to_print.size() + 1))) {
-                    fc.stop();
-                    return {};
-                } else {
-                    // Pressure equalizer need insert empty input. Because it returns one layer back.
-                    // Insert NOP (no operation) layer;
-                    ++layer_to_print_idx;
-                    return LayerResult::make_nop_layer_result();
-                }
-            } else {
-                const std::pair<coordf_t, ObjectsLayerToPrint> &layer = layers_to_print[layer_to_print_idx++];
-                const LayerTools& layer_tools = tool_ordering.tools_for_layer(layer.first);
-                if (m_wipe_tower && layer_tools.has_wipe_tower)
-                    m_wipe_tower->next_layer();
-                print.throw_if_canceled();
-                return this->process_layer(print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, size_t(-1));
-            }
-        });
-    const auto spiral_vase = tbb::make_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [spiral_vase = this->m_spiral_vase.get()](LayerResult in) -> LayerResult {
-            if (in.nop_layer_result)
-                return in;
-
-            spiral_vase->enable(in.spiral_vase_enable);
-            return { spiral_vase->process_layer(std::move(in.gcode)), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush};
-        });
-    const auto pressure_equalizer = tbb::make_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [pressure_equalizer = this->m_pressure_equalizer.get()](LayerResult in) -> LayerResult {
-            return pressure_equalizer->process_layer(std::move(in));
-        });
-    const auto cooling = tbb::make_filter<LayerResult, std::string>(slic3r_tbb_filtermode::serial_in_order,
-        [cooling_buffer = this->m_cooling_buffer.get()](LayerResult in) -> std::string {
-             if (in.nop_layer_result)
-                return in.gcode;
-
-             return cooling_buffer->process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush);
-        });
-    const auto find_replace = tbb::make_filter<std::string, std::string>(slic3r_tbb_filtermode::serial_in_order,
-        [find_replace = this->m_find_replace.get()](std::string s) -> std::string {
-            return find_replace->process_layer(std::move(s));
-        });
-    const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-        [&output_stream](std::string s) { output_stream.write(s); }
-    );
-
-    // It registers a handler that sets locales to "C" before any TBB thread starts participating in tbb::parallel_pipeline.
-    // Handler is unregistered when the destructor is called.
-    TBBLocalesSetter locales_setter;
-
-    // The pipeline elements are joined using const references, thus no copying is performed.
-    output_stream.find_replace_supress();
-    if (m_spiral_vase && m_find_replace && m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator & spiral_vase & pressure_equalizer & cooling & find_replace & output);
-    else if (m_spiral_vase && m_find_replace)
-        tbb::parallel_pipeline(12, generator & spiral_vase &                      cooling & find_replace & output);
-    else if (m_spiral_vase && m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator & spiral_vase & pressure_equalizer & cooling &                output);
-    else if (m_find_replace && m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator &               pressure_equalizer & cooling & find_replace & output);
-    else if (m_spiral_vase)
-        tbb::parallel_pipeline(12, generator & spiral_vase &                      cooling &                output);
-    else if (m_find_replace)
-        tbb::parallel_pipeline(12, generator &                                    cooling & find_replace & output);
-    else if (m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator &               pressure_equalizer & cooling &                output);
-    else
-        tbb::parallel_pipeline(12, generator &                                    cooling &                output);
-    output_stream.find_replace_enable();
+    this->run_process_layers_pipeline(print, layers_to_print.size(),
+        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print](size_t layer_to_print_idx) -> LayerResult {
+            const std::pair<coordf_t, ObjectsLayerToPrint> &layer = layers_to_print[layer_to_print_idx];
+            const LayerTools& layer_tools = tool_ordering.tools_for_layer(layer.first);
+            if (m_wipe_tower && layer_tools.has_wipe_tower)
+                m_wipe_tower->next_layer();
+            return this->process_layer(print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, size_t(-1));
+        },
+        output_stream);
 }
 
 // Process all layers of a single object instance (sequential mode) with a parallel pipeline:
@@ -1610,74 +1614,132 @@ void GCode::process_layers(
     const size_t                             single_object_idx,
     GCodeOutputStream                       &output_stream)
 {
-    // The pipeline is variable: The vase mode filter is optional.
+    this->run_process_layers_pipeline(print, layers_to_print.size(),
+        [this, &print, &tool_ordering, &layers_to_print, single_object_idx](size_t layer_to_print_idx) -> LayerResult {
+            ObjectLayerToPrint &layer = layers_to_print[layer_to_print_idx];
+            return this->process_layer(print, { std::move(layer) }, tool_ordering.tools_for_layer(layer.print_z()), &layer == &layers_to_print.back(), nullptr, single_object_idx);
+        },
+        output_stream);
+}
+
+void GCode::run_process_layers_pipeline(
+    const Print                                     &print,
+    const size_t                                     num_layers,
+    const std::function<LayerResult(size_t)>        &generate_layer,
+    GCodeOutputStream                               &output_stream)
+{
+    using namespace ProcessLayers;
+
+    // Pressure equalizer returns one layer back, thus a NOP (no operation) layer is inserted at the end to flush it.
+    const size_t num_results  = num_layers + (m_pressure_equalizer ? 1 : 0);
+    // The threads config option is not exposed to the user, the TBB arena knows about any concurrency limit set on it.
+    const size_t threads      = size_t(std::max(1, tbb::this_task_arena::max_concurrency()));
+    const size_t memory_limit = size_t(std::max(0, m_config.gcode_export_memory_limit.value)) << 20;
+
+    StageTiming timing_generator("generator"), timing_spiral_vase("spiral_vase"), timing_pressure_equalizer("pressure_equalizer"),
+                timing_cooling_prepare("cooling_prepare"), timing_cooling("cooling"), timing_find_replace("find_replace"), timing_output("output");
+    // Largest memory held by a single layer in flight, used to estimate the number of tokens fitting into memory_limit.
+    std::atomic<size_t> layer_bytes_max { 0 };
+
+    // The pipeline is run in rounds of round_end - layer_to_print_idx layers, so that its number of tokens could be adjusted
+    // to the size of the layers seen. Without a memory limit the whole print is processed in a single round.
     size_t layer_to_print_idx = 0;
-    const auto generator = tbb::make_filter<void, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &layers_to_print, &layer_to_print_idx, single_object_idx](tbb::flow_control& fc) -> LayerResult {
-            if (layer_to_print_idx >= layers_to_print.size()) {
-                if ((!m_pressure_equalizer && layer_to_print_idx == layers_to_print.size()) || (m_pressure_equalizer && layer_to_print_idx == (layers_to_print.size() + 1))) {
-                    fc.stop();
-                    return {};
-                } else {
-                    // Pressure equalizer need insert empty input. Because it returns one layer back.
-                    // Insert NOP (no operation) layer;
-                    ++layer_to_print_idx;
-                    return LayerResult::make_nop_layer_result();
-                }
-            } else {
-                ObjectLayerToPrint &layer = layers_to_print[layer_to_print_idx ++];
-                print.throw_if_canceled();
-                return this->process_layer(print, { std::move(layer) }, tool_ordering.tools_for_layer(layer.print_z()), &layer == &layers_to_print.back(), nullptr, single_object_idx);
+    size_t round_end          = 0;
+    const auto generator = make_timed_filter<void, LayerResult>(slic3r_tbb_filtermode::serial_in_order, timing_generator,
+        [&print, &generate_layer, &layer_to_print_idx, &round_end, num_layers](tbb::flow_control& fc) -> LayerResult {
+            if (layer_to_print_idx == round_end) {
+                fc.stop();
+                return {};
+            }
+            if (layer_to_print_idx >= num_layers) {
+                // Pressure equalizer need insert empty input. Because it returns one layer back.
+                // Insert NOP (no operation) layer;
+                ++ layer_to_print_idx;
+                return LayerResult::make_nop_layer_result();
             }
+            print.throw_if_canceled();
+            return generate_layer(layer_to_print_idx ++);
         });
-    const auto spiral_vase = tbb::make_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [spiral_vase = this->m_spiral_vase.get()](LayerResult in)->LayerResult {
+    const auto spiral_vase = make_timed_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::serial_in_order, timing_spiral_vase,
+        [spiral_vase = this->m_spiral_vase.get()](LayerResult in) -> LayerResult {
             if (in.nop_layer_result)
                 return in;
+
             spiral_vase->enable(in.spiral_vase_enable);
-            return { spiral_vase->process_layer(std::move(in.gcode)), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush };
+            return { spiral_vase->process_layer(std::move(in.gcode)), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush};
         });
-    const auto pressure_equalizer = tbb::make_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
+    const auto pressure_equalizer = make_timed_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::serial_in_order, timing_pressure_equalizer,
         [pressure_equalizer = this->m_pressure_equalizer.get()](LayerResult in) -> LayerResult {
-             return pressure_equalizer->process_layer(std::move(in));
+            return pressure_equalizer->process_layer(std::move(in));
         });
-    const auto cooling = tbb::make_filter<LayerResult, std::string>(slic3r_tbb_filtermode::serial_in_order,
-        [cooling_buffer = this->m_cooling_buffer.get()](LayerResult in)->std::string {
-            if (in.nop_layer_result)
-                return in.gcode;
-            return cooling_buffer->process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush);
+    // Parsing of the G-code lines by the cooling buffer does not depend on the previous layers, run it in parallel.
+    const auto cooling_prepare = make_timed_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::parallel, timing_cooling_prepare,
+        [cooling_buffer = this->m_cooling_buffer.get(), &layer_bytes_max](LayerResult in) -> LayerResult {
+            if (! in.nop_layer_result) {
+                in.cooling_prepared = cooling_buffer->prepare_layer(in.gcode);
+                // The layer G-code is held twice until the output: On the input and on the output of the cooling buffer.
+                size_t bytes = 2 * in.gcode.capacity() + in.cooling_prepared.lines.capacity() * sizeof(CoolingPreparedLine);
+                for (size_t max = layer_bytes_max; bytes > max && ! layer_bytes_max.compare_exchange_weak(max, bytes););
+            }
+            return in;
         });
-    const auto find_replace = tbb::make_filter<std::string, std::string>(slic3r_tbb_filtermode::serial_in_order,
+    const auto cooling = make_timed_filter<LayerResult, std::string>(slic3r_tbb_filtermode::serial_in_order, timing_cooling,
+        [cooling_buffer = this->m_cooling_buffer.get()](LayerResult in) -> std::string {
+             if (in.nop_layer_result)
+                return std::move(in.gcode);
+
+             return cooling_buffer->process_layer(std::move(in.gcode), std::move(in.cooling_prepared), in.layer_id, in.cooling_buffer_flush);
+        });
+    // Find / replace works on a single layer only, run it in parallel.
+    const auto find_replace = make_timed_filter<std::string, std::string>(slic3r_tbb_filtermode::parallel, timing_find_replace,
         [find_replace = this->m_find_replace.get()](std::string s) -> std::string {
             return find_replace->process_layer(std::move(s));
         });
-    const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-        [&output_stream](std::string s) { output_stream.write(s); }
+    const auto output = make_timed_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order, timing_output,
+        [&output_stream, &buffer_pool = m_layer_buffer_pool](std::string s) { output_stream.write(s); buffer_pool.release(std::move(s)); }
     );
 
+    // Compose the pipeline of the enabled filters only.
+    // The pipeline elements are joined using const references, thus no copying is performed.
+    Filter<void, LayerResult> layers = generator;
+    if (m_spiral_vase)
+        layers = layers & spiral_vase;
+    if (m_pressure_equalizer)
+        layers = layers & pressure_equalizer;
+    Filter<void, std::string> gcode = layers & cooling_prepare & cooling;
+    if (m_find_replace)
+        gcode = gcode & find_replace;
+    const Filter<void, void> pipeline = gcode & output;
+
     // It registers a handler that sets locales to "C" before any TBB thread starts participating in tbb::parallel_pipeline.
     // Handler is unregistered when the destructor is called.
     TBBLocalesSetter locales_setter;
 
-    // The pipeline elements are joined using const references, thus no copying is performed.
+    const auto   time_start  = std::chrono::steady_clock::now();
+    const size_t tokens_max  = max_tokens(threads, 0, 0);
+    size_t       tokens_used = 0;
     output_stream.find_replace_supress();
-    if (m_spiral_vase && m_find_replace && m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator & spiral_vase & pressure_equalizer & cooling & find_replace & output);
-    else if (m_spiral_vase && m_find_replace)
-        tbb::parallel_pipeline(12, generator & spiral_vase &                      cooling & find_replace & output);
-    else if (m_spiral_vase && m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator & spiral_vase & pressure_equalizer & cooling &                output);
-    else if (m_find_replace && m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator &               pressure_equalizer & cooling & find_replace & output);
-    else if (m_spiral_vase)
-        tbb::parallel_pipeline(12, generator & spiral_vase &                      cooling &                output);
-    else if (m_find_replace)
-        tbb::parallel_pipeline(12, generator &                                    cooling & find_replace & output);
-    else if (m_pressure_equalizer)
-        tbb::parallel_pipeline(12, generator &               pressure_equalizer & cooling &                output);
-    else
-        tbb::parallel_pipeline(12, generator &                                    cooling &                output);
+    while (layer_to_print_idx < num_results) {
+        size_t tokens = max_tokens(threads, memory_limit, layer_bytes_max);
+        if (memory_limit == 0)
+            round_end = num_results;
+        else {
+            if (layer_bytes_max == 0)
+                // Nothing is known about the size of the layers yet, start with a single layer per thread.
+                tokens = std::min(tokens, threads);
+            round_end = std::min(num_results, layer_to_print_idx + 4 * tokens_max);
+        }
+        tokens_used = std::max(tokens_used, tokens);
+        tbb::parallel_pipeline(tokens, pipeline);
+    }
     output_stream.find_replace_enable();
+    m_layer_buffer_pool.clear();
+
+    BOOST_LOG_TRIVIAL(debug) << "G-code pipeline: " << num_results << " layers, up to " << tokens_used << " in flight, " <<
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - time_start).count() << " ms";
+    for (const StageTiming *timing : { &timing_generator, &timing_spiral_vase, &timing_pressure_equalizer, &timing_cooling_prepare, &timing_cooling, &timing_find_replace, &timing_output })
+        if (timing->calls > 0)
+            BOOST_LOG_TRIVIAL(debug) << "G-code pipeline stage " << timing->name << ": " << timing->calls << " calls, " << timing->time_ns / 1000000 << " ms";
 }
 
 std::string GCode::placeholder_parser_process(
@@ -2172,7 +2234,8 @@ LayerResult GCode::process_layer(
         m_enable_loop_clipping = !enable;
     }
 
-    std::string gcode;
+    // Reuse a buffer of an already exported layer, it is likely large enough to hold this layer without reallocation.
+    std::string gcode = m_layer_buffer_pool.acquire();
     assert(is_decimal_separator_point()); // for the sprintfs
 
     // add tag for processor
@@ -2787,11 +2850,10 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, const std::string_view descr
         // Shift by no more than a nozzle diameter.
         //FIXME Hiding the seams will not work nicely for very densely discretized contours!
         Point  pt = ((nd * nd >= l2) ? p2 : (p1 + v * (nd / sqrt(l2)))).cast<coord_t>();
-        pt.nonplanar_z = paths.front().polyline.points.front().nonplanar_z;
         // Rotate pt inside around the seam point.
         pt.rotate(angle_inside / 3., paths.front().polyline.points.front());
         // generate the travel move
-        gcode += m_writer.travel_to_xyz(this->point3_to_gcode(pt), "move inwards before travel");
+        gcode += m_writer.travel_to_xyz(this->point3_to_gcode(pt, paths.front().first_z()), "move inwards before travel");
     }
 
     return gcode;
@@ -2912,14 +2974,27 @@ void GCode::GCodeOutputStream::close()
     }
 }
 
+void GCode::GCodeOutputStream::write(const std::string &what)
+{
+    if (m_find_replace) {
+        this->write(what.c_str());
+    } else {
+        // Nothing to modify, pass the caller's buffer to the G-code processor as it is.
+        m_processor.process_buffer(what, m_processed);
+        fwrite(m_processed.data(), 1, m_processed.size(), this->f);
+        m_processed.clear();
+    }
+}
+
 void GCode::GCodeOutputStream::write(const char *what)
 {
     if (what != nullptr) {
         //FIXME don't allocate a string, maybe process a batch of lines?
         std::string gcode(m_find_replace ? m_find_replace->process_layer(what) : what);
-        // writes string to file
-        fwrite(gcode.c_str(), 1, gcode.size(), this->f);
-        m_processor.process_buffer(gcode);
+        // writes the G-code post-processed by the G-code processor to file
+        m_processor.process_buffer(gcode, m_processed);
+        fwrite(m_processed.data(), 1, m_processed.size(), this->f);
+        m_processed.clear();
     }
 }
 
@@ -2972,7 +3047,7 @@ std::string GCode::_extrude(const ExtrusionPath &path, const std::string_view de
         comment += description;
         comment += description_bridge;
         comment += " point";
-        gcode += this->travel_to(path.first_point(), path.role(), comment);
+        gcode += this->travel_to(path.first_point(), path.role(), comment, path.first_z());
     }
 
     // compensate retraction
@@ -3162,11 +3237,9 @@ std::string GCode::_extrude(const ExtrusionPath &path, const std::string_view de
             comment = description;
             comment += description_bridge;
         }
-        Vec3d prev3 = this->point3_to_gcode_quantized(path.polyline.points.front());
-        auto  it   = path.polyline.points.begin();
-        auto  end  = path.polyline.points.end();
-        for (++ it; it != end; ++ it) {
-            Vec3d p3 = this->point3_to_gcode_quantized(*it);
+        Vec3d prev3 = this->point3_to_gcode_quantized(path.polyline.points.front(), path.first_z());
+        for (size_t i = 1; i < path.polyline.points.size(); ++ i) {
+            Vec3d p3 = this->point3_to_gcode_quantized(path.polyline.points[i], path.z(i));
             const double line_length = (p3 - prev3).norm();
             path_length += line_length;
             gcode += m_writer.extrude_to_xyz(p3, e_per_mm * line_length, comment);
@@ -3182,10 +3255,10 @@ std::string GCode::_extrude(const ExtrusionPath &path, const std::string_view de
         double last_set_fan_speed = new_points[0].fan_speed;
         gcode += m_writer.set_speed(last_set_speed, "", cooling_marker_setspeed_comments);
         gcode += "\n;_SET_FAN_SPEED" + std::to_string(int(last_set_fan_speed)) + "\n";
-        Vec3d prev3 = this->point3_to_gcode_quantized(new_points[0].p);
+        Vec3d prev3 = this->point3_to_gcode_quantized(new_points[0].p, -1);
         for (size_t i = 1; i < new_points.size(); i++) {
             const ProcessedPoint &processed_point = new_points[i];
-            Vec3d                 p3              = this->point3_to_gcode_quantized(processed_point.p);
+            Vec3d                 p3              = this->point3_to_gcode_quantized(processed_point.p, -1);
             const double          line_length     = (p3 - prev3).norm();
             gcode += m_writer.extrude_to_xyz(p3, e_per_mm * line_length, marked_comment);
             prev3             = p3;
@@ -3205,12 +3278,12 @@ std::string GCode::_extrude(const ExtrusionPath &path, const std::string_view de
     if (m_enable_cooling_markers)
         gcode += path.role().is_bridge() ? ";_BRIDGE_FAN_END\n" : ";_EXTRUDE_END\n";
 
-    this->set_last_pos(path.last_point());
+    this->set_last_pos(path.last_point(), path.last_z());
     return gcode;
 }
 
 // This method accepts &point in print coordinates.
-std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string comment)
+std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string comment, coord_t z)
 {
     /*  Define the travel move as a line between current position and the taget point.
         This is expressed in print coordinates, so it will need to be translated by
@@ -3231,7 +3304,7 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
     // check whether a straight travel move would need retraction
     bool needs_retraction             = this->needs_retraction(travel, role);
     // check whether we need to move to a different z layer
-    bool needs_zmove                  = this->needs_zmove(travel);
+    bool needs_zmove                  = this->needs_zmove(travel, m_last_z, z);
     // check whether wipe could be disabled without causing visible stringing
     bool could_be_wipe_disabled       = false;
     // Save state of use_external_mp_once for the case that will be needed to call twice m_avoid_crossing_perimeters.travel_to.
@@ -3280,8 +3353,8 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
 
         // Move Z up if necessary
         if (needs_zmove) {
-            float move_z = unscale<double>(travel.points[0].nonplanar_z);
-            if(travel.points[0].nonplanar_z == -1)
+            float move_z = unscale<double>(m_last_z);
+            if(m_last_z == -1)
                 move_z = this->layer()->print_z;
             gcode += m_writer.travel_to_z(move_z, "Move up for non planar extrusion");
         }
@@ -3290,7 +3363,8 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
 
         for (size_t i = 1; i < travel.size(); ++ i) {
             if (needs_zmove) {
-                gcode += m_writer.travel_to_xyz(this->point3_to_gcode(travel.points[i]), comment);
+                // Only the end point of the travel may lie on a nonplanar surface.
+                gcode += m_writer.travel_to_xyz(this->point3_to_gcode(travel.points[i], i + 1 == travel.size() ? z : -1), comment);
             } else {
                 gcode += m_writer.travel_to_xy(this->point_to_gcode(travel.points[i]), comment);
             }
@@ -3303,14 +3377,14 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
         }
 
         if (needs_zmove) {
-            float move_z = unscale<double>(point.nonplanar_z);
-            if(point.nonplanar_z == -1) {
+            float move_z = unscale<double>(z);
+            if(z == -1) {
                 move_z = this->layer()->print_z;
             }
             gcode += m_writer.travel_to_z(move_z, "Move down for non planar extrusion");
         }
 
-        this->set_last_pos(travel.points.back());
+        this->set_last_pos(travel.points.back(), z);
     }
 
 
@@ -3357,17 +3431,17 @@ bool GCode::needs_retraction(const Polyline &travel, ExtrusionRole role)
 }
 
 bool
-GCode::needs_zmove(const Polyline &travel)
+GCode::needs_zmove(const Polyline &travel, coord_t z_from, coord_t z_to)
 {
     if (travel.length() < scale_(1.0)) {
         // skip zmove if the move is shorter 1 mm
         return false;
     }
 
-    //check if any point in travel is below the layer z
-    for (Point p : travel.points)
+    //check if any end of the travel is below the layer z
+    for (coord_t z : { z_from, z_to })
     {
-        if ((p.nonplanar_z != -1) && (p.nonplanar_z < scale_(this->layer()->print_z)))
+        if ((z != -1) && (z < scale_(this->layer()->print_z)))
             return true;
     }
 
@@ -3509,12 +3583,12 @@ Vec2d GCode::point_to_gcode(const Point &point) const
 }
 
 // convert a model-space scaled point into G-code coordinates
-Vec3d GCode::point3_to_gcode(const Point &point) const
+Vec3d GCode::point3_to_gcode(const Point &point, coord_t z) const
 {
     Vec2d extruder_offset = EXTRUDER_CONFIG(extruder_offset);
     double p_x = unscaled<double>(point.x()) + m_origin.x() - extruder_offset.x();
     double p_y = unscaled<double>(point.y()) + m_origin.y() - extruder_offset.y();
-    double p_z = point.nonplanar_z == -1 ? this->layer()->print_z : unscale<double>(point.nonplanar_z);
+    double p_z = z == -1 ? this->layer()->print_z : unscale<double>(z);
     return { p_x, p_y, p_z };
 }
 
@@ -3524,9 +3598,9 @@ Vec2d GCode::point_to_gcode_quantized(const Point &point) const
     return { GCodeFormatter::quantize_xyzf(p.x()), GCodeFormatter::quantize_xyzf(p.y()) };
 }
 
-Vec3d GCode::point3_to_gcode_quantized(const Point &point) const
+Vec3d GCode::point3_to_gcode_quantized(const Point &point, coord_t z) const
 {
-    Vec3d p = this->point3_to_gcode(point);
+    Vec3d p = this->point3_to_gcode(point, z);
     return { GCodeFormatter::quantize_xyzf(p.x()), GCodeFormatter::quantize_xyzf(p.y()), GCodeFormatter::quantize_xyzf(p.z()) };
 }
 
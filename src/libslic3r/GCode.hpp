@@ -13,6 +13,7 @@
 #include "GCode/AvoidCrossingPerimeters.hpp"
 #include "GCode/CoolingBuffer.hpp"
 #include "GCode/FindReplace.hpp"
+#include "GCode/LayerBufferPool.hpp"
 #include "GCode/RetractWhenCrossingPerimeters.hpp"
 #include "GCode/SpiralVase.hpp"
 #include "GCode/ToolOrdering.hpp"
@@ -22,6 +23,7 @@
 #include "EdgeGrid.hpp"
 #include "GCode/ThumbnailData.hpp"
 
+#include <functional>
 #include <memory>
 #include <map>
 #include <string>
@@ -125,6 +127,8 @@ struct LayerResult {
     // Is indicating if this LayerResult should be processed, or it is just inserted artificial LayerResult.
     // It is used for the pressure equalizer because it needs to buffer one layer back.
     bool        nop_layer_result { false };
+    // Lines of the G-code prepared for the cooling buffer by a parallel stage of process_layers().
+    CoolingPreparedLayer cooling_prepared;
 
     static LayerResult make_nop_layer_result() { return {"", std::numeric_limits<coord_t>::max(), false, false, true}; }
 };
@@ -166,10 +170,11 @@ public:
     const Point&    last_pos() const { return m_last_pos; }
     // Convert coordinates of the active object to G-code coordinates, possibly adjusted for extruder offset.
     Vec2d           point_to_gcode(const Point &point) const;
-    Vec3d           point3_to_gcode(const Point &point) const;
+    // Scaled z of -1 stands for the print_z of the active layer, see ExtrusionPath::nonplanar_z.
+    Vec3d           point3_to_gcode(const Point &point, coord_t z) const;
     // Convert coordinates of the active object to G-code coordinates, possibly adjusted for extruder offset and quantized to G-code resolution.
     Vec2d           point_to_gcode_quantized(const Point &point) const;
-    Vec3d           point3_to_gcode_quantized(const Point &point) const;
+    Vec3d           point3_to_gcode_quantized(const Point &point, coord_t z) const;
     Point           gcode_to_point(const Vec2d &point) const;
     const FullPrintConfig &config() const { return m_config; }
     const Layer*    layer() const { return m_layer; }
@@ -223,7 +228,7 @@ private:
         void close();
 
         // Write a string into a file.
-        void write(const std::string& what) { this->write(what.c_str()); }
+        void write(const std::string& what);
         void write(const char* what);
 
         // Write a string into a file. 
@@ -241,6 +246,8 @@ private:
         // If suppressed, the backoup holds m_find_replace.
         GCodeFindReplace *m_find_replace_backup { nullptr };
         GCodeProcessor   &m_processor;
+        // G-code post-processed by m_processor, to be written into the file.
+        std::string       m_processed;
     };
     void            _do_export(Print &print, GCodeOutputStream &file, ThumbnailsGeneratorCallback thumbnail_cb);
 
@@ -276,8 +283,17 @@ private:
         ObjectsLayerToPrint                      layers_to_print,
         const size_t                             single_object_idx,
         GCodeOutputStream                       &output_stream);
-
-    void            set_last_pos(const Point &pos) { m_last_pos = pos; m_last_pos_defined = true; }
+    // Shared by both variants of process_layers(): Generates G-code of num_layers layers by generate_layer(), runs the filters
+    // (vase mode, pressure equalizer, cooling buffer, find / replace) in a parallel pipeline and exports G-code into file.
+    // The number of layers in flight is derived from tbb::this_task_arena::max_concurrency() and the "gcode_export_memory_limit"
+    // configuration value.
+    void run_process_layers_pipeline(
+        const Print                                     &print,
+        const size_t                                     num_layers,
+        const std::function<LayerResult(size_t)>        &generate_layer,
+        GCodeOutputStream                               &output_stream);
+
+    void            set_last_pos(const Point &pos, coord_t z = -1) { m_last_pos = pos; m_last_z = z; m_last_pos_defined = true; }
     bool            last_pos_defined() const { return m_last_pos_defined; }
     void            set_extruders(const std::vector<unsigned int> &extruder_ids);
     std::string     preamble();
@@ -326,9 +342,10 @@ private:
 
     std::string     extrude_support(const ExtrusionEntityCollection &support_fills);
 
-    std::string     travel_to(const Point &point, ExtrusionRole role, std::string comment);
+    // z is the scaled nonplanar Z of the target point, -1 for the layer height.
+    std::string     travel_to(const Point &point, ExtrusionRole role, std::string comment, coord_t z = -1);
     bool            needs_retraction(const Polyline &travel, ExtrusionRole role = ExtrusionRole::None);
-    bool            needs_zmove(const Polyline &travel);
+    bool            needs_zmove(const Polyline &travel, coord_t z_from, coord_t z_to);
     std::string     retract(bool toolchange = false);
     std::string     unretract() { return m_writer.unlift() + m_writer.unretract(); }
     std::string     set_extruder(unsigned int extruder_id, double print_z);
@@ -415,12 +432,16 @@ private:
 #endif // ENABLE_GCODE_VIEWER_DATA_CHECKING
 
     Point                               m_last_pos;
+    // Scaled Z of m_last_pos if it was the end of a nonplanar extrusion, otherwise -1.
+    coord_t                             m_last_z { -1 };
     bool                                m_last_pos_defined;
 
     std::unique_ptr<CoolingBuffer>      m_cooling_buffer;
     std::unique_ptr<SpiralVase>         m_spiral_vase;
     std::unique_ptr<GCodeFindReplace>   m_find_replace;
     std::unique_ptr<PressureEqualizer>  m_pressure_equalizer;
+    // G-code buffers recycled by process_layers() from the output stage back to process_layer().
+    LayerBufferPool                     m_layer_buffer_pool;
     std::unique_ptr<WipeTowerIntegration> m_wipe_tower;
 
     // Heights (print_z) at which the skirt has already been extruded.
@@ -0,0 +1,1247 @@
+#include "BinaryGCode.hpp"
+
+#include "../libslic3r.h"
+#include "../Exception.hpp"
+#include "../Utils.hpp"
+#include "../miniz_extension.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+#include <boost/beast/core/detail/base64.hpp>
+#include <boost/nowide/cstdio.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <fast_float/fast_float.h>
+
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+namespace Slic3r {
+namespace BinaryGCode {
+
+using namespace std::literals;
+
+static constexpr const char Magic[4]      = { 'S', 'B', 'G', 'C' };
+// Binary G-code of the Prusa printers.
+static constexpr const char UnsupportedMagic[4] = { 'G', 'C', 'D', 'E' };
+static constexpr uint32_t   Version       = 2;
+static constexpr uint16_t   ChecksumCRC32 = 1;
+static constexpr size_t     FileHeaderSize  = sizeof(Magic) + sizeof(uint32_t) + sizeof(uint16_t);
+static constexpr size_t     BlockHeaderSize = 2 * sizeof(uint16_t) + 2 * sizeof(uint32_t);
+// Format, width, height, reserved, offset of the thumbnail in the G-code text.
+static constexpr size_t     ThumbnailParamsSize = 4 * sizeof(uint16_t) + sizeof(uint64_t);
+// Length of the text, number of lines, flags, reserved.
+static constexpr size_t     GCodeParamsSize = 2 * sizeof(uint32_t) + 2 * sizeof(uint16_t);
+static constexpr uint16_t   GCodeFlagNoNewlineAtEnd = 1;
+// Approximate length of the text of a G-code block, the G-code is split at line ends.
+static constexpr size_t     GCodeBlockSize = 1 << 20;
+// Row length of the base64 encoded thumbnails, as written by GCodeThumbnails::export_thumbnails_to_file().
+static constexpr size_t     ThumbnailRowLength = 78;
+// Size of the chunks read from the source file.
+static constexpr size_t     ReadChunkSize = 1 << 20;
+// Limit on the length of the print statistics comments to be parsed into the print metadata.
+static constexpr size_t     MetadataMaxSize = 1 << 20;
+
+static constexpr std::string_view ConfigBegin = "; prusaslicer_config = begin\n"sv;
+static constexpr std::string_view ConfigEnd   = "; prusaslicer_config = end\n"sv;
+
+// Values copied into the printer metadata block from the print statistics and from the slicer configuration.
+static constexpr std::string_view PrinterMetadataKeys[] = {
+    "printer_model"sv, "nozzle_diameter"sv, "filament_type"sv, "temperature"sv, "bed_temperature"sv,
+    "filament used [mm]"sv, "filament used [g]"sv,
+    "estimated printing time (normal mode)"sv, "estimated printing time (silent mode)"sv
+};
+
+static constexpr std::string_view thumbnail_tag(ThumbnailFormat format)
+{
+    switch (format) {
+    case ThumbnailFormat::JPG: return "thumbnail_JPG"sv;
+    case ThumbnailFormat::QOI: return "thumbnail_QOI"sv;
+    default:                   return "thumbnail"sv;
+    }
+}
+
+// All the supported platforms are little endian.
+template<typename T>
+static void append(std::string &out, T value)
+{
+    static_assert(std::is_integral_v<T>);
+    char buf[sizeof(T)];
+    std::memcpy(buf, &value, sizeof(T));
+    out.append(buf, sizeof(T));
+}
+
+template<typename T>
+static T read_value(const std::string &data, size_t pos)
+{
+    T out;
+    std::memcpy(&out, data.data() + pos, sizeof(T));
+    return out;
+}
+
+static std::string deflate(std::string_view data)
+{
+    mz_ulong    len = mz_compressBound(mz_ulong(data.size()));
+    std::string out(len, '\0');
+    if (mz_compress2((unsigned char*)out.data(), &len, (const unsigned char*)data.data(), mz_ulong(data.size()), MZ_DEFAULT_LEVEL) != MZ_OK)
+        throw Slic3r::RuntimeError("Binary G-code: Failed to compress a block");
+    out.resize(len);
+    return out;
+}
+
+static std::string inflate(std::string_view data, size_t uncompressed_size)
+{
+    std::string out(uncompressed_size, '\0');
+    mz_ulong    len = mz_ulong(uncompressed_size);
+    if (mz_uncompress((unsigned char*)out.data(), &len, (const unsigned char*)data.data(), mz_ulong(data.size())) != MZ_OK || len != uncompressed_size)
+        throw Slic3r::RuntimeError("Binary G-code: Failed to decompress a block");
+    return out;
+}
+
+struct Block
+{
+    BlockType   type;
+    Compression compression { Compression::None };
+    uint32_t    uncompressed_size { 0 };
+    std::string params;
+    std::string payload;
+};
+
+static Block make_block(BlockType type, std::string params, std::string_view data)
+{
+    Block out { type, Compression::None, uint32_t(data.size()), std::move(params), {} };
+    if (! data.empty()) {
+        out.payload = deflate(data);
+        if (out.payload.size() < data.size())
+            out.compression = Compression::Deflate;
+        else
+            out.payload = std::string(data);
+    }
+    return out;
+}
+
+static void append_block(std::string &out, const Block &block)
+{
+    const size_t begin = out.size();
+    append(out, uint16_t(block.type));
+    append(out, uint16_t(block.compression));
+    append(out, block.uncompressed_size);
+    append(out, uint32_t(block.payload.size()));
+    out += block.params;
+    out += block.payload;
+    append(out, uint32_t(mz_crc32(MZ_CRC32_INIT, (const unsigned char*)out.data() + begin, out.size() - begin)));
+}
+
+static std::string encode_metadata(const Metadata &metadata)
+{
+    std::string out;
+    for (const auto &[key, value] : metadata)
+        out += key + "=" + value + "\n";
+    return out;
+}
+
+static Metadata decode_metadata(const std::string &data)
+{
+    Metadata out;
+    for (size_t begin = 0; begin < data.size();) {
+        size_t end = std::min(data.find('\n', begin), data.size());
+        size_t eq  = data.find('=', begin);
+        if (eq < end)
+            out.emplace_back(data.substr(begin, eq - begin), data.substr(eq + 1, end - eq - 1));
+        begin = end + 1;
+    }
+    return out;
+}
+
+// Formats the thumbnail the same way as GCodeThumbnails::export_thumbnails_to_file(), without the empty comments around.
+static std::string thumbnail_to_text(const Thumbnail &thumbnail)
+{
+    namespace base64 = boost::beast::detail::base64;
+    std::string encoded(base64::encoded_size(thumbnail.data.size()), '\0');
+    encoded.resize(base64::encode(encoded.data(), thumbnail.data.data(), thumbnail.data.size()));
+    const std::string tag(thumbnail_tag(thumbnail.format));
+    std::string out = "; " + tag + " begin " + std::to_string(thumbnail.width) + "x" + std::to_string(thumbnail.height) + " " +
+        std::to_string(encoded.size()) + "\n";
+    for (size_t i = 0; i < encoded.size(); i += ThumbnailRowLength)
+        out += "; " + encoded.substr(i, ThumbnailRowLength) + "\n";
+    out += "; " + tag + " end\n";
+    return out;
+}
+
+// Axis letters of the moves stored in the structured form, indexed by Slic3r::Axis.
+static constexpr size_t     NumMoveAxes = 5;
+static constexpr const char MoveAxes[NumMoveAxes] = { 'X', 'Y', 'Z', 'E', 'F' };
+static_assert(NumMoveAxes == size_t(NUM_AXES), "The moves store the axes of GCodeReader");
+
+// The axis values are delta encoded as fixed point numbers with MaxDecimals decimal digits. Values with more decimal digits
+// or with more than MaxDecimals digits of the integer part are not stored in the structured form, thus the fixed point
+// numbers are smaller than 10^18 and fit into int64_t.
+static constexpr int        MaxDecimals = 9;
+static constexpr int64_t    Pow10[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL, 1000000000LL,
+    10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL, 100000000000000LL, 1000000000000000LL,
+    10000000000000000LL, 100000000000000000LL, 1000000000000000000LL
+};
+
+// Line types of a G-code block: zero for a text line, OpMove with the flags and the axes for a move.
+static constexpr uint8_t    OpMove    = 0x80;
+static constexpr uint8_t    OpG1      = 0x40;
+static constexpr uint8_t    OpComment = 0x20;
+static constexpr uint8_t    OpAxes    = 0x1F;
+// Decimal digits of an axis value with the leading zero flag.
+static constexpr uint8_t    DecimalsMask        = 0x0F;
+static constexpr uint8_t    DecimalsLeadingZero = 0x10;
+
+// Columns of a G-code block, the axis values are stored in a column per axis.
+enum Column {
+    ColumnOps,
+    ColumnText,
+    ColumnDecimals,
+    ColumnValues,
+    NumColumns = ColumnValues + NumMoveAxes
+};
+
+// Axis value as written in the text G-code: mantissa / 10^decimals.
+struct Value
+{
+    int64_t mantissa     { 0 };
+    uint8_t decimals     { 0 };
+    // Whether the zero integer part of a value smaller than one is written ("0.5" rather than ".5").
+    bool    leading_zero { false };
+};
+
+// Parses a decimal number such as "-12.345", ".5", "0.5" or "7". Returns the end of the number,
+// nullptr if there is no such number or if it has more than MaxDecimals digits of the integer or of the fractional part.
+static const char* parse_value(const char *begin, const char *end, Value &out)
+{
+    const char *c        = begin;
+    const bool  negative = c != end && *c == '-';
+    if (negative)
+        ++ c;
+    uint64_t mantissa   = 0;
+    int      int_digits = 0;
+    for (; c != end && *c >= '0' && *c <= '9'; ++ c, ++ int_digits) {
+        if (int_digits == MaxDecimals)
+            return nullptr;
+        mantissa = mantissa * 10 + uint64_t(*c - '0');
+    }
+    const uint64_t int_part = mantissa;
+    int            decimals = 0;
+    if (c != end && *c == '.') {
+        for (++ c; c != end && *c >= '0' && *c <= '9'; ++ c, ++ decimals) {
+            if (decimals == MaxDecimals)
+                return nullptr;
+            mantissa = mantissa * 10 + uint64_t(*c - '0');
+        }
+        if (decimals == 0)
+            return nullptr;
+    }
+    if (int_digits + decimals == 0)
+        return nullptr;
+    out.mantissa     = negative ? - int64_t(mantissa) : int64_t(mantissa);
+    out.decimals     = uint8_t(decimals);
+    out.leading_zero = int_digits > 0 && int_part == 0 && decimals > 0;
+    return c;
+}
+
+// Writes the value the way parse_value() read it. At most 21 characters are written, returns the end of the written text.
+static char* format_value(char *dst, const Value &value)
+{
+    const uint64_t mantissa = value.mantissa < 0 ? uint64_t(- value.mantissa) : uint64_t(value.mantissa);
+    const uint64_t scale    = uint64_t(Pow10[value.decimals]);
+    if (value.mantissa < 0)
+        *dst ++ = '-';
+    if (const uint64_t int_part = mantissa / scale; int_part > 0 || value.decimals == 0 || value.leading_zero)
+        dst = std::to_chars(dst, dst + 20, int_part).ptr;
+    if (value.decimals > 0) {
+        *dst ++ = '.';
+        uint64_t fraction = mantissa % scale;
+        for (int i = int(value.decimals) - 1; i >= 0; -- i, fraction /= 10)
+            dst[i] = char('0' + fraction % 10);
+        dst += value.decimals;
+    }
+    return dst;
+}
+
+// The same double as parsed from the text by GCodeReader.
+static double value_to_double(const Value &value)
+{
+    static constexpr int64_t max_exact = int64_t(1) << 53;
+    if (value.mantissa > - max_exact && value.mantissa < max_exact)
+        // Both the mantissa and the power of ten are exact, thus the division is rounded correctly.
+        return double(value.mantissa) / double(Pow10[value.decimals]);
+    char   buf[24];
+    double out = 0.;
+    fast_float::from_chars(buf, format_value(buf, value), out);
+    return out;
+}
+
+static bool is_end_of_value(char c)
+{
+    return c == ' ' || c == '\t' || c == ';' || c == '\r';
+}
+
+struct Move
+{
+    bool             g1   { true };
+    uint8_t          axes { 0 };
+    Value            values[NumMoveAxes];
+    // Rest of the line following the axes: empty, a comment or a carriage return.
+    std::string_view comment;
+};
+
+// Parses "G0" or "G1" followed by at least one of the axes X, Y, Z, E, F in this order, separated by single spaces,
+// optionally followed by a comment. Returns false if the line is not such a move or if formatting the move would not
+// reproduce the line, for example because of a superfluous zero.
+static bool parse_move(std::string_view line, Move &out)
+{
+    if (line.size() < 3 || line[0] != 'G' || (line[1] != '0' && line[1] != '1') || line[2] != ' ')
+        return false;
+    out.g1   = line[1] == '1';
+    out.axes = 0;
+    const char *c   = line.data() + 2;
+    const char *end = line.data() + line.size();
+    for (size_t next_axis = 0; end - c >= 3 && *c == ' ';) {
+        const size_t axis = std::find(MoveAxes + next_axis, MoveAxes + NumMoveAxes, c[1]) - MoveAxes;
+        if (axis == NumMoveAxes)
+            break;
+        const char *value_begin = c + 2;
+        const char *value_end   = parse_value(value_begin, end, out.values[axis]);
+        if (value_end == nullptr || (value_end != end && ! is_end_of_value(*value_end)))
+            return false;
+        char buf[24];
+        if (const char *buf_end = format_value(buf, out.values[axis]);
+            buf_end - buf != value_end - value_begin || std::memcmp(buf, value_begin, value_end - value_begin) != 0)
+            return false;
+        out.axes  |= uint8_t(1 << axis);
+        next_axis  = axis + 1;
+        c          = value_end;
+    }
+    out.comment = std::string_view(c, end - c);
+    if (const size_t first = out.comment.find_first_not_of(" \t");
+        ! out.comment.empty() && out.comment != "\r"sv && (first == std::string_view::npos || out.comment[first] != ';'))
+        // Anything else than a comment follows the axes.
+        return false;
+    if (const size_t eol = out.comment.find_first_of("\r\0"sv); eol != std::string_view::npos && eol + 1 != out.comment.size())
+        // GCodeReader splits the line there or drops the rest of the line.
+        return false;
+    return out.axes != 0;
+}
+
+static void format_move(const Move &move, std::string &out)
+{
+    char  buf[2 + NumMoveAxes * 23];
+    char *ptr = buf;
+    *ptr ++ = 'G';
+    *ptr ++ = move.g1 ? '1' : '0';
+    for (size_t axis = 0; axis < NumMoveAxes; ++ axis)
+        if (move.axes & (1 << axis)) {
+            *ptr ++ = ' ';
+            *ptr ++ = MoveAxes[axis];
+            ptr = format_value(ptr, move.values[axis]);
+        }
+    out.append(buf, ptr);
+    out += move.comment;
+}
+
+static void append_varint(std::string &out, uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+        out += char(value | 0x80);
+    out += char(value);
+}
+
+static uint64_t zigzag(int64_t value)
+{
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+    return int64_t(value >> 1) ^ - int64_t(value & 1);
+}
+
+struct GCodeBlockParams
+{
+    // Length of the text of the block.
+    uint32_t text_size      { 0 };
+    uint32_t num_lines      { 0 };
+    // False if the last line of the block does not end with a newline.
+    bool     newline_at_end { true };
+};
+
+// Splits the text into lines and stores them into the columns.
+static std::string encode_gcode_block(std::string_view text, GCodeBlockParams &params)
+{
+    std::string columns[NumColumns];
+    // Last value of each axis as a fixed point number with MaxDecimals decimal digits.
+    int64_t     last[NumMoveAxes] = { 0 };
+    Move        move;
+    params.text_size      = uint32_t(text.size());
+    params.num_lines      = 0;
+    params.newline_at_end = text.empty() || text.back() == '\n';
+    for (size_t begin = 0; begin < text.size(); ++ params.num_lines) {
+        const size_t           end  = std::min(text.find('\n', begin), text.size());
+        const std::string_view line = text.substr(begin, end - begin);
+        begin = end + 1;
+        if (parse_move(line, move)) {
+            columns[ColumnOps] += char(OpMove | (move.g1 ? OpG1 : 0) | (move.comment.empty() ? 0 : OpComment) | move.axes);
+            for (size_t axis = 0; axis < NumMoveAxes; ++ axis)
+                if (move.axes & (1 << axis)) {
+                    // The value is predicted by the last value of the axis truncated to the decimal digits of the value.
+                    const Value   &value = move.values[axis];
+                    const int64_t  scale = Pow10[MaxDecimals - value.decimals];
+                    columns[ColumnDecimals] += char(value.decimals | (value.leading_zero ? DecimalsLeadingZero : 0));
+                    append_varint(columns[ColumnValues + axis], zigzag(value.mantissa - last[axis] / scale));
+                    last[axis] = value.mantissa * scale;
+                }
+            if (! move.comment.empty()) {
+                columns[ColumnText] += move.comment;
+                columns[ColumnText] += '\n';
+            }
+        } else {
+            columns[ColumnOps]  += char(0);
+            columns[ColumnText] += line;
+            columns[ColumnText] += '\n';
+        }
+    }
+    std::string out;
+    for (const std::string &column : columns)
+        append(out, uint32_t(column.size()));
+    for (const std::string &column : columns)
+        out += column;
+    return out;
+}
+
+static Block make_gcode_block(std::string_view text)
+{
+    GCodeBlockParams params;
+    std::string      data = encode_gcode_block(text, params);
+    std::string      params_data;
+    append(params_data, params.text_size);
+    append(params_data, params.num_lines);
+    append(params_data, uint16_t(params.newline_at_end ? 0 : GCodeFlagNoNewlineAtEnd));
+    append(params_data, uint16_t(0));
+    return make_block(BlockType::GCode, std::move(params_data), data);
+}
+
+// G-code block decoded into its columns.
+struct DecodedGCodeBlock
+{
+    GCodeBlockParams   params;
+    // Inflated data of the block, referenced by ops and text.
+    std::string        data;
+    std::string_view   ops;
+    std::string_view   text;
+    // Axis values of the moves in the order of the lines and of the axes.
+    std::vector<Value> values;
+
+    // Splits data into the columns and decodes the axis values.
+    // Throws Slic3r::RuntimeError if the columns are not consistent.
+    void        decode();
+    // Calls fn(const Move *move, std::string_view text) for each line, move is nullptr for a text line, text is the comment of a move.
+    template<typename Fn>
+    void        for_each_line(Fn &&fn) const;
+    std::string to_text() const;
+    void        lines(std::vector<Line> &out) const;
+};
+
+void DecodedGCodeBlock::decode()
+{
+    auto invalid = []() { return Slic3r::RuntimeError("Binary G-code: Invalid G-code block"); };
+    if (data.size() < NumColumns * sizeof(uint32_t))
+        throw invalid();
+    std::string_view columns[NumColumns];
+    size_t           pos = NumColumns * sizeof(uint32_t);
+    for (size_t i = 0; i < NumColumns; ++ i) {
+        const size_t size = read_value<uint32_t>(data, i * sizeof(uint32_t));
+        if (data.size() - pos < size)
+            throw invalid();
+        columns[i] = std::string_view(data).substr(pos, size);
+        pos += size;
+    }
+    ops  = columns[ColumnOps];
+    text = columns[ColumnText];
+    if (ops.size() != params.num_lines)
+        throw invalid();
+
+    const std::string_view decimals = columns[ColumnDecimals];
+    size_t                 value_pos[NumMoveAxes] = { 0 };
+    int64_t                last[NumMoveAxes]      = { 0 };
+    values.clear();
+    values.reserve(decimals.size());
+    for (const char op : ops)
+        if (op & OpMove)
+            for (size_t axis = 0; axis < NumMoveAxes; ++ axis)
+                if (op & (1 << axis)) {
+                    if (values.size() == decimals.size())
+                        throw invalid();
+                    Value &value = values.emplace_back();
+                    value.decimals     = uint8_t(decimals[values.size() - 1]) & DecimalsMask;
+                    value.leading_zero = (uint8_t(decimals[values.size() - 1]) & DecimalsLeadingZero) != 0;
+                    if (value.decimals > MaxDecimals)
+                        throw invalid();
+                    const std::string_view column = columns[ColumnValues + axis];
+                    uint64_t               delta  = 0;
+                    for (int shift = 0;; shift += 7) {
+                        if (value_pos[axis] == column.size() || shift > 63)
+                            throw invalid();
+                        const uint8_t c = uint8_t(column[value_pos[axis] ++]);
+                        delta |= uint64_t(c & 0x7F) << shift;
+                        if ((c & 0x80) == 0)
+                            break;
+                    }
+                    // The fixed point value shall stay below 10^18.
+                    const int64_t scale      = Pow10[MaxDecimals - value.decimals];
+                    const int64_t max_abs    = Pow10[MaxDecimals + value.decimals];
+                    const int64_t prediction = last[axis] / scale;
+                    const int64_t d          = unzigzag(delta);
+                    if (d <= - 2 * max_abs || d >= 2 * max_abs || prediction + d <= - max_abs || prediction + d >= max_abs)
+                        throw invalid();
+                    value.mantissa = prediction + d;
+                    last[axis]     = value.mantissa * scale;
+                }
+    if (values.size() != decimals.size())
+        throw invalid();
+    for (size_t axis = 0; axis < NumMoveAxes; ++ axis)
+        if (value_pos[axis] != columns[ColumnValues + axis].size())
+            throw invalid();
+}
+
+template<typename Fn>
+void DecodedGCodeBlock::for_each_line(Fn &&fn) const
+{
+    size_t text_pos  = 0;
+    size_t value_idx = 0;
+    auto   next_text = [this, &text_pos]() {
+        const size_t end = text.find('\n', text_pos);
+        if (end == std::string_view::npos)
+            throw Slic3r::RuntimeError("Binary G-code: Invalid G-code block");
+        const std::string_view out = text.substr(text_pos, end - text_pos);
+        text_pos = end + 1;
+        return out;
+    };
+    Move move;
+    for (const char op : ops)
+        if (op & OpMove) {
+            move.g1   = (op & OpG1) != 0;
+            move.axes = uint8_t(op & OpAxes);
+            for (size_t axis = 0; axis < NumMoveAxes; ++ axis)
+                if (move.axes & (1 << axis))
+                    move.values[axis] = values[value_idx ++];
+            move.comment = (op & OpComment) ? next_text() : std::string_view();
+            fn(&move, move.comment);
+        } else
+            fn(nullptr, next_text());
+}
+
+std::string DecodedGCodeBlock::to_text() const
+{
+    std::string out;
+    out.reserve(params.text_size);
+    this->for_each_line([&out](const Move *move, std::string_view text) {
+        if (move)
+            format_move(*move, out);
+        else
+            out += text;
+        out += '\n';
+    });
+    if (! params.newline_at_end && ! out.empty())
+        out.pop_back();
+    if (out.size() != params.text_size)
+        throw Slic3r::RuntimeError("Binary G-code: Invalid G-code block");
+    return out;
+}
+
+void DecodedGCodeBlock::lines(std::vector<Line> &out) const
+{
+    out.clear();
+    out.reserve(ops.size());
+    this->for_each_line([&out](const Move *move, std::string_view text) {
+        Line &line = out.emplace_back();
+        line.text   = text;
+        line.length = text.size() + 1;
+        if (move) {
+            line.type    = move->g1 ? Line::Type::G1 : Line::Type::G0;
+            line.axes    = move->axes;
+            line.length += 2;
+            for (size_t axis = 0; axis < NumMoveAxes; ++ axis)
+                if (move->axes & (1 << axis)) {
+                    char buf[24];
+                    line.values[axis] = value_to_double(move->values[axis]);
+                    line.length      += 2 + (format_value(buf, move->values[axis]) - buf);
+                }
+        }
+    });
+    if (! params.newline_at_end && ! out.empty()) {
+        out.back().newline = false;
+        -- out.back().length;
+    }
+}
+
+// Random access to the data being encoded or decoded, either a string in memory or a file.
+class Source
+{
+public:
+    virtual ~Source() = default;
+    virtual size_t size() const = 0;
+    // Reads exactly len bytes starting at pos. Throws Slic3r::RuntimeError on error.
+    virtual void   read(size_t pos, char *out, size_t len) = 0;
+};
+
+class StringSource : public Source
+{
+public:
+    explicit StringSource(const std::string &data) : m_data(data) {}
+    size_t size() const override { return m_data.size(); }
+    void   read(size_t pos, char *out, size_t len) override {
+        assert(pos + len <= m_data.size());
+        std::memcpy(out, m_data.data() + pos, len);
+    }
+private:
+    const std::string &m_data;
+};
+
+class FileSource : public Source
+{
+public:
+    explicit FileSource(const std::string &path) : m_path(path), m_file(path, std::ios::binary) {
+        if (! m_file.good())
+            throw Slic3r::RuntimeError(std::string("Failed to open ") + path);
+        m_file.seekg(0, std::ios::end);
+        m_size = size_t(m_file.tellg());
+    }
+    size_t size() const override { return m_size; }
+    void   read(size_t pos, char *out, size_t len) override {
+        m_file.seekg(std::streamoff(pos), std::ios::beg);
+        m_file.read(out, std::streamsize(len));
+        if (! m_file.good())
+            throw Slic3r::RuntimeError(std::string("Failed to read ") + m_path);
+    }
+private:
+    std::string             m_path;
+    boost::nowide::ifstream m_file;
+    size_t                  m_size { 0 };
+};
+
+// Reads a source line by line, holding just a chunk of the source in memory.
+class LineReader
+{
+public:
+    LineReader(Source &source, size_t pos = 0) : m_source(source), m_buffer_pos(pos) {}
+
+    // Position of the next line in the source.
+    size_t pos() const { return m_buffer_pos + m_begin; }
+    void   seek(size_t pos) {
+        if (pos >= m_buffer_pos && pos <= m_buffer_pos + m_buffer.size())
+            m_begin = pos - m_buffer_pos;
+        else {
+            m_buffer.clear();
+            m_buffer_pos = pos;
+            m_begin      = 0;
+        }
+    }
+
+    // Returns the next line including its newline character, an empty line at the end of the source.
+    // The line is valid until the next call to next() or seek().
+    std::string_view next() {
+        for (size_t search_from = m_begin;;) {
+            if (size_t end = m_buffer.find('\n', search_from); end != std::string::npos) {
+                std::string_view line = std::string_view(m_buffer).substr(m_begin, end + 1 - m_begin);
+                m_begin = end + 1;
+                return line;
+            }
+            const size_t buffer_end = m_buffer_pos + m_buffer.size();
+            if (buffer_end >= m_source.size()) {
+                // The last line without a newline character.
+                std::string_view line = std::string_view(m_buffer).substr(m_begin);
+                m_begin = m_buffer.size();
+                return line;
+            }
+            // Drop the lines already returned and append the next chunk.
+            m_buffer.erase(0, m_begin);
+            m_buffer_pos += m_begin;
+            m_begin       = 0;
+            search_from   = m_buffer.size();
+            const size_t len = std::min(ReadChunkSize, m_source.size() - buffer_end);
+            m_buffer.resize(search_from + len);
+            m_source.read(buffer_end, m_buffer.data() + search_from, len);
+        }
+    }
+
+private:
+    Source      &m_source;
+    std::string  m_buffer;
+    // Position of m_buffer in the source.
+    size_t       m_buffer_pos;
+    // Start of the next line in m_buffer.
+    size_t       m_begin { 0 };
+};
+
+// Parses a thumbnail starting with first_line, the reader is positioned after first_line. Returns the thumbnail only if it is
+// reproduced exactly by thumbnail_to_text(), otherwise the thumbnail is left in the G-code text and the reader is to be rewound by the caller.
+static std::optional<Thumbnail> parse_thumbnail(LineReader &reader, std::string_view first_line)
+{
+    Thumbnail        thumbnail;
+    std::string_view tag;
+    for (ThumbnailFormat format : { ThumbnailFormat::PNG, ThumbnailFormat::JPG, ThumbnailFormat::QOI })
+        if (first_line.substr(2, thumbnail_tag(format).size() + 7) == std::string(thumbnail_tag(format)) + " begin ") {
+            thumbnail.format = format;
+            tag              = thumbnail_tag(format);
+        }
+    if (tag.empty())
+        return std::nullopt;
+    unsigned int width = 0, height = 0;
+    size_t       encoded_size = 0;
+    if (std::sscanf(std::string(first_line.substr(tag.size() + 9)).c_str(), "%ux%u %zu", &width, &height, &encoded_size) != 3 ||
+        width > 0xFFFF || height > 0xFFFF)
+        return std::nullopt;
+    thumbnail.width  = uint16_t(width);
+    thumbnail.height = uint16_t(height);
+
+    const std::string end_line = "; " + std::string(tag) + " end\n";
+    std::string       text(first_line);
+    std::string       encoded;
+    for (;;) {
+        std::string_view line = reader.next();
+        if (line.empty() || line.back() != '\n' || line.size() < 3 || line.substr(0, 2) != "; "sv)
+            return std::nullopt;
+        text += line;
+        if (line == end_line)
+            break;
+        encoded += line.substr(2, line.size() - 3);
+        if (encoded.size() > encoded_size)
+            return std::nullopt;
+    }
+    if (encoded.size() != encoded_size)
+        return std::nullopt;
+
+    namespace base64 = boost::beast::detail::base64;
+    thumbnail.data.resize(base64::decoded_size(encoded.size()));
+    thumbnail.data.resize(base64::decode(thumbnail.data.data(), encoded.data(), encoded.size()).first);
+    if (thumbnail_to_text(thumbnail) != text)
+        return std::nullopt;
+    return thumbnail;
+}
+
+// Parses a "; key = value" comment.
+static void parse_key_value(std::string_view line, Metadata &out)
+{
+    if (size_t eq = line.find(" = "); line.substr(0, 2) == "; "sv && eq != std::string_view::npos)
+        out.emplace_back(line.substr(2, eq - 2), line.substr(eq + 3, line.size() - eq - 3 - (line.back() == '\n')));
+}
+
+static bool is_comment_or_empty(std::string_view line)
+{
+    return line.empty() || line.front() == ';' || line == "\n"sv;
+}
+
+// Encodes the text G-code read from source, passing the binary G-code to write() by pieces.
+static void encode(Source &source, const std::function<void(const std::string&)> &write)
+{
+    // The configuration between "; prusaslicer_config = begin" and "; prusaslicer_config = end" goes to the slicer metadata,
+    // the "; key = value" comments following the last G-code command and preceding the configuration go to the print metadata.
+    // Find the last configuration block and the start of the comments preceding it.
+    size_t config_begin = std::string::npos;
+    size_t print_begin  = 0;
+    size_t print_end    = source.size();
+    {
+        LineReader reader(source);
+        size_t     comments_begin = 0;
+        for (size_t pos = 0;;) {
+            std::string_view line = reader.next();
+            if (line.empty())
+                break;
+            if (! is_comment_or_empty(line))
+                comments_begin = pos + line.size();
+            else if (line == ConfigBegin) {
+                config_begin = pos;
+                print_begin  = comments_begin;
+                print_end    = pos;
+            }
+            pos += line.size();
+        }
+        if (config_begin == std::string::npos)
+            print_begin = comments_begin;
+    }
+
+    Metadata print_metadata;
+    {
+        // Only the comments right before the configuration are considered if there are too many of them.
+        LineReader reader(source, std::max(print_begin, print_end - std::min(print_end, MetadataMaxSize)));
+        if (reader.pos() > print_begin)
+            // Skip the partial line.
+            reader.next();
+        while (reader.pos() < print_end)
+            parse_key_value(reader.next(), print_metadata);
+    }
+    Metadata slicer_metadata;
+    if (config_begin != std::string::npos) {
+        LineReader reader(source, config_begin + ConfigBegin.size());
+        for (std::string_view line = reader.next(); ! line.empty() && line != ConfigEnd; line = reader.next())
+            parse_key_value(line, slicer_metadata);
+    }
+    Metadata printer_metadata;
+    for (std::string_view key : PrinterMetadataKeys)
+        for (const Metadata *metadata : { &print_metadata, &slicer_metadata })
+            if (auto it = std::find_if(metadata->begin(), metadata->end(), [key](const auto &kvp) { return kvp.first == key; });
+                it != metadata->end()) {
+                printer_metadata.emplace_back(*it);
+                break;
+            }
+
+    std::string out;
+    out.append(Magic, sizeof(Magic));
+    append(out, Version);
+    append(out, ChecksumCRC32);
+    append_block(out, make_block(BlockType::FileMetadata, {}, encode_metadata({ { "Producer", SLIC3R_APP_NAME " " SLIC3R_VERSION } })));
+    append_block(out, make_block(BlockType::PrinterMetadata, {}, encode_metadata(printer_metadata)));
+    append_block(out, make_block(BlockType::PrintMetadata, {}, encode_metadata(print_metadata)));
+    append_block(out, make_block(BlockType::SlicerMetadata, {}, encode_metadata(slicer_metadata)));
+    write(out);
+
+    // Move the thumbnails out of the G-code text, split the rest at line ends into blocks
+    // and encode the blocks in parallel by batches.
+    const size_t             batch_size = size_t(std::max(1, tbb::this_task_arena::max_concurrency()));
+    std::vector<std::string> texts(1);
+    std::vector<Block>       blocks;
+    auto                     flush_blocks = [&texts, &blocks, &out, &write]() {
+        blocks.assign(texts.size(), Block {});
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, texts.size()), [&texts, &blocks](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                blocks[i] = make_gcode_block(texts[i]);
+        });
+        for (const Block &block : blocks) {
+            out.clear();
+            append_block(out, block);
+            write(out);
+        }
+        texts.clear();
+    };
+    LineReader reader(source);
+    // Length of the G-code text without the thumbnails.
+    uint64_t   text_size = 0;
+    for (;;) {
+        const size_t     line_begin = reader.pos();
+        std::string_view line       = reader.next();
+        if (line.empty())
+            break;
+        if (line.substr(0, 11) == "; thumbnail"sv) {
+            if (std::optional<Thumbnail> thumbnail = parse_thumbnail(reader, line); thumbnail) {
+                std::string params;
+                append(params, uint16_t(thumbnail->format));
+                append(params, thumbnail->width);
+                append(params, thumbnail->height);
+                append(params, uint16_t(0));
+                append(params, text_size);
+                // The images are compressed already.
+                out.clear();
+                append_block(out, Block { BlockType::Thumbnail, Compression::None, uint32_t(thumbnail->data.size()), std::move(params), std::move(thumbnail->data) });
+                write(out);
+                continue;
+            }
+            reader.seek(line_begin);
+            line = reader.next();
+        }
+        texts.back() += line;
+        text_size    += line.size();
+        if (texts.back().size() >= GCodeBlockSize) {
+            if (texts.size() == batch_size)
+                flush_blocks();
+            texts.emplace_back();
+        }
+    }
+    if (texts.back().empty())
+        texts.pop_back();
+    flush_blocks();
+}
+
+std::string to_binary(const std::string &gcode)
+{
+    StringSource source(gcode);
+    std::string  out;
+    out.reserve(gcode.size() / 4);
+    encode(source, [&out](const std::string &data) { out += data; });
+    return out;
+}
+
+bool is_binary(const char *data, size_t size)
+{
+    return size >= FileHeaderSize && std::memcmp(data, Magic, sizeof(Magic)) == 0;
+}
+
+// Reads up to size bytes from the start of a file, returns the number of bytes read.
+static size_t read_file_header(const std::string &path, char *out, size_t size)
+{
+    FILE *file = boost::nowide::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return 0;
+    size = ::fread(out, 1, size, file);
+    ::fclose(file);
+    return size;
+}
+
+bool is_binary_file(const std::string &path)
+{
+    char header[FileHeaderSize];
+    return is_binary(header, read_file_header(path, header, FileHeaderSize));
+}
+
+bool is_unsupported_binary_file(const std::string &path)
+{
+    char header[sizeof(UnsupportedMagic)];
+    return read_file_header(path, header, sizeof(header)) == sizeof(header) && std::memcmp(header, UnsupportedMagic, sizeof(header)) == 0;
+}
+
+struct File::Decoder
+{
+    explicit Decoder(std::unique_ptr<Source> source);
+
+    bool   for_each_line(const std::function<bool(const Line&)> &callback);
+    size_t read(size_t offset, char *out, size_t len);
+
+    struct BlockHeader
+    {
+        BlockType   type;
+        Compression compression;
+        size_t      uncompressed_size;
+        size_t      params_size;
+        size_t      payload_size;
+        // Including the header and the checksum.
+        size_t      block_size;
+    };
+    BlockHeader read_block_header(size_t pos);
+    // Reads the whole block including its header and checksum.
+    std::string read_raw_block(size_t pos, const BlockHeader &header);
+    // Verifies the checksum of a block read by read_raw_block() and returns its inflated data. Thread safe.
+    std::string unpack_block(const std::string &raw, const BlockHeader &header, std::string *params = nullptr) const;
+    std::string read_block(size_t pos, const BlockHeader &header, std::string *params = nullptr)
+        { return this->unpack_block(this->read_raw_block(pos, header), header, params); }
+    const std::string& gcode_block_text(size_t idx);
+
+    struct GCodeBlock
+    {
+        size_t           pos;
+        BlockHeader      header;
+        GCodeBlockParams params;
+    };
+    // Piece of the text G-code: either a range of a G-code block or a thumbnail.
+    struct Segment
+    {
+        size_t      text_begin;
+        // Index to gcode_blocks or std::string::npos for a thumbnail.
+        size_t      block;
+        // Offset in the text of the G-code block or index to thumbnail_texts.
+        size_t      offset;
+        size_t      length;
+    };
+
+    std::unique_ptr<Source>  source;
+    bool                     checksum { false };
+    FileInfo                 info;
+    std::vector<GCodeBlock>  gcode_blocks;
+    // Thumbnails formatted as G-code comments, sorted by their position in the G-code text without the thumbnails.
+    std::vector<std::string> thumbnail_texts;
+    std::vector<size_t>      thumbnail_offsets;
+    std::vector<Segment>     segments;
+    size_t                   text_size { 0 };
+    size_t                   cached_block { std::string::npos };
+    std::string              cached_text;
+};
+
+File::Decoder::Decoder(std::unique_ptr<Source> source_in) : source(std::move(source_in))
+{
+    std::string header(FileHeaderSize, '\0');
+    if (source->size() < FileHeaderSize)
+        throw Slic3r::RuntimeError("Binary G-code: Invalid file header");
+    source->read(0, header.data(), FileHeaderSize);
+    if (! is_binary(header.data(), header.size()))
+        throw Slic3r::RuntimeError("Binary G-code: Invalid file header");
+    if (read_value<uint32_t>(header, sizeof(Magic)) != Version)
+        throw Slic3r::RuntimeError("Binary G-code: Unsupported version");
+    checksum = read_value<uint16_t>(header, sizeof(Magic) + sizeof(uint32_t)) == ChecksumCRC32;
+
+    // Read the metadata and the thumbnails, only index the G-code blocks.
+    std::vector<std::pair<uint64_t, size_t>> thumbnail_positions;
+    size_t                                   gcode_size = 0;
+    for (size_t pos = FileHeaderSize; pos < source->size();) {
+        const BlockHeader block = read_block_header(pos);
+        std::string       params;
+        switch (block.type) {
+        case BlockType::GCode:
+        {
+            // Only the parameters are read, the rest of the block is read when decoding it.
+            params.assign(block.params_size, '\0');
+            source->read(pos + BlockHeaderSize, params.data(), params.size());
+            GCodeBlockParams gcode_params;
+            gcode_params.text_size      = read_value<uint32_t>(params, 0);
+            gcode_params.num_lines      = read_value<uint32_t>(params, 4);
+            gcode_params.newline_at_end = (read_value<uint16_t>(params, 8) & GCodeFlagNoNewlineAtEnd) == 0;
+            gcode_blocks.push_back({ pos, block, gcode_params });
+            gcode_size += gcode_params.text_size;
+            break;
+        }
+        case BlockType::FileMetadata:    info.file_metadata    = decode_metadata(read_block(pos, block)); break;
+        case BlockType::PrinterMetadata: info.printer_metadata = decode_metadata(read_block(pos, block)); break;
+        case BlockType::PrintMetadata:   info.print_metadata   = decode_metadata(read_block(pos, block)); break;
+        case BlockType::SlicerMetadata:  info.slicer_metadata  = decode_metadata(read_block(pos, block)); break;
+        case BlockType::Thumbnail:
+        {
+            std::string data = read_block(pos, block, &params);
+            info.thumbnails.push_back({ ThumbnailFormat(read_value<uint16_t>(params, 0)), read_value<uint16_t>(params, 2), read_value<uint16_t>(params, 4), std::move(data) });
+            thumbnail_positions.emplace_back(read_value<uint64_t>(params, 8), thumbnail_positions.size());
+            break;
+        }
+        default: break;
+        }
+        pos += block.block_size;
+    }
+
+    // Lay out the G-code blocks and the thumbnails put back into the G-code comments.
+    std::stable_sort(thumbnail_positions.begin(), thumbnail_positions.end(), [](const auto &l, const auto &r) { return l.first < r.first; });
+    size_t gcode_pos   = 0;
+    size_t block       = 0;
+    size_t block_begin = 0;
+    auto   add_gcode   = [this, &gcode_pos, &block, &block_begin](size_t gcode_end) {
+        while (gcode_pos < gcode_end) {
+            for (; block_begin + gcode_blocks[block].params.text_size <= gcode_pos; ++ block)
+                block_begin += gcode_blocks[block].params.text_size;
+            const size_t length = std::min(gcode_end, block_begin + gcode_blocks[block].params.text_size) - gcode_pos;
+            segments.push_back({ text_size, block, gcode_pos - block_begin, length });
+            text_size += length;
+            gcode_pos += length;
+        }
+    };
+    for (const auto &[offset, idx] : thumbnail_positions) {
+        if (offset > gcode_size)
+            throw Slic3r::RuntimeError("Binary G-code: Invalid thumbnail position");
+        add_gcode(size_t(offset));
+        thumbnail_texts.emplace_back(thumbnail_to_text(info.thumbnails[idx]));
+        thumbnail_offsets.emplace_back(size_t(offset));
+        segments.push_back({ text_size, std::string::npos, thumbnail_texts.size() - 1, thumbnail_texts.back().size() });
+        text_size += thumbnail_texts.back().size();
+    }
+    add_gcode(gcode_size);
+}
+
+File::Decoder::BlockHeader File::Decoder::read_block_header(size_t pos)
+{
+    if (source->size() - pos < BlockHeaderSize)
+        throw Slic3r::RuntimeError("Binary G-code: Truncated block header");
+    std::string data(BlockHeaderSize, '\0');
+    source->read(pos, data.data(), BlockHeaderSize);
+    BlockHeader out;
+    out.type              = BlockType(read_value<uint16_t>(data, 0));
+    out.compression       = Compression(read_value<uint16_t>(data, 2));
+    out.uncompressed_size = read_value<uint32_t>(data, 4);
+    out.payload_size      = read_value<uint32_t>(data, 8);
+    out.params_size       = out.type == BlockType::Thumbnail ? ThumbnailParamsSize :
+                            out.type == BlockType::GCode     ? GCodeParamsSize     : 0;
+    out.block_size        = BlockHeaderSize + out.params_size + out.payload_size + (checksum ? sizeof(uint32_t) : 0);
+    if (source->size() - pos < out.block_size)
+        throw Slic3r::RuntimeError("Binary G-code: Truncated block");
+    if (out.compression == Compression::None ? out.payload_size != out.uncompressed_size : out.compression != Compression::Deflate)
+        throw Slic3r::RuntimeError("Binary G-code: Invalid block compression");
+    return out;
+}
+
+std::string File::Decoder::read_raw_block(size_t pos, const BlockHeader &header)
+{
+    std::string data(header.block_size, '\0');
+    source->read(pos, data.data(), data.size());
+    return data;
+}
+
+std::string File::Decoder::unpack_block(const std::string &raw, const BlockHeader &header, std::string *params) const
+{
+    if (checksum && mz_crc32(MZ_CRC32_INIT, (const unsigned char*)raw.data(), raw.size() - sizeof(uint32_t)) !=
+        read_value<uint32_t>(raw, raw.size() - sizeof(uint32_t)))
+        throw Slic3r::RuntimeError("Binary G-code: Block checksum mismatch");
+    if (params)
+        *params = raw.substr(BlockHeaderSize, header.params_size);
+    const std::string_view payload = std::string_view(raw).substr(BlockHeaderSize + header.params_size, header.payload_size);
+    return header.compression == Compression::Deflate ? inflate(payload, header.uncompressed_size) : std::string(payload);
+}
+
+const std::string& File::Decoder::gcode_block_text(size_t idx)
+{
+    if (cached_block != idx) {
+        cached_block = std::string::npos;
+        DecodedGCodeBlock block;
+        block.params = gcode_blocks[idx].params;
+        block.data   = read_block(gcode_blocks[idx].pos, gcode_blocks[idx].header);
+        block.decode();
+        cached_text  = block.to_text();
+        cached_block = idx;
+    }
+    return cached_text;
+}
+
+bool File::Decoder::for_each_line(const std::function<bool(const Line&)> &callback)
+{
+    // Position in the text G-code without the thumbnails.
+    size_t gcode_pos      = 0;
+    size_t next_thumbnail = 0;
+    auto   emit_thumbnails = [this, &callback, &gcode_pos, &next_thumbnail](bool all) {
+        for (; next_thumbnail < thumbnail_texts.size() && (all || thumbnail_offsets[next_thumbnail] <= gcode_pos); ++ next_thumbnail) {
+            const std::string &text = thumbnail_texts[next_thumbnail];
+            Line               line;
+            for (size_t begin = 0; begin < text.size();) {
+                const size_t end = text.find('\n', begin);
+                line.text   = std::string_view(text).substr(begin, end - begin);
+                line.length = end + 1 - begin;
+                if (! callback(line))
+                    return false;
+                begin = end + 1;
+            }
+        }
+        return true;
+    };
+
+    // The blocks are read from the source sequentially, then verified, inflated and decoded in parallel by batches.
+    const size_t                   batch_size = size_t(std::max(1, tbb::this_task_arena::max_concurrency()));
+    std::vector<std::string>       raw(batch_size);
+    std::vector<DecodedGCodeBlock> blocks(batch_size);
+    std::vector<std::vector<Line>> lines(batch_size);
+    for (size_t first = 0; first < gcode_blocks.size(); first += batch_size) {
+        const size_t num_blocks = std::min(batch_size, gcode_blocks.size() - first);
+        for (size_t i = 0; i < num_blocks; ++ i)
+            raw[i] = this->read_raw_block(gcode_blocks[first + i].pos, gcode_blocks[first + i].header);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_blocks, 1), [this, first, &raw, &blocks, &lines](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                const GCodeBlock &block = gcode_blocks[first + i];
+                blocks[i].params = block.params;
+                blocks[i].data   = this->unpack_block(raw[i], block.header);
+                blocks[i].decode();
+                blocks[i].lines(lines[i]);
+            }
+        });
+        for (size_t i = 0; i < num_blocks; ++ i)
+            for (const Line &line : lines[i]) {
+                if (! emit_thumbnails(false) || ! callback(line))
+                    return false;
+                gcode_pos += line.length;
+            }
+    }
+    return emit_thumbnails(true);
+}
+
+size_t File::Decoder::read(size_t offset, char *out, size_t len)
+{
+    size_t copied = 0;
+    auto   it     = std::upper_bound(segments.begin(), segments.end(), offset, [](size_t offset, const Segment &segment) { return offset < segment.text_begin; });
+    for (it = (it == segments.begin()) ? it : std::prev(it); it != segments.end() && copied < len; ++ it) {
+        const size_t begin = offset + copied - it->text_begin;
+        if (begin >= it->length)
+            continue;
+        const size_t n = std::min(len - copied, it->length - begin);
+        const char  *src = it->block == std::string::npos ?
+            thumbnail_texts[it->offset].data() + begin : gcode_block_text(it->block).data() + it->offset + begin;
+        std::memcpy(out + copied, src, n);
+        copied += n;
+    }
+    return copied;
+}
+
+File::File(const std::string &path) : m_decoder(std::make_unique<Decoder>(std::make_unique<FileSource>(path))) {}
+File::~File() = default;
+
+const FileInfo& File::info() const
+{
+    return m_decoder->info;
+}
+
+void File::for_each_line(const std::function<bool(const Line&)> &callback)
+{
+    m_decoder->for_each_line(callback);
+}
+
+size_t File::size() const
+{
+    return m_decoder->text_size;
+}
+
+size_t File::read(size_t offset, char *out, size_t len)
+{
+    return m_decoder->read(offset, out, len);
+}
+
+std::string File::read(size_t offset, size_t len)
+{
+    std::string out(std::min(len, m_decoder->text_size - std::min(offset, m_decoder->text_size)), '\0');
+    out.resize(m_decoder->read(offset, out.data(), out.size()));
+    return out;
+}
+
+FileInfo read_info(const std::string &binary)
+{
+    return File::Decoder(std::make_unique<StringSource>(binary)).info;
+}
+
+FileInfo read_file_info(const std::string &path)
+{
+    return File(path).info();
+}
+
+std::string to_text(const std::string &binary)
+{
+    File::Decoder decoder(std::make_unique<StringSource>(binary));
+    std::string   out(decoder.text_size, '\0');
+    decoder.read(0, out.data(), out.size());
+    return out;
+}
+
+// Writes a file through a temporary file, which is renamed to path once complete. write(ofstream) writes the content.
+template<typename Write>
+static void save_file(const std::string &path, Write write)
+{
+    const std::string path_tmp = path + ".tmp";
+    try {
+        boost::nowide::ofstream out(path_tmp, std::ios::binary);
+        write(out);
+        out.close();
+        if (out.fail())
+            throw Slic3r::RuntimeError(std::string("Failed to write ") + path_tmp);
+    } catch (...) {
+        boost::nowide::remove(path_tmp.c_str());
+        throw;
+    }
+    if (rename_file(path_tmp, path))
+        throw Slic3r::RuntimeError(std::string("Failed to rename the output G-code file from ") + path_tmp + " to " + path);
+}
+
+void convert_to_binary(const std::string &src_path, const std::string &dst_path)
+{
+    // The source is closed before the temporary file replaces it, as src_path and dst_path may be the same.
+    auto source = std::make_unique<FileSource>(src_path);
+    save_file(dst_path, [&source](boost::nowide::ofstream &out) {
+        encode(*source, [&out](const std::string &data) { out.write(data.data(), data.size()); });
+        source.reset();
+    });
+}
+
+void convert_to_text(const std::string &src_path, const std::string &dst_path)
+{
+    auto source = std::make_unique<File>(src_path);
+    save_file(dst_path, [&source](boost::nowide::ofstream &out) {
+        std::string buffer(ReadChunkSize, '\0');
+        for (size_t offset = 0; offset < source->size();) {
+            const size_t len = source->read(offset, buffer.data(), buffer.size());
+            out.write(buffer.data(), len);
+            offset += len;
+        }
+        source.reset();
+    });
+}
+
+} // namespace BinaryGCode
+} // namespace Slic3r
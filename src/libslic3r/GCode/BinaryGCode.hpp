@@ -0,0 +1,157 @@
+#ifndef slic3r_GCode_BinaryGCode_hpp_
+#define slic3r_GCode_BinaryGCode_hpp_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Slic3r {
+namespace BinaryGCode {
+
+// Compact binary container of a G-code file (.sbgc).
+// This is not the binary G-code of the Prusa printers (.bgcode), which has a different magic and is not supported.
+//
+// The file starts with a header (magic, version, checksum type) followed by a sequence of typed blocks.
+// Each block has a header (type, compression, uncompressed and compressed size), block type specific parameters,
+// the data and a CRC32 checksum of all of the above. All numbers are little endian.
+//
+// The metadata blocks come first: the print statistics from the end of the G-code, the slicer configuration and a subset
+// of both interesting for a printer are copied into them, so that they may be read without decoding the G-code.
+// Thumbnails are moved out of the G-code comments into their own blocks holding the raw images and the position
+// of the thumbnail in the G-code.
+// The G-code itself follows, split at line ends into blocks of about 1MB of text. A G-code block stores its lines in columns,
+// which are deflated together:
+//  - a line type per line: a G0 / G1 move with its axes, or a line kept as text,
+//  - the text lines and the comments of the moves,
+//  - the number of decimal digits of each axis value,
+//  - the axis values as fixed point numbers, delta encoded per axis.
+// A move is only stored in the structured form if formatting it back reproduces its text exactly, thus the conversion back
+// to text reproduces the source G-code byte by byte.
+// Both the encoder and the decoder stream the files, only a batch of G-code blocks is held in memory at a time.
+
+enum class BlockType : uint16_t {
+    FileMetadata,
+    GCode,
+    SlicerMetadata,
+    PrinterMetadata,
+    PrintMetadata,
+    Thumbnail,
+};
+
+enum class Compression : uint16_t {
+    None,
+    Deflate,
+};
+
+enum class ThumbnailFormat : uint16_t {
+    PNG,
+    JPG,
+    QOI,
+};
+
+using Metadata = std::vector<std::pair<std::string, std::string>>;
+
+struct Thumbnail
+{
+    ThumbnailFormat format { ThumbnailFormat::PNG };
+    uint16_t        width  { 0 };
+    uint16_t        height { 0 };
+    // Compressed image as stored in the G-code comments, not base64 encoded.
+    std::string     data;
+};
+
+// Content of the binary G-code except for the G-code blocks.
+struct FileInfo
+{
+    Metadata               file_metadata;
+    Metadata               printer_metadata;
+    Metadata               print_metadata;
+    Metadata               slicer_metadata;
+    std::vector<Thumbnail> thumbnails;
+};
+
+// Line of the G-code decoded from a G-code block.
+struct Line
+{
+    enum class Type : uint8_t {
+        // Any line not stored as a move, including the lines of the thumbnails.
+        Text,
+        G0,
+        G1,
+    };
+    Type             type { Type::Text };
+    // Axes of a move, bit i set for the Slic3r::Axis i (X, Y, Z, E, F).
+    uint8_t          axes { 0 };
+    // Values of the axes of a move indexed by Slic3r::Axis, valid for the axes set.
+    double           values[5];
+    // Text of a text line, the rest of a move line following the axes (a comment) otherwise. Without the newline.
+    std::string_view text;
+    // Length of the line in the text G-code including its newline.
+    size_t           length { 0 };
+    // False for the last line of a G-code not ending with a newline.
+    bool             newline { true };
+};
+
+// Returns true if the data start with the binary G-code magic.
+bool is_binary(const char *data, size_t size);
+// Returns true if the file exists and starts with the binary G-code magic.
+bool is_binary_file(const std::string &path);
+// Returns true if the file starts with the magic of the binary G-code of the Prusa printers (.bgcode), which is not supported.
+bool is_unsupported_binary_file(const std::string &path);
+
+// Encodes a text G-code into the binary container.
+std::string to_binary(const std::string &gcode);
+// Decodes the binary container back to the text G-code.
+// Throws Slic3r::RuntimeError if the data are not a valid binary G-code or if a checksum does not match.
+std::string to_text(const std::string &binary);
+// Reads the metadata and the thumbnails, the G-code blocks are skipped without being inflated.
+// Throws Slic3r::RuntimeError if the data are not a valid binary G-code.
+FileInfo    read_info(const std::string &binary);
+FileInfo    read_file_info(const std::string &path);
+
+// Converts a text G-code file into a binary one and vice versa. src_path and dst_path may be the same.
+// Throws Slic3r::RuntimeError on error.
+void convert_to_binary(const std::string &src_path, const std::string &dst_path);
+void convert_to_text(const std::string &src_path, const std::string &dst_path);
+
+// Binary G-code file opened for reading. Only the metadata and the thumbnails are read when opening the file,
+// the G-code blocks are read and decoded when their lines or their text are accessed. Not thread safe.
+class File
+{
+public:
+    // Throws Slic3r::RuntimeError if the file could not be read or if it is not a valid binary G-code.
+    explicit File(const std::string &path);
+    ~File();
+
+    const FileInfo& info() const;
+
+    // Passes the lines of the G-code to callback in order, the thumbnails as text lines at their original positions.
+    // The moves are passed as decoded from the G-code blocks, their text is not formatted. The G-code blocks are decoded
+    // by batches in parallel. Stops if callback returns false.
+    // Throws Slic3r::RuntimeError if the file could not be read or if a checksum does not match.
+    void            for_each_line(const std::function<bool(const Line&)> &callback);
+
+    // Random access to the text G-code. The last decoded block is cached, thus reading the text sequentially
+    // or reading a few neighboring lines is cheap.
+    // Size of the text G-code.
+    size_t          size() const;
+    // Copies up to len bytes of the text G-code starting at offset to out. Returns the number of bytes copied, zero at the end of the text.
+    // Throws Slic3r::RuntimeError if the file could not be read or if a checksum does not match.
+    size_t          read(size_t offset, char *out, size_t len);
+    std::string     read(size_t offset, size_t len);
+
+    // Also decodes the binary G-code held in memory by to_text() and read_info().
+    struct Decoder;
+
+private:
+    std::unique_ptr<Decoder> m_decoder;
+};
+
+} // namespace BinaryGCode
+} // namespace Slic3r
+
+#endif /* slic3r_GCode_BinaryGCode_hpp_ */
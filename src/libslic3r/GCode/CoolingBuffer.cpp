@@ -303,61 +303,69 @@ finished:
 }
 
 std::string CoolingBuffer::process_layer(std::string &&gcode, size_t layer_id, bool flush)
+{
+    CoolingPreparedLayer prepared = this->prepare_layer(gcode);
+    return this->process_layer(std::move(gcode), std::move(prepared), layer_id, flush);
+}
+
+std::string CoolingBuffer::process_layer(std::string &&gcode, CoolingPreparedLayer &&prepared, size_t layer_id, bool flush)
 {
     // Cache the input G-code.
-    if (m_gcode.empty())
-        m_gcode = std::move(gcode);
-    else
+    if (m_gcode.empty()) {
+        m_gcode    = std::move(gcode);
+        m_prepared = std::move(prepared);
+    } else {
+        // The cached lines and the new lines were prepared separately. This is equal to preparing the concatenated G-code
+        // only if the cached G-code ends with a complete line and there is no zero character terminating the parsing early.
+        const bool   split_at_line = m_prepared.complete && m_gcode.back() == '\n';
+        const size_t offset        = m_gcode.size();
         m_gcode += gcode;
+        if (split_at_line) {
+            m_prepared.lines.reserve(m_prepared.lines.size() + prepared.lines.size());
+            for (CoolingPreparedLine &line : prepared.lines) {
+                line.line_start += offset;
+                line.line_end   += offset;
+                m_prepared.lines.emplace_back(line);
+            }
+            m_prepared.complete = prepared.complete;
+        } else
+            m_prepared = this->prepare_layer(m_gcode);
+    }
 
     std::string out;
     if (flush) {
         // This is either an object layer or the very last print layer. Calculate cool down over the collected support layers
         // and one object layer.
-        std::vector<PerExtruderAdjustments> per_extruder_adjustments = this->parse_layer_gcode(m_gcode, m_current_pos);
+        std::vector<PerExtruderAdjustments> per_extruder_adjustments = this->parse_layer_gcode(m_prepared, m_current_pos);
         float layer_time_stretched = this->calculate_layer_slowdown(per_extruder_adjustments);
         out = this->apply_layer_cooldown(m_gcode, layer_id, layer_time_stretched, per_extruder_adjustments);
         m_gcode.clear();
+        m_prepared.lines.clear();
     }
     return out;
 }
 
-// Parse the layer G-code for the moves, which could be adjusted.
-// Return the list of parsed lines, bucketed by an extruder.
-std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const
+// Split the layer G-code into lines and parse the lines, which could be adjusted.
+// Only the text of the lines is parsed here, the state of the cooling buffer is not touched.
+CoolingPreparedLayer CoolingBuffer::prepare_layer(const std::string &gcode) const
 {
-    std::vector<PerExtruderAdjustments> per_extruder_adjustments(m_extruder_ids.size());
-    std::vector<size_t>                 map_extruder_to_per_extruder_adjustment(m_num_extruders, 0);
-    for (size_t i = 0; i < m_extruder_ids.size(); ++ i) {
-        PerExtruderAdjustments &adj         = per_extruder_adjustments[i];
-        unsigned int            extruder_id = m_extruder_ids[i];
-        adj.extruder_id               = extruder_id;
-        adj.cooling_slow_down_enabled = m_config.cooling.get_at(extruder_id);
-        adj.slowdown_below_layer_time = float(m_config.slowdown_below_layer_time.get_at(extruder_id));
-        adj.min_print_speed           = float(m_config.min_print_speed.get_at(extruder_id));
-        map_extruder_to_per_extruder_adjustment[extruder_id] = i;
-    }
+    CoolingPreparedLayer out;
+    const char *line_start     = gcode.c_str();
+    const char *line_end       = line_start;
+    const char  extrusion_axis = get_extrusion_axis(m_config)[0];
 
-    unsigned int      current_extruder  = m_current_extruder;
-    PerExtruderAdjustments *adjustment  = &per_extruder_adjustments[map_extruder_to_per_extruder_adjustment[current_extruder]];
-    const char       *line_start = gcode.c_str();
-    const char       *line_end   = line_start;
-    const char        extrusion_axis = get_extrusion_axis(m_config)[0];
-    // Index of an existing CoolingLine of the current adjustment, which holds the feedrate setting command
-    // for a sequence of extrusion moves.
-    size_t            active_speed_modifier = size_t(-1);
-
-    std::vector<float> new_pos;
     for (; *line_start != 0; line_start = line_end) 
     {
         while (*line_end != '\n' && *line_end != 0)
             ++ line_end;
         // sline will not contain the trailing '\n'.
         std::string_view sline(line_start, line_end - line_start);
-        // CoolingLine will contain the trailing '\n'.
+        // CoolingPreparedLine will contain the trailing '\n'.
         if (*line_end == '\n')
             ++ line_end;
-        CoolingLine line(0, line_start - gcode.c_str(), line_end - gcode.c_str());
+        CoolingPreparedLine line;
+        line.line_start = line_start - gcode.c_str();
+        line.line_end   = line_end   - gcode.c_str();
         if (boost::starts_with(sline, "G0 "))
             line.type = CoolingLine::TYPE_G0;
         else if (boost::starts_with(sline, "G1 "))
@@ -367,7 +375,6 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
         if (line.type) {
             // G0, G1 or G92
             // Parse the G-code line.
-            new_pos = current_pos;
             for (auto c = sline.begin() + 3;;) {
                 // Skip whitespaces.
                 for (; c != sline.end() && (*c == ' ' || *c == '\t'); ++ c);
@@ -378,11 +385,18 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                 size_t axis = (*c >= 'X' && *c <= 'Z') ? (*c - 'X') :
                               (*c == extrusion_axis) ? 3 : (*c == 'F') ? 4 : size_t(-1);
                 if (axis != size_t(-1)) {
-                    //auto [pend, ec] = 
-                        fast_float::from_chars(&*(++ c), sline.data() + sline.size(), new_pos[axis]);
+                    auto [pend, ec] = fast_float::from_chars(&*(++ c), sline.data() + sline.size(), line.axes[axis]);
+                    // The axis keeps its previous value if the number could not be parsed.
+                    const bool parsed = ec != std::errc::invalid_argument;
+                    if (parsed)
+                        line.axes_set |= 1 << axis;
                     if (axis == 4) {
                         // Convert mm/min to mm/sec.
-                        new_pos[4] /= 60.f;
+                        if (parsed) {
+                            line.axes[4] /= 60.f;
+                            line.f_unparsed = 0;
+                        } else
+                            ++ line.f_unparsed;
                         if ((line.type & CoolingLine::TYPE_G92) == 0)
                             // This is G0 or G1 line and it sets the feedrate. This mark is used for reducing the duplicate F calls.
                             line.type |= CoolingLine::TYPE_HAS_F;
@@ -397,10 +411,103 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                 line.type |= CoolingLine::TYPE_EXTERNAL_PERIMETER;
             if (wipe)
                 line.type |= CoolingLine::TYPE_WIPE;
-            if (boost::contains(sline, ";_EXTRUDE_SET_SPEED") && ! wipe) {
+            if (boost::contains(sline, ";_EXTRUDE_SET_SPEED") && ! wipe)
                 line.type |= CoolingLine::TYPE_ADJUSTABLE;
-                active_speed_modifier = adjustment->lines.size();
+        } else if (boost::starts_with(sline, ";_EXTRUDE_END")) {
+            // Closing a block of non-zero length extrusion moves.
+            line.type = CoolingLine::TYPE_EXTRUDE_END;
+        } else if (boost::starts_with(sline, m_toolchange_prefix)) {
+            unsigned int new_extruder = 0;
+            auto res = std::from_chars(sline.data() + m_toolchange_prefix.size(), sline.data() + sline.size(), new_extruder);
+            if (res.ec != std::errc::invalid_argument) {
+                // Only change extruder in case the number is meaningful. User could provide an out-of-range index through custom gcodes - those shall be ignored.
+                if (new_extruder < m_num_extruders) {
+                    // The tool is only switched if the extruder differs from the current one, which is decided by parse_layer_gcode().
+                    line.type         = CoolingLine::TYPE_SET_TOOL;
+                    line.new_extruder = new_extruder;
+                }
+                else {
+                    // Only log the error in case of MM printer. Single extruder printers likely ignore any T anyway.
+                    if (m_num_extruders > 1)
+                        BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << sline;
+                }
+            }
+        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_START")) {
+            line.type = CoolingLine::TYPE_BRIDGE_FAN_START;
+        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_END")) {
+            line.type = CoolingLine::TYPE_BRIDGE_FAN_END;
+        } else if (boost::starts_with(sline, "G4 ")) {
+            // Parse the wait time.
+            line.type = CoolingLine::TYPE_G4;
+            size_t pos_S = sline.find('S', 3);
+            size_t pos_P = sline.find('P', 3);
+            bool   has_S = pos_S > 0;
+            bool   has_P = pos_P > 0;
+            if (has_S || has_P) {
+                //auto [pend, ec] = 
+                    fast_float::from_chars(sline.data() + (has_S ? pos_S : pos_P) + 1, sline.data() + sline.size(), line.time);
+                if (has_P)
+                    line.time *= 0.001f;
+            } else
+                line.time = 0;
+        } else if (boost::contains(sline, ";_SET_FAN_SPEED")) {
+            auto speed_start = sline.find_last_of('D');
+            int  speed       = 0;
+            for (char num : sline.substr(speed_start + 1)) {
+                speed = speed * 10 + (num - '0');
             }
+            line.type = CoolingLine::TYPE_SET_FAN_SPEED;
+            line.fan_speed = speed;
+        } else if (boost::contains(sline, ";_RESET_FAN_SPEED")) {
+            line.type = CoolingLine::TYPE_RESET_FAN_SPEED;
+        }
+
+        if (line.type != 0)
+            out.lines.emplace_back(line);
+    }
+
+    out.complete = line_start == gcode.c_str() + gcode.size();
+    return out;
+}
+
+// Calculate the durations of the lines prepared by prepare_layer(), which depend on the position
+// and on the extruder at the end of the previous layer.
+// Return the list of parsed lines, bucketed by an extruder.
+std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const CoolingPreparedLayer &prepared, std::vector<float> &current_pos) const
+{
+    std::vector<PerExtruderAdjustments> per_extruder_adjustments(m_extruder_ids.size());
+    std::vector<size_t>                 map_extruder_to_per_extruder_adjustment(m_num_extruders, 0);
+    for (size_t i = 0; i < m_extruder_ids.size(); ++ i) {
+        PerExtruderAdjustments &adj         = per_extruder_adjustments[i];
+        unsigned int            extruder_id = m_extruder_ids[i];
+        adj.extruder_id               = extruder_id;
+        adj.cooling_slow_down_enabled = m_config.cooling.get_at(extruder_id);
+        adj.slowdown_below_layer_time = float(m_config.slowdown_below_layer_time.get_at(extruder_id));
+        adj.min_print_speed           = float(m_config.min_print_speed.get_at(extruder_id));
+        map_extruder_to_per_extruder_adjustment[extruder_id] = i;
+    }
+
+    unsigned int      current_extruder  = m_current_extruder;
+    PerExtruderAdjustments *adjustment  = &per_extruder_adjustments[map_extruder_to_per_extruder_adjustment[current_extruder]];
+    // Index of an existing CoolingLine of the current adjustment, which holds the feedrate setting command
+    // for a sequence of extrusion moves.
+    size_t            active_speed_modifier = size_t(-1);
+
+    std::vector<float> new_pos;
+    for (const CoolingPreparedLine &prepared_line : prepared.lines)
+    {
+        CoolingLine line(prepared_line.type, prepared_line.line_start, prepared_line.line_end);
+        if (line.type & (CoolingLine::TYPE_G0 | CoolingLine::TYPE_G1 | CoolingLine::TYPE_G92)) {
+            // G0, G1 or G92
+            new_pos = current_pos;
+            for (size_t axis = 0; axis < 5; ++ axis)
+                if (prepared_line.axes_set & (1 << axis))
+                    new_pos[axis] = prepared_line.axes[axis];
+            // F words, which failed to parse, still convert the feedrate from mm/min to mm/sec.
+            for (unsigned int i = 0; i < prepared_line.f_unparsed; ++ i)
+                new_pos[4] /= 60.f;
+            if (line.type & CoolingLine::TYPE_ADJUSTABLE)
+                active_speed_modifier = adjustment->lines.size();
             if ((line.type & CoolingLine::TYPE_G92) == 0) {
                 // G0 or G1. Calculate the duration.
                 if (m_config.use_relative_e_distances.value)
@@ -448,9 +555,8 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                 }
             }
             current_pos = std::move(new_pos);
-        } else if (boost::starts_with(sline, ";_EXTRUDE_END")) {
+        } else if (line.type == CoolingLine::TYPE_EXTRUDE_END) {
             // Closing a block of non-zero length extrusion moves.
-            line.type = CoolingLine::TYPE_EXTRUDE_END;
             if (active_speed_modifier != size_t(-1)) {
                 assert(active_speed_modifier < adjustment->lines.size());
                 CoolingLine &sm = adjustment->lines[active_speed_modifier];
@@ -467,54 +573,18 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                 }
             }
             active_speed_modifier = size_t(-1);
-        } else if (boost::starts_with(sline, m_toolchange_prefix)) {
-            unsigned int new_extruder = 0;
-            auto res = std::from_chars(sline.data() + m_toolchange_prefix.size(), sline.data() + sline.size(), new_extruder);
-            if (res.ec != std::errc::invalid_argument) {
-                // Only change extruder in case the number is meaningful. User could provide an out-of-range index through custom gcodes - those shall be ignored.
-                if (new_extruder < map_extruder_to_per_extruder_adjustment.size()) {
-                    if (new_extruder != current_extruder) {
-                        // Switch the tool.
-                        line.type = CoolingLine::TYPE_SET_TOOL;
-                        current_extruder = new_extruder;
-                        adjustment         = &per_extruder_adjustments[map_extruder_to_per_extruder_adjustment[current_extruder]];
-                    }
-                }
-                else {
-                    // Only log the error in case of MM printer. Single extruder printers likely ignore any T anyway.
-                    if (map_extruder_to_per_extruder_adjustment.size() > 1)
-                        BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << sline;
-                }
-            }
-        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_START")) {
-            line.type = CoolingLine::TYPE_BRIDGE_FAN_START;
-        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_END")) {
-            line.type = CoolingLine::TYPE_BRIDGE_FAN_END;
-        } else if (boost::starts_with(sline, "G4 ")) {
-            // Parse the wait time.
-            line.type = CoolingLine::TYPE_G4;
-            size_t pos_S = sline.find('S', 3);
-            size_t pos_P = sline.find('P', 3);
-            bool   has_S = pos_S > 0;
-            bool   has_P = pos_P > 0;
-            if (has_S || has_P) {
-                //auto [pend, ec] = 
-                    fast_float::from_chars(sline.data() + (has_S ? pos_S : pos_P) + 1, sline.data() + sline.size(), line.time);
-                if (has_P)
-                    line.time *= 0.001f;
+        } else if (line.type == CoolingLine::TYPE_SET_TOOL) {
+            if (prepared_line.new_extruder != current_extruder) {
+                // Switch the tool.
+                current_extruder = prepared_line.new_extruder;
+                adjustment       = &per_extruder_adjustments[map_extruder_to_per_extruder_adjustment[current_extruder]];
             } else
-                line.time = 0;
+                line.type = 0;
+        } else if (line.type == CoolingLine::TYPE_G4) {
+            line.time     = prepared_line.time;
             line.time_max = line.time;
-        } else if (boost::contains(sline, ";_SET_FAN_SPEED")) {
-            auto speed_start = sline.find_last_of('D');
-            int  speed       = 0;
-            for (char num : sline.substr(speed_start + 1)) {
-                speed = speed * 10 + (num - '0');
-            }
-            line.type = CoolingLine::TYPE_SET_FAN_SPEED;
-            line.fan_speed = speed;
-        } else if (boost::contains(sline, ";_RESET_FAN_SPEED")) {
-            line.type = CoolingLine::TYPE_RESET_FAN_SPEED;
+        } else if (line.type == CoolingLine::TYPE_SET_FAN_SPEED) {
+            line.fan_speed = prepared_line.fan_speed;
         }
 
         if (line.type != 0)
@@ -11,6 +11,36 @@ class GCode;
 class Layer;
 struct PerExtruderAdjustments;
 
+// A G-code line relevant to the cooling buffer, parsed from the text of the line only.
+struct CoolingPreparedLine
+{
+    // CoolingLine::Type flags known from the line alone.
+    size_t          type { 0 };
+    // Start and end of this line in the G-code of the layer, the end includes the trailing '\n'.
+    size_t          line_start { 0 };
+    size_t          line_end { 0 };
+    // G0, G1, G92: X, Y, Z, E and F set by this line, F converted to mm/sec. Bit mask of the axes set.
+    float           axes[5] { 0.f, 0.f, 0.f, 0.f, 0.f };
+    unsigned char   axes_set { 0 };
+    // G0, G1, G92: Number of F words after the last parsed F, which failed to parse.
+    unsigned char   f_unparsed { 0 };
+    // Tool change: the new extruder.
+    unsigned int    new_extruder { 0 };
+    // G4: the wait time.
+    float           time { 0.f };
+    // Set fan speed: the requested fan speed.
+    int             fan_speed { 0 };
+};
+
+// Lines of a layer relevant to the cooling buffer. Preparing the lines does not depend on the previous layers,
+// thus the layers may be prepared in parallel and then passed to CoolingBuffer::process_layer() in order.
+struct CoolingPreparedLayer
+{
+    std::vector<CoolingPreparedLine> lines;
+    // False if a zero character terminated parsing before the end of the G-code.
+    bool                             complete { true };
+};
+
 // A standalone G-code filter, to control cooling of the print.
 // The G-code is processed per layer. Once a layer is collected, fan start / stop commands are edited
 // and the print is modified to stretch over a minimum layer time.
@@ -28,10 +58,15 @@ public:
     std::string process_layer(std::string &&gcode, size_t layer_id, bool flush);
     std::string process_layer(const std::string &gcode, size_t layer_id, bool flush)
         { return this->process_layer(std::string(gcode), layer_id, flush); }
+    // Process a layer, which was already prepared by prepare_layer().
+    std::string process_layer(std::string &&gcode, CoolingPreparedLayer &&prepared, size_t layer_id, bool flush);
+    // Parse the lines of a layer independently of the previous layers.
+    // Only reads the configuration, thus it may be called for multiple layers in parallel with process_layer().
+    CoolingPreparedLayer prepare_layer(const std::string &gcode) const;
 
 private:
 	CoolingBuffer& operator=(const CoolingBuffer&) = delete;
-    std::vector<PerExtruderAdjustments> parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const;
+    std::vector<PerExtruderAdjustments> parse_layer_gcode(const CoolingPreparedLayer &prepared, std::vector<float> &current_pos) const;
     float       calculate_layer_slowdown(std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
     // Apply slow down over G-code lines stored in per_extruder_adjustments, enable fan if needed.
     // Returns the adjusted G-code.
@@ -39,6 +74,8 @@ private:
 
     // G-code snippet cached for the support layers preceding an object layer.
     std::string                 m_gcode;
+    // Lines of m_gcode prepared by prepare_layer().
+    CoolingPreparedLayer        m_prepared;
     // Internal data.
     // X,Y,Z,E,F
     std::vector<char>           m_axis;
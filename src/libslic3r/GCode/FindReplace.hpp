@@ -13,7 +13,8 @@ public:
     GCodeFindReplace(const std::vector<std::string> &gcode_substitutions);
 
 
-    std::string process_layer(const std::string &gcode);
+    // Thread safe, the layers may be processed in parallel.
+    std::string process_layer(const std::string &gcode) const;
     
 private:
     struct Substitution {
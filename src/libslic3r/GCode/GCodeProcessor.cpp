@@ -7,6 +7,7 @@
 #include "libslic3r/GCodeWriter.hpp"
 #include "libslic3r/I18N.hpp"
 #include "GCodeProcessor.hpp"
+#include "BinaryGCode.hpp"
 
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/log/trivial.hpp>
@@ -26,6 +27,9 @@
 
 #include <chrono>
 
+#include <tbb/parallel_invoke.h>
+#include <tbb/task_arena.h>
+
 static const float DEFAULT_TOOLPATH_WIDTH = 0.4f;
 static const float DEFAULT_TOOLPATH_HEIGHT = 0.2f;
 
@@ -144,19 +148,19 @@ float GCodeProcessor::Trapezoid::cruise_distance() const
     return decelerate_after - accelerate_until;
 }
 
-void GCodeProcessor::TimeBlock::calculate_trapezoid()
+void GCodeProcessor::TimeBlock::calculate_trapezoid(float exit_feedrate)
 {
     trapezoid.cruise_feedrate = feedrate_profile.cruise;
 
     float accelerate_distance = std::max(0.0f, estimated_acceleration_distance(feedrate_profile.entry, feedrate_profile.cruise, acceleration));
-    float decelerate_distance = std::max(0.0f, estimated_acceleration_distance(feedrate_profile.cruise, feedrate_profile.exit, -acceleration));
+    float decelerate_distance = std::max(0.0f, estimated_acceleration_distance(feedrate_profile.cruise, exit_feedrate, -acceleration));
     float cruise_distance = distance - accelerate_distance - decelerate_distance;
 
     // Not enough space to reach the nominal feedrate.
     // This means no cruising, and we'll have to use intersection_distance() to calculate when to abort acceleration 
     // and start braking in order to reach the exit_feedrate exactly at the end of this block.
     if (cruise_distance < 0.0f) {
-        accelerate_distance = std::clamp(intersection_distance(feedrate_profile.entry, feedrate_profile.exit, acceleration, distance), 0.0f, distance);
+        accelerate_distance = std::clamp(intersection_distance(feedrate_profile.entry, exit_feedrate, acceleration, distance), 0.0f, distance);
         cruise_distance = 0.0f;
         trapezoid.cruise_feedrate = speed_from_distance(feedrate_profile.entry, accelerate_distance, acceleration);
     }
@@ -254,63 +258,78 @@ void planner_reverse_pass_kernel(GCodeProcessor::TimeBlock& curr, GCodeProcessor
     }
 }
 
-static void recalculate_trapezoids(std::vector<GCodeProcessor::TimeBlock>& blocks)
+static void recalculate_trapezoids(GCodeProcessor::TimeBlock* blocks_begin, GCodeProcessor::TimeBlock* blocks_end)
 {
-    GCodeProcessor::TimeBlock* curr = nullptr;
-    GCodeProcessor::TimeBlock* next = nullptr;
-
-    for (size_t i = 0; i < blocks.size(); ++i) {
-        GCodeProcessor::TimeBlock& b = blocks[i];
-
-        curr = next;
-        next = &b;
+    if (blocks_begin == blocks_end)
+        return;
 
-        if (curr != nullptr) {
-            // Recalculate if current block entry or exit junction speed has changed.
-            if (curr->flags.recalculate || next->flags.recalculate) {
-                // NOTE: Entry and exit factors always > 0 by all previous logic operations.
-                GCodeProcessor::TimeBlock block = *curr;
-                block.feedrate_profile.exit = next->feedrate_profile.entry;
-                block.calculate_trapezoid();
-                curr->trapezoid = block.trapezoid;
-                curr->flags.recalculate = false; // Reset current only to ensure next trapezoid is computed
-            }
+    // A trapezoid depends on its block and on the entry speed of the next block only, the next block's recalculate flag
+    // is reset by the following iteration. Thus the iterations are independent, without copying the blocks.
+    for (GCodeProcessor::TimeBlock* it = blocks_begin; it + 1 != blocks_end; ++it) {
+        GCodeProcessor::TimeBlock& curr = *it;
+        const GCodeProcessor::TimeBlock& next = *(it + 1);
+        // Recalculate if current block entry or exit junction speed has changed.
+        if (curr.flags.recalculate || next.flags.recalculate) {
+            // NOTE: Entry and exit factors always > 0 by all previous logic operations.
+            curr.calculate_trapezoid(next.feedrate_profile.entry);
+            curr.flags.recalculate = false; // Reset current only to ensure next trapezoid is computed
         }
     }
 
     // Last/newest block in buffer. Always recalculated.
-    if (next != nullptr) {
-        GCodeProcessor::TimeBlock block = *next;
-        block.feedrate_profile.exit = next->safe_feedrate;
-        block.calculate_trapezoid();
-        next->trapezoid = block.trapezoid;
-        next->flags.recalculate = false;
-    }
+    GCodeProcessor::TimeBlock& last = *(blocks_end - 1);
+    last.calculate_trapezoid(last.safe_feedrate);
+    last.flags.recalculate = false;
 }
 
 void GCodeProcessor::TimeMachine::calculate_time(size_t keep_last_n_blocks, float additional_time)
 {
-    if (!enabled || blocks.size() < 2)
+    if (!enabled)
+        return;
+
+    this->refresh();
+    if (blocks.size() < 2)
         return;
 
     assert(keep_last_n_blocks <= blocks.size());
+    this->calculate_time(0, blocks.size(), keep_last_n_blocks, additional_time);
+
+    if (keep_last_n_blocks)
+        blocks.erase(blocks.begin(), blocks.end() - keep_last_n_blocks);
+    else
+        blocks.clear();
+}
+
+void GCodeProcessor::TimeMachine::refresh()
+{
+    static constexpr size_t window = TimeProcessor::Planner::refresh_threshold + 1;
+    static constexpr size_t keep   = TimeProcessor::Planner::queue_size;
+    size_t begin = 0;
+    for (; blocks.size() - begin >= window; begin += window - keep)
+        this->calculate_time(begin, begin + window, keep, 0.0f);
+    blocks.erase(blocks.begin(), blocks.begin() + begin);
+}
+
+void GCodeProcessor::TimeMachine::calculate_time(size_t begin, size_t end, size_t keep_last_n_blocks, float additional_time)
+{
+    assert(begin + 2 <= end && end <= blocks.size() && keep_last_n_blocks <= end - begin);
 
     // forward_pass
-    for (size_t i = 0; i + 1 < blocks.size(); ++i) {
+    for (size_t i = begin; i + 1 < end; ++i) {
         planner_forward_pass_kernel(blocks[i], blocks[i + 1]);
     }
 
     // reverse_pass
-    for (int i = static_cast<int>(blocks.size()) - 1; i > 0; --i)
+    for (size_t i = end - 1; i > begin; --i)
         planner_reverse_pass_kernel(blocks[i - 1], blocks[i]);
 
-    recalculate_trapezoids(blocks);
+    recalculate_trapezoids(blocks.data() + begin, blocks.data() + end);
 
-    size_t n_blocks_process = blocks.size() - keep_last_n_blocks;
-    for (size_t i = 0; i < n_blocks_process; ++i) {
+    size_t n_blocks_process = end - begin - keep_last_n_blocks;
+    for (size_t i = begin; i < begin + n_blocks_process; ++i) {
         const TimeBlock& block = blocks[i];
         float block_time = block.time();
-        if (i == 0)
+        if (i == begin)
             block_time += additional_time;
 
         time += block_time;
@@ -335,11 +354,26 @@ void GCodeProcessor::TimeMachine::calculate_time(size_t keep_last_n_blocks, floa
         if (it_stop_time != stop_times.end() && it_stop_time->g1_line_id == block.g1_line_id)
             it_stop_time->elapsed_time = time;
     }
+}
 
-    if (keep_last_n_blocks)
-        blocks.erase(blocks.begin(), blocks.begin() + n_blocks_process);
-    else
-        blocks.clear();
+template<typename Fn>
+void GCodeProcessor::for_each_enabled_time_machine(Fn &&fn)
+{
+    static_assert(static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count) == 2, "Normal and stealth time machines expected");
+    TimeMachine& normal  = m_time_processor.machines[static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Normal)];
+    TimeMachine& stealth = m_time_processor.machines[static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Stealth)];
+    // Calculating a planner window of a single machine takes about 2us, waking up a worker thread takes longer.
+    // Calculating 1024 blocks takes about 13us per machine.
+    static constexpr size_t parallel_min_blocks = TimeProcessor::Planner::refresh_threshold * 4;
+    if (normal.enabled && stealth.enabled && std::min(normal.blocks.size(), stealth.blocks.size()) >= parallel_min_blocks &&
+        tbb::this_task_arena::max_concurrency() > 1)
+        tbb::parallel_invoke([&fn, &normal]() { fn(normal); }, [&fn, &stealth]() { fn(stealth); });
+    else {
+        if (normal.enabled)
+            fn(normal);
+        if (stealth.enabled)
+            fn(stealth);
+    }
 }
 
 void GCodeProcessor::TimeProcessor::reset()
@@ -438,7 +472,7 @@ void GCodeProcessor::UsedFilaments::process_caches(const GCodeProcessor* process
 
 #if ENABLE_GCODE_VIEWER_STATISTICS
 void GCodeProcessorResult::reset() {
-    moves = std::vector<GCodeProcessorResult::MoveVertex>();
+    moves = MoveVertices();
     bed_shape = Pointfs();
     max_print_height = 0.0f;
     settings_ids.reset();
@@ -540,6 +574,340 @@ bool GCodeProcessor::contains_reserved_tags(const std::string& gcode, unsigned i
     return ret;
 }
 
+static int time_in_minutes(float time_in_seconds)
+{
+    assert(time_in_seconds >= 0.f);
+    return int((time_in_seconds + 0.5f) / 60.0f);
+}
+
+static float time_in_last_minute(float time_in_seconds)
+{
+    assert(time_in_seconds <= 60.0f);
+    return time_in_seconds / 60.0f;
+}
+
+static std::string format_line_M73_main(const std::string& mask, int percent, int time)
+{
+    char line_M73[64];
+    sprintf(line_M73, mask.c_str(),
+        std::to_string(percent).c_str(),
+        std::to_string(time).c_str());
+    return std::string(line_M73);
+}
+
+static std::string format_line_M73_stop_int(const std::string& mask, int time)
+{
+    char line_M73[64];
+    sprintf(line_M73, mask.c_str(), std::to_string(time).c_str());
+    return std::string(line_M73);
+}
+
+static std::string format_time_float(float time)
+{
+    return Slic3r::float_to_string_decimal_point(time, 2);
+}
+
+static std::string format_line_M73_stop_float(const std::string& mask, float time)
+{
+    char line_M73[64];
+    sprintf(line_M73, mask.c_str(), format_time_float(time).c_str());
+    return std::string(line_M73);
+}
+
+// Post-processes the G-code exported through GCodeProcessor::process_buffer() in a single pass, while it is being exported:
+// inserts the M73 remaining time lines and the M104 lines preheating the next tool of the XL printer, replaces the placeholders.
+// A line is held until the time machines calculated the times of its moves, thus just a bounded window of the G-code is kept
+// in memory, and the footer of the G-code, which is post-processed once all the G-code was processed.
+// The values of the M73 lines depend on the total print time and on the printer stops to come. The M73 lines are inserted
+// at the elapsed times where they belong with fixed width placeholder values, which are replaced in place by patch_M73_lines().
+class GCodeProcessor::PostProcessor
+{
+public:
+    explicit PostProcessor(GCodeProcessor& processor);
+
+    // Hold the line just processed by GCodeProcessor::process_gcode_line(), without its end of line.
+    void push_line(const std::string& line);
+    // Post-process the lines held, whose moves were timed by all the time machines, or all the lines held if finished.
+    // The G-code to be written into the file is appended to out.
+    void process(bool finished, std::string& out);
+    // Write the values of the M73 lines into the G-code file, once all the lines were post-processed.
+    void patch_M73_lines(boost::nowide::fstream& file) const;
+
+private:
+    // The M73 lines are inserted each time the elapsed time advances by 1% of the time elapsed so far, so that they are spaced
+    // by 1% of the total time at most, but at least by M73_Min_Interval and at most by M73_Max_Interval seconds.
+    static constexpr float M73_Min_Interval = 6.0f;
+    static constexpr float M73_Max_Interval = 60.0f;
+    // Upper bound of the remaining time in minutes, the placeholders are wide enough to hold it.
+    static constexpr int   M73_Max_Minutes = 999999;
+
+    struct PendingLine
+    {
+        // Line with its end of line.
+        std::string line;
+        // GCodeProcessor::m_line_id, m_g1_line_id and m_layer_id after the line was processed.
+        unsigned int line_id;
+        unsigned int g1_line_id;
+        unsigned int layer_id;
+        // Number of the printer stops up to this line.
+        size_t stops;
+        // The line follows GCodeProcessor::begin_footer(), it is held until all the G-code was processed.
+        bool footer;
+    };
+
+    struct M73Line
+    {
+        // Position of the placeholder in the G-code file, known once it was written.
+        size_t file_pos;
+        unsigned char machine;
+        // Remaining time to the next printer stop, otherwise percentage and remaining time.
+        bool stop;
+        // Index of the next printer stop in TimeMachine::stop_times.
+        size_t stop_id;
+        float elapsed_time;
+    };
+
+    struct MachineTimes
+    {
+        // Entries of TimeMachine::g1_times_cache consumed.
+        size_t g1_times_cache_id{ 0 };
+        // Elapsed time after the last line post-processed and before it.
+        float elapsed_time{ 0.0f };
+        float elapsed_time_before{ 0.0f };
+        // Elapsed time, from which the next M73 line is inserted.
+        float next_M73_time{ M73_Min_Interval };
+    };
+
+    // Helper class to modify and export gcode lines
+    class ExportLines
+    {
+    public:
+        struct Backtrace
+        {
+            float time{ 60.0f };
+            unsigned int steps{ 10 };
+            float time_step() const { return time / float(steps); }
+        };
+
+        enum class EWriteType
+        {
+            BySize,
+            ByTime
+        };
+
+    private:
+        struct LineData
+        {
+            std::string line;
+            float time;
+            // Index of the M73 placeholder in PostProcessor::m_M73_lines, or -1.
+            int M73_line_id;
+        };
+
+#ifndef NDEBUG
+        class Statistics
+        {
+            ExportLines& m_parent;
+            size_t m_max_size{ 0 };
+            size_t m_lines_count{ 0 };
+            size_t m_max_lines_count{ 0 };
+
+        public:
+            explicit Statistics(ExportLines& parent)
+            : m_parent(parent)
+            {}
+
+            void add_line(size_t line_size) {
+                ++m_lines_count;
+                m_max_size = std::max(m_max_size, m_parent.get_size() + line_size);
+                m_max_lines_count = std::max(m_max_lines_count, m_lines_count);
+            }
+
+            void remove_line() { --m_lines_count; }
+            void remove_all_lines() { m_lines_count = 0; }
+        };
+
+        Statistics m_statistics;
+#endif // NDEBUG
+
+        EWriteType m_write_type{ EWriteType::BySize };
+        // Current time
+        float m_time{ 0.0f };
+        // Current size in bytes
+        size_t m_size{ 0 };
+
+        // gcode lines cache
+        std::deque<LineData> m_lines;
+        size_t m_added_lines_counter{ 0 };
+        // map of gcode line ids from original to final of the lines, whose moves were not synchronized yet
+        // used to update m_result.moves[].gcode_id
+        std::deque<std::pair<size_t, size_t>> m_gcode_lines_map;
+        // moves of m_result.moves with their gcode_id updated
+        size_t m_synchronized_moves{ 0 };
+
+        size_t m_written_lines{ 0 };
+        size_t m_out_file_pos{ 0 };
+
+    public:
+        explicit ExportLines(EWriteType type)
+#ifndef NDEBUG
+        : m_statistics(*this), m_write_type(type) {}
+#else
+        : m_write_type(type) {}
+#endif // NDEBUG
+
+        // start exporting the lines of the original line_id'th line, whose moves end at time
+        void update(size_t line_id, float time) {
+            m_gcode_lines_map.push_back({ line_id, 0 });
+            m_time = time;
+        }
+
+        // add the given gcode line to the cache
+        void append_line(const std::string& line, int M73_line_id = -1) {
+            m_lines.push_back({ line, m_time, M73_line_id });
+#ifndef NDEBUG
+            m_statistics.add_line(line.length());
+#endif // NDEBUG
+            m_size += line.length();
+            ++m_added_lines_counter;
+            assert(!m_gcode_lines_map.empty());
+            m_gcode_lines_map.back().second = m_added_lines_counter;
+        }
+
+        // Insert the gcode lines required by the command cmd by backtracing into the cache
+        void insert_lines(const Backtrace& backtrace, const std::string& cmd, std::function<std::string(unsigned int, float, float)> line_inserter,
+            std::function<std::string(const std::string&)> line_replacer) {
+            assert(!m_lines.empty());
+            const float time_step = backtrace.time_step();
+            size_t rev_it_dist = 0; // distance from the end of the cache of the starting point of the backtrace
+            float last_time_insertion = 0.0f; // used to avoid inserting two lines at the same time
+            for (unsigned int i = 0; i < backtrace.steps; ++i) {
+                const float backtrace_time_i = (i + 1) * time_step;
+                const float time_threshold_i = m_time - backtrace_time_i;
+                auto rev_it = m_lines.rbegin() + rev_it_dist;
+                auto start_rev_it = rev_it;
+
+                std::string curr_cmd = GCodeReader::GCodeLine::extract_cmd(rev_it->line);
+                // backtrace into the cache to find the place where to insert the line
+                while (rev_it != m_lines.rend() && rev_it->time > time_threshold_i && curr_cmd != cmd && curr_cmd != "G28" && curr_cmd != "G29") {
+                    rev_it->line = line_replacer(rev_it->line);
+                    ++rev_it;
+                    if (rev_it != m_lines.rend())
+                        curr_cmd = GCodeReader::GCodeLine::extract_cmd(rev_it->line);
+                }
+
+                // we met the previous evenience of cmd, or a G28/G29 command. stop inserting lines
+                if (rev_it != m_lines.rend() && (curr_cmd == cmd || curr_cmd == "G28" || curr_cmd == "G29"))
+                    break;
+
+                // insert the line for the current step
+                if (rev_it != m_lines.rend() && rev_it != start_rev_it && rev_it->time != last_time_insertion) {
+                    last_time_insertion = rev_it->time;
+                    const std::string out_line = line_inserter(i + 1, last_time_insertion, m_time - last_time_insertion);
+                    rev_it_dist = std::distance(m_lines.rbegin(), rev_it) + 1;
+                    m_lines.insert(rev_it.base(), { out_line, rev_it->time, -1 });
+#ifndef NDEBUG
+                    m_statistics.add_line(out_line.length());
+#endif // NDEBUG
+                    m_size += out_line.length();
+                    // synchronize gcode lines map, the lines already written are not in the map
+                    const size_t num_shifted = std::min(rev_it_dist - 1, m_gcode_lines_map.size());
+                    for (auto map_it = m_gcode_lines_map.rbegin(); map_it != m_gcode_lines_map.rbegin() + num_shifted; ++map_it) {
+                        ++map_it->second;
+                    }
+
+                    ++m_added_lines_counter;
+                }
+            }
+        }
+
+        // write to out:
+        // m_write_type == EWriteType::ByTime - all lines older than m_time - backtrace_time
+        // m_write_type == EWriteType::BySize - all lines if current size is greater than 65535 bytes
+        void write(std::string& out, float backtrace_time, GCodeProcessorResult& result, std::vector<M73Line>& M73_lines) {
+            if (m_write_type == EWriteType::ByTime) {
+                while (!m_lines.empty() && m_lines.front().time < m_time - backtrace_time) {
+                    m_size -= m_lines.front().line.length();
+                    write_line(out, result, M73_lines);
+#ifndef NDEBUG
+                    m_statistics.remove_line();
+#endif // NDEBUG
+                }
+            }
+            else if (m_size > 65535)
+                flush(out, result, M73_lines);
+        }
+
+        // flush the current content of the cache to out
+        void flush(std::string& out, GCodeProcessorResult& result, std::vector<M73Line>& M73_lines) {
+            while (!m_lines.empty())
+                write_line(out, result, M73_lines);
+            m_size = 0;
+#ifndef NDEBUG
+            m_statistics.remove_all_lines();
+#endif // NDEBUG
+        }
+
+        // update gcode_id of the moves of the lines written, up to the moves of the original line_id'th line
+        void synchronize_moves(GCodeProcessorResult& result, size_t line_id) {
+            while (!m_gcode_lines_map.empty() && m_gcode_lines_map.front().second <= m_written_lines && m_gcode_lines_map.front().first <= line_id) {
+                const auto [gcode_id, final_gcode_id] = m_gcode_lines_map.front();
+                for (; m_synchronized_moves < result.moves.size() && result.moves.gcode_id(m_synchronized_moves) <= gcode_id; ++m_synchronized_moves) {
+                    if (result.moves.gcode_id(m_synchronized_moves) == gcode_id)
+                        result.moves.set_gcode_id(m_synchronized_moves, final_gcode_id);
+                }
+                m_gcode_lines_map.pop_front();
+            }
+        }
+
+        size_t get_size() const { return m_size; }
+
+    private:
+        void write_line(std::string& out, GCodeProcessorResult& result, std::vector<M73Line>& M73_lines) {
+            const LineData& data = m_lines.front();
+            if (data.M73_line_id != -1)
+                M73_lines[data.M73_line_id].file_pos = m_out_file_pos;
+            out += data.line;
+            m_out_file_pos += data.line.size();
+            result.lines_ends.emplace_back(m_out_file_pos);
+            ++m_written_lines;
+            m_lines.pop_front();
+        }
+    };
+
+    // Insert M73 lines before the G1 line
+    void process_line_G1(size_t stops);
+    // Insert M104 lines before the T line
+    void process_line_T(const std::string& gcode_line, unsigned int layer_id, const ExportLines::Backtrace& backtrace);
+    // Replace placeholder lines with the proper final value
+    bool process_placeholders(const std::string& gcode_line);
+    bool process_used_filament(std::string& gcode_line) const;
+    void append_M73_line(size_t machine_id, bool stop, size_t stop_id, float elapsed_time);
+    // Placeholder of an M73 line for the time machine, fixed width comment line.
+    std::string M73_placeholder(size_t machine_id, bool stop) const;
+
+    GCodeProcessor&             m_processor;
+    std::deque<PendingLine>     m_lines;
+    ExportLines                 m_export_lines;
+    std::vector<M73Line>        m_M73_lines;
+    // Widths of the main and stop M73 lines of the time machines, without the end of line.
+    std::array<std::array<size_t, 2>, static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count)> m_M73_widths;
+    std::array<MachineTimes, static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count)> m_times;
+    // In case there are multiple sources of backtracing, keeps track of the longest backtrack time needed
+    // to flush the backtrace cache accordingly
+    float                       m_max_backtrace_time{ 120.0f };
+
+    // Used filament, known once all the G-code was processed.
+    bool                        m_filament_valid{ false };
+    std::vector<double>         m_filament_mm;
+    std::vector<double>         m_filament_cm3;
+    std::vector<double>         m_filament_g;
+    std::vector<double>         m_filament_cost;
+    double                      m_filament_total_g{ 0.0 };
+    double                      m_filament_total_cost{ 0.0 };
+};
+
+
 GCodeProcessor::GCodeProcessor()
 : m_options_z_corrector(m_result)
 {
@@ -989,6 +1357,9 @@ void GCodeProcessor::reset()
 
     m_time_processor.reset();
     m_used_filaments.reset();
+    m_post_processor.reset();
+    m_footer_begun = false;
+    m_printer_stops_count = 0;
 
     m_result.reset();
     m_result.id = ++s_result_id;
@@ -1024,6 +1395,16 @@ static inline const char* remove_eols(const char *begin, const char *end) {
 // throws CanceledException through print->throw_if_canceled() (sent by the caller as callback).
 void GCodeProcessor::process_file(const std::string& filename, std::function<void()> cancel_callback)
 {
+    if (BinaryGCode::is_unsupported_binary_file(filename))
+        throw Slic3r::RuntimeError(format("%1% is a binary G-code of the Prusa printers (.bgcode), which is not supported. "
+            "Only binary G-codes exported by %2% (.sbgc) may be loaded.", filename, SLIC3R_APP_NAME));
+    // The moves of a binary G-code are passed to the G-code reader as decoded, their text is not formatted and parsed.
+    // GCodeProcessorResult::lines_ends point into the text G-code, thus the G-code window of the viewer reads the lines
+    // from the binary G-code through BinaryGCode::File.
+    std::unique_ptr<BinaryGCode::File> binary_file;
+    if (BinaryGCode::is_binary_file(filename))
+        binary_file = std::make_unique<BinaryGCode::File>(filename);
+
     CNumericLocalesSetter locales_setter;
 
 #if ENABLE_GCODE_VIEWER_STATISTICS
@@ -1033,7 +1414,7 @@ void GCodeProcessor::process_file(const std::string& filename, std::function<voi
     // pre-processing
     // parse the gcode file to detect its producer
     {
-        m_parser.parse_file_raw(filename, [this](GCodeReader& reader, const char *begin, const char *end) {
+        auto detect_producer_callback = [this](GCodeReader& reader, const char *begin, const char *end) {
             begin = skip_whitespaces(begin, end);
             if (begin != end && *begin == ';') {
                 // Comment.
@@ -1042,7 +1423,15 @@ void GCodeProcessor::process_file(const std::string& filename, std::function<voi
                 if (begin != end && detect_producer(std::string_view(begin, end - begin)))
                     m_parser.quit_parsing();
             }
-        });
+        };
+        if (binary_file)
+            binary_file->for_each_line([this, &detect_producer_callback](const BinaryGCode::Line &line) {
+                if (line.type == BinaryGCode::Line::Type::Text)
+                    detect_producer_callback(m_parser, line.text.data(), line.text.data() + line.text.size());
+                return m_producer == EProducer::Unknown;
+            });
+        else
+            m_parser.parse_file_raw(filename, detect_producer_callback);
         m_parser.reset();
 
         // if the gcode was produced by PrusaSlicer,
@@ -1056,6 +1445,11 @@ void GCodeProcessor::process_file(const std::string& filename, std::function<voi
             config.load_from_gcode_file(filename, ForwardCompatibilitySubstitutionRule::EnableSilent);
             apply_config(config);
         }
+        else if (binary_file) {
+            // The binary G-code is exported by PrusaSlicer only, the configurations of the other slicers are not looked for.
+            m_result.extruder_colors = DEFAULT_EXTRUDER_COLORS;
+            m_result.extruders_count = MIN_EXTRUDERS_COUNT;
+        }
         else {
             m_result.extruder_colors = DEFAULT_EXTRUDER_COLORS;
 
@@ -1076,7 +1470,7 @@ void GCodeProcessor::process_file(const std::string& filename, std::function<voi
     m_result.id = ++s_result_id;
     initialize_result_moves();
     size_t parse_line_callback_cntr = 10000;
-    m_parser.parse_file(filename, [this, cancel_callback, &parse_line_callback_cntr](GCodeReader& reader, const GCodeReader::GCodeLine& line) {
+    auto   parse_line_callback = [this, cancel_callback, &parse_line_callback_cntr](GCodeReader& reader, const GCodeReader::GCodeLine& line) {
         if (-- parse_line_callback_cntr == 0) {
             // Don't call the cancel_callback() too often, do it every at every 10000'th line.
             parse_line_callback_cntr = 10000;
@@ -1084,7 +1478,35 @@ void GCodeProcessor::process_file(const std::string& filename, std::function<voi
                 cancel_callback();
         }
         this->process_gcode_line(line, true);
-    }, m_result.lines_ends);
+    };
+    if (binary_file) {
+        m_result.lines_ends.clear();
+        GCodeReader::GCodeLine gline;
+        size_t                 offset = 0;
+        binary_file->for_each_line([this, &parse_line_callback, &gline, &offset](const BinaryGCode::Line &line) {
+            if (line.type == BinaryGCode::Line::Type::Text) {
+                // Split at the carriage returns the same way GCodeReader::parse_file() does.
+                const char *ptr = line.text.data();
+                const char *end = ptr + line.text.size();
+                do {
+                    const char *eol = std::find(ptr, end, '\r');
+                    gline.reset();
+                    m_parser.parse_line(ptr, eol, gline, parse_line_callback);
+                    ptr = (eol == end) ? end : eol + 1;
+                } while (ptr != end);
+            } else {
+                float values[NUM_AXES];
+                for (size_t axis = 0; axis < NUM_AXES; ++ axis)
+                    values[axis] = (line.axes & (1 << axis)) ? float(line.values[axis]) : 0.f;
+                m_parser.parse_move(line.type == BinaryGCode::Line::Type::G1, line.axes, values, line.text, gline, parse_line_callback);
+            }
+            offset += line.length;
+            if (line.newline)
+                m_result.lines_ends.emplace_back(offset);
+            return true;
+        });
+    } else
+        m_parser.parse_file(filename, parse_line_callback, m_result.lines_ends);
 
     // Don't post-process the G-code to update time stamps.
     this->finalize(false);
@@ -1101,34 +1523,34 @@ void GCodeProcessor::initialize(const std::string& filename)
     // process gcode
     m_result.filename = filename;
     m_result.id = ++s_result_id;
+    m_result.lines_ends.clear();
+    m_post_processor.reset();
 }
 
-void GCodeProcessor::process_buffer(const std::string &buffer)
+void GCodeProcessor::process_buffer(const std::string &buffer, std::string &out)
 {
+    if (! m_post_processor)
+        m_post_processor = std::make_unique<PostProcessor>(*this);
     //FIXME maybe cache GCodeLine gline to be over multiple parse_buffer() invocations.
     m_parser.parse_buffer(buffer, [this](GCodeReader&, const GCodeReader::GCodeLine& line) { 
         this->process_gcode_line(line, false);
+        m_post_processor->push_line(line.raw());
     });
+    m_post_processor->process(false, out);
 }
 
 void GCodeProcessor::finalize(bool perform_post_process)
 {
-    // update width/height of wipe moves
-    for (GCodeProcessorResult::MoveVertex& move : m_result.moves) {
-        if (move.type == EMoveType::Wipe) {
-            move.width = Wipe_Width;
-            move.height = Wipe_Height;
-        }
-    }
+    // all moves were stored, release the memory used to deduplicate their attributes
+    m_result.moves.shrink_to_fit();
 
     // process the time blocks
-    for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-        TimeMachine& machine = m_time_processor.machines[i];
+    for_each_enabled_time_machine([](TimeMachine& machine) {
         TimeMachine::CustomGCodeTime& gcode_time = machine.gcode_time;
         machine.calculate_time();
         if (gcode_time.needed && gcode_time.cache != 0.0f)
             gcode_time.times.push_back({ CustomGCode::ColorChange, gcode_time.cache });
-    }
+    });
 
     m_used_filaments.process_caches(this);
 
@@ -2650,11 +3072,13 @@ void GCodeProcessor::process_G1(const std::array<std::optional<double>, 4>& axes
         prev = curr;
 
         blocks.push_back(block);
-
-        if (blocks.size() > TimeProcessor::Planner::refresh_threshold)
-            machine.calculate_time(TimeProcessor::Planner::queue_size);
     }
 
+    const size_t refresh_threshold = m_deferred_time_refresh ? TimeProcessor::Planner::deferred_refresh_threshold : TimeProcessor::Planner::refresh_threshold;
+    if (std::any_of(m_time_processor.machines.begin(), m_time_processor.machines.end(),
+        [refresh_threshold](const TimeMachine& machine) { return machine.enabled && machine.blocks.size() > refresh_threshold; }))
+        for_each_enabled_time_machine([](TimeMachine& machine) { machine.refresh(); });
+
     if (m_seams_detector.is_active()) {
         // check for seam starting vertex
         if (type == EMoveType::Extrude && m_extrusion_role == GCodeExtrusionRole::ExternalPerimeter && !m_seams_detector.has_first_vertex())
@@ -3426,623 +3850,332 @@ void GCodeProcessor::process_T(const std::string_view command)
     }
 }
 
-void GCodeProcessor::post_process()
+GCodeProcessor::PostProcessor::PostProcessor(GCodeProcessor& processor)
+    : m_processor(processor)
+    , m_export_lines(processor.m_result.backtrace_enabled ? ExportLines::EWriteType::ByTime : ExportLines::EWriteType::BySize)
 {
-    FilePtr in{ boost::nowide::fopen(m_result.filename.c_str(), "rb") };
-    if (in.f == nullptr)
-        throw Slic3r::RuntimeError(std::string("GCode processor post process export failed.\nCannot open file for reading.\n"));
-
-    // temporary file to contain modified gcode
-    std::string out_path = m_result.filename + ".postprocess";
-    FilePtr out{ boost::nowide::fopen(out_path.c_str(), "wb") };
-    if (out.f == nullptr) {
-        throw Slic3r::RuntimeError(std::string("GCode processor post process export failed.\nCannot open file for writing.\n"));
+    for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
+        const TimeMachine& machine = m_processor.m_time_processor.machines[i];
+        m_M73_widths[i] = { format_line_M73_main(machine.line_m73_main_mask, 100, M73_Max_Minutes).size() - 1,
+                            format_line_M73_stop_int(machine.line_m73_stop_mask, M73_Max_Minutes).size() - 1 };
     }
+}
 
-    auto time_in_minutes = [](float time_in_seconds) {
-        assert(time_in_seconds >= 0.f);
-        return int((time_in_seconds + 0.5f) / 60.0f);
-    };
-
-    auto time_in_last_minute = [](float time_in_seconds) {
-        assert(time_in_seconds <= 60.0f);
-        return time_in_seconds / 60.0f;
-    };
-
-    auto format_line_M73_main = [](const std::string& mask, int percent, int time) {
-        char line_M73[64];
-        sprintf(line_M73, mask.c_str(),
-            std::to_string(percent).c_str(),
-            std::to_string(time).c_str());
-        return std::string(line_M73);
-    };
-
-    auto format_line_M73_stop_int = [](const std::string& mask, int time) {
-        char line_M73[64];
-        sprintf(line_M73, mask.c_str(), std::to_string(time).c_str());
-        return std::string(line_M73);
-    };
-
-    auto format_time_float = [](float time) {
-        return Slic3r::float_to_string_decimal_point(time, 2);
-    };
+void GCodeProcessor::PostProcessor::push_line(const std::string& line)
+{
+    PendingLine& pending = m_lines.emplace_back();
+    pending.line.reserve(line.size() + 1);
+    pending.line = line;
+    pending.line += '\n';
+    pending.line_id    = m_processor.m_line_id;
+    pending.g1_line_id = m_processor.m_g1_line_id;
+    pending.layer_id   = m_processor.m_layer_id;
+    pending.stops      = m_processor.m_time_processor.machines[static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Normal)].stop_times.size();
+    pending.footer     = m_processor.m_footer_begun;
+}
 
-    auto format_line_M73_stop_float = [format_time_float](const std::string& mask, float time) {
-        char line_M73[64];
-        sprintf(line_M73, mask.c_str(), format_time_float(time).c_str());
-        return std::string(line_M73);
+void GCodeProcessor::PostProcessor::process(bool finished, std::string& out)
+{
+    std::array<TimeMachine, static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count)>& machines = m_processor.m_time_processor.machines;
+    // The moves of a line were timed, if no block of the line or of a preceding line waits to be calculated.
+    auto timed = [&machines](unsigned int g1_line_id) {
+        return std::none_of(machines.begin(), machines.end(), [g1_line_id](const TimeMachine& machine) {
+            return machine.enabled && ! machine.blocks.empty() && machine.blocks.front().g1_line_id <= g1_line_id;
+        });
     };
 
-    std::string gcode_line;
-    size_t g1_lines_counter = 0;
-    // keeps track of last exported pair <percent, remaining time>
-    std::array<std::pair<int, int>, static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count)> last_exported_main;
-    for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-        last_exported_main[i] = { 0, time_in_minutes(m_time_processor.machines[i].time) };
-    }
-
-    // keeps track of last exported remaining time to next printer stop
-    std::array<int, static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count)> last_exported_stop;
-    for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-        last_exported_stop[i] = time_in_minutes(m_time_processor.machines[i].time);
+    if (finished && ! m_filament_valid) {
+        const GCodeProcessorResult& result = m_processor.m_result;
+        m_filament_mm.assign(result.extruders_count, 0.0);
+        m_filament_cm3.assign(result.extruders_count, 0.0);
+        m_filament_g.assign(result.extruders_count, 0.0);
+        m_filament_cost.assign(result.extruders_count, 0.0);
+        for (const auto& [id, volume] : result.print_statistics.volumes_per_extruder) {
+            m_filament_mm[id]   = volume / (static_cast<double>(M_PI) * sqr(0.5 * result.filament_diameters[id]));
+            m_filament_cm3[id]  = volume * 0.001;
+            m_filament_g[id]    = m_filament_cm3[id] * double(result.filament_densities[id]);
+            m_filament_cost[id] = m_filament_g[id] * double(result.filament_cost[id]) * 0.001;
+            m_filament_total_g    += m_filament_g[id];
+            m_filament_total_cost += m_filament_cost[id];
+        }
+        m_filament_valid = true;
     }
 
-    // Helper class to modify and export gcode to file
-    class ExportLines
-    {
-    public:
-        struct Backtrace
-        {
-            float time{ 60.0f };
-            unsigned int steps{ 10 };
-            float time_step() const { return time / float(steps); }
-        };
-
-        enum class EWriteType
-        {
-            BySize,
-            ByTime
-        };
-
-    private:
-        struct LineData
-        {
-            std::string line;
-            float time;
-        };
-
-#ifndef NDEBUG
-        class Statistics
-        {
-            ExportLines& m_parent;
-            size_t m_max_size{ 0 };
-            size_t m_lines_count{ 0 };
-            size_t m_max_lines_count{ 0 };
-
-        public:
-            explicit Statistics(ExportLines& parent)
-            : m_parent(parent)
-            {}
-
-            void add_line(size_t line_size) {
-                ++m_lines_count;
-                m_max_size = std::max(m_max_size, m_parent.get_size() + line_size);
-                m_max_lines_count = std::max(m_max_lines_count, m_lines_count);
-            }
-
-            void remove_line() { --m_lines_count; }
-            void remove_all_lines() { m_lines_count = 0; }
-        };
-
-        Statistics m_statistics;
-#endif // NDEBUG
-
-        EWriteType m_write_type{ EWriteType::BySize };
-        // Time machine containing g1 times cache
-        TimeMachine& m_machine;
-        // Current time
-        float m_time{ 0.0f };
-        // Current size in bytes
-        size_t m_size{ 0 };
-
-        // gcode lines cache
-        std::deque<LineData> m_lines;
-        size_t m_added_lines_counter{ 0 };
-        // map of gcode line ids from original to final 
-        // used to update m_result.moves[].gcode_id
-        std::vector<std::pair<size_t, size_t>> m_gcode_lines_map;
-
-        size_t m_curr_g1_id{ 0 };
-        size_t m_out_file_pos{ 0 };
-
-    public:
-        ExportLines(EWriteType type, TimeMachine& machine)
-#ifndef NDEBUG
-        : m_statistics(*this), m_write_type(type), m_machine(machine) {}
-#else
-        : m_write_type(type), m_machine(machine) {}
-#endif // NDEBUG
-
-        void update(size_t lines_counter, size_t g1_lines_counter) {
-            m_gcode_lines_map.push_back({ lines_counter, 0 });
-
-            if (g1_lines_counter == 0)
-                return;
-
-            auto init_it = m_machine.g1_times_cache.begin() + m_curr_g1_id;
-            auto it = init_it;
-            while (it != m_machine.g1_times_cache.end() && it->id < g1_lines_counter + 1) {
-                ++it;
-                ++m_curr_g1_id;
-            }
+    // Backtrace data for Tx gcode lines
+    static const ExportLines::Backtrace backtrace_T = { 120.0f, 10 };
 
-            if ((it != m_machine.g1_times_cache.end() && it != init_it) || m_curr_g1_id == 0)
-                m_time = it->elapsed_time;
+    for (; ! m_lines.empty() && (finished || (! m_lines.front().footer && timed(m_lines.front().g1_line_id))); m_lines.pop_front()) {
+        PendingLine& pending = m_lines.front();
+        // Elapsed times before and after the moves of this line.
+        for (size_t i = 0; i < machines.size(); ++i) {
+            const TimeMachine& machine = machines[i];
+            MachineTimes&      times   = m_times[i];
+            times.elapsed_time_before = times.elapsed_time;
+            for (; times.g1_times_cache_id < machine.g1_times_cache.size() && machine.g1_times_cache[times.g1_times_cache_id].id <= pending.g1_line_id; ++times.g1_times_cache_id)
+                times.elapsed_time = machine.g1_times_cache[times.g1_times_cache_id].elapsed_time;
         }
-
-        // add the given gcode line to the cache
-        void append_line(const std::string& line) {
-            m_lines.push_back({ line, m_time });
-#ifndef NDEBUG
-            m_statistics.add_line(line.length());
-#endif // NDEBUG
-            m_size += line.length();
-            ++m_added_lines_counter;
-            assert(!m_gcode_lines_map.empty());
-            m_gcode_lines_map.back().second = m_added_lines_counter;
-        }
-
-        // Insert the gcode lines required by the command cmd by backtracing into the cache
-        void insert_lines(const Backtrace& backtrace, const std::string& cmd, std::function<std::string(unsigned int, float, float)> line_inserter,
-            std::function<std::string(const std::string&)> line_replacer) {
-            assert(!m_lines.empty());
-            const float time_step = backtrace.time_step();
-            size_t rev_it_dist = 0; // distance from the end of the cache of the starting point of the backtrace
-            float last_time_insertion = 0.0f; // used to avoid inserting two lines at the same time
-            for (unsigned int i = 0; i < backtrace.steps; ++i) {
-                const float backtrace_time_i = (i + 1) * time_step;
-                const float time_threshold_i = m_time - backtrace_time_i;
-                auto rev_it = m_lines.rbegin() + rev_it_dist;
-                auto start_rev_it = rev_it;
-
-                std::string curr_cmd = GCodeReader::GCodeLine::extract_cmd(rev_it->line);
-                // backtrace into the cache to find the place where to insert the line
-                while (rev_it != m_lines.rend() && rev_it->time > time_threshold_i && curr_cmd != cmd && curr_cmd != "G28" && curr_cmd != "G29") {
-                    rev_it->line = line_replacer(rev_it->line);
-                    ++rev_it;
-                    curr_cmd = GCodeReader::GCodeLine::extract_cmd(rev_it->line);
-                }
-
-                // we met the previous evenience of cmd, or a G28/G29 command. stop inserting lines
-                if (rev_it != m_lines.rend() && (curr_cmd == cmd || curr_cmd == "G28" || curr_cmd == "G29"))
-                    break;
-
-                // insert the line for the current step
-                if (rev_it != m_lines.rend() && rev_it != start_rev_it && rev_it->time != last_time_insertion) {
-                    last_time_insertion = rev_it->time;
-                    const std::string out_line = line_inserter(i + 1, last_time_insertion, m_time - last_time_insertion);
-                    rev_it_dist = std::distance(m_lines.rbegin(), rev_it) + 1;
-                    m_lines.insert(rev_it.base(), { out_line, rev_it->time });
-#ifndef NDEBUG
-                    m_statistics.add_line(out_line.length());
-#endif // NDEBUG
-                    m_size += out_line.length();
-                    // synchronize gcode lines map
-                    for (auto map_it = m_gcode_lines_map.rbegin(); map_it != m_gcode_lines_map.rbegin() + rev_it_dist - 1; ++map_it) {
-                        ++map_it->second;
-                    }
-
-                    ++m_added_lines_counter;
-                }
+        m_export_lines.update(pending.line_id, m_times.front().elapsed_time);
+
+        std::string& gcode_line = pending.line;
+        // replace placeholder lines
+        bool processed = process_placeholders(gcode_line);
+        if (processed)
+            gcode_line.clear();
+        if (!processed && finished)
+            processed = process_used_filament(gcode_line);
+        if (!processed) {
+            if (GCodeReader::GCodeLine::cmd_is(gcode_line, "G1"))
+                // add lines M73 where needed
+                process_line_G1(pending.stops);
+            else if (m_processor.m_result.backtrace_enabled && GCodeReader::GCodeLine::cmd_starts_with(gcode_line, "T")) {
+                // add lines XXX where needed
+                process_line_T(gcode_line, pending.layer_id, backtrace_T);
+                m_max_backtrace_time = std::max(m_max_backtrace_time, backtrace_T.time);
             }
         }
 
-        // write to file:
-        // m_write_type == EWriteType::ByTime - all lines older than m_time - backtrace_time
-        // m_write_type == EWriteType::BySize - all lines if current size is greater than 65535 bytes
-        void write(FilePtr& out, float backtrace_time, GCodeProcessorResult& result, const std::string& out_path) {
-            if (m_lines.empty())
-                return;
-
-            // collect lines to write into a single string
-            std::string out_string;
-            if (!m_lines.empty()) {
-                if (m_write_type == EWriteType::ByTime) {
-                    while (m_lines.front().time < m_time - backtrace_time) {
-                        const LineData& data = m_lines.front();
-                        out_string += data.line;
-                        m_size -= data.line.length();
-                        m_lines.pop_front();
-#ifndef NDEBUG
-                        m_statistics.remove_line();
-#endif // NDEBUG
-                    }
-                }
-                else {
-                    if (m_size > 65535) {
-                        while (!m_lines.empty()) {
-                            out_string += m_lines.front().line;
-                            m_lines.pop_front();
-                        }
-                        m_size = 0;
-#ifndef NDEBUG
-                        m_statistics.remove_all_lines();
-#endif // NDEBUG
-                    }
-                }
-            }
+        if (!gcode_line.empty())
+            m_export_lines.append_line(gcode_line);
+    }
 
-            write_to_file(out, out_string, result, out_path);
+    if (finished)
+        m_export_lines.flush(out, m_processor.m_result, m_M73_lines);
+    else
+        m_export_lines.write(out, 1.1f * m_max_backtrace_time, m_processor.m_result, m_M73_lines);
+    // The moves to be stored yet refer to m_last_line_id (seams) or to the following lines.
+    const unsigned int last_line_id = m_processor.m_last_line_id;
+    m_export_lines.synchronize_moves(m_processor.m_result, finished ? std::numeric_limits<size_t>::max() : size_t(std::max(last_line_id, 1u) - 1));
+
+    // The cached times are not used anymore once they were consumed.
+    for (size_t i = 0; i < machines.size(); ++i) {
+        std::vector<TimeMachine::G1LinesCacheItem>& g1_times_cache = machines[i].g1_times_cache;
+        MachineTimes& times = m_times[i];
+        if (times.g1_times_cache_id > 65536 && 2 * times.g1_times_cache_id > g1_times_cache.size()) {
+            g1_times_cache.erase(g1_times_cache.begin(), g1_times_cache.begin() + times.g1_times_cache_id);
+            times.g1_times_cache_id = 0;
         }
+    }
+}
 
-        // flush the current content of the cache to file
-        void flush(FilePtr& out, GCodeProcessorResult& result, const std::string& out_path) {
-            // collect lines to flush into a single string
-            std::string out_string;
-            while (!m_lines.empty()) {
-                out_string += m_lines.front().line;
-                m_lines.pop_front();
-            }
-            m_size = 0;
-#ifndef NDEBUG
-            m_statistics.remove_all_lines();
-#endif // NDEBUG
+void GCodeProcessor::PostProcessor::append_M73_line(size_t machine_id, bool stop, size_t stop_id, float elapsed_time)
+{
+    m_M73_lines.push_back({ 0, static_cast<unsigned char>(machine_id), stop, stop_id, elapsed_time });
+    m_export_lines.append_line(M73_placeholder(machine_id, stop), int(m_M73_lines.size() - 1));
+}
 
-            write_to_file(out, out_string, result, out_path);
-        }
+std::string GCodeProcessor::PostProcessor::M73_placeholder(size_t machine_id, bool stop) const
+{
+    std::string line(m_M73_widths[machine_id][stop], ' ');
+    line.front() = ';';
+    line += '\n';
+    return line;
+}
 
-        void synchronize_moves(GCodeProcessorResult& result) const {
-            auto it = m_gcode_lines_map.begin();
-            for (GCodeProcessorResult::MoveVertex& move : result.moves) {
-                while (it != m_gcode_lines_map.end() && it->first < move.gcode_id) {
-                    ++it;
-                }
-                if (it != m_gcode_lines_map.end() && it->first == move.gcode_id)
-                    move.gcode_id = it->second;
-            }
-        }
+bool GCodeProcessor::PostProcessor::process_placeholders(const std::string& gcode_line)
+{
+    bool processed = false;
 
-        size_t get_size() const { return m_size; }
+    // remove trailing '\n'
+    auto line = std::string_view(gcode_line).substr(0, gcode_line.length() - 1);
 
-    private:
-        void write_to_file(FilePtr& out, const std::string& out_string, GCodeProcessorResult& result, const std::string& out_path) {
-            if (!out_string.empty()) {
-                fwrite((const void*)out_string.c_str(), 1, out_string.length(), out.f);
-                if (ferror(out.f)) {
-                    out.close();
-                    boost::nowide::remove(out_path.c_str());
-                    throw Slic3r::RuntimeError(std::string("GCode processor post process export failed.\nIs the disk full?\n"));
-                }
-                for (size_t i = 0; i < out_string.size(); ++i) {
-                    if (out_string[i] == '\n')
-                        result.lines_ends.emplace_back(m_out_file_pos + i + 1);
+    if (line.length() > 1) {
+        line = line.substr(1);
+        if (m_processor.m_time_processor.export_remaining_time_enabled &&
+            (line == reserved_tag(ETags::First_Line_M73_Placeholder) || line == reserved_tag(ETags::Last_Line_M73_Placeholder))) {
+            for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
+                const TimeMachine& machine = m_processor.m_time_processor.machines[i];
+                if (machine.enabled) {
+                    // export pair <percent, remaining time>
+                    if (line == reserved_tag(ETags::First_Line_M73_Placeholder))
+                        append_M73_line(i, false, 0, 0.0f);
+                    else
+                        m_export_lines.append_line(format_line_M73_main(machine.line_m73_main_mask, 100, 0));
+                    processed = true;
+
+                    // export remaining time to next printer stop
+                    if (line == reserved_tag(ETags::First_Line_M73_Placeholder) && m_processor.m_printer_stops_count > 0)
+                        append_M73_line(i, true, 0, 0.0f);
                 }
-                m_out_file_pos += out_string.size();
             }
         }
-    };
-
-    ExportLines export_lines(m_result.backtrace_enabled ? ExportLines::EWriteType::ByTime : ExportLines::EWriteType::BySize, m_time_processor.machines[0]);
-
-    // replace placeholder lines with the proper final value
-    // gcode_line is in/out parameter, to reduce expensive memory allocation
-    auto process_placeholders = [&](std::string& gcode_line) {
-        bool processed = false;
-
-        // remove trailing '\n'
-        auto line = std::string_view(gcode_line).substr(0, gcode_line.length() - 1);
-
-        if (line.length() > 1) {
-            line = line.substr(1);
-            if (m_time_processor.export_remaining_time_enabled &&
-                (line == reserved_tag(ETags::First_Line_M73_Placeholder) || line == reserved_tag(ETags::Last_Line_M73_Placeholder))) {
-                for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-                    const TimeMachine& machine = m_time_processor.machines[i];
-                    if (machine.enabled) {
-                        // export pair <percent, remaining time>
-                        export_lines.append_line(format_line_M73_main(machine.line_m73_main_mask.c_str(),
-                            (line == reserved_tag(ETags::First_Line_M73_Placeholder)) ? 0 : 100,
-                            (line == reserved_tag(ETags::First_Line_M73_Placeholder)) ? time_in_minutes(machine.time) : 0));
-                        processed = true;
-
-                        // export remaining time to next printer stop
-                        if (line == reserved_tag(ETags::First_Line_M73_Placeholder) && !machine.stop_times.empty()) {
-                            const int to_export_stop = time_in_minutes(machine.stop_times.front().elapsed_time);
-                            export_lines.append_line(format_line_M73_stop_int(machine.line_m73_stop_mask.c_str(), to_export_stop));
-                            last_exported_stop[i] = to_export_stop;
-                        }
-                    }
+        else if (line == reserved_tag(ETags::Estimated_Printing_Time_Placeholder)) {
+            for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
+                const TimeMachine& machine = m_processor.m_time_processor.machines[i];
+                PrintEstimatedStatistics::ETimeMode mode = static_cast<PrintEstimatedStatistics::ETimeMode>(i);
+                if (mode == PrintEstimatedStatistics::ETimeMode::Normal || machine.enabled) {
+                    char buf[128];
+                    sprintf(buf, "; estimated printing time (%s mode) = %s\n",
+                        (mode == PrintEstimatedStatistics::ETimeMode::Normal) ? "normal" : "silent",
+                        get_time_dhms(machine.time).c_str());
+                    m_export_lines.append_line(buf);
+                    processed = true;
                 }
             }
-            else if (line == reserved_tag(ETags::Estimated_Printing_Time_Placeholder)) {
-                for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-                    const TimeMachine& machine = m_time_processor.machines[i];
-                    PrintEstimatedStatistics::ETimeMode mode = static_cast<PrintEstimatedStatistics::ETimeMode>(i);
-                    if (mode == PrintEstimatedStatistics::ETimeMode::Normal || machine.enabled) {
-                        char buf[128];
-                        sprintf(buf, "; estimated printing time (%s mode) = %s\n",
-                            (mode == PrintEstimatedStatistics::ETimeMode::Normal) ? "normal" : "silent",
-                            get_time_dhms(machine.time).c_str());
-                        export_lines.append_line(buf);
-                        processed = true;
-                    }
-                }
-                for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-                    const TimeMachine& machine = m_time_processor.machines[i];
-                    PrintEstimatedStatistics::ETimeMode mode = static_cast<PrintEstimatedStatistics::ETimeMode>(i);
-                    if (mode == PrintEstimatedStatistics::ETimeMode::Normal || machine.enabled) {
-                        char buf[128];
-                        sprintf(buf, "; estimated first layer printing time (%s mode) = %s\n",
-                            (mode == PrintEstimatedStatistics::ETimeMode::Normal) ? "normal" : "silent",
-                            get_time_dhms(machine.layers_time.empty() ? 0.f : machine.layers_time.front()).c_str());
-                        export_lines.append_line(buf);
-                        processed = true;
-                    }
+            for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
+                const TimeMachine& machine = m_processor.m_time_processor.machines[i];
+                PrintEstimatedStatistics::ETimeMode mode = static_cast<PrintEstimatedStatistics::ETimeMode>(i);
+                if (mode == PrintEstimatedStatistics::ETimeMode::Normal || machine.enabled) {
+                    char buf[128];
+                    sprintf(buf, "; estimated first layer printing time (%s mode) = %s\n",
+                        (mode == PrintEstimatedStatistics::ETimeMode::Normal) ? "normal" : "silent",
+                        get_time_dhms(machine.layers_time.empty() ? 0.f : machine.layers_time.front()).c_str());
+                    m_export_lines.append_line(buf);
+                    processed = true;
                 }
             }
         }
-
-        return processed;
-    };
-
-    std::vector<double> filament_mm(m_result.extruders_count, 0.0);
-    std::vector<double> filament_cm3(m_result.extruders_count, 0.0);
-    std::vector<double> filament_g(m_result.extruders_count, 0.0);
-    std::vector<double> filament_cost(m_result.extruders_count, 0.0);
-
-    double filament_total_g    = 0.0;
-    double filament_total_cost = 0.0;
-
-    for (const auto& [id, volume] : m_result.print_statistics.volumes_per_extruder) {
-        filament_mm[id]   = volume / (static_cast<double>(M_PI) * sqr(0.5 * m_result.filament_diameters[id]));
-        filament_cm3[id]  = volume * 0.001;
-        filament_g[id]    = filament_cm3[id] * double(m_result.filament_densities[id]);
-        filament_cost[id] = filament_g[id] * double(m_result.filament_cost[id]) * 0.001;
-        filament_total_g    += filament_g[id];
-        filament_total_cost += filament_cost[id];
     }
 
-    auto process_used_filament = [&](std::string& gcode_line) {
-        // Prefilter for parsing speed.
-        if (gcode_line.size() < 8 || gcode_line[0] != ';' || gcode_line[1] != ' ')
-            return false;
-        if (const char c = gcode_line[2]; c != 'f' && c != 't')
-            return false;
-        auto process_tag = [](std::string& gcode_line, const std::string_view tag, const std::vector<double>& values) {
-            if (boost::algorithm::starts_with(gcode_line, tag)) {
-                gcode_line = tag;
-                char buf[1024];
-                for (size_t i = 0; i < values.size(); ++i) {
-                    sprintf(buf, i == values.size() - 1 ? " %.2lf\n" : " %.2lf,", values[i]);
-                    gcode_line += buf;
-                }
-                return true;
-            }
-            return false;
-        };
-
-        bool ret = false;
-        ret |= process_tag(gcode_line, "; filament used [mm] =", filament_mm);
-        ret |= process_tag(gcode_line, "; filament used [g] =", filament_g);
-        ret |= process_tag(gcode_line, "; total filament used [g] =", { filament_total_g });
-        ret |= process_tag(gcode_line, "; filament used [cm3] =", filament_cm3);
-        ret |= process_tag(gcode_line, "; filament cost =", filament_cost);
-        ret |= process_tag(gcode_line, "; total filament cost =", { filament_total_cost });
-        return ret;
-    };
+    return processed;
+}
 
-    // check for temporary lines
-    auto is_temporary_decoration = [](const std::string_view gcode_line) {
-        // remove trailing '\n'
-        assert(!gcode_line.empty());
-        assert(gcode_line.back() == '\n');
-
-        // return true for decorations which are used in processing the gcode but that should not be exported into the final gcode
-        // i.e.:
-        // bool ret = gcode_line.substr(0, gcode_line.length() - 1) == ";" + Layer_Change_Tag;
-        // ...
-        // return ret;
+bool GCodeProcessor::PostProcessor::process_used_filament(std::string& gcode_line) const
+{
+    // Prefilter for parsing speed.
+    if (gcode_line.size() < 8 || gcode_line[0] != ';' || gcode_line[1] != ' ')
         return false;
-    };
-
-    // Iterators for the normal and silent cached time estimate entry recently processed, used by process_line_G1.
-    auto g1_times_cache_it = Slic3r::reserve_vector<std::vector<TimeMachine::G1LinesCacheItem>::const_iterator>(m_time_processor.machines.size());
-    for (const auto& machine : m_time_processor.machines)
-        g1_times_cache_it.emplace_back(machine.g1_times_cache.begin());
-
-    // add lines M73 to exported gcode
-    auto process_line_G1 = [this,
-        // Lambdas, mostly for string formatting, all with an empty capture block.
-        time_in_minutes, format_time_float, format_line_M73_main, format_line_M73_stop_int, format_line_M73_stop_float, time_in_last_minute,
-        // Caches, to be modified
-        &g1_times_cache_it, &last_exported_main, &last_exported_stop,
-        &export_lines]
-        (const size_t g1_lines_counter) {
-        if (m_time_processor.export_remaining_time_enabled) {
-            for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-                const TimeMachine& machine = m_time_processor.machines[i];
-                if (machine.enabled) {
-                    // export pair <percent, remaining time>
-                    // Skip all machine.g1_times_cache below g1_lines_counter.
-                    auto& it = g1_times_cache_it[i];
-                    while (it != machine.g1_times_cache.end() && it->id < g1_lines_counter)
-                        ++it;
-                    if (it != machine.g1_times_cache.end() && it->id == g1_lines_counter) {
-                        std::pair<int, int> to_export_main = { int(100.0f * it->elapsed_time / machine.time),
-                                                                time_in_minutes(machine.time - it->elapsed_time) };
-                        if (last_exported_main[i] != to_export_main) {
-                            export_lines.append_line(format_line_M73_main(machine.line_m73_main_mask.c_str(),
-                                to_export_main.first, to_export_main.second));
-                            last_exported_main[i] = to_export_main;
-                        }
-                        // export remaining time to next printer stop
-                        auto it_stop = std::upper_bound(machine.stop_times.begin(), machine.stop_times.end(), it->elapsed_time,
-                            [](float value, const TimeMachine::StopTime& t) { return value < t.elapsed_time; });
-                        if (it_stop != machine.stop_times.end()) {
-                            int to_export_stop = time_in_minutes(it_stop->elapsed_time - it->elapsed_time);
-                            if (last_exported_stop[i] != to_export_stop) {
-                                if (to_export_stop > 0) {
-                                    if (last_exported_stop[i] != to_export_stop) {
-                                        export_lines.append_line(format_line_M73_stop_int(machine.line_m73_stop_mask.c_str(), to_export_stop));
-                                        last_exported_stop[i] = to_export_stop;
-                                    }
-                                }
-                                else {
-                                    bool is_last = false;
-                                    auto next_it = it + 1;
-                                    is_last |= (next_it == machine.g1_times_cache.end());
-
-                                    if (next_it != machine.g1_times_cache.end()) {
-                                        auto next_it_stop = std::upper_bound(machine.stop_times.begin(), machine.stop_times.end(), next_it->elapsed_time,
-                                            [](float value, const TimeMachine::StopTime& t) { return value < t.elapsed_time; });
-                                        is_last |= (next_it_stop != it_stop);
-
-                                        std::string time_float_str = format_time_float(time_in_last_minute(it_stop->elapsed_time - it->elapsed_time));
-                                        std::string next_time_float_str = format_time_float(time_in_last_minute(it_stop->elapsed_time - next_it->elapsed_time));
-                                        is_last |= (string_to_double_decimal_point(time_float_str) > 0. && string_to_double_decimal_point(next_time_float_str) == 0.);
-                                    }
-
-                                    if (is_last) {
-                                        if (std::distance(machine.stop_times.begin(), it_stop) == static_cast<ptrdiff_t>(machine.stop_times.size() - 1))
-                                            export_lines.append_line(format_line_M73_stop_int(machine.line_m73_stop_mask.c_str(), to_export_stop));
-                                        else
-                                            export_lines.append_line(format_line_M73_stop_float(machine.line_m73_stop_mask.c_str(), time_in_last_minute(it_stop->elapsed_time - it->elapsed_time)));
-
-                                        last_exported_stop[i] = to_export_stop;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+    if (const char c = gcode_line[2]; c != 'f' && c != 't')
+        return false;
+    auto process_tag = [](std::string& gcode_line, const std::string_view tag, const std::vector<double>& values) {
+        if (boost::algorithm::starts_with(gcode_line, tag)) {
+            gcode_line = tag;
+            char buf[1024];
+            for (size_t i = 0; i < values.size(); ++i) {
+                sprintf(buf, i == values.size() - 1 ? " %.2lf\n" : " %.2lf,", values[i]);
+                gcode_line += buf;
             }
+            return true;
         }
+        return false;
     };
 
-    // add lines XXX to exported gcode
-    auto process_line_T = [this, &export_lines](const std::string& gcode_line, const size_t g1_lines_counter, const ExportLines::Backtrace& backtrace) {
-        const std::string cmd = GCodeReader::GCodeLine::extract_cmd(gcode_line);
-        if (cmd.size() >= 2) {
-            std::stringstream ss(cmd.substr(1));
-            int tool_number = -1;
-            ss >> tool_number;
-            if (tool_number != -1) {
-                if (tool_number < 0 || (int)m_extruder_temps_config.size() <= tool_number) {
-                    // found an invalid value, clamp it to a valid one
-                    tool_number = std::clamp<int>(0, m_extruder_temps_config.size() - 1, tool_number);
-                    // emit warning
-                    std::string warning = _u8L("GCode Post-Processor encountered an invalid toolchange, maybe from a custom gcode:");
-                    warning += "\n> ";
-                    warning += gcode_line;
-                    warning += _u8L("Generated M104 lines may be incorrect.");
-                    BOOST_LOG_TRIVIAL(error) << warning;
-                    if (m_print != nullptr)
-                        m_print->active_step_add_warning(PrintStateBase::WarningLevel::CRITICAL, warning);
-                }
+    bool ret = false;
+    ret |= process_tag(gcode_line, "; filament used [mm] =", m_filament_mm);
+    ret |= process_tag(gcode_line, "; filament used [g] =", m_filament_g);
+    ret |= process_tag(gcode_line, "; total filament used [g] =", { m_filament_total_g });
+    ret |= process_tag(gcode_line, "; filament used [cm3] =", m_filament_cm3);
+    ret |= process_tag(gcode_line, "; filament cost =", m_filament_cost);
+    ret |= process_tag(gcode_line, "; total filament cost =", { m_filament_total_cost });
+    return ret;
+}
+
+void GCodeProcessor::PostProcessor::process_line_G1(size_t stops)
+{
+    if (m_processor.m_time_processor.export_remaining_time_enabled) {
+        for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
+            if (! m_processor.m_time_processor.machines[i].enabled)
+                continue;
+            // The position of an M73 line depends on the elapsed time only, its values are written by patch_M73_lines().
+            MachineTimes& times = m_times[i];
+            const float elapsed_time = times.elapsed_time_before;
+            if (elapsed_time >= times.next_M73_time) {
+                // export pair <percent, remaining time>
+                append_M73_line(i, false, stops, elapsed_time);
+                // export remaining time to next printer stop
+                if (stops < m_processor.m_printer_stops_count)
+                    append_M73_line(i, true, stops, elapsed_time);
+                times.next_M73_time = elapsed_time + std::clamp(0.01f * elapsed_time, M73_Min_Interval, M73_Max_Interval);
             }
-            export_lines.insert_lines(backtrace, cmd,
-                // line inserter
-                [tool_number, this](unsigned int id, float time, float time_diff) {
-                    int temperature = int( m_layer_id != 1 ? m_extruder_temps_config[tool_number] : m_extruder_temps_first_layer_config[tool_number]);
-                    const std::string out = "M104 T" + std::to_string(tool_number) + " P" + std::to_string(int(std::round(time_diff))) + " S" + std::to_string(temperature) + "\n";
-                    return out;
-                },
-                // line replacer
-                [this, tool_number](const std::string& line) {
-                    if (GCodeReader::GCodeLine::cmd_is(line, "M104")) {
-                        GCodeReader::GCodeLine gline;
-                        GCodeReader reader;
-                        reader.parse_line(line, [&gline](GCodeReader& reader, const GCodeReader::GCodeLine& l) { gline = l; });
-
-                        float val;
-                        if (gline.has_value('T', val) && gline.raw().find("cooldown") != std::string::npos && m_is_XL_printer) {
-                            if (static_cast<int>(val) == tool_number)
-                                return std::string("; removed M104\n");
-                        }
-                    }
-                    return line;
-                });
         }
-    };
-
-    m_result.lines_ends.clear();
-
-    unsigned int line_id = 0;
-    // Backtrace data for Tx gcode lines
-    static const ExportLines::Backtrace backtrace_T = { 120.0f, 10 };
-    // In case there are multiple sources of backtracing, keeps track of the longest backtrack time needed
-    // to flush the backtrace cache accordingly
-    float max_backtrace_time = 120.0f;
-
-    {
-        // Read the input stream 64kB at a time, extract lines and process them.
-        std::vector<char> buffer(65536 * 10, 0);
-        // Line buffer.
-        assert(gcode_line.empty());
-        for (;;) {
-            size_t cnt_read = ::fread(buffer.data(), 1, buffer.size(), in.f);
-            if (::ferror(in.f))
-                throw Slic3r::RuntimeError(std::string("GCode processor post process export failed.\nError while reading from file.\n"));
-            bool eof = cnt_read == 0;
-            auto it = buffer.begin();
-            auto it_bufend = buffer.begin() + cnt_read;
-            while (it != it_bufend || (eof && !gcode_line.empty())) {
-                // Find end of line.
-                bool eol = false;
-                auto it_end = it;
-                for (; it_end != it_bufend && !(eol = *it_end == '\r' || *it_end == '\n'); ++it_end);
-                // End of line is indicated also if end of file was reached.
-                eol |= eof && it_end == it_bufend;
-                gcode_line.insert(gcode_line.end(), it, it_end);
-                if (eol) {
-                    ++line_id;
-                    export_lines.update(line_id, g1_lines_counter);
-
-                    gcode_line += "\n";
-                    // replace placeholder lines
-                    bool processed = process_placeholders(gcode_line);
-                    if (processed)
-                        gcode_line.clear();
-                    if (!processed)
-                        processed = process_used_filament(gcode_line);
-                    if (!processed && !is_temporary_decoration(gcode_line)) {
-                        if (GCodeReader::GCodeLine::cmd_is(gcode_line, "G1"))
-                            // add lines M73 where needed
-                            process_line_G1(g1_lines_counter++);
-                        else if (m_result.backtrace_enabled && GCodeReader::GCodeLine::cmd_starts_with(gcode_line, "T")) {
-                            // add lines XXX where needed
-                            process_line_T(gcode_line, g1_lines_counter, backtrace_T);
-                            max_backtrace_time = std::max(max_backtrace_time, backtrace_T.time);
-                        }
-                    }
+    }
+}
 
-                    if (!gcode_line.empty())
-                        export_lines.append_line(gcode_line);
-                    export_lines.write(out, 1.1f * max_backtrace_time, m_result, out_path);
-                    gcode_line.clear();
-                }
-                // Skip EOL.
-                it = it_end;
-                if (it != it_bufend && *it == '\r')
-                    ++it;
-                if (it != it_bufend && *it == '\n')
-                    ++it;
+void GCodeProcessor::PostProcessor::process_line_T(const std::string& gcode_line, unsigned int layer_id, const ExportLines::Backtrace& backtrace)
+{
+    const std::string cmd = GCodeReader::GCodeLine::extract_cmd(gcode_line);
+    if (cmd.size() >= 2) {
+        std::stringstream ss(cmd.substr(1));
+        int tool_number = -1;
+        ss >> tool_number;
+        if (tool_number != -1) {
+            if (tool_number < 0 || (int)m_processor.m_extruder_temps_config.size() <= tool_number) {
+                // found an invalid value, clamp it to a valid one
+                tool_number = std::clamp<int>(0, m_processor.m_extruder_temps_config.size() - 1, tool_number);
+                // emit warning
+                std::string warning = _u8L("GCode Post-Processor encountered an invalid toolchange, maybe from a custom gcode:");
+                warning += "\n> ";
+                warning += gcode_line;
+                warning += _u8L("Generated M104 lines may be incorrect.");
+                BOOST_LOG_TRIVIAL(error) << warning;
+                if (m_processor.m_print != nullptr)
+                    m_processor.m_print->active_step_add_warning(PrintStateBase::WarningLevel::CRITICAL, warning);
             }
-            if (eof)
-                break;
         }
+        const GCodeProcessor& processor = m_processor;
+        m_export_lines.insert_lines(backtrace, cmd,
+            // line inserter
+            [tool_number, layer_id, &processor](unsigned int id, float time, float time_diff) {
+                int temperature = int( layer_id != 1 ? processor.m_extruder_temps_config[tool_number] : processor.m_extruder_temps_first_layer_config[tool_number]);
+                const std::string out = "M104 T" + std::to_string(tool_number) + " P" + std::to_string(int(std::round(time_diff))) + " S" + std::to_string(temperature) + "\n";
+                return out;
+            },
+            // line replacer
+            [&processor, tool_number](const std::string& line) {
+                if (GCodeReader::GCodeLine::cmd_is(line, "M104")) {
+                    GCodeReader::GCodeLine gline;
+                    GCodeReader reader;
+                    reader.parse_line(line, [&gline](GCodeReader& reader, const GCodeReader::GCodeLine& l) { gline = l; });
+
+                    float val;
+                    if (gline.has_value('T', val) && gline.raw().find("cooldown") != std::string::npos && processor.m_is_XL_printer) {
+                        if (static_cast<int>(val) == tool_number)
+                            return std::string("; removed M104\n");
+                    }
+                }
+                return line;
+            });
     }
+}
 
-    export_lines.flush(out, m_result, out_path);
+void GCodeProcessor::PostProcessor::patch_M73_lines(boost::nowide::fstream& file) const
+{
+    for (const M73Line& M73_line : m_M73_lines) {
+        const TimeMachine& machine = m_processor.m_time_processor.machines[M73_line.machine];
+        std::string line;
+        if (! M73_line.stop)
+            // pair <percent, remaining time>
+            line = format_line_M73_main(machine.line_m73_main_mask,
+                (machine.time > 0.0f) ? int(100.0f * M73_line.elapsed_time / machine.time) : 100,
+                std::min(time_in_minutes(std::max(0.0f, machine.time - M73_line.elapsed_time)), M73_Max_Minutes));
+        else if (M73_line.stop_id < machine.stop_times.size()) {
+            // remaining time to next printer stop
+            const float remaining_time = std::max(0.0f, machine.stop_times[M73_line.stop_id].elapsed_time - M73_line.elapsed_time);
+            const int   to_export_stop = std::min(time_in_minutes(remaining_time), M73_Max_Minutes);
+            line = (to_export_stop > 0) ? format_line_M73_stop_int(machine.line_m73_stop_mask, to_export_stop) :
+                format_line_M73_stop_float(machine.line_m73_stop_mask, time_in_last_minute(remaining_time));
+        } else
+            // The printer stop expected by GCodeProcessor::set_printer_stops_count() was not exported, leave the placeholder.
+            continue;
+        // Pad the line to the width of the placeholder.
+        const size_t width = m_M73_widths[M73_line.machine][M73_line.stop];
+        assert(line.size() - 1 <= width);
+        line.insert(line.size() - 1, width - std::min(width, line.size() - 1), ' ');
+        file.seekp(M73_line.file_pos);
+        file.write(line.data(), line.size());
+    }
+}
 
-    out.close();
-    in.close();
+GCodeProcessor::~GCodeProcessor() = default;
 
-    export_lines.synchronize_moves(m_result);
+void GCodeProcessor::post_process()
+{
+    // The lines held by the post processor: the end of the G-code, whose moves were calculated by finalize(), and the footer.
+    std::string out;
+    if (m_post_processor)
+        m_post_processor->process(true, out);
 
-    if (rename_file(out_path, m_result.filename))
-        throw Slic3r::RuntimeError(std::string("Failed to rename the output G-code file from ") + out_path + " to " + m_result.filename + '\n' +
-            "Is " + out_path + " locked?" + '\n');
+    boost::nowide::fstream file(m_result.filename, std::ios::binary | std::ios::in | std::ios::out);
+    if (! file.is_open())
+        throw Slic3r::RuntimeError(std::string("GCode processor post process export failed.\nCannot open file for writing.\n"));
+    file.seekp(0, std::ios::end);
+    file.write(out.data(), out.size());
+    // Write the values of the M73 lines in place, the G-code is not rewritten.
+    if (m_post_processor)
+        m_post_processor->patch_M73_lines(file);
+    file.close();
+    if (file.fail())
+        throw Slic3r::RuntimeError(std::string("GCode processor post process export failed.\nIs the disk full?\n"));
+    m_post_processor.reset();
 }
 
 void GCodeProcessor::store_move_vertex(EMoveType type, bool internal_only)
@@ -4060,12 +4193,12 @@ void GCodeProcessor::store_move_vertex(EMoveType type, bool internal_only)
         Vec3f(m_end_position[X], m_end_position[Y], m_end_position[Z] - m_z_offset) + m_extruder_offsets[m_extruder_id],
         static_cast<float>(m_end_position[E] - m_start_position[E]),
         m_feedrate,
-        m_width,
-        m_height,
+        // wipe moves are shown with a fixed width/height
+        (type == EMoveType::Wipe) ? Wipe_Width : m_width,
+        (type == EMoveType::Wipe) ? Wipe_Height : m_height,
         m_mm3_per_mm,
         m_fan_speed,
         m_extruder_temps[m_extruder_id],
-        static_cast<float>(m_result.moves.size()),
         internal_only
     });
 
@@ -4209,11 +4342,7 @@ float GCodeProcessor::get_filament_unload_time(size_t extruder_id)
 
 void GCodeProcessor::process_custom_gcode_time(CustomGCode::Type code)
 {
-    for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-        TimeMachine& machine = m_time_processor.machines[i];
-        if (!machine.enabled)
-            continue;
-
+    for_each_enabled_time_machine([code](TimeMachine& machine) {
         TimeMachine::CustomGCodeTime& gcode_time = machine.gcode_time;
         gcode_time.needed = true;
         //FIXME this simulates st_synchronize! is it correct?
@@ -4223,7 +4352,7 @@ void GCodeProcessor::process_custom_gcode_time(CustomGCode::Type code)
             gcode_time.times.push_back({ code, gcode_time.cache });
             gcode_time.cache = 0.0f;
         }
-    }
+    });
 }
 
 void GCodeProcessor::process_filaments(CustomGCode::Type code)
@@ -4237,9 +4366,7 @@ void GCodeProcessor::process_filaments(CustomGCode::Type code)
 
 void GCodeProcessor::simulate_st_synchronize(float additional_time)
 {
-    for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
-        m_time_processor.machines[i].simulate_st_synchronize(additional_time);
-    }
+    for_each_enabled_time_machine([additional_time](TimeMachine& machine) { machine.simulate_st_synchronize(additional_time); });
 }
 
 void GCodeProcessor::update_estimated_times_stats()
@@ -7,8 +7,16 @@
 #include "libslic3r/PrintConfig.hpp"
 #include "libslic3r/CustomGCode.hpp"
 
+#include <ankerl/unordered_dense.h>
+
+#include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <array>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <vector>
 #include <string>
 #include <string_view>
@@ -128,16 +136,392 @@ namespace Slic3r {
             float mm3_per_mm{ 0.0f };
             float fan_speed{ 0.0f }; // percentage
             float temperature{ 0.0f }; // Celsius degrees
-            float time{ 0.0f }; // s
             bool internal_only{ false };
 
             float volumetric_rate() const { return feedrate * mm3_per_mm; }
         };
 
+        // Compact storage of the moves, a large print produces tens of millions of them.
+        // Only the G-code line id, the position and the extrusion change with every move. The other attributes
+        // (type, role, extruder, feedrate, width, height, fan speed, temperature) are mostly repeated,
+        // therefore they are deduplicated into a table and each move stores just a 16 bit index into the table,
+        // widened to 32 bits once there are more than 65536 unique attribute sets.
+        // The moves are stored in blocks of Block_Size moves. A block stores the absolute position quantized to microns
+        // and the G-code line id of its first move, a move stores 16 bit deltas: its position relative to the previous move
+        // of the block, its extrusion quantized to 0.1 micron and its G-code line id relative to the block.
+        // A move not fitting the deltas (a long travel, a G-code line id far apart) is stored in full in a side table.
+        // A move takes about 13.5 bytes instead of 56 bytes taken by a MoveVertex in the former std::vector<MoveVertex>.
+        // Random access is O(1), at most Block_Size deltas are summed, a move is returned by value.
+        class MoveVertices
+        {
+        public:
+            class const_iterator
+            {
+            public:
+                using iterator_category = std::random_access_iterator_tag;
+                using value_type        = MoveVertex;
+                using difference_type   = std::ptrdiff_t;
+                using pointer           = void;
+                using reference         = MoveVertex;
+
+                const_iterator() = default;
+                const_iterator(const MoveVertices *moves, size_t idx) : m_moves(moves), m_idx(idx) {}
+
+                MoveVertex      operator*() const { return (*m_moves)[m_idx]; }
+                MoveVertex      operator[](difference_type n) const { return (*m_moves)[m_idx + n]; }
+                const_iterator& operator++() { ++ m_idx; return *this; }
+                const_iterator  operator++(int) { const_iterator out(*this); ++ m_idx; return out; }
+                const_iterator& operator--() { -- m_idx; return *this; }
+                const_iterator  operator--(int) { const_iterator out(*this); -- m_idx; return out; }
+                const_iterator& operator+=(difference_type n) { m_idx += n; return *this; }
+                const_iterator& operator-=(difference_type n) { m_idx -= n; return *this; }
+                const_iterator  operator+(difference_type n) const { return { m_moves, m_idx + n }; }
+                const_iterator  operator-(difference_type n) const { return { m_moves, m_idx - n }; }
+                difference_type operator-(const const_iterator &rhs) const { return difference_type(m_idx) - difference_type(rhs.m_idx); }
+                bool            operator==(const const_iterator &rhs) const { return m_idx == rhs.m_idx; }
+                bool            operator!=(const const_iterator &rhs) const { return m_idx != rhs.m_idx; }
+                bool            operator<(const const_iterator &rhs) const { return m_idx < rhs.m_idx; }
+                bool            operator>(const const_iterator &rhs) const { return m_idx > rhs.m_idx; }
+                bool            operator<=(const const_iterator &rhs) const { return m_idx <= rhs.m_idx; }
+                bool            operator>=(const const_iterator &rhs) const { return m_idx >= rhs.m_idx; }
+
+            private:
+                const MoveVertices *m_moves { nullptr };
+                size_t              m_idx   { 0 };
+            };
+
+            // Number of moves sharing the position and G-code line id of a block.
+            static constexpr size_t Block_Size        = 16;
+            // Quantization of the positions and of the extrusions stored as deltas, in millimeters.
+            static constexpr double Position_Quantum  = 0.001;
+            static constexpr double Extrusion_Quantum = 0.0001;
+
+            size_t         size() const { return m_deltas.size(); }
+            bool           empty() const { return m_deltas.empty(); }
+            const_iterator begin() const { return { this, 0 }; }
+            const_iterator end() const { return { this, this->size() }; }
+
+            MoveVertex operator[](size_t idx) const {
+                assert(idx < this->size());
+                const Attributes &attr = m_attributes[this->attribute_id(idx)];
+                MoveVertex out;
+                out.gcode_id       = this->gcode_id(idx);
+                out.type           = attr.type;
+                out.extrusion_role = attr.extrusion_role;
+                out.extruder_id    = attr.extruder_id;
+                out.cp_color_id    = attr.cp_color_id;
+                out.position       = this->position(idx);
+                out.delta_extruder = this->is_escaped(idx) ? m_escaped[this->escaped_id(idx)].delta_extruder :
+                                                             float(double(m_deltas[idx].delta_extruder) * Extrusion_Quantum);
+                out.feedrate       = attr.feedrate;
+                out.width          = attr.width;
+                out.height         = attr.height;
+                out.mm3_per_mm     = attr.mm3_per_mm;
+                out.fan_speed      = attr.fan_speed;
+                out.temperature    = attr.temperature;
+                out.internal_only  = attr.internal_only;
+                return out;
+            }
+            MoveVertex   back() const { assert(! this->empty()); return (*this)[this->size() - 1]; }
+            unsigned int gcode_id(size_t idx) const {
+                return this->is_escaped(idx) ? m_escaped[this->escaped_id(idx)].gcode_id : m_blocks[idx / Block_Size].gcode_id + m_deltas[idx].gcode_id;
+            }
+            Vec3f        position(size_t idx) const {
+                return this->is_escaped(idx) ? m_escaped[this->escaped_id(idx)].position : from_grid(this->grid_position(idx));
+            }
+
+            void push_back(const MoveVertex &move) {
+                const Attributes attr { move.type, move.extrusion_role, move.extruder_id, move.cp_color_id, move.internal_only,
+                    move.feedrate, move.width, move.height, move.mm3_per_mm, move.fan_speed, move.temperature };
+                if (m_attributes_map.size() != m_attributes.size()) {
+                    // The map was released by shrink_to_fit(), rebuild it.
+                    m_attributes_map.clear();
+                    for (uint32_t i = 0; i < uint32_t(m_attributes.size()); ++ i)
+                        m_attributes_map.emplace(m_attributes[i], i);
+                }
+                auto [it, inserted] = m_attributes_map.emplace(attr, uint32_t(m_attributes.size()));
+                if (inserted)
+                    m_attributes.emplace_back(attr);
+                if (m_attribute_ids_wide.empty() && it->second <= std::numeric_limits<uint16_t>::max())
+                    m_attribute_ids.emplace_back(uint16_t(it->second));
+                else {
+                    if (m_attribute_ids_wide.empty()) {
+                        // Too many unique attribute sets for a 16 bit index, widen the indices.
+                        m_attribute_ids_wide.assign(m_attribute_ids.begin(), m_attribute_ids.end());
+                        m_attribute_ids = {};
+                    }
+                    m_attribute_ids_wide.emplace_back(it->second);
+                }
+
+                const size_t idx = this->size();
+                if (idx % Block_Size == 0) {
+                    Block &block = m_blocks.emplace_back();
+                    block.gcode_id      = move.gcode_id;
+                    block.first_escaped = uint32_t(m_escaped.size());
+                    if (! to_grid(move.position, block.position))
+                        block.position = Vec3i32::Zero();
+                }
+                // Position of the previous move of the block, to which the position delta is relative.
+                Vec3i32 prev;
+                bool    prev_valid = true;
+                if (idx % Block_Size == 0)
+                    prev = m_blocks.back().position;
+                else if (this->is_escaped(idx - 1))
+                    prev_valid = to_grid(m_escaped[this->escaped_id(idx - 1)].position, prev);
+                else
+                    prev = this->grid_position(idx - 1);
+                Delta   delta;
+                Vec3i32 pos;
+                if (prev_valid && to_grid(move.position, pos) && to_delta(pos - prev, delta) && to_delta(move.delta_extruder, delta.delta_extruder) &&
+                    to_delta(m_blocks.back().gcode_id, move.gcode_id, delta.gcode_id))
+                    m_deltas.emplace_back(delta);
+                else {
+                    m_deltas.emplace_back(Delta{});
+                    m_escaped.push_back({ move.position, move.delta_extruder, move.gcode_id });
+                    m_blocks.back().escaped |= uint16_t(1u << (idx % Block_Size));
+                }
+            }
+            void erase(size_t idx) {
+                assert(idx < this->size());
+                std::vector<MoveVertex> tail;
+                tail.reserve(this->size() - idx - 1);
+                for (size_t i = idx + 1; i < this->size(); ++ i)
+                    tail.emplace_back((*this)[i]);
+                this->resize_down(idx);
+                for (const MoveVertex &move : tail)
+                    this->push_back(move);
+            }
+            void set_gcode_id(size_t idx, unsigned int gcode_id) {
+                assert(idx < this->size());
+                if (this->is_escaped(idx)) {
+                    m_escaped[this->escaped_id(idx)].gcode_id = gcode_id;
+                    return;
+                }
+                Block &block = m_blocks[idx / Block_Size];
+                if (to_delta(block.gcode_id, gcode_id, m_deltas[idx].gcode_id))
+                    return;
+                // Rebase the G-code line ids of the block to the lowest one.
+                const size_t first = idx - idx % Block_Size;
+                const size_t last  = std::min(first + Block_Size, this->size());
+                unsigned int lo = gcode_id;
+                unsigned int hi = gcode_id;
+                for (size_t i = first; i < last; ++ i)
+                    if (i != idx && ! this->is_escaped(i)) {
+                        lo = std::min(lo, block.gcode_id + m_deltas[i].gcode_id);
+                        hi = std::max(hi, block.gcode_id + m_deltas[i].gcode_id);
+                    }
+                if (hi - lo <= std::numeric_limits<uint16_t>::max()) {
+                    for (size_t i = first; i < last; ++ i)
+                        if (i != idx && ! this->is_escaped(i))
+                            m_deltas[i].gcode_id = uint16_t(block.gcode_id + m_deltas[i].gcode_id - lo);
+                    m_deltas[idx].gcode_id = uint16_t(gcode_id - lo);
+                    block.gcode_id = lo;
+                } else {
+                    // The G-code line ids of the block are too far apart, store the move in full.
+                    this->escape(idx);
+                    m_escaped[this->escaped_id(idx)].gcode_id = gcode_id;
+                }
+            }
+            void clear() {
+                m_blocks.clear();
+                m_deltas.clear();
+                m_escaped.clear();
+                m_attribute_ids.clear();
+                m_attribute_ids_wide.clear();
+                m_attributes.clear();
+                m_attributes_map.clear();
+            }
+            // To be called once all the moves were stored: Releases the map used to deduplicate the attributes
+            // and the reserved, but unused memory.
+            void shrink_to_fit() {
+                m_attributes_map = {};
+                m_blocks.shrink_to_fit();
+                m_deltas.shrink_to_fit();
+                m_escaped.shrink_to_fit();
+                m_attribute_ids.shrink_to_fit();
+                m_attribute_ids_wide.shrink_to_fit();
+                m_attributes.shrink_to_fit();
+            }
+            // Number of unique attribute sets.
+            size_t attributes_count() const { return m_attributes.size(); }
+            // Number of moves stored in full, not fitting the deltas.
+            size_t escaped_count() const { return m_escaped.size(); }
+            size_t memsize() const {
+                return m_blocks.capacity() * sizeof(Block) + m_deltas.capacity() * sizeof(Delta) + m_escaped.capacity() * sizeof(Escaped) +
+                    m_attribute_ids.capacity() * sizeof(uint16_t) + m_attribute_ids_wide.capacity() * sizeof(uint32_t) +
+                    m_attributes.capacity() * sizeof(Attributes) + m_attributes_map.size() * sizeof(std::pair<Attributes, uint32_t>) +
+                    m_attributes_map.bucket_count() * sizeof(AttributesMap::bucket_type);
+            }
+
+        private:
+            struct Attributes
+            {
+                EMoveType          type;
+                GCodeExtrusionRole extrusion_role;
+                unsigned char      extruder_id;
+                unsigned char      cp_color_id;
+                bool               internal_only;
+                float              feedrate;
+                float              width;
+                float              height;
+                float              mm3_per_mm;
+                float              fan_speed;
+                float              temperature;
+
+                // Compared and hashed bitwise, so that the map stays consistent for -0.f and NaN.
+                std::array<uint32_t, 7> words() const {
+                    std::array<uint32_t, 7> out;
+                    out[0] = uint32_t(type) | (uint32_t(internal_only) << 7) | (uint32_t(extrusion_role) << 8) |
+                        (uint32_t(extruder_id) << 16) | (uint32_t(cp_color_id) << 24);
+                    std::memcpy(&out[1], &feedrate,    sizeof(float));
+                    std::memcpy(&out[2], &width,       sizeof(float));
+                    std::memcpy(&out[3], &height,      sizeof(float));
+                    std::memcpy(&out[4], &mm3_per_mm,  sizeof(float));
+                    std::memcpy(&out[5], &fan_speed,   sizeof(float));
+                    std::memcpy(&out[6], &temperature, sizeof(float));
+                    return out;
+                }
+                bool operator==(const Attributes &rhs) const { return this->words() == rhs.words(); }
+            };
+            struct AttributesHash
+            {
+                using is_avalanching = void;
+                uint64_t operator()(const Attributes &attr) const noexcept {
+                    const std::array<uint32_t, 7> words = attr.words();
+                    return ankerl::unordered_dense::detail::wyhash::hash(words.data(), sizeof(words));
+                }
+            };
+
+            using AttributesMap = ankerl::unordered_dense::map<Attributes, uint32_t, AttributesHash>;
+
+            struct Block
+            {
+                // Position of the first move in microns, G-code line id the deltas of the moves are relative to.
+                Vec3i32      position;
+                unsigned int gcode_id;
+                // Index of the first escaped move of the block in m_escaped.
+                uint32_t     first_escaped;
+                // Bit mask of the moves of the block stored in m_escaped.
+                uint16_t     escaped{ 0 };
+            };
+            static_assert(Block_Size <= 16, "Block::escaped holds a bit per move of a block");
+            struct Delta
+            {
+                // Position relative to the previous move of the block in microns.
+                int16_t  position[3];
+                int16_t  delta_extruder;
+                uint16_t gcode_id;
+            };
+            struct Escaped
+            {
+                Vec3f        position;
+                float        delta_extruder;
+                unsigned int gcode_id;
+            };
+
+            // Positions up to 4 meters from the origin survive the conversion to float and back.
+            static constexpr int32_t Max_Grid = 1 << 22;
+
+            static bool to_grid(const Vec3f &position, Vec3i32 &out) {
+                for (int i = 0; i < 3; ++ i) {
+                    const double v = std::round(double(position[i]) / Position_Quantum);
+                    if (! (std::abs(v) < double(Max_Grid)))
+                        return false;
+                    out[i] = int32_t(v);
+                }
+                return true;
+            }
+            static Vec3f from_grid(const Vec3i32 &grid) {
+                return { float(double(grid.x()) * Position_Quantum), float(double(grid.y()) * Position_Quantum), float(double(grid.z()) * Position_Quantum) };
+            }
+            static bool to_delta(const Vec3i32 &v, Delta &out) {
+                for (int i = 0; i < 3; ++ i) {
+                    if (v[i] < std::numeric_limits<int16_t>::min() || v[i] > std::numeric_limits<int16_t>::max())
+                        return false;
+                    out.position[i] = int16_t(v[i]);
+                }
+                return true;
+            }
+            // A non-zero extrusion is not rounded to zero, its sign is used to color the travel moves.
+            static bool to_delta(float delta_extruder, int16_t &out) {
+                const double v = std::round(double(delta_extruder) / Extrusion_Quantum);
+                if (! (std::abs(v) <= double(std::numeric_limits<int16_t>::max())) || (v == 0. && delta_extruder != 0.f))
+                    return false;
+                out = int16_t(v);
+                return true;
+            }
+            static bool to_delta(unsigned int base_gcode_id, unsigned int gcode_id, uint16_t &out) {
+                if (gcode_id < base_gcode_id || gcode_id - base_gcode_id > std::numeric_limits<uint16_t>::max())
+                    return false;
+                out = uint16_t(gcode_id - base_gcode_id);
+                return true;
+            }
+
+            uint32_t attribute_id(size_t idx) const { return m_attribute_ids_wide.empty() ? m_attribute_ids[idx] : m_attribute_ids_wide[idx]; }
+            bool     is_escaped(size_t idx) const { return (m_blocks[idx / Block_Size].escaped >> (idx % Block_Size)) & 1; }
+            // Index of the escaped move in m_escaped.
+            size_t   escaped_id(size_t idx) const {
+                const Block &block = m_blocks[idx / Block_Size];
+                uint32_t     mask  = block.escaped & ((1u << (idx % Block_Size)) - 1);
+                size_t       id    = block.first_escaped;
+                for (; mask != 0; mask &= mask - 1)
+                    ++ id;
+                return id;
+            }
+            // Position of a move stored as a delta in microns: sum of the deltas back to the block start or to an escaped move.
+            Vec3i32  grid_position(size_t idx) const {
+                assert(! this->is_escaped(idx));
+                const size_t first = idx - idx % Block_Size;
+                Vec3i32      out   = Vec3i32::Zero();
+                for (size_t i = idx;; -- i) {
+                    if (this->is_escaped(i)) {
+                        Vec3i32 pos;
+                        [[maybe_unused]] const bool valid = to_grid(m_escaped[this->escaped_id(i)].position, pos);
+                        assert(valid);
+                        return out + pos;
+                    }
+                    out += Vec3i32(m_deltas[i].position[0], m_deltas[i].position[1], m_deltas[i].position[2]);
+                    if (i == first)
+                        return out + m_blocks[idx / Block_Size].position;
+                }
+            }
+            // Store a move stored as a delta in full. The following moves of the block stay relative to its position.
+            void escape(size_t idx) {
+                assert(! this->is_escaped(idx));
+                const Escaped escaped { from_grid(this->grid_position(idx)), float(double(m_deltas[idx].delta_extruder) * Extrusion_Quantum), this->gcode_id(idx) };
+                m_escaped.insert(m_escaped.begin() + this->escaped_id(idx), escaped);
+                m_blocks[idx / Block_Size].escaped |= uint16_t(1u << (idx % Block_Size));
+                for (size_t i = idx / Block_Size + 1; i < m_blocks.size(); ++ i)
+                    ++ m_blocks[i].first_escaped;
+            }
+            // Keep the first size moves.
+            void resize_down(size_t size) {
+                assert(size <= this->size());
+                m_deltas.resize(size);
+                if (m_attribute_ids_wide.empty())
+                    m_attribute_ids.resize(size);
+                else
+                    m_attribute_ids_wide.resize(size);
+                m_blocks.resize((size + Block_Size - 1) / Block_Size);
+                if (size % Block_Size != 0)
+                    m_blocks.back().escaped &= uint16_t((1u << (size % Block_Size)) - 1);
+                m_escaped.resize(size == 0 ? 0 : this->escaped_id(size - 1) + this->is_escaped(size - 1));
+            }
+
+            std::vector<Block>                                                   m_blocks;
+            std::vector<Delta>                                                   m_deltas;
+            std::vector<Escaped>                                                 m_escaped;
+            // Indices into m_attributes, m_attribute_ids_wide is used once there are more than 65536 of them.
+            std::vector<uint16_t>                                                m_attribute_ids;
+            std::vector<uint32_t>                                                m_attribute_ids_wide;
+            std::vector<Attributes>                                              m_attributes;
+            AttributesMap                                                        m_attributes_map;
+        };
+
         std::string filename;
         unsigned int id;
-        std::vector<MoveVertex> moves;
-        // Positions of ends of lines of the final G-code this->filename after TimeProcessor::post_process() finalizes the G-code.
+        MoveVertices moves;
+        // Positions of ends of lines of the final G-code this->filename after GCodeProcessor::post_process() finalizes the G-code.
         std::vector<size_t> lines_ends;
         Pointfs bed_shape;
         float max_print_height;
@@ -271,7 +655,9 @@ namespace Slic3r {
             Trapezoid trapezoid;
 
             // Calculates this block's trapezoid
-            void calculate_trapezoid();
+            void calculate_trapezoid() { calculate_trapezoid(feedrate_profile.exit); }
+            // Calculates this block's trapezoid for the given exit feedrate, feedrate_profile.exit is left unchanged.
+            void calculate_trapezoid(float exit_feedrate);
 
             float time() const;
         };
@@ -338,7 +724,15 @@ namespace Slic3r {
 
             // Simulates firmware st_synchronize() call
             void simulate_st_synchronize(float additional_time = 0.0f);
+            // Calculates the times of the planner windows deferred by refresh(), then the time of all blocks but the last keep_last_n_blocks.
             void calculate_time(size_t keep_last_n_blocks = 0, float additional_time = 0.0f);
+            // Calculates the times of the accumulated blocks in planner windows of TimeProcessor::Planner::refresh_threshold + 1 blocks,
+            // keeping the last TimeProcessor::Planner::queue_size blocks of each window for the next one, as if each window was
+            // calculated once its last block was added.
+            void refresh();
+
+        private:
+            void calculate_time(size_t begin, size_t end, size_t keep_last_n_blocks, float additional_time);
         };
 
         struct TimeProcessor
@@ -351,6 +745,9 @@ namespace Slic3r {
                 // The firmware recalculates last planner_queue_size trapezoidal blocks each time a new block is added.
                 // We are not simulating the firmware exactly, we calculate a sequence of blocks once a reasonable number of blocks accumulate.
                 static constexpr size_t refresh_threshold = queue_size * 4;
+                // The planner windows are calculated once this many blocks accumulate, so that the normal and the stealth
+                // machines get enough work to be processed concurrently.
+                static constexpr size_t deferred_refresh_threshold = refresh_threshold * 16;
             };
 
             // extruder_id is currently used to correctly calculate filament load / unload times into the total print time.
@@ -441,10 +838,11 @@ namespace Slic3r {
 
                 const Vec3f position = m_result.moves.back().position;
 
-                GCodeProcessorResult::MoveVertex& move = m_result.moves.emplace_back(m_result.moves[*m_move_id]);
+                GCodeProcessorResult::MoveVertex move = m_result.moves[*m_move_id];
                 move.position = position;
                 move.height = height;
-                m_result.moves.erase(m_result.moves.begin() + *m_move_id);
+                m_result.moves.erase(*m_move_id);
+                m_result.moves.push_back(move);
                 m_result.custom_gcode_per_print_z[*m_custom_gcode_per_print_z_id].print_z = position.z();
                 reset();
             }
@@ -604,10 +1002,20 @@ namespace Slic3r {
         EProducer m_producer;
 
         TimeProcessor m_time_processor;
+        // Calculate the planner windows once TimeProcessor::Planner::deferred_refresh_threshold blocks accumulate.
+        bool m_deferred_time_refresh{ true };
         UsedFilaments m_used_filaments;
 
         Print* m_print{ nullptr };
 
+        // Post-processes the G-code being exported through process_buffer(), defined in GCodeProcessor.cpp.
+        class PostProcessor;
+        std::unique_ptr<PostProcessor> m_post_processor;
+        // The lines passed to process_buffer() after begin_footer() are post-processed by finalize().
+        bool m_footer_begun{ false };
+        // Number of the color changes and pauses expected in the G-code being exported, see set_printer_stops_count().
+        size_t m_printer_stops_count{ 0 };
+
         GCodeProcessorResult m_result;
         static unsigned int s_result_id;
 
@@ -619,6 +1027,7 @@ namespace Slic3r {
 
     public:
         GCodeProcessor();
+        ~GCodeProcessor();
 
         void apply_config(const PrintConfig& config);
         void set_print(Print* print) { m_print = print; }
@@ -628,12 +1037,16 @@ namespace Slic3r {
             return m_time_processor.machines[static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Stealth)].enabled;
         }
         void enable_machine_envelope_processing(bool enabled) { m_time_processor.machine_envelope_processing_enabled = enabled; }
+        // Disabled, each planner window is calculated as soon as its last block is added instead of deferring the windows
+        // to be processed in batches. The estimated times are the same, used by the unit tests to check that.
+        void enable_deferred_time_refresh(bool enabled) { m_deferred_time_refresh = enabled; }
         void reset();
 
         const GCodeProcessorResult& get_result() const { return m_result; }
         GCodeProcessorResult&& extract_result() { return std::move(m_result); }
 
         // Load a G-code into a stand-alone G-code viewer.
+        // The moves of a binary G-code (.sbgc) are processed as decoded from its G-code blocks, without parsing their text.
         // throws CanceledException through print->throw_if_canceled() (sent by the caller as callback).
         void process_file(const std::string& filename, std::function<void()> cancel_callback = nullptr);
 
@@ -642,9 +1055,17 @@ namespace Slic3r {
         void initialize_result_moves() {
             // 1st move must be a dummy move
             assert(m_result.moves.empty());
-            m_result.moves.emplace_back(GCodeProcessorResult::MoveVertex());
+            m_result.moves.push_back(GCodeProcessorResult::MoveVertex());
         }
-        void process_buffer(const std::string& buffer);
+        // Processes the next chunk of the G-code being exported. The post-processed G-code to be written into the file is appended
+        // to out: it lags behind the processed G-code, as its lines are held until the time machines calculated the times of their moves.
+        void process_buffer(const std::string& buffer, std::string& out);
+        // Called before the statistics and the placeholders at the end of the G-code are exported. Their values are known
+        // once all the G-code was processed, thus the footer is held in memory until finalize() appends it to the file.
+        void begin_footer() { m_footer_begun = true; }
+        // Number of the color changes and pauses of the G-code to be exported, to be set before its first move is processed.
+        // M73 lines with the remaining time to the next printer stop are inserted until that many stops were processed.
+        void set_printer_stops_count(size_t count) { m_printer_stops_count = count; }
         void finalize(bool post_process);
 
         float get_time(PrintEstimatedStatistics::ETimeMode mode) const;
@@ -786,9 +1207,9 @@ namespace Slic3r {
         void process_T(const GCodeReader::GCodeLine& line);
         void process_T(const std::string_view command);
 
-        // post process the file with the given filename to:
-        // 1) add remaining time lines M73 and update moves' gcode ids accordingly
-        // 2) update used filament data
+        // post process the G-code exported through process_buffer() to:
+        // 1) append the lines held by m_post_processor, with the used filament data and the estimated times in its footer
+        // 2) write the values of the M73 remaining time lines into the file in place and update moves' gcode ids
         void post_process();
 
         void store_move_vertex(EMoveType type, bool internal_only = false);
@@ -814,6 +1235,10 @@ namespace Slic3r {
 
         // Simulates firmware st_synchronize() call
         void simulate_st_synchronize(float additional_time = 0.0f);
+        // Calls fn on the enabled time machines. The normal and the stealth machines do not share any state,
+        // they are processed concurrently if they hold enough time blocks to be worth it, see TimeProcessor::Planner::deferred_refresh_threshold.
+        template<typename Fn>
+        void for_each_enabled_time_machine(Fn &&fn);
 
         void update_estimated_times_stats();
 
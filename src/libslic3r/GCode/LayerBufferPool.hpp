@@ -0,0 +1,54 @@
+#ifndef slic3r_LayerBufferPool_hpp_
+#define slic3r_LayerBufferPool_hpp_
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Slic3r {
+
+// Recycles the G-code buffers of LayerResult between the first and the last stage of GCode::process_layers().
+// The G-code of a layer is appended into a buffer released by the output stage after a previous layer was written,
+// thus the buffer does not need to grow from scratch by repeated reallocation for each layer.
+// Acquired and released from the pipeline threads, thus synchronized.
+class LayerBufferPool {
+public:
+    explicit LayerBufferPool(size_t max_buffers = 16) : m_max_buffers(max_buffers) {}
+
+    // Returns an empty buffer, possibly with capacity preallocated by a previous layer.
+    std::string acquire() {
+        std::string out;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (! m_buffers.empty()) {
+            out = std::move(m_buffers.back());
+            m_buffers.pop_back();
+        }
+        return out;
+    }
+
+    // Returns a buffer to the pool. Its content is discarded, its capacity is kept for the next acquire().
+    void release(std::string &&buffer) {
+        if (buffer.capacity() == 0)
+            return;
+        buffer.clear();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_buffers.size() < m_max_buffers)
+            m_buffers.emplace_back(std::move(buffer));
+    }
+
+    // Release the memory held by the pool.
+    void clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffers.clear();
+        m_buffers.shrink_to_fit();
+    }
+
+private:
+    std::mutex               m_mutex;
+    std::vector<std::string> m_buffers;
+    size_t                   m_max_buffers;
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_LayerBufferPool_hpp_
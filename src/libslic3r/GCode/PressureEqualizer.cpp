@@ -106,8 +106,8 @@ LayerResult PressureEqualizer::process_layer(LayerResult &&input)
 
     if (!input.nop_layer_result) {
         this->process_layer(input.gcode);
-        input.gcode.clear(); // GCode is already processed, so it isn't needed to store it.
-        m_layer_results.emplace(new LayerResult(input));
+        input.gcode.clear(); // GCode is already processed, so it isn't needed to store it. Keep the buffer to store the output into.
+        m_layer_results.emplace(new LayerResult(std::move(input)));
     }
 
     if (is_first_layer) // Buffer previous input result and output NOP.
@@ -124,10 +124,10 @@ LayerResult PressureEqualizer::process_layer(LayerResult &&input)
     m_gcode_lines.erase(m_gcode_lines.begin(), m_gcode_lines.begin() + int(next_layer_first_idx));
 
     if (output_buffer_length > 0)
-        prev_layer_result->gcode = std::string(output_buffer.data());
+        prev_layer_result->gcode.assign(output_buffer.data(), output_buffer_length);
 
     assert(!input.nop_layer_result || m_layer_results.empty());
-    LayerResult out = *prev_layer_result;
+    LayerResult out = std::move(*prev_layer_result);
     delete prev_layer_result;
     return out;
 }
@@ -22,6 +22,7 @@
 #include "libslic3r/Geometry/Curves.hpp"
 #include "libslic3r/ShortEdgeCollapse.hpp"
 #include "libslic3r/TriangleSetSampling.hpp"
+#include "libslic3r/Trace.hpp"
 
 #include "libslic3r/Utils.hpp"
 
@@ -1413,6 +1414,7 @@ void SeamPlacer::align_seam_points(const PrintObject *po, const SeamPlacerImpl::
 
 void SeamPlacer::init(const Print &print, std::function<void(void)> throw_if_canceled_func) {
     using namespace SeamPlacerImpl;
+    SLIC3R_TRACE_SCOPE("SeamPlacer", "init");
     m_seam_per_object.clear();
 
     for (const PrintObject *po : print.objects()) {
@@ -1425,18 +1427,23 @@ void SeamPlacer::init(const Print &print, std::function<void(void)> throw_if_can
             gather_enforcers_blockers(global_model_info, po);
             throw_if_canceled_func();
             if (configured_seam_preference == spAligned || configured_seam_preference == spNearest) {
+                SLIC3R_TRACE_SCOPE("SeamPlacer", "compute_global_occlusion");
                 compute_global_occlusion(global_model_info, po, throw_if_canceled_func);
             }
             throw_if_canceled_func();
             BOOST_LOG_TRIVIAL(debug)
             << "SeamPlacer: gather_seam_candidates: start";
-            gather_seam_candidates(po, global_model_info);
+            {
+                SLIC3R_TRACE_SCOPE("SeamPlacer", "gather_seam_candidates");
+                gather_seam_candidates(po, global_model_info);
+            }
             BOOST_LOG_TRIVIAL(debug)
             << "SeamPlacer: gather_seam_candidates: end";
             throw_if_canceled_func();
             if (configured_seam_preference == spAligned || configured_seam_preference == spNearest) {
                 BOOST_LOG_TRIVIAL(debug)
                 << "SeamPlacer: calculate_candidates_visibility : start";
+                SLIC3R_TRACE_SCOPE("SeamPlacer", "calculate_candidates_visibility");
                 calculate_candidates_visibility(po, global_model_info);
                 BOOST_LOG_TRIVIAL(debug)
                 << "SeamPlacer: calculate_candidates_visibility : end";
@@ -1445,7 +1452,10 @@ void SeamPlacer::init(const Print &print, std::function<void(void)> throw_if_can
         throw_if_canceled_func();
         BOOST_LOG_TRIVIAL(debug)
         << "SeamPlacer: calculate_overhangs and layer embdedding : start";
-        calculate_overhangs_and_layer_embedding(po);
+        {
+            SLIC3R_TRACE_SCOPE("SeamPlacer", "calculate_overhangs_and_layer_embedding");
+            calculate_overhangs_and_layer_embedding(po);
+        }
         BOOST_LOG_TRIVIAL(debug)
         << "SeamPlacer: calculate_overhangs and layer embdedding: end";
         throw_if_canceled_func();
@@ -1473,6 +1483,7 @@ void SeamPlacer::init(const Print &print, std::function<void(void)> throw_if_can
         if (configured_seam_preference == spAligned || configured_seam_preference == spRear) {
             BOOST_LOG_TRIVIAL(debug)
             << "SeamPlacer: align_seam_points : start";
+            SLIC3R_TRACE_SCOPE("SeamPlacer", "align_seam_points");
             align_seam_points(po, comparator);
             BOOST_LOG_TRIVIAL(debug)
             << "SeamPlacer: align_seam_points : end";
@@ -4,7 +4,7 @@
 
 namespace Slic3r {
 
-std::string SpiralVase::process_layer(const std::string &gcode)
+std::string SpiralVase::process_layer(std::string &&gcode)
 {
     /*  This post-processor relies on several assumptions:
         - all layers are processed through it, including those that are not supposed
@@ -18,7 +18,7 @@ std::string SpiralVase::process_layer(const std::string &gcode)
     // in order to update positions.
     if (! m_enabled) {
         m_reader.parse_buffer(gcode);
-        return gcode;
+        return std::move(gcode);
     }
     
     // Get total XY length for this layer by summing all extrusion moves.
@@ -19,7 +19,7 @@ public:
     	m_enabled 		   = en;
     }
 
-    std::string process_layer(const std::string &gcode);
+    std::string process_layer(std::string &&gcode);
     
 private:
     const PrintConfig  &m_config;
@@ -1,8 +1,11 @@
 #include "GCodeReader.hpp"
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/nowide/fstream.hpp>
 #include <boost/nowide/cstdio.hpp>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -12,6 +15,9 @@
 
 #include <fast_float/fast_float.h>
 
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+
 namespace Slic3r {
 
 static inline char get_extrusion_axis_char(const GCodeConfig &config)
@@ -34,10 +40,8 @@ void GCodeReader::apply_config(const DynamicPrintConfig &config)
     m_extrusion_axis = get_extrusion_axis_char(m_config);
 }
 
-const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, GCodeLine &gline, std::pair<const char*, const char*> &command)
+const char* GCodeReader::tokenize_line(const char *ptr, const char *end, float *axis_values, uint32_t &mask, std::pair<const char*, const char*> &command) const
 {
-    assert(is_decimal_separator_point());
-    
     // command and args
     const char *c = ptr;
     {
@@ -75,8 +79,8 @@ const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, G
                 if (pend != c && is_end_of_word(*pend)) {
                     // The axis value has been parsed correctly.
                     if (axis != UNKNOWN_AXIS)
-	                    gline.m_axis[int(axis)] = float(v);
-                    gline.m_mask |= 1 << int(axis);
+	                    axis_values[int(axis)] = float(v);
+                    mask |= 1 << int(axis);
                     c = pend;
                 } else
                     // Skip the rest of the word.
@@ -86,12 +90,20 @@ const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, G
                 c = skip_word(c);
         }
     }
-    
-    if (gline.has(E) && m_config.use_relative_e_distances)
-        m_position[E] = 0;
 
     // Skip the rest of the line.
     for (; ! is_end_of_line(*c); ++ c);
+    return c;
+}
+
+const char* GCodeReader::parse_line_internal(const char *ptr, const char *end, GCodeLine &gline, std::pair<const char*, const char*> &command)
+{
+    assert(is_decimal_separator_point());
+
+    const char *c = this->tokenize_line(ptr, end, gline.m_axis, gline.m_mask, command);
+
+    if (gline.has(E) && m_config.use_relative_e_distances)
+        m_position[E] = 0;
 
     // Copy the raw string including the comment, without the trailing newlines.
     if (c > ptr)
@@ -126,6 +138,8 @@ template<typename ParseLineCallback, typename LineEndCallback>
 bool GCodeReader::parse_file_raw_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback)
 {
     FilePtr in{ boost::nowide::fopen(filename.c_str(), "rb") };
+    if (in.f == nullptr)
+        return false;
 
     // Read the input stream 64kB at a time, extract lines and process them.
     std::vector<char> buffer(65536 * 10, 0);
@@ -190,15 +204,172 @@ bool GCodeReader::parse_file_internal(const std::string &filename, ParseLineCall
         line_end_callback);
 }
 
+namespace ParseFileMapped {
+    // The file is tokenized in batches of whole lines, while the previous batch is being passed to the callback.
+    static constexpr size_t batch_size = 4 * 1024 * 1024;
+    // A batch is split into chunks of whole lines, which are tokenized in parallel.
+    static constexpr size_t chunk_size = 256 * 1024;
+
+    // G-code line tokenized by GCodeReader::tokenize_line(), referencing the memory mapped file.
+    // Offsets are relative to the start of the line, the line starts at the "next" offset of the previous line.
+    struct TokenizedLine {
+        uint32_t raw_end;
+        uint32_t cmd_begin;
+        uint32_t cmd_end;
+        // Start of the next line after the newline characters.
+        uint32_t next;
+        uint32_t mask;
+        float    axis[NUM_AXES];
+    };
+
+    struct Chunk {
+        const char                  *begin;
+        const char                  *end;
+        std::vector<TokenizedLine>   lines;
+    };
+
+    struct Batch {
+        // Chunks are reused between the batches to keep the capacity of their lines.
+        std::vector<Chunk>   chunks;
+        size_t               num_chunks { 0 };
+    };
+
+    // End of the first line ending at or after begin + size, including its newline character. Limited to end.
+    static const char* chunk_end(const char *begin, size_t size, const char *end)
+    {
+        if (size_t(end - begin) <= size)
+            return end;
+        const char *eol = static_cast<const char*>(memchr(begin + size - 1, '\n', end - (begin + size - 1)));
+        return eol == nullptr ? end : eol + 1;
+    }
+} // namespace ParseFileMapped
+
+template<typename ParseLineCallback, typename LineEndCallback>
+bool GCodeReader::parse_file_mapped_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback)
+{
+    using namespace ParseFileMapped;
+
+    boost::iostreams::mapped_file_source file;
+    try {
+        boost::filesystem::path path(filename);
+        if (boost::filesystem::file_size(path) == 0)
+            return true;
+        file.open(path);
+    } catch (const std::exception &) {
+        // Not a regular file or the file could not be mapped into memory. Read it by blocks.
+        return this->parse_file_internal(filename, parse_line_callback, line_end_callback);
+    }
+    if (! file.is_open())
+        return this->parse_file_internal(filename, parse_line_callback, line_end_callback);
+
+    const char *data     = file.data();
+    const char *data_end = data + file.size();
+    // tokenize_line() reads up to the end of line character, which is missing after the last line if the file does not end with a newline.
+    // Such a line is parsed from a copy.
+    const char *tail     = data_end;
+    while (tail != data && tail[-1] != '\r' && tail[-1] != '\n')
+        -- tail;
+
+    auto tokenize_batch = [this, tail](const char *begin, Batch &batch) -> const char* {
+        const char *batch_end = chunk_end(begin, batch_size, tail);
+        batch.num_chunks = 0;
+        for (const char *chunk_begin = begin; chunk_begin != batch_end; ++ batch.num_chunks) {
+            if (batch.num_chunks == batch.chunks.size())
+                batch.chunks.emplace_back();
+            Chunk &chunk = batch.chunks[batch.num_chunks];
+            chunk.begin = chunk_begin;
+            chunk.end   = chunk_begin = chunk_end(chunk_begin, chunk_size, batch_end);
+        }
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, batch.num_chunks, 1), [this, &batch](const tbb::blocked_range<size_t> &range) {
+            for (size_t chunk_idx = range.begin(); chunk_idx < range.end(); ++ chunk_idx) {
+                Chunk &chunk = batch.chunks[chunk_idx];
+                chunk.lines.clear();
+                for (const char *line = chunk.begin; line != chunk.end;) {
+                    const char *eol = line;
+                    for (; eol != chunk.end && *eol != '\r' && *eol != '\n'; ++ eol) ;
+                    TokenizedLine &out = chunk.lines.emplace_back();
+                    std::pair<const char*, const char*> command;
+                    memset(out.axis, 0, sizeof(out.axis));
+                    out.mask = 0;
+                    const char *raw_end = this->tokenize_line(line, eol, out.axis, out.mask, command);
+                    if (eol != chunk.end && *eol == '\r')
+                        ++ eol;
+                    if (eol != chunk.end && *eol == '\n')
+                        ++ eol;
+                    out.raw_end   = uint32_t(raw_end - line);
+                    out.cmd_begin = uint32_t(command.first - line);
+                    out.cmd_end   = uint32_t(command.second - line);
+                    out.next      = uint32_t(eol - line);
+                    line = eol;
+                }
+            }
+        });
+        return batch_end;
+    };
+
+    GCodeLine gline;
+    // Pass the tokenized lines to the callback in order, update the reader state.
+    auto replay_batch = [this, data, &gline, &parse_line_callback, &line_end_callback](const Batch &batch) {
+        for (size_t chunk_idx = 0; chunk_idx < batch.num_chunks; ++ chunk_idx) {
+            const Chunk &chunk = batch.chunks[chunk_idx];
+            const char  *line  = chunk.begin;
+            for (const TokenizedLine &in : chunk.lines) {
+                gline.reset();
+                memcpy(gline.m_axis, in.axis, sizeof(in.axis));
+                gline.m_mask = in.mask;
+                gline.m_raw.assign(line, line + in.raw_end);
+                std::pair<const char*, const char*> command(line + in.cmd_begin, line + in.cmd_end);
+                if (gline.has(E) && m_config.use_relative_e_distances)
+                    m_position[E] = 0;
+                if (m_verbose)
+                    std::cout << gline.m_raw << std::endl;
+                parse_line_callback(*this, gline);
+                update_coordinates(gline, command);
+                if (! m_parsing)
+                    // The callback wishes to exit.
+                    return;
+                line += in.next;
+                if (line[-1] == '\n')
+                    line_end_callback(size_t(line - data));
+            }
+        }
+    };
+
+    m_parsing = true;
+    Batch batches[2];
+    const char *batch_begin = tokenize_batch(data, batches[0]);
+    for (size_t batch_idx = 0; m_parsing && batches[batch_idx].num_chunks > 0; batch_idx ^= 1) {
+        // Tokenize the next batch while the current one is being processed.
+        tbb::task_group next_batch;
+        next_batch.run([&tokenize_batch, &batch_begin, &next = batches[batch_idx ^ 1]]() { batch_begin = tokenize_batch(batch_begin, next); });
+        try {
+            replay_batch(batches[batch_idx]);
+        } catch (...) {
+            // Canceled by the callback.
+            next_batch.cancel();
+            next_batch.wait();
+            throw;
+        }
+        next_batch.wait();
+    }
+
+    if (m_parsing && tail != data_end) {
+        std::string line(tail, data_end);
+        gline.reset();
+        this->parse_line(line.c_str(), line.c_str() + line.size(), gline, parse_line_callback);
+    }
+    return true;
+}
+
 bool GCodeReader::parse_file(const std::string &file, callback_t callback)
 {
-    return this->parse_file_internal(file, callback, [](size_t){});
+    return this->parse_file_mapped_internal(file, callback, [](size_t){});
 }
 
 bool GCodeReader::parse_file(const std::string &file, callback_t callback, std::vector<size_t> &lines_ends)
 {
     lines_ends.clear();
-    return this->parse_file_internal(file, callback, [&lines_ends](size_t file_pos){ lines_ends.emplace_back(file_pos); });
+    return this->parse_file_mapped_internal(file, callback, [&lines_ends](size_t file_pos){ lines_ends.emplace_back(file_pos); });
 }
 
 bool GCodeReader::parse_file_raw(const std::string &filename, raw_line_callback_t line_callback)
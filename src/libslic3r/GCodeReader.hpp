@@ -127,7 +127,32 @@ public:
     void parse_line(const std::string &line, Callback callback)
         { GCodeLine gline; this->parse_line(line.c_str(), line.c_str() + line.size(), gline, callback); }
 
+    // Pass a G0 / G1 move given by the values of its axes to the callback, as if its text was parsed, for example a move
+    // decoded from a binary G-code. mask has the bits of the Axis set, comment is the rest of the line following the axes.
+    template<typename Callback>
+    void parse_move(bool g1, uint32_t mask, const float *axis_values, std::string_view comment, GCodeLine &gline, Callback &callback)
+    {
+        gline.reset();
+        gline.m_raw = g1 ? "G1" : "G0";
+        gline.m_raw.append(comment.data(), comment.size() - (! comment.empty() && comment.back() == '\r'));
+        memcpy(gline.m_axis, axis_values, sizeof(gline.m_axis));
+        gline.m_mask = mask;
+        if (gline.has(E) && m_extrusion_axis != 'E') {
+            // The text parser would not recognize E as the extrusion axis.
+            gline.m_mask  &= ~(1 << int(E));
+            gline.m_mask  |= 1 << int(UNKNOWN_AXIS);
+            gline.m_axis[E] = 0;
+        }
+        if (gline.has(E) && m_config.use_relative_e_distances)
+            m_position[E] = 0;
+        callback(*this, gline);
+        for (size_t i = 0; i < NUM_AXES; ++ i)
+            if (gline.has(Axis(i)))
+                m_position[i] = gline.value(Axis(i));
+    }
+
     // Returns false if reading the file failed.
+    // The file is memory mapped, its lines are tokenized in parallel and then passed to the callback in order on the calling thread.
     bool parse_file(const std::string &file, callback_t callback);
     // Collect positions of line ends in the binary G-code to be used by the G-code viewer when memory mapping and displaying section of G-code
     // as an overlay in the 3D scene.
@@ -160,8 +185,13 @@ private:
     bool        parse_file_raw_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
     template<typename ParseLineCallback, typename LineEndCallback>
     bool        parse_file_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
+    template<typename ParseLineCallback, typename LineEndCallback>
+    bool        parse_file_mapped_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
 
     const char* parse_line_internal(const char *ptr, const char *end, GCodeLine &gline, std::pair<const char*, const char*> &command);
+    // Parse the command and the axes of a single line into axis / mask. Returns the end of the line without the newline characters.
+    // Does not modify the reader state, thus it may be called from multiple threads in parallel.
+    const char* tokenize_line(const char *ptr, const char *end, float *axis, uint32_t &mask, std::pair<const char*, const char*> &command) const;
     void        update_coordinates(GCodeLine &gline, std::pair<const char*, const char*> &command);
 
     static bool         is_whitespace(char c)           { return c == ' ' || c == '\t'; }
@@ -1,15 +1,12 @@
 #include "GCodeWriter.hpp"
 #include "CustomGCode.hpp"
 #include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <assert.h>
 
-#ifdef __APPLE__
-    #include <boost/spirit/include/karma.hpp>
-#endif
-
 #define FLAVOR_IS(val) this->config.gcode_flavor == val
 #define FLAVOR_IS_NOT(val) this->config.gcode_flavor != val
 
@@ -539,63 +536,91 @@ std::string GCodeWriter::set_fan(unsigned int speed) const
     return GCodeWriter::set_fan(this->config.gcode_flavor, this->config.gcode_comments, speed);
 }
 
-void GCodeFormatter::emit_axis(const char axis, const double v, size_t digits) {
-    assert(digits <= 9);
-    static constexpr const std::array<int, 10> pow_10{1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
-    *ptr_err.ptr++ = ' '; *ptr_err.ptr++ = axis;
+// Pairs of decimal digits "00" to "99", so that two digits are written by a single table lookup.
+static constexpr const char digit_pairs[201] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
 
-    char *base_ptr = this->ptr_err.ptr;
-    auto  v_int    = int64_t(std::round(v * pow_10[digits]));
-    // Older stdlib on macOS doesn't support std::from_chars at all, so it is used boost::spirit::karma::generate instead of it.
-    // That is a little bit slower than std::to_chars but not much.
-#ifdef __APPLE__
-    boost::spirit::karma::generate(this->ptr_err.ptr, boost::spirit::karma::int_generator<int64_t>(), v_int);
-#else
-    // this->buf_end minus 1 because we need space for adding the extra decimal point.
-    this->ptr_err = std::to_chars(this->ptr_err.ptr, this->buf_end - 1, v_int);
-#endif
-    size_t writen_digits = (this->ptr_err.ptr - base_ptr) - (v_int < 0 ? 1 : 0);
-    if (writen_digits < digits) {
-        // Number is smaller than 10^digits, so that we will pad it with zeros.
-        size_t remaining_digits = digits - writen_digits;
-        // Move all newly inserted chars by remaining_digits to allocate space for padding with zeros.
-        for (char *from_ptr = this->ptr_err.ptr - 1, *to_ptr = from_ptr + remaining_digits; from_ptr >= this->ptr_err.ptr - writen_digits; --to_ptr, --from_ptr)
-            *to_ptr = *from_ptr;
-
-        memset(this->ptr_err.ptr - writen_digits, '0', remaining_digits);
-        this->ptr_err.ptr += remaining_digits;
+// Writes ndigits of v, padded with leading zeros, in front of end and removes them from v.
+// Returns the start of the written digits.
+static inline char* write_digits_backwards(char *end, uint64_t &v, size_t ndigits)
+{
+    for (; ndigits >= 2; ndigits -= 2) {
+        const char *pair = digit_pairs + 2 * (v % 100);
+        v /= 100;
+        *-- end = pair[1];
+        *-- end = pair[0];
+    }
+    if (ndigits == 1) {
+        *-- end = char('0' + v % 10);
+        v /= 10;
     }
+    return end;
+}
 
-    // Move all newly inserted chars by one to allocate space for a decimal point.
-    for (char *to_ptr = this->ptr_err.ptr, *from_ptr = to_ptr - 1; from_ptr >= this->ptr_err.ptr - digits; --to_ptr, --from_ptr)
-        *to_ptr = *from_ptr;
+static inline size_t count_digits(uint64_t v)
+{
+    size_t n = 1;
+    for (; v >= 100; v /= 100)
+        n += 2;
+    return v >= 10 ? n + 1 : n;
+}
 
-    *(this->ptr_err.ptr - digits) = '.';
-    for (size_t i = 0; i < digits; ++i) {
-        if (*this->ptr_err.ptr != '0')
-            break;
-        this->ptr_err.ptr--;
-    }
-    if (*this->ptr_err.ptr == '.')
-        this->ptr_err.ptr--;
-    if ((this->ptr_err.ptr + 1) == base_ptr || *this->ptr_err.ptr == '-')
-        *(++this->ptr_err.ptr) = '0';
-    this->ptr_err.ptr++;
+// Same as int64_t(std::round(v)) for |v| < 2^63, but inlined. Subtracting the truncated value is exact.
+static inline int64_t round_half_away_from_zero(const double v)
+{
+    int64_t     i    = int64_t(v);
+    const double frac = v - double(i);
+    if (frac >= 0.5)
+        ++ i;
+    else if (frac <= -0.5)
+        -- i;
+    return i;
+}
 
-#if 0 // #ifndef NDEBUG
-    {
-        // Verify that the optimized formatter produces the same result as the standard sprintf().
-        double v1 = atof(std::string(base_ptr, this->ptr_err.ptr).c_str());
-        char buf[2048];
-        sprintf(buf, "%.*lf", int(digits), v);
-        double v2 = atof(buf);
-        // Numbers may differ when rounding at exactly or very close to 0.5 due to numerical issues when scaling the double to an integer.
-        // Thus the complex assert.
-//        assert(v1 == v2);
-        assert(std::abs(v1 - v) * pow_10[digits] < 0.50001);
-        assert(std::abs(v2 - v) * pow_10[digits] < 0.50001);
+char* GCodeFormatter::format_fixed(char *dst, const double v, size_t digits)
+{
+    assert(digits <= 9);
+    const int64_t v_int = round_half_away_from_zero(v * GCodeFormatter::pow_10[digits]);
+    if (v_int == 0) {
+        *dst ++ = '0';
+        return dst;
+    }
+    if (v_int < 0)
+        *dst ++ = '-';
+    uint64_t     v_abs   = v_int < 0 ? uint64_t(0) - uint64_t(v_int) : uint64_t(v_int);
+    const size_t ndigits = count_digits(v_abs);
+    char        *end;
+    if (ndigits <= digits) {
+        // No integer part, the leading zero of "0.x" is not written to save space in the G-code.
+        *dst ++ = '.';
+        memset(dst, '0', digits - ndigits);
+        end = dst + digits;
+        write_digits_backwards(end, v_abs, ndigits);
+    } else {
+        // Write the fractional digits, the decimal point and the integer digits from the back,
+        // so that only divisions by constants are needed.
+        end = dst + ndigits + (digits > 0);
+        char *ptr = write_digits_backwards(end, v_abs, digits);
+        if (digits > 0)
+            *-- ptr = '.';
+        write_digits_backwards(ptr, v_abs, ndigits - digits);
+    }
+    if (digits > 0) {
+        // Trim the trailing zeros and the decimal point. There is a non-zero digit before the decimal point
+        // or after it, so the scan stops inside the number.
+        while (end[-1] == '0')
+            -- end;
+        if (end[-1] == '.')
+            -- end;
     }
-#endif // NDEBUG
+    return end;
+}
+
+void GCodeFormatter::emit_axis(const char axis, const double v, size_t digits) {
+    *ptr_err.ptr++ = ' '; *ptr_err.ptr++ = axis;
+    this->ptr_err.ptr = format_fixed(this->ptr_err.ptr, v, digits);
+    assert(this->ptr_err.ptr < this->buf_end);
 }
 
 } // namespace Slic3r
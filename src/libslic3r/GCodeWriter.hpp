@@ -153,6 +153,11 @@ public:
     static double                                 quantize_xyzf(double v) { return quantize(v, XYZF_EXPORT_DIGITS); }
     static double                                 quantize_e(double v) { return quantize(v, E_EXPORT_DIGITS); }
 
+    // Writes v rounded to the given number of decimal digits (at most 9) into dst without a terminating zero,
+    // trailing zeros and the leading zero of the integer part are trimmed ("-.5", "12", "0").
+    // At most 21 characters are written, returns the end of the written text.
+    static char*                                  format_fixed(char *dst, double v, size_t digits);
+
     void emit_axis(const char axis, const double v, size_t digits);
 
     void emit_xy(const Vec2d &point) {
@@ -781,8 +781,8 @@ Project_point_on_plane(Vec3f v1, Vec3f n, Point pt)
 }
 
 // http://paulbourke.net/geometry/pointlineplane/index.html
-Vec3d*
-Line_intersection(Vec3d p1, Vec3d p2, Point p3, Point p4) {
+std::optional<Vec3d>
+Line_intersection(const Vec3d &p1, const Vec3d &p2, const Point &p3, const Point &p4) {
 
     float denom = ((p4.y() - p3.y())*(p2.x() - p1.x())) -
                   ((p4.x() - p3.x())*(p2.y() - p1.y()));
@@ -795,7 +795,7 @@ Line_intersection(Vec3d p1, Vec3d p2, Point p3, Point p4) {
 
     if(denom == 0.0f)
     {
-        return NULL;
+        return std::nullopt;
     }
 
     float ua = nume_a / denom;
@@ -804,16 +804,124 @@ Line_intersection(Vec3d p1, Vec3d p2, Point p3, Point p4) {
     if(ua >= 0.0f && ua <= 1.0f && ub >= 0.0f && ub <= 1.0f)
     {
         // Get the intersection point anc calculate z component
-        Vec3d* ret = new Vec3d();
-        ret->x() = p1.x() + ua*(p2.x() - p1.x());
-        ret->y() = p1.y() + ua*(p2.y() - p1.y());
-        ret->z() = p1.z() - ((sqrt((p1.x()-ret->x())*(p1.x()-ret->x()) + (p1.y()-ret->y())*(p1.y()-ret->y()))
+        Vec3d ret;
+        ret.x() = p1.x() + ua*(p2.x() - p1.x());
+        ret.y() = p1.y() + ua*(p2.y() - p1.y());
+        ret.z() = p1.z() - ((sqrt((p1.x()-ret.x())*(p1.x()-ret.x()) + (p1.y()-ret.y())*(p1.y()-ret.y()))
                   / sqrt((p1.x()-p2.x())*(p1.x()-p2.x()) + (p1.y()-p2.y())*(p1.y()-p2.y())))
                   * (p1.z() - p2.z()));
         return ret;
     }
 
-    return NULL;
+    return std::nullopt;
+}
+
+void TrianglesSoA::clear()
+{
+    for (int j = 0; j < 3; ++ j) {
+        x[j].clear();
+        y[j].clear();
+        z[j].clear();
+    }
+    nx.clear();
+    ny.clear();
+    nz.clear();
+}
+
+void TrianglesSoA::reserve(size_t n)
+{
+    for (int j = 0; j < 3; ++ j) {
+        x[j].reserve(n);
+        y[j].reserve(n);
+        z[j].reserve(n);
+    }
+    nx.reserve(n);
+    ny.reserve(n);
+    nz.reserve(n);
+}
+
+void TrianglesSoA::push_back(const Vec3f &v0, const Vec3f &v1, const Vec3f &v2, const Vec3f &normal)
+{
+    for (int j = 0; j < 3; ++ j) {
+        const Vec3f &v = j == 0 ? v0 : j == 1 ? v1 : v2;
+        x[j].emplace_back(v.x());
+        y[j].emplace_back(v.y());
+        z[j].emplace_back(v.z());
+    }
+    nx.emplace_back(normal.x());
+    ny.emplace_back(normal.y());
+    nz.emplace_back(normal.z());
+}
+
+void points_in_triangles(const Vec2f &pt, const TrianglesSoA &triangles, uint8_t *out)
+{
+    const float  px = pt.x();
+    const float  py = pt.y();
+    const float *x0 = triangles.x[0].data(), *x1 = triangles.x[1].data(), *x2 = triangles.x[2].data();
+    const float *y0 = triangles.y[0].data(), *y1 = triangles.y[1].data(), *y2 = triangles.y[2].data();
+    const size_t n  = triangles.size();
+    for (size_t i = 0; i < n; ++ i) {
+        // Same as sign() of the three edges in Point_in_triangle().
+        const float s0 = (px - x1[i]) * (y0[i] - y1[i]) - (x0[i] - x1[i]) * (py - y1[i]);
+        const float s1 = (px - x2[i]) * (y1[i] - y2[i]) - (x1[i] - x2[i]) * (py - y2[i]);
+        const float s2 = (px - x0[i]) * (y2[i] - y0[i]) - (x2[i] - x0[i]) * (py - y0[i]);
+        out[i] = uint8_t(s0 > 0.f) & uint8_t(s1 > 0.f) & uint8_t(s2 > 0.f);
+    }
+}
+
+void project_point_on_planes(const Vec2f &pt, const TrianglesSoA &triangles, float *out)
+{
+    const float  px = pt.x();
+    const float  py = pt.y();
+    const float *x0 = triangles.x[0].data(), *y0 = triangles.y[0].data(), *z0 = triangles.z[0].data();
+    const float *nx = triangles.nx.data(), *ny = triangles.ny.data(), *nz = triangles.nz.data();
+    const size_t n  = triangles.size();
+    for (size_t i = 0; i < n; ++ i) {
+        const float d = -(x0[i] * nx[i] + y0[i] * ny[i] + z0[i] * nz[i]);
+        out[i] = -(nx[i] * px + ny[i] * py + d) / nz[i];
+    }
+}
+
+void line_intersections(const TrianglesSoA &triangles, const Point &p3, const Point &p4,
+                        double *out_x, double *out_y, double *out_z, uint8_t *out_mask)
+{
+    const double x3  = p3.x();
+    const double y3  = p3.y();
+    const double dx4 = p4.x() - p3.x();
+    const double dy4 = p4.y() - p3.y();
+    const size_t n   = triangles.size();
+    for (int j = 0; j < 3; ++ j) {
+        const float *xa = triangles.x[j].data(), *ya = triangles.y[j].data();
+        const float *xb = triangles.x[(j + 1) % 3].data(), *yb = triangles.y[(j + 1) % 3].data();
+        for (size_t i = 0; i < n; ++ i) {
+            const double x1 = scale_(xa[i]), y1 = scale_(ya[i]);
+            const double x2 = scale_(xb[i]), y2 = scale_(yb[i]);
+            const float  denom  = dy4 * (x2 - x1) - dx4 * (y2 - y1);
+            const float  nume_a = dx4 * (y1 - y3) - dy4 * (x1 - x3);
+            const float  nume_b = (x2 - x1) * (y1 - y3) - (y2 - y1) * (x1 - x3);
+            // Parallel segments produce an infinite or NaN ratio, which fails the range test below.
+            const float  ua     = nume_a / denom;
+            const float  ub     = nume_b / denom;
+            const size_t k      = 3 * i + j;
+            out_x[k]    = x1 + ua * (x2 - x1);
+            out_y[k]    = y1 + ua * (y2 - y1);
+            out_mask[k] = uint8_t(ua >= 0.f) & uint8_t(ua <= 1.f) & uint8_t(ub >= 0.f) & uint8_t(ub <= 1.f);
+        }
+    }
+    // Intersections are rare, interpolate Z only for those.
+    for (size_t k = 0; k < 3 * n; ++ k)
+        if (out_mask[k]) {
+            const size_t i  = k / 3;
+            const int    ja = int(k % 3);
+            const int    jb = (ja + 1) % 3;
+            const double x1 = scale_(triangles.x[ja][i]), y1 = scale_(triangles.y[ja][i]), z1 = scale_(triangles.z[ja][i]);
+            const double x2 = scale_(triangles.x[jb][i]), y2 = scale_(triangles.y[jb][i]), z2 = scale_(triangles.z[jb][i]);
+            const double x  = out_x[k];
+            const double y  = out_y[k];
+            out_z[k] = z1 - ((std::sqrt((x1 - x) * (x1 - x) + (y1 - y) * (y1 - y))
+                            / std::sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2)))
+                            * (z1 - z2));
+        }
 }
 
 }} // namespace Slic3r::Geometry
@@ -540,7 +540,37 @@ bool Point_in_triangle(Vec2f pt, Vec2f v1, Vec2f v2, Vec2f v3);
 coord_t Project_point_on_plane(Vec3f v1, Vec3f n, Point pt);
 
 // http://paulbourke.net/geometry/pointlineplane/index.html
-Vec3d *Line_intersection(Vec3d p1, Vec3d p2, Point p3, Point p4);
+// Intersection of the segment (p1, p2) with the segment (p3, p4) in the XY plane, Z interpolated along (p1, p2).
+std::optional<Vec3d> Line_intersection(const Vec3d &p1, const Vec3d &p2, const Point &p3, const Point &p4);
+
+// Triangles stored as a structure of arrays for the batch variants of the functions above.
+struct TrianglesSoA
+{
+    // Coordinates of the three vertices of the triangles, unscaled.
+    std::array<std::vector<float>, 3> x, y, z;
+    // Normals of the triangles.
+    std::vector<float>                nx, ny, nz;
+
+    size_t size() const { return nx.size(); }
+    void   clear();
+    void   reserve(size_t n);
+    void   push_back(const Vec3f &v0, const Vec3f &v1, const Vec3f &v2, const Vec3f &normal);
+};
+
+// Batch variants of Point_in_triangle(), Project_point_on_plane() and Line_intersection() testing a single point
+// or a segment against all triangles, writing the results into buffers provided by the caller.
+// The loops are branch free, so that the compiler vectorizes them for the instruction set the build targets.
+
+// out[i] = Point_in_triangle(pt, v0[i], v1[i], v2[i])
+void points_in_triangles(const Vec2f &pt, const TrianglesSoA &triangles, uint8_t *out);
+// Unscaled Z of the vertical projection of pt onto the planes of the triangles, as calculated by Project_point_on_plane().
+// Undefined for triangles with zero normal.z().
+void project_point_on_planes(const Vec2f &pt, const TrianglesSoA &triangles, float *out);
+// Intersections of the segment (p3, p4) with the edges (v[j], v[(j + 1) % 3]) of the triangles scaled up,
+// as calculated by Line_intersection(). The result of edge j of triangle i is stored at index 3 * i + j,
+// out_mask is 0 where the segments do not intersect.
+void line_intersections(const TrianglesSoA &triangles, const Point &p3, const Point &p4,
+                        double *out_x, double *out_y, double *out_z, uint8_t *out_mask);
 
 inline float triangle_surface(Point p1, Point p2, Point p3) {
     return 0.5 * ((p2.x()-p1.x()) * (p3.y()-p1.y()) - (p2.y()-p1.y()) * (p3.x()-p1.x()));
@@ -588,6 +588,27 @@ void Layer::restore_untyped_slices_no_extra_perimeters()
     }
 }
 
+void Layer::backup_planar_slices()
+{
+    for (LayerRegion *layerm : m_regions)
+        layerm->m_planar_slices = to_expolygons(layerm->slices().surfaces);
+    m_planar_lslices = this->lslices;
+    m_planar_lslice_indices_sorted_by_print_order = this->lslice_indices_sorted_by_print_order;
+}
+
+void Layer::restore_planar_slices()
+{
+    for (LayerRegion *layerm : m_regions) {
+        layerm->m_slices.set(std::move(layerm->m_planar_slices), stInternal);
+        layerm->m_planar_slices.clear();
+        layerm->m_nonplanar_surfaces.clear();
+    }
+    this->lslices = std::move(m_planar_lslices);
+    this->lslice_indices_sorted_by_print_order = std::move(m_planar_lslice_indices_sorted_by_print_order);
+    m_planar_lslices.clear();
+    m_planar_lslice_indices_sorted_by_print_order.clear();
+}
+
 ExPolygons Layer::merged(float offset_scaled) const
 {
 	assert(offset_scaled >= 0.f);
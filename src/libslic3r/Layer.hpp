@@ -172,7 +172,7 @@ public:
     bool    has_extrusions() const { return ! this->perimeters().empty() || ! this->fills().empty(); }
 
     //append a new nonplanar surface to the list skip if already in list
-    void append_nonplanar_surface(NonplanarSurface& surface);
+    void append_nonplanar_surface(const NonplanarSurface& surface);
     // Projects the paths of a collection regarding the structure of a stl mesh
     void project_nonplanar_extrusion(ExtrusionEntityCollection* collection);
     /// Projects nonplanar surfaces downwards regarding the structure of the stl mesh.
@@ -205,6 +205,9 @@ private:
     // Only backed up for multi-region layers or layers with elephant foot compensation.
     //FIXME Review whether not to simplify the code by keeping the raw_slices all the time.
     ExPolygons                  m_raw_slices;
+    // Backed up slices before the slices of nonplanar surfaces were moved to their home layers.
+    // Only backed up for objects with nonplanar surfaces.
+    ExPolygons                  m_planar_slices;
 
 //FIXME make m_slices public for unit tests
 public:
@@ -376,6 +379,10 @@ public:
     void                    restore_untyped_slices();
     // To improve robustness of detect_surfaces_type() when reslicing (working with typed slices), see GH issue #7442.
     void                    restore_untyped_slices_no_extra_perimeters();
+    // Backup and restore the slices before the slices of nonplanar surfaces were moved to their home layers,
+    // so that the nonplanar surfaces may be detected again without reslicing.
+    void                    backup_planar_slices();
+    void                    restore_planar_slices();
     // Slices merged into islands, to be used by the elephant foot compensation to trim the individual surfaces with the shrunk merged slices.
     ExPolygons              merged(float offset) const;
     template <class T> bool any_internal_region_slice_contains(const T &item) const {
@@ -444,6 +451,10 @@ private:
     size_t              m_id;
     PrintObject        *m_object;
     LayerRegionPtrs     m_regions;
+
+    // Backup of lslices and their print order before the slices of nonplanar surfaces were moved to their home layers.
+    ExPolygons          m_planar_lslices;
+    std::vector<size_t> m_planar_lslice_indices_sorted_by_print_order;
 };
 
 class SupportLayer : public Layer 
@@ -9,6 +9,7 @@
 #include "Surface.hpp"
 #include "BoundingBox.hpp"
 #include "SVG.hpp"
+#include "TriangleMesh.hpp"
 #include "Algorithm/RegionExpansion.hpp"
 
 #include <algorithm>
@@ -915,7 +916,7 @@ void LayerRegion::export_region_fill_surfaces_to_svg_debug(const char *name) con
 }
 
 void
-LayerRegion::append_nonplanar_surface(NonplanarSurface& surface)
+LayerRegion::append_nonplanar_surface(const NonplanarSurface& surface)
 {
     for(auto & s : m_nonplanar_surfaces){
         if (s == surface){
@@ -1031,37 +1032,42 @@ smallerY(const Vec3d &a, const Vec3d &b)
 void
 LayerRegion::project_nonplanar_path(ExtrusionPath *path)
 {
+    std::vector<size_t>           facets;
+    Geometry::TrianglesSoA        triangles;
+    std::vector<uint8_t>          mask;
+    std::vector<float>            plane_z;
+    std::vector<double>           xs, ys, zs;
+    // Gather the facets overlapping bbox into the batch buffers.
+    auto collect_triangles = [&facets, &triangles](const NonplanarSurface &surface, const BoundingBoxf &bbox) {
+        surface.facets_in_bbox(bbox, facets);
+        triangles.clear();
+        for (size_t facet_idx : facets) {
+            const stl_triangle_vertex_indices &idx = surface.its.indices[facet_idx];
+            triangles.push_back(surface.its.vertices[idx(0)], surface.its.vertices[idx(1)], surface.its.vertices[idx(2)], surface.normals[facet_idx]);
+        }
+    };
+
+    path->nonplanar_z.assign(path->polyline.points.size(), -1);
+
     //First check all points and project them regarding the triangle mesh
-    for (Point& point : path->polyline.points) {
+    for (size_t point_idx = 0; point_idx < path->polyline.points.size(); ++ point_idx) {
+        const Point &point = path->polyline.points[point_idx];
+        const Vec2d  pt    = unscale(point);
         for (auto& surface : m_nonplanar_surfaces) {
             float distance_to_top = surface.stats.max.z - this->layer()->print_z;
-            for(auto& facet : surface.mesh) {
-                // skip if point is outside of the bounding box of the triangle
-                if (unscale(point).x() < std::min({facet.second.vertex[0].x, facet.second.vertex[1].x, facet.second.vertex[2].x}) ||
-                    unscale(point).x() > std::max({facet.second.vertex[0].x, facet.second.vertex[1].x, facet.second.vertex[2].x}) ||
-                    unscale(point).y() < std::min({facet.second.vertex[0].y, facet.second.vertex[1].y, facet.second.vertex[2].y}) ||
-                    unscale(point).y() > std::max({facet.second.vertex[0].y, facet.second.vertex[1].y, facet.second.vertex[2].y}))
-                {
-                    continue;
-                }
-
-                //check if point is inside of Triangle
-                if (Slic3r::Geometry::Point_in_triangle(
-                    Vec2f(unscale(point).x(), unscale(point).y()),
-                    Vec2f(facet.second.vertex[0].x, facet.second.vertex[0].y),
-                    Vec2f(facet.second.vertex[1].x, facet.second.vertex[1].y),
-                    Vec2f(facet.second.vertex[2].x, facet.second.vertex[2].y))
-                    && (facet.second.normal.z != 0))
-                {
-                    coord_t z = Slic3r::Geometry::Project_point_on_plane(Vec3f(facet.second.vertex[0].x,facet.second.vertex[0].y,facet.second.vertex[0].z),
-                                                             Vec3f(facet.second.normal.x,facet.second.normal.y,facet.second.normal.z),
-                                                             point);
-
+            collect_triangles(surface, BoundingBoxf(pt, pt));
+            mask.resize(triangles.size());
+            plane_z.resize(triangles.size());
+            //check if point is inside of Triangle
+            Slic3r::Geometry::points_in_triangles(Vec2f(pt.x(), pt.y()), triangles, mask.data());
+            Slic3r::Geometry::project_point_on_planes(Vec2f(unscale<float>(point.x()), unscale<float>(point.y())), triangles, plane_z.data());
+            for (size_t i = 0; i < triangles.size(); ++ i)
+                if (mask[i] && triangles.nz[i] != 0) {
+                    coord_t z = scale_(plane_z[i]);
                     //Shift down when on lower layer
-                    point.nonplanar_z = z - scale_(distance_to_top);
+                    path->nonplanar_z[point_idx] = z - scale_(distance_to_top);
                     //break;
                 }
-            }
         }
     }
 
@@ -1070,23 +1076,24 @@ LayerRegion::project_nonplanar_path(ExtrusionPath *path)
     for (std::vector<Vec3crd>::size_type i = 0; i < size-1; ++i)
     {
         Pointf3s intersections;
+        // only the facets overlapping the bounding box of the line may intersect it
+        BoundingBoxf line_bbox;
+        line_bbox.merge(unscale(path->polyline.points[i]));
+        line_bbox.merge(unscale(path->polyline.points[i+1]));
         // check against every facet if lines intersect
         for (auto& surface : m_nonplanar_surfaces) {
             float distance_to_top = surface.stats.max.z - this->layer()->print_z;
-            for(auto& facet : surface.mesh) {
-                for(int j= 0; j < 3; j++) {
-                    // TODO precheck for faster computation
-                    Vec3d p1 = Vec3d(scale_(facet.second.vertex[j].x), scale_(facet.second.vertex[j].y), scale_(facet.second.vertex[j].z));
-                    Vec3d p2 = Vec3d(scale_(facet.second.vertex[(j+1) % 3].x), scale_(facet.second.vertex[(j+1) % 3].y), scale_(facet.second.vertex[(j+1) % 3].z));
-                    Vec3d* p = Slic3r::Geometry::Line_intersection(p1, p2, path->polyline.points[i], path->polyline.points[i+1]);
-
-                    if (p) {
-                        // add distance to top for every added point
-                        p->z() = p->z() - scale_(distance_to_top);
-                        intersections.push_back(*p);
-                    }
-                }
-            }
+            collect_triangles(surface, line_bbox);
+            const size_t num_edges = 3 * triangles.size();
+            xs.resize(num_edges);
+            ys.resize(num_edges);
+            zs.resize(num_edges);
+            mask.resize(num_edges);
+            Slic3r::Geometry::line_intersections(triangles, path->polyline.points[i], path->polyline.points[i+1], xs.data(), ys.data(), zs.data(), mask.data());
+            for (size_t k = 0; k < num_edges; ++ k)
+                if (mask[k])
+                    // add distance to top for every added point
+                    intersections.emplace_back(xs[k], ys[k], zs[k] - scale_(distance_to_top));
         }
 
         // Stop if no intersections are found
@@ -1132,9 +1139,8 @@ LayerRegion::project_nonplanar_path(ExtrusionPath *path)
         //insert new points into array
         for (Vec3d p : intersections)
         {
-            Point *pt = new Point(p.x(), p.y());
-            pt->nonplanar_z = p.z();
-            path->polyline.points.insert(path->polyline.points.begin()+i+1, *pt);
+            path->polyline.points.insert(path->polyline.points.begin()+i+1, Point(p.x(), p.y()));
+            path->nonplanar_z.insert(path->nonplanar_z.begin()+i+1, coord_t(p.z()));
         }
 
         //modifiy array boundary
@@ -1146,9 +1152,9 @@ LayerRegion::project_nonplanar_path(ExtrusionPath *path)
 void
 LayerRegion::correct_z_on_path(ExtrusionPath *path)
 {
-    for (Point& point : path->polyline.points) {
-        if(point.nonplanar_z == -1) {
-            point.nonplanar_z = scale_(this->layer()->print_z);
+    for (coord_t &z : path->nonplanar_z) {
+        if(z == -1) {
+            z = scale_(this->layer()->print_z);
         }
     }
 }
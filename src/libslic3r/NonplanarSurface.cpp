@@ -1,11 +1,46 @@
 #include "NonplanarSurface.hpp"
+#include "TriangleMesh.hpp"
+
 #include <boost/log/trivial.hpp>
 
 namespace Slic3r {
 
-NonplanarSurface::NonplanarSurface(std::map<int, NonplanarFacet> &_mesh)
+NonplanarSurface::NonplanarSurface(const indexed_triangle_set &source, const std::vector<Vec3f> &source_normals,
+                                   const std::vector<Vec3i> &source_neighbors, const std::vector<int> &facets)
 {
-    this->mesh = _mesh;
+    assert(source_normals.size() == source.indices.size());
+    assert(source_neighbors.size() == source.indices.size());
+
+    // Map of source facets / vertices to the facets / vertices of this surface, -1 if not copied.
+    std::vector<int> facet_map(source.indices.size(), -1);
+    std::vector<int> vertex_map(source.vertices.size(), -1);
+
+    this->its.indices.reserve(facets.size());
+    this->normals.reserve(facets.size());
+    for (int facet_idx : facets) {
+        facet_map[facet_idx] = int(this->its.indices.size());
+        stl_triangle_vertex_indices face;
+        for (int j = 0; j < 3; ++ j) {
+            int &vertex_idx = vertex_map[source.indices[facet_idx](j)];
+            if (vertex_idx == -1) {
+                vertex_idx = int(this->its.vertices.size());
+                this->its.vertices.emplace_back(source.vertices[source.indices[facet_idx](j)]);
+            }
+            face(j) = vertex_idx;
+        }
+        this->its.indices.emplace_back(face);
+        this->normals.emplace_back(source_normals[facet_idx]);
+    }
+
+    this->neighbors.reserve(facets.size());
+    for (int facet_idx : facets) {
+        const Vec3i &source_neighbor = source_neighbors[facet_idx];
+        Vec3i neighbor;
+        for (int j = 0; j < 3; ++ j)
+            neighbor(j) = source_neighbor(j) == -1 ? -1 : facet_map[source_neighbor(j)];
+        this->neighbors.emplace_back(neighbor);
+    }
+
     this->calculate_stats();
 }
 
@@ -29,23 +64,24 @@ NonplanarSurface::calculate_stats()
     this->stats.max.x = -10000000;
     this->stats.max.y = -10000000;
     this->stats.max.z = -10000000;
-    for(auto& facet : this->mesh) {
-        this->stats.min.x = std::min(this->stats.min.x, facet.second.stats.min.x);
-        this->stats.min.y = std::min(this->stats.min.y, facet.second.stats.min.y);
-        this->stats.min.z = std::min(this->stats.min.z, facet.second.stats.min.z);
-        this->stats.max.x = std::max(this->stats.max.x, facet.second.stats.max.x);
-        this->stats.max.y = std::max(this->stats.max.y, facet.second.stats.max.y);
-        this->stats.max.z = std::max(this->stats.max.z, facet.second.stats.max.z);
+    for (const stl_vertex &v : this->its.vertices) {
+        this->stats.min.x = std::min(this->stats.min.x, v.x());
+        this->stats.min.y = std::min(this->stats.min.y, v.y());
+        this->stats.min.z = std::min(this->stats.min.z, v.z());
+        this->stats.max.x = std::max(this->stats.max.x, v.x());
+        this->stats.max.y = std::max(this->stats.max.y, v.y());
+        this->stats.max.z = std::max(this->stats.max.z, v.z());
     }
 }
 
 void
 NonplanarSurface::translate(float x, float y, float z)
 {
-    //translate all facets
-    for(auto& facet : this->mesh) {
-        facet.second.translate(x, y, z);
-    }
+    this->tree.clear();
+
+    //translate all vertices
+    for (stl_vertex &v : this->its.vertices)
+        v += Vec3f(x, y, z);
 
     //translate min and max values
     this->stats.min.x += x;
@@ -69,9 +105,13 @@ NonplanarSurface::scale(float factor)
 void
 NonplanarSurface::scale(float versor[3])
 {
-    //scale all facets
-    for(auto& facet : this->mesh) {
-        facet.second.scale(versor);
+    this->tree.clear();
+
+    //scale all vertices
+    for (stl_vertex &v : this->its.vertices) {
+        v.x() *= versor[0];
+        v.y() *= versor[1];
+        v.z() *= versor[2];
     }
 
     //scale min and max values
@@ -89,14 +129,13 @@ NonplanarSurface::rotate_z(float angle) {
   double c = cos(radian_angle);
   double s = sin(radian_angle);
 
-  for(auto& facet : this->mesh) {
-    for(int j = 0; j < 3; j++) {
-        double xold = facet.second.vertex[j].x;
-        double yold = facet.second.vertex[j].y;
-        facet.second.vertex[j].x = c * xold - s * yold;
-        facet.second.vertex[j].y = s * xold + c * yold;
-    }
-    facet.second.calculate_stats();
+  this->tree.clear();
+
+  for (stl_vertex &v : this->its.vertices) {
+      double xold = v.x();
+      double yold = v.y();
+      v.x() = c * xold - s * yold;
+      v.y() = s * xold + c * yold;
   }
 
   this->calculate_stats();
@@ -105,84 +144,72 @@ NonplanarSurface::rotate_z(float angle) {
 void
 NonplanarSurface::debug_output()
 {
-    std::cout << "Facets(" << this->mesh.size() << "): (min:X:" << this->stats.min.x << " Y:" << this->stats.min.y << " Z:" << this->stats.min.z <<
+    std::cout << "Facets(" << this->facets_count() << "): (min:X:" << this->stats.min.x << " Y:" << this->stats.min.y << " Z:" << this->stats.min.z <<
                            " max:X:" << this->stats.max.x << " Y:" << this->stats.max.y << " Z:" << this->stats.max.z << ")" << 
                            "Height " << this->stats.max.z - this->stats.min.z << std::endl;
-    for(auto& facet : this->mesh) {
-        std::cout << "triangle: (" << facet.first << ")(" << facet.second.marked << ") ";
-        std::cout << " (" << (180*std::acos(facet.second.normal.z))/3.14159265 << "°)";
-
-        std::cout << " | V0:";
-        std::cout << " X:"<< facet.second.vertex[0].x;
-        std::cout << " Y:"<< facet.second.vertex[0].y;
-        std::cout << " Z:"<< facet.second.vertex[0].z;
-
-        std::cout << " | V1:";
-        std::cout << " X:"<< facet.second.vertex[1].x;
-        std::cout << " Y:"<< facet.second.vertex[1].y;
-        std::cout << " Z:"<< facet.second.vertex[1].z;
+    for (size_t facet_idx = 0; facet_idx < this->facets_count(); ++ facet_idx) {
+        const Vec3f &normal = this->normals[facet_idx];
+        std::cout << "triangle: (" << facet_idx << ") ";
+        std::cout << " (" << (180*std::acos(normal.z()))/3.14159265 << "°)";
 
-        std::cout << " | V2:";
-        std::cout << " X:"<< facet.second.vertex[2].x;
-        std::cout << " Y:"<< facet.second.vertex[2].y;
-        std::cout << " Z:"<< facet.second.vertex[2].z;
+        for (int j = 0; j < 3; ++ j) {
+            const stl_vertex &v = this->its.vertices[this->its.indices[facet_idx](j)];
+            std::cout << " | V" << j << ":";
+            std::cout << " X:"<< v.x();
+            std::cout << " Y:"<< v.y();
+            std::cout << " Z:"<< v.z();
+        }
 
         std::cout << " | Normal:";
-        std::cout << " X:"<< facet.second.normal.x;
-        std::cout << " Y:"<< facet.second.normal.y;
-        std::cout << " Z:"<< facet.second.normal.z;
+        std::cout << " X:"<< normal.x();
+        std::cout << " Y:"<< normal.y();
+        std::cout << " Z:"<< normal.z();
 
-        //TODO check if neighbors exist
-        // stl_neighbors* neighbors = mesh.stl.neighbors_start + facet.first;
         std::cout << " | Neighbors:";
-        std::cout << " 0:"<< facet.second.neighbor[0];
-        std::cout << " 1:"<< facet.second.neighbor[1];
-        std::cout << " 2:"<< facet.second.neighbor[2];
+        std::cout << " 0:"<< this->neighbors[facet_idx](0);
+        std::cout << " 1:"<< this->neighbors[facet_idx](1);
+        std::cout << " 2:"<< this->neighbors[facet_idx](2);
         std::cout << std::endl;
     }
 }
 
+// Split the surface into its edge connected components.
 NonplanarSurfaces
-NonplanarSurface::group_surfaces()
+NonplanarSurface::group_surfaces() const
 {
-    std::pair<int, NonplanarFacet> begin = *this->mesh.begin();
-    this->mark_neighbor_surfaces(begin.first);
-    NonplanarSurface newSurface;
-    for (std::map<int, NonplanarFacet>::iterator it=this->mesh.begin(); it!=this->mesh.end();) {
-        if((*it).second.marked == false) {
-            newSurface.mesh[(*it).first] = (*it).second;
-            it = this->mesh.erase(it);
-        }
-        else {
-            ++it;
+    // Label the components with a flood fill over the facet neighbors, seeded in ascending facet order.
+    std::vector<int> component(this->facets_count(), -1);
+    int              num_components = 0;
+    std::vector<int> queue;
+    for (size_t seed = 0; seed < this->facets_count(); ++ seed) {
+        if (component[seed] != -1)
+            continue;
+        component[seed] = num_components;
+        queue.assign(1, int(seed));
+        while (! queue.empty()) {
+            int facet_idx = queue.back();
+            queue.pop_back();
+            for (int j = 0; j < 3; ++ j) {
+                int neighbor = this->neighbors[facet_idx](j);
+                if (neighbor != -1 && component[neighbor] == -1) {
+                    component[neighbor] = num_components;
+                    queue.emplace_back(neighbor);
+                }
+            }
         }
+        ++ num_components;
     }
-    this->calculate_stats();
-    if (newSurface.mesh.size() == 0) {
-        //return only this
-        NonplanarSurfaces nonplanar_surfaces;
-        nonplanar_surfaces.push_back(*this);
-        return nonplanar_surfaces;
-    } 
-    else {
-        //return union of this and recursion
-        NonplanarSurfaces nonplanar_surfaces = newSurface.group_surfaces();
-        nonplanar_surfaces.push_back(*this);
-        return nonplanar_surfaces;
-    }
-}
 
-void
-NonplanarSurface::mark_neighbor_surfaces(int id)
-{
-    //if already marked return
-    if(this->mesh.find(id) == this->mesh.end() || this->mesh[id].marked == true) return;
-    //mark this facet
-    this->mesh[id].marked = true;
-    //mark all neighbors
-    for(int j = 0; j < 3; j++) {
-        this->mark_neighbor_surfaces(this->mesh[id].neighbor[j]);
-    }
+    std::vector<std::vector<int>> facets(num_components);
+    for (size_t facet_idx = 0; facet_idx < this->facets_count(); ++ facet_idx)
+        facets[component[facet_idx]].emplace_back(int(facet_idx));
+
+    // The components are returned starting with the one seeded last.
+    NonplanarSurfaces nonplanar_surfaces;
+    nonplanar_surfaces.reserve(num_components);
+    for (int i = num_components - 1; i >= 0; -- i)
+        nonplanar_surfaces.emplace_back(this->its, this->normals, this->neighbors, facets[i]);
+    return nonplanar_surfaces;
 }
 
 bool
@@ -201,8 +228,12 @@ NonplanarSurface::check_surface_area()
 {
     //calculate surface area of nonplanar surface.
     float area = 0.0f;
-    for(auto& facet : this->mesh) {
-        area += facet.second.calculate_surface_area();
+    for (size_t facet_idx = 0; facet_idx < this->facets_count(); ++ facet_idx) {
+        its_triangle vertex = its_triangle_vertices(this->its, facet_idx);
+        area += Slic3r::Geometry::triangle_surface(
+            Point(vertex[0].x(), vertex[0].y()),
+            Point(vertex[1].x(), vertex[1].y()),
+            Point(vertex[2].x(), vertex[2].y()));
     }
     if (area < 20.0f) {
         BOOST_LOG_TRIVIAL(trace) << "Surface removed: area too small (" << area << " mm²)";
@@ -223,13 +254,14 @@ ExPolygons
 NonplanarSurface::horizontal_projection() const
 {
     Polygons pp;
-    pp.reserve(this->mesh.size());
-    for(auto& facet : this->mesh) {
+    pp.reserve(this->facets_count());
+    for (size_t facet_idx = 0; facet_idx < this->facets_count(); ++ facet_idx) {
+        its_triangle vertex = its_triangle_vertices(this->its, facet_idx);
         Polygon p;
         p.points.resize(3);
-        p.points[0] = Point(scale_(facet.second.vertex[0].x), scale_(facet.second.vertex[0].y));
-        p.points[1] = Point(scale_(facet.second.vertex[1].x), scale_(facet.second.vertex[1].y));
-        p.points[2] = Point(scale_(facet.second.vertex[2].x), scale_(facet.second.vertex[2].y));
+        p.points[0] = Point(scale_(vertex[0].x()), scale_(vertex[0].y()));
+        p.points[1] = Point(scale_(vertex[1].x()), scale_(vertex[1].y()));
+        p.points[2] = Point(scale_(vertex[2].x()), scale_(vertex[2].y()));
         p.make_counter_clockwise();  // do this after scaling, as winding order might change while doing that
         pp.push_back(p);
     }
@@ -238,4 +270,56 @@ NonplanarSurface::horizontal_projection() const
     return union_ex(offset(pp, scale_(0.01)));
 }
 
-}
\ No newline at end of file
+void
+NonplanarSurface::build_aabb_tree()
+{
+    using TreeType    = AABBTreeIndirect::Tree<2, double>;
+    using VectorType  = TreeType::VectorType;
+    using BoundingBox = TreeType::BoundingBox;
+
+    struct InputType {
+        size_t             idx()      const { return m_idx; }
+        const BoundingBox& bbox()     const { return m_bbox; }
+        const VectorType&  centroid() const { return m_centroid; }
+
+        size_t      m_idx;
+        BoundingBox m_bbox;
+        VectorType  m_centroid;
+    };
+
+    // Epsilon applied to the facet bounding boxes to cope with numeric inaccuracies of the
+    // line intersection, the exact tests are performed by the caller.
+    const VectorType veps(EPSILON, EPSILON);
+
+    std::vector<InputType> input;
+    input.reserve(this->facets_count());
+    for (size_t facet_idx = 0; facet_idx < this->facets_count(); ++ facet_idx) {
+        its_triangle vertex = its_triangle_vertices(this->its, facet_idx);
+        InputType n;
+        n.m_idx      = facet_idx;
+        n.m_bbox     = BoundingBox(vertex[0].head<2>().cast<double>(), vertex[0].head<2>().cast<double>());
+        n.m_bbox.extend(vertex[1].head<2>().cast<double>());
+        n.m_bbox.extend(vertex[2].head<2>().cast<double>());
+        n.m_centroid = n.m_bbox.center();
+        n.m_bbox.min() -= veps;
+        n.m_bbox.max() += veps;
+        input.emplace_back(n);
+    }
+    this->tree.build(std::move(input));
+}
+
+void
+NonplanarSurface::facets_in_bbox(const BoundingBoxf &bbox, std::vector<size_t> &out) const
+{
+    out.clear();
+    AABBTreeIndirect::traverse(this->tree,
+        AABBTreeIndirect::intersecting(Eigen::AlignedBox<double, 2>(bbox.min, bbox.max)),
+        [&out](const AABBTreeIndirect::Tree<2, double>::Node &node) {
+            out.emplace_back(node.idx);
+            return true;
+        });
+    // Keep the order of the facets, so that the results do not depend on the shape of the tree.
+    std::sort(out.begin(), out.end());
+}
+
+}
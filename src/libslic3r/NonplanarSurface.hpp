@@ -2,12 +2,15 @@
 #define slic3r_NonplanarSurface_hpp_
 
 #include "libslic3r.h"
-#include "NonplanarFacet.hpp"
 #include "Point.hpp"
 #include "Polygon.hpp"
 #include "ExPolygon.hpp"
 #include "Geometry.hpp"
 #include "ClipperUtils.hpp"
+#include "BoundingBox.hpp"
+#include "AABBTreeIndirect.hpp"
+
+#include <admesh/stl.h>
 
 namespace Slic3r {
 
@@ -29,24 +32,38 @@ typedef std::vector<NonplanarSurface> NonplanarSurfaces;
 class NonplanarSurface
 {
     public:
-    std::map<int, NonplanarFacet> mesh;
+    // Facets of the surface with shared vertices, in the order of the source mesh.
+    indexed_triangle_set its;
+    // Per facet unit normal.
+    std::vector<Vec3f> normals;
+    // Per facet neighbors, indices into its.indices, -1 if the neighbor is not part of this surface.
+    std::vector<Vec3i> neighbors;
     mesh_stats stats;
+    // 2D AABB tree over the horizontal projection of the facets, built by build_aabb_tree().
+    // Tree nodes index into its.indices.
+    AABBTreeIndirect::Tree<2, double> tree;
     NonplanarSurface() {};
     ~NonplanarSurface() {};
-    NonplanarSurface(std::map<int, NonplanarFacet> &_mesh);
+    // Create a surface from a subset of facets of a source mesh. source_normals and source_neighbors
+    // are indexed by the facets of source, facets lists the facets to copy in ascending order.
+    NonplanarSurface(const indexed_triangle_set &source, const std::vector<Vec3f> &source_normals,
+                     const std::vector<Vec3i> &source_neighbors, const std::vector<int> &facets);
     bool operator==(const NonplanarSurface& other) const;
+    size_t facets_count() const { return this->its.indices.size(); }
     void calculate_stats();
     void translate(float x, float y, float z);
     void scale(float factor);
     void scale(float versor[3]);
     void rotate_z(float angle);
     void debug_output();
-    NonplanarSurfaces group_surfaces();
-    void mark_neighbor_surfaces(int id);
+    NonplanarSurfaces group_surfaces() const;
     bool check_max_printing_height(float height);
     void check_printable_surfaces(float max_angle);
     bool check_surface_area();
     ExPolygons horizontal_projection() const;
+    void build_aabb_tree();
+    // Collect the indices of facets whose projected bounding box overlaps bbox (unscaled), in ascending order.
+    void facets_in_bbox(const BoundingBoxf &bbox, std::vector<size_t> &out) const;
 
 };
 };
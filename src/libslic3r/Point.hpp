@@ -159,8 +159,6 @@ class Point : public Vec2crd
 public:
     using coord_type = coord_t;
 
-    coord_t nonplanar_z { -1 };
-
     Point() : Vec2crd(0, 0) {}
     Point(int32_t x, int32_t y) : Vec2crd(coord_t(x), coord_t(y)) {}
     Point(int64_t x, int64_t y) : Vec2crd(coord_t(x), coord_t(y)) {}
@@ -51,9 +51,7 @@ void Polyline::clip_end(double distance)
         Vec2d  v    = this->last_point().cast<double>() - last_point;
         double lsqr = v.squaredNorm();
         if (lsqr > distance * distance) {
-            Point p((last_point + v * (distance / sqrt(lsqr))).cast<coord_t>());
-            p.nonplanar_z = this->last_point().nonplanar_z;
-            this->points.emplace_back(p);
+            this->points.emplace_back((last_point + v * (distance / sqrt(lsqr))).cast<coord_t>());
             return;
         }
         distance -= sqrt(lsqr);
@@ -104,9 +102,7 @@ Points Polyline::equally_spaced_points(double distance) const
             continue;
         }
         double take = segment_length - (len - distance);  // how much we take of this segment
-        Point p((p1 + v * (take / v.norm())).cast<coord_t>());
-        p.nonplanar_z = (*it).nonplanar_z;
-        points.emplace_back(p);
+        points.emplace_back((p1 + v * (take / v.norm())).cast<coord_t>());
         -- it;
         len = - take;
     }
@@ -251,7 +247,6 @@ std::pair<int, Point> foot_pt(const Points &polyline, const Point &pt)
         if (double d2 = line_alg::distance_to_squared(Line(prev, *it), pt, &foot_pt); d2 < d2_min) {
             d2_min      = d2;
             foot_pt_min = foot_pt;
-            foot_pt_min.nonplanar_z = (*it).nonplanar_z;
             it_proj     = it;
         }
         prev = *it;
@@ -277,7 +272,6 @@ void ThickPolyline::clip_end(double distance)
         assert(this->width.size() == (this->points.size() - 1) * 2);
         while (distance > 0) {
             Vec2d last_point = this->last_point().cast<double>();
-            coord_t last_z = this->last_point().nonplanar_z;
             this->points.pop_back();
             if (this->points.empty()) {
                 assert(this->width.empty());
@@ -291,9 +285,7 @@ void ThickPolyline::clip_end(double distance)
             double   vec_length_sqr = vec.squaredNorm();
             if (vec_length_sqr > distance * distance) {
                 double t = (distance / std::sqrt(vec_length_sqr));
-                Point p((last_point + vec * t).cast<coord_t>());
-                p.nonplanar_z = last_z;
-                this->points.emplace_back(p);
+                this->points.emplace_back((last_point + vec * t).cast<coord_t>());
                 this->width.emplace_back(last_width + width_diff * t);
                 assert(this->width.size() == (this->points.size() - 1) * 2);
                 return;
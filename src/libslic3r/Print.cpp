@@ -9,6 +9,7 @@
 #include "I18N.hpp"
 #include "ShortestPath.hpp"
 #include "Thread.hpp"
+#include "Trace.hpp"
 #include "GCode.hpp"
 #include "GCode/WipeTower.hpp"
 #include "GCode/ConflictChecker.hpp"
@@ -19,14 +20,22 @@
 #include <float.h>
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_set>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/regex.hpp>
 
+#include <tbb/flow_graph.h>
+#include <tbb/task_arena.h>
+
 namespace Slic3r {
 
 template class PrintState<PrintStep, psCount>;
@@ -64,6 +73,7 @@ bool Print::invalidate_state_by_config_options(const ConfigOptionResolver & /* n
         "bed_temperature",
         "before_layer_gcode",
         "between_objects_gcode",
+        "binary_gcode",
         "bridge_acceleration",
         "bridge_fan_speed",
         "enable_dynamic_fan_speeds",
@@ -100,6 +110,7 @@ bool Print::invalidate_state_by_config_options(const ConfigOptionResolver & /* n
         "first_layer_bed_temperature",
         "first_layer_speed_over_raft",
         "gcode_comments",
+        "gcode_export_memory_limit",
         "gcode_label_objects",
         "infill_acceleration",
         "layer_gcode",
@@ -894,27 +905,120 @@ void Print::auto_assign_extruders(ModelObject* model_object) const
     }
 }
 
+// Runs the PrintObject steps (slicing, perimeters, infill, ironing, support spots, support material, curled extrusions)
+// as a TBB flow graph. The steps of a single object depend on each other, however the objects are independent,
+// thus a plate of many small objects is not throttled by a barrier after each step, where each object alone
+// is too small to saturate the cores with its parallel loops over layers.
+// PrintObjects sharing PrintObjectRegions (instances of the same ModelObject, which differ in their transformation)
+// share the support points generated by generate_support_spots(), thus they are chained into a single sequence.
+// The alert about missing supports needs the support points of all objects, it runs concurrently with the support generation.
+// An exception thrown by any step (including CanceledException) stops scheduling further steps and it is rethrown at the end.
+void Print::process_objects()
+{
+    using continue_node = tbb::flow::continue_node<tbb::flow::continue_msg>;
+
+    // Group objects sharing PrintObjectRegions, keeping the order of m_objects.
+    std::vector<std::vector<PrintObject*>> chains;
+    {
+        std::vector<std::pair<const PrintObjectRegions*, size_t>> chain_of_regions;
+        for (PrintObject *obj : m_objects) {
+            auto it = std::find_if(chain_of_regions.begin(), chain_of_regions.end(),
+                [obj](const std::pair<const PrintObjectRegions*, size_t> &l) { return l.first == obj->shared_regions(); });
+            if (it == chain_of_regions.end()) {
+                chain_of_regions.emplace_back(obj->shared_regions(), chains.size());
+                chains.emplace_back();
+                chains.back().emplace_back(obj);
+            } else
+                chains[it->second].emplace_back(obj);
+        }
+    }
+
+    if (chains.size() < 2 || tbb::this_task_arena::max_concurrency() < 2) {
+        // Nothing to run concurrently, spare the graph.
+        for (PrintObject *obj : m_objects)
+            obj->make_perimeters();
+        for (PrintObject *obj : m_objects)
+            obj->infill();
+        for (PrintObject *obj : m_objects)
+            obj->ironing();
+        for (PrintObject *obj : m_objects)
+            obj->generate_support_spots();
+        // check data from previous step, format the error message(s) and send alert to ui
+        alert_when_supports_needed();
+        for (PrintObject *obj : m_objects)
+            obj->generate_support_material();
+        for (PrintObject *obj : m_objects)
+            obj->estimate_curled_extrusions();
+        return;
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Processing " << m_objects.size() << " objects in " << chains.size() << " independent chains - start";
+    // Exceptions are not let to propagate through the graph: TBB would cancel the task group context of the graph,
+    // which would silently cut short the parallel loops of the steps running in the other chains, and these steps
+    // would then be marked as done. Instead the first exception is stored, the steps not yet started are skipped
+    // and the exception is rethrown once the running steps finish.
+    // A step is isolated: While waiting for its own parallel loops, the thread may only take their tasks, not a whole step
+    // of another chain, which would nest the long running steps on the stack of a single thread.
+    std::exception_ptr error;
+    std::mutex         error_mutex;
+    std::atomic<bool>  failed { false };
+    auto               guarded = [&error, &error_mutex, &failed](auto &&fn) {
+        if (failed)
+            return;
+        try {
+            tbb::this_task_arena::isolate(fn);
+        } catch (...) {
+            std::scoped_lock<std::mutex> lock(error_mutex);
+            if (! error)
+                error = std::current_exception();
+            failed = true;
+        }
+    };
+
+    tbb::flow::graph graph;
+    // check data from the support spots search of all objects, format the error message(s) and send alert to ui
+    continue_node alert(graph, [this, &guarded](const tbb::flow::continue_msg&) { guarded([this]{ this->alert_when_supports_needed(); }); });
+    std::vector<std::unique_ptr<continue_node>> nodes;
+    std::vector<continue_node*> roots;
+    for (const std::vector<PrintObject*> &chain : chains) {
+        auto add_step = [&graph, &nodes, &guarded, &chain](continue_node *predecessor, void (PrintObject::*step)()) {
+            nodes.emplace_back(std::make_unique<continue_node>(graph, [&guarded, &chain, step](const tbb::flow::continue_msg&) {
+                guarded([&chain, step]{
+                    for (PrintObject *obj : chain)
+                        (obj->*step)();
+                });
+            }));
+            if (predecessor)
+                tbb::flow::make_edge(*predecessor, *nodes.back());
+            return nodes.back().get();
+        };
+        // make_perimeters() slices the object first.
+        continue_node *node = add_step(nullptr, &PrintObject::make_perimeters);
+        roots.emplace_back(node);
+        node = add_step(node, &PrintObject::infill);
+        node = add_step(node, &PrintObject::ironing);
+        node = add_step(node, &PrintObject::generate_support_spots);
+        tbb::flow::make_edge(*node, alert);
+        node = add_step(node, &PrintObject::generate_support_material);
+        add_step(node, &PrintObject::estimate_curled_extrusions);
+    }
+    for (continue_node *root : roots)
+        root->try_put(tbb::flow::continue_msg());
+    graph.wait_for_all();
+    if (error)
+        std::rethrow_exception(error);
+    BOOST_LOG_TRIVIAL(debug) << "Processing " << m_objects.size() << " objects in " << chains.size() << " independent chains - end";
+}
+
 // Slicing process, running at a background thread.
 void Print::process()
 {
     name_tbb_thread_pool_threads_set_locale();
 
     BOOST_LOG_TRIVIAL(info) << "Starting the slicing process." << log_memory_info();
-    for (PrintObject *obj : m_objects)
-        obj->make_perimeters();
-    for (PrintObject *obj : m_objects)
-        obj->infill();
-    for (PrintObject *obj : m_objects)
-        obj->ironing();
-    for (PrintObject *obj : m_objects)
-        obj->generate_support_spots();
-    // check data from previous step, format the error message(s) and send alert to ui
-    alert_when_supports_needed();
-    for (PrintObject *obj : m_objects)
-        obj->generate_support_material();
-    for (PrintObject *obj : m_objects)
-        obj->estimate_curled_extrusions();
+    this->process_objects();
     if (this->set_started(psWipeTower)) {
+        SLIC3R_TRACE_SCOPE("Print", "wipe_tower");
         m_wipe_tower_data.clear();
         m_tool_ordering.clear();
         if (this->has_wipe_tower()) {
@@ -929,6 +1033,7 @@ void Print::process()
         this->set_done(psWipeTower);
     }
     if (this->set_started(psSkirtBrim)) {
+        SLIC3R_TRACE_SCOPE("Print", "skirt_brim");
         this->set_status(88, _u8L("Generating skirt and brim"));
 
         m_skirt.clear();
@@ -968,7 +1073,10 @@ void Print::process()
         m_fake_wipe_tower.set_pos_and_rotation({ m_config.wipe_tower_x, m_config.wipe_tower_y }, m_config.wipe_tower_rotation_angle);
         wipe_tower_opt = std::make_optional<const FakeWipeTower*>(&m_fake_wipe_tower);
     }
-    auto conflictRes = ConflictChecker::find_inter_of_lines_in_diff_objs(m_objects, wipe_tower_opt);
+    auto conflictRes = [this, &wipe_tower_opt]() {
+        SLIC3R_TRACE_SCOPE("Print", "conflict_checker");
+        return ConflictChecker::find_inter_of_lines_in_diff_objs(m_objects, wipe_tower_opt);
+    }();
 
     m_conflict_result = conflictRes;
     if (conflictRes.has_value())
@@ -1541,8 +1649,13 @@ std::string Print::output_filename(const std::string &filename_base) const
     // These values will be just propagated into the output file name.
     DynamicConfig config = this->finished() ? this->print_statistics().config() : this->print_statistics().placeholders();
     config.set_key_value("num_extruders", new ConfigOptionInt((int)m_config.nozzle_diameter.size()));
-    config.set_key_value("default_output_extension", new ConfigOptionString(".gcode"));
-    return this->PrintBase::output_filename(m_config.output_filename_format.value, ".gcode", filename_base, &config);
+    const std::string extension = m_config.binary_gcode ? ".sbgc" : ".gcode";
+    config.set_key_value("default_output_extension", new ConfigOptionString(extension));
+    std::string filename = this->PrintBase::output_filename(m_config.output_filename_format.value, extension, filename_base, &config);
+    // The output filename format usually contains the ".gcode" extension verbatim.
+    if (m_config.binary_gcode && boost::iends_with(filename, ".gcode"))
+        filename.replace(filename.size() - 6, 6, extension);
+    return filename;
 }
 
 DynamicConfig PrintStatistics::config() const
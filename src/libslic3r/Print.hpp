@@ -18,7 +18,6 @@
 #include "GCode/GCodeProcessor.hpp"
 #include "MultiMaterialSegmentation.hpp"
 #include "NonplanarSurface.hpp"
-#include "NonplanarFacet.hpp"
 
 #include "libslic3r.h"
 
@@ -68,7 +67,7 @@ enum PrintStep : unsigned int {
 };
 
 enum PrintObjectStep : unsigned int {
-    posSlice, posPerimeters, posPrepareInfill,
+    posSlice, posNonplanarDetect, posPerimeters, posPrepareInfill,
     posInfill, posIroning, posSupportSpotsSearch, 
     posSupportMaterial, posNonplanarProjection, posEstimateCurledExtrusions, 
     posCount,
@@ -269,7 +268,7 @@ public:
     // Centering offset of the sliced mesh from the scaled and rotated mesh of the model.
     const Point& 			     center_offset() const  { return m_center_offset; }
     // 
-    NonplanarSurfaces            nonplanar_surfaces()   { return m_nonplanar_surfaces; }
+    const NonplanarSurfaces&     nonplanar_surfaces() const { return m_nonplanar_surfaces; }
 
     bool                         has_brim() const       {
         return this->config().brim_type != btNoBrim
@@ -394,6 +393,8 @@ private:
     void project_nonplanar_surfaces();
     void find_nonplanar_surfaces();
     void detect_nonplanar_surfaces();
+    void assign_nonplanar_surfaces();
+    void restore_planar_slices();
     void process_external_surfaces();
     void discover_vertical_shells();
     void bridge_over_infill();
@@ -427,6 +428,9 @@ private:
     // this is set to true when LayerRegion->slices is split in top/internal/bottom
     // so that next call to make_perimeters() performs a union() before computing loops
     bool                    				m_typed_slices = false;
+    // this is set to true when the slices of nonplanar surfaces were moved to their home layers
+    // and the planar slices were backed up, so that detect_nonplanar_surfaces() may run again without reslicing
+    bool                                    m_planar_slices_backed_up = false;
 
     NonplanarSurfaces                       m_nonplanar_surfaces;
 
@@ -672,6 +676,8 @@ private:
     void                _make_skirt();
     void                _make_wipe_tower();
     void                finalize_first_layer_convex_hull();
+    // Run the PrintObject steps of all objects, independent objects concurrently.
+    void                process_objects();
     void                alert_when_supports_needed();
 
     // Islands of objects and their supports extruded at the 1st layer.
@@ -118,6 +118,11 @@ std::function<void()> PrintObjectBase::cancel_callback(PrintBase *print)
 	return print->cancel_callback();
 }
 
+void PrintObjectBase::step_event(PrintBase *print, const PrintObjectBase *print_object, int step, bool finished)
+{
+    print->step_event(print_object, step, finished);
+}
+
 void PrintObjectBase::status_update_warnings(PrintBase *print, int step, PrintStateBase::WarningLevel warning_level, const std::string &message)
 {
     print->status_update_warnings(step, warning_level, message, this);
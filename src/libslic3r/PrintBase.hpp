@@ -368,6 +368,7 @@ protected:
     // Declared here to allow access from PrintBase through friendship.
 	static std::mutex&                  state_mutex(PrintBase *print);
 	static std::function<void()>        cancel_callback(PrintBase *print);
+	static void                         step_event(PrintBase *print, const PrintObjectBase *print_object, int step, bool finished);
 	// Notify UI about a new warning of a milestone "step" on this PrintObjectBase.
 	// The UI will be notified by calling a status callback registered on print.
 	// If no status callback is registered, the message is printed to console.
@@ -494,6 +495,16 @@ public:
         else printf("%d => %s\n", percent, message.c_str());
     }
 
+    // Called at the worker thread when a Print step (print_object == nullptr) or a PrintObject step is being started
+    // (finished == false) and when it is finished (finished == true). Steps that are up to date are not reported.
+    // Steps of independent PrintObjects may be processed in parallel, thus the callback may be called concurrently
+    // from multiple worker threads and it has to be thread safe. The start and finish of a single step of a single
+    // PrintObject (or of the Print) are reported in sequence. A step is reported as finished only after it was marked as done,
+    // thus a canceled step is reported as started, but not as finished.
+    // Used for benchmarking and profiling.
+    typedef std::function<void(const PrintObjectBase *print_object, int step, bool finished)> step_callback_type;
+    void                    set_step_callback(step_callback_type cb) { m_step_callback = cb; }
+
     typedef std::function<void()>  cancel_callback_type;
     // Various methods will call this callback to stop the background processing (the Print::process() call)
     // in case a successive change of the Print / PrintObject / PrintRegion instances changed
@@ -534,6 +545,8 @@ protected:
     std::mutex&            state_mutex() const { return m_state_mutex; }
     std::function<void()>  cancel_callback() { return m_cancel_callback; }
 	void				   call_cancel_callback() { m_cancel_callback(); }
+    void                   step_event(const PrintObjectBase *print_object, int step, bool finished) const
+        { if (m_step_callback) m_step_callback(print_object, step, finished); }
 	// Notify UI about a new warning of a milestone "step" on this PrintBase.
 	// The UI will be notified by calling a status callback.
 	// If no status callback is registered, the message is printed to console.
@@ -556,6 +569,8 @@ protected:
 
     // Callback to be evoked regularly to update state of the UI thread.
     status_callback_type                    m_status_callback;
+    // Callback to be evoked when a step is started or finished.
+    step_callback_type                      m_step_callback;
 
 private:
     std::atomic<CancelStatus>               m_cancel_status;
@@ -585,9 +600,16 @@ public:
     PrintStateBase::StateWithWarnings  step_state_with_warnings(PrintStepEnum step) const { return m_state.state_with_warnings(step, this->state_mutex()); }
 
 protected:
-    bool            set_started(PrintStepEnum step) { return m_state.set_started(step, this->state_mutex(), [this](){ this->throw_if_canceled(); }); }
+    bool            set_started(PrintStepEnum step) {
+        bool started = m_state.set_started(step, this->state_mutex(), [this](){ this->throw_if_canceled(); });
+        if (started)
+            this->step_event(nullptr, static_cast<int>(step), false);
+        return started;
+    }
 	PrintStateBase::TimeStamp set_done(PrintStepEnum step) { 
 		std::pair<PrintStateBase::TimeStamp, bool> status = m_state.set_done(step, this->state_mutex(), [this](){ this->throw_if_canceled(); });
+        // Only a step marked as done is reported as finished, set_done() throws CanceledException on cancellation.
+        this->step_event(nullptr, static_cast<int>(step), true);
         if (status.second)
             this->status_update_warnings(static_cast<int>(step), PrintStateBase::WarningLevel::NON_CRITICAL, std::string());
         return status.first;
@@ -758,10 +780,15 @@ public:
 protected:
 	PrintObjectBaseWithState(PrintType *print, ModelObject *model_object) : PrintObjectBase(model_object), m_print(print) {}
 
-    bool            set_started(PrintObjectStepEnum step) 
-        { return m_state.set_started(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); }); }
+    bool            set_started(PrintObjectStepEnum step) {
+        bool started = m_state.set_started(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); });
+        if (started)
+            PrintObjectBase::step_event(m_print, this, static_cast<int>(step), false);
+        return started;
+    }
 	PrintStateBase::TimeStamp set_done(PrintObjectStepEnum step) { 
 		std::pair<PrintStateBase::TimeStamp, bool> status = m_state.set_done(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); });
+        PrintObjectBase::step_event(m_print, this, static_cast<int>(step), true);
         if (status.second)
             this->status_update_warnings(m_print, static_cast<int>(step), PrintStateBase::WarningLevel::NON_CRITICAL, std::string());
         return status.first;
@@ -458,6 +458,15 @@ void PrintConfigDef::init_fff_params()
     def->mode = comExpert;
     def->set_default_value(new ConfigOptionString(""));
 
+    def = this->add("binary_gcode", coBool);
+    def->label = L("Binary G-code");
+    def->tooltip = L("Export the G-code in a compact binary format (.sbgc) instead of text. The G-code is stored compressed, "
+                     "thumbnails and print metadata are stored in separate blocks. The file may be converted back to text losslessly. "
+                     "This is not the binary G-code format (.bgcode) of the Prusa printers, thus the G-code sent to a print host "
+                     "is uploaded as text.");
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionBool(false));
+
     def = this->add("bottom_solid_layers", coInt);
     //TRN Print Settings: "Bottom solid layers"
     def->label = L_CONTEXT("Bottom", "Layers");
@@ -1421,6 +1430,16 @@ void PrintConfigDef::init_fff_params()
     def->mode = comExpert;
     def->set_default_value(new ConfigOptionBool(0));
 
+    def = this->add("gcode_export_memory_limit", coInt);
+    def->label = L("G-code export memory limit");
+    def->tooltip = L("Limits the memory used by the G-code of the layers being processed in parallel during G-code export. "
+                   "Lower values reduce the peak memory consumption of large prints at the cost of export speed. "
+                   "Set zero to disable the limit.");
+    def->sidetext = L("MB");
+    def->min = 0;
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionInt(0));
+
     def = this->add("gcode_flavor", coEnum);
     def->label = L("G-code flavor");
     def->tooltip = L("Some G/M-code commands, including temperature control and others, are not universal. "
@@ -2626,6 +2645,17 @@ void PrintConfigDef::init_fff_params()
     def->mode = comAdvanced;
     def->set_default_value(new ConfigOptionEnum<SlicingMode>(SlicingMode::Regular));
 
+    def = this->add("slicing_cache_min_facets", coInt);
+    def->label = L("Out of core slicing threshold");
+    def->category = L("Advanced");
+    def->tooltip = L("Meshes with at least this number of facets are sliced out of core: the mesh is written into a temporary file "
+                     "with its facets sorted by height, which is then sliced in bands of layers, so that just the slicing data of a single band "
+                     "is kept in memory. Lowers the peak memory consumption of slicing huge meshes at the cost of slicing time, "
+                     "the slices are the same. Set zero to disable.");
+    def->min = 0;
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionInt(0));
+
     def = this->add("support_material", coBool);
     def->label = L("Generate support material");
     def->category = L("Support material");
@@ -2992,6 +3022,20 @@ void PrintConfigDef::init_fff_params()
     def->mode = comAdvanced;
     def->set_default_value(new ConfigOptionFloat(1.));
 
+    def = this->add("support_tree_cache_memory_limit", coInt);
+    def->label = L("Cache memory limit");
+    def->category = L("Support material");
+    // TRN PrintSettings: "Organic supports" > "Cache memory limit"
+    def->tooltip = L("Limits the memory used by the avoidance areas cached while the branches are routed from the top layers down. "
+                     "If the areas of an object are estimated to exceed the limit, they are kept just for every 16th layer, the layers in between "
+                     "are recalculated in windows of 16 layers as the routing proceeds, and the windows already routed are released "
+                     "whenever the cached areas exceed the limit, trading calculation time for memory. "
+                     "Set zero to disable the limit.");
+    def->sidetext = L("MB");
+    def->min = 0;
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionInt(0));
+
     def = this->add("support_tree_top_rate", coPercent);
     def->label = L("Branch Density");
     def->category = L("Support material");
@@ -4731,6 +4775,12 @@ CLIActionsConfigDef::CLIActionsConfigDef()
     def->cli = "export-gcode|gcode|g";
     def->set_default_value(new ConfigOptionBool(false));
 
+    def = this->add("convert_gcode", coBool);
+    def->label = L("Convert G-code");
+    def->tooltip = L("Convert the G-code files given on the command line between the text and the binary format. "
+                     "The converted file is written next to the source file with the .gcode or .sbgc extension.");
+    def->set_default_value(new ConfigOptionBool(false));
+
     def = this->add("gcodeviewer", coBool);
     def->label = L("G-code viewer");
     def->tooltip = L("Visualize an already sliced and saved G-code");
@@ -4927,6 +4977,11 @@ CLIMiscConfigDef::CLIMiscConfigDef()
                      "For example. loglevel=2 logs fatal, error and warning level messages.");
     def->min = 0;
 
+    def = this->add("trace", coString);
+    def->label = L("Trace file");
+    def->tooltip = L("Record the run time of the slicing steps on each thread and save it to the given file in the Chrome trace format. "
+                     "The file may be opened by chrome://tracing or https://ui.perfetto.dev.");
+
 #if (defined(_MSC_VER) || defined(__MINGW32__)) && defined(SLIC3R_GUI)
     def = this->add("sw_renderer", coBool);
     def->label = L("Render with a software renderer");
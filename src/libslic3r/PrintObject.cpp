@@ -23,6 +23,7 @@
 #include "Slicing.hpp"
 #include "SurfaceCollection.hpp"
 #include "Tesselate.hpp"
+#include "Trace.hpp"
 #include "TriangleMeshSlicer.hpp"
 #include "Utils.hpp"
 #include "Fill/FillAdaptive.hpp"
@@ -163,25 +164,19 @@ std::vector<std::reference_wrapper<const PrintRegion>> PrintObject::all_regions(
 void PrintObject::make_perimeters()
 {
     // prerequisites
-    this->slice();
+    this->detect_nonplanar_surfaces();
 
     if (! this->set_started(posPerimeters))
         return;
+    SLIC3R_TRACE_SCOPE("PrintObject", "make_perimeters");
 
     m_print->set_status(20, _u8L("Generating perimeters"));
     BOOST_LOG_TRIVIAL(info) << "Generating perimeters..." << log_memory_info();
     
-    // Revert the typed slices into untyped slices.
-    if (m_typed_slices) {
-        for (Layer *layer : m_layers) {
-            layer->clear_fills();
-            layer->restore_untyped_slices();
-            m_print->throw_if_canceled();
-        }
-        m_typed_slices = false;
-    }
+    // Revert the typed slices into untyped slices, move the nonplanar slices back to their layers.
+    this->restore_planar_slices();
 
-    this->detect_nonplanar_surfaces();
+    this->assign_nonplanar_surfaces();
     
     // compare each layer to the one below, and mark those slices needing
     // one additional inner perimeter, like the top of domed objects-
@@ -276,6 +271,7 @@ void PrintObject::prepare_infill()
 {
     if (! this->set_started(posPrepareInfill))
         return;
+    SLIC3R_TRACE_SCOPE("PrintObject", "prepare_infill");
 
     m_print->set_status(30, _u8L("Preparing infill"));
 
@@ -423,6 +419,7 @@ void PrintObject::infill()
     this->prepare_infill();
 
     if (this->set_started(posInfill)) {
+        SLIC3R_TRACE_SCOPE("PrintObject", "infill");
         // TRN Status for the Print calculation 
         m_print->set_status(45, _u8L("Making infill"));
         const auto& adaptive_fill_octree = this->m_adaptive_fill_octrees.first;
@@ -454,6 +451,7 @@ void PrintObject::infill()
 void PrintObject::ironing()
 {
     if (this->set_started(posIroning)) {
+        SLIC3R_TRACE_SCOPE("PrintObject", "ironing");
         BOOST_LOG_TRIVIAL(debug) << "Ironing in parallel - start";
         tbb::parallel_for(
             // Ironing starting with layer 0 to support ironing all surfaces.
@@ -475,6 +473,7 @@ void PrintObject::ironing()
 void PrintObject::generate_support_spots()
 {
     if (this->set_started(posSupportSpotsSearch)) {
+        SLIC3R_TRACE_SCOPE("PrintObject", "generate_support_spots");
         BOOST_LOG_TRIVIAL(debug) << "Searching support spots - start";
         m_print->set_status(65, _u8L("Searching support spots"));
         if (!this->shared_regions()->generated_support_points.has_value()) {
@@ -499,6 +498,7 @@ void PrintObject::generate_support_spots()
 void PrintObject::generate_support_material()
 {
     if (this->set_started(posSupportMaterial)) {
+        SLIC3R_TRACE_SCOPE("PrintObject", "generate_support_material");
         this->clear_support_layers();
         if ((this->has_support() && m_layers.size() > 1) || (this->has_raft() && ! m_layers.empty())) {
             m_print->set_status(70, _u8L("Generating support material"));    
@@ -520,6 +520,7 @@ void PrintObject::generate_support_material()
 void PrintObject::estimate_curled_extrusions()
 {
     if (this->set_started(posEstimateCurledExtrusions)) {
+        SLIC3R_TRACE_SCOPE("PrintObject", "estimate_curled_extrusions");
         if (this->print()->config().avoid_crossing_curled_overhangs ||
             std::any_of(this->print()->m_print_regions.begin(), this->print()->m_print_regions.end(),
                         [](const PrintRegion *region) { return region->config().enable_dynamic_overhang_speeds.getBool(); })) {
@@ -594,7 +595,10 @@ FillLightning::GeneratorPtr PrintObject::prepare_lightning_infill_data()
     if (has_lightning_infill)
         lightning_density /= coordf_t(lightning_cnt);
 
-    return has_lightning_infill ? FillLightning::build_generator(std::as_const(*this), lightning_density, [this]() -> void { this->throw_if_canceled(); }) : FillLightning::GeneratorPtr();
+    // The generator of the previous run is passed in to reuse the trees of the top layers, whose infill areas did not change.
+    return has_lightning_infill ? FillLightning::build_generator(std::as_const(*this), lightning_density, [this]() -> void { this->throw_if_canceled(); },
+                                                                 m_lightning_generator.get()) :
+                                  FillLightning::GeneratorPtr();
 }
 
 void PrintObject::clear_layers()
@@ -804,9 +808,7 @@ bool PrintObject::invalidate_state_by_config_options(
                opt_key == "use_nonplanar_layers"
             || opt_key == "nonplanar_layers_angle"
             || opt_key == "nonplanar_layers_height") {
-            // steps.emplace_back(posPerimeters);
-            // steps.emplace_back(posInfill);
-            steps.emplace_back(posSlice);
+            steps.emplace_back(posNonplanarDetect);
         } else if (
             opt_key == "perimeter_generator"
             || opt_key == "wall_transition_length"
@@ -835,6 +837,11 @@ bool PrintObject::invalidate_state_by_config_options(
             || opt_key == "solid_infill_speed"
             || opt_key == "top_solid_infill_speed") {
             invalidated |= m_print->invalidate_step(psGCodeExport);
+        } else if (opt_key == "slicing_cache_min_facets") {
+            // Only trades the slicing time for memory, the slices are the same.
+        } else if (opt_key == "support_tree_cache_memory_limit") {
+            // Only trades the calculation time of the tree supports for memory, the supports are the same.
+            // The new limit applies once the supports are generated again.
         } else if (
                opt_key == "wipe_into_infill"
             || opt_key == "wipe_into_objects") {
@@ -859,16 +866,21 @@ bool PrintObject::invalidate_step(PrintObjectStep step)
     
     // propagate to dependent steps
     if (step == posPerimeters) {
-		invalidated |= this->invalidate_steps({ posPrepareInfill, posInfill, posIroning,  posSupportSpotsSearch, posEstimateCurledExtrusions });
+		invalidated |= this->invalidate_steps({ posPrepareInfill, posInfill, posIroning,  posSupportSpotsSearch, posNonplanarProjection, posEstimateCurledExtrusions });
         invalidated |= m_print->invalidate_steps({ psSkirtBrim });
     } else if (step == posPrepareInfill) {
-        invalidated |= this->invalidate_steps({ posInfill, posIroning, posSupportSpotsSearch});
+        invalidated |= this->invalidate_steps({ posInfill, posIroning, posSupportSpotsSearch, posNonplanarProjection });
     } else if (step == posInfill) {
-        invalidated |= this->invalidate_steps({ posIroning, posSupportSpotsSearch });
+        invalidated |= this->invalidate_steps({ posIroning, posSupportSpotsSearch, posNonplanarProjection });
+        invalidated |= m_print->invalidate_steps({ psSkirtBrim });
+    } else if (step == posNonplanarDetect) {
+        // Moving the nonplanar slices to their home layers changes the lslices, which the supports are generated from.
+        invalidated |= this->invalidate_steps({ posPerimeters, posPrepareInfill, posInfill, posIroning, posSupportSpotsSearch,
+                                                posSupportMaterial, posNonplanarProjection, posEstimateCurledExtrusions });
         invalidated |= m_print->invalidate_steps({ psSkirtBrim });
     } else if (step == posSlice) {
-        invalidated |= this->invalidate_steps({posPerimeters, posPrepareInfill, posInfill, posIroning, posSupportSpotsSearch,
-                                               posSupportMaterial, posEstimateCurledExtrusions});
+        invalidated |= this->invalidate_steps({posNonplanarDetect, posPerimeters, posPrepareInfill, posInfill, posIroning, posSupportSpotsSearch,
+                                               posSupportMaterial, posNonplanarProjection, posEstimateCurledExtrusions});
         invalidated |= m_print->invalidate_steps({ psSkirtBrim });
         m_slicing_params.valid = false;
     } else if (step == posSupportMaterial) {
@@ -1231,116 +1243,223 @@ PrintObject::check_nonplanar_collisions(NonplanarSurface &surface)
     return false;
 }
 
+// Finds the nonplanar surfaces of the object. Only depends on the slices and on the nonplanar options,
+// thus changing the nonplanar options does not require reslicing.
 void
 PrintObject::detect_nonplanar_surfaces()
+{
+    // prerequisites
+    this->slice();
+
+    if (! this->set_started(posNonplanarDetect))
+        return;
+    SLIC3R_TRACE_SCOPE("PrintObject", "detect_nonplanar_surfaces");
+
+    // The collision check needs the slices as they were sliced.
+    this->restore_planar_slices();
+
+    m_nonplanar_surfaces.clear();
+    this->find_nonplanar_surfaces();
+
+    this->set_done(posNonplanarDetect);
+}
+
+// Reverts the slices into the state produced by slice(): untyped and with the slices of nonplanar surfaces in their own layers.
+void
+PrintObject::restore_planar_slices()
+{
+    // Revert the typed slices into untyped slices.
+    if (m_typed_slices) {
+        for (Layer *layer : m_layers) {
+            layer->clear_fills();
+            layer->restore_untyped_slices();
+            m_print->throw_if_canceled();
+        }
+        m_typed_slices = false;
+    }
+
+    if (m_planar_slices_backed_up) {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, m_layers.size()),
+            [this](const tbb::blocked_range<size_t> &range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    m_layers[layer_idx]->restore_planar_slices();
+                }
+            });
+        m_planar_slices_backed_up = false;
+        this->lslices_were_updated();
+    }
+}
+
+// Moves the top slices of nonplanar surfaces to the layer, from which they will be projected onto the nonplanar surface.
+void
+PrintObject::assign_nonplanar_surfaces()
 {
     //skip if not active
     if(!m_config.use_nonplanar_layers.value) return;
 
+    const NonplanarSurfaces &nonplanar_surfaces = this->nonplanar_surfaces();
+    if (nonplanar_surfaces.empty()) return;
+
+    // Back up the planar slices, so that the nonplanar surfaces may be detected again without reslicing.
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_layers.size()),
+        [this](const tbb::blocked_range<size_t> &range) {
+            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                m_print->throw_if_canceled();
+                m_layers[layer_idx]->backup_planar_slices();
+            }
+        });
+    m_planar_slices_backed_up = true;
+
+    // The horizontal projection of a nonplanar surface is a union of all its facets, calculate it just once.
+    std::vector<ExPolygons> projections(nonplanar_surfaces.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nonplanar_surfaces.size()),
+        [this, &nonplanar_surfaces, &projections](const tbb::blocked_range<size_t> &range) {
+            for (size_t surface_idx = range.begin(); surface_idx < range.end(); ++ surface_idx) {
+                m_print->throw_if_canceled();
+                projections[surface_idx] = nonplanar_surfaces[surface_idx].horizontal_projection();
+            }
+        });
+
     bool moved_surfaces = false;
 
     for (size_t region_id = 0; region_id < this->num_printing_regions(); ++ region_id) {
         m_print->throw_if_canceled();
-        BOOST_LOG_TRIVIAL(trace) << "detect_nonplanar_surfaces for region " << region_id;
+        BOOST_LOG_TRIVIAL(trace) << "assign_nonplanar_surfaces for region " << region_id;
         const PrintRegion &region = this->printing_region(region_id);
 
         //repeat detection for every nonplanar_surface
-        for (auto& nonplanar_surface: this->nonplanar_surfaces()) {
+        for (size_t surface_idx = 0; surface_idx < nonplanar_surfaces.size(); ++ surface_idx) {
+            const NonplanarSurface &nonplanar_surface = nonplanar_surfaces[surface_idx];
+            const ExPolygons       &projection        = projections[surface_idx];
             float distance_to_top = 0.0f;            
             for (int shell_thickness = 0; region.config().top_solid_layers > shell_thickness; ++shell_thickness){
+                const SurfaceType surface_type = shell_thickness == 0 ? stTopNonplanar : stInternalSolidNonplanar;
                 //search home layer where the area is projected to
-                for (LayerPtrs::reverse_iterator home_layer_it = this->m_layers.rbegin(); home_layer_it != this->m_layers.rend(); ++home_layer_it){
-                    Layer* home_layer        = *home_layer_it;
-                    LayerRegion &home_layerm = *home_layer->m_regions[region_id];
-                    //continue if home layer is not maximum height of nonplanar_surface - the desired distance to the top of the surface for more than one top solid layer
-                    if (home_layer->slice_z > nonplanar_surface.stats.max.z - distance_to_top) continue;
-
-                    //process layers
-                    for (LayerPtrs::iterator layer_it = this->m_layers.begin(); layer_it != this->m_layers.end(); ++layer_it){
-                        Layer* layer        = *layer_it;
-                        LayerRegion &layerm = *layer->m_regions[region_id];
-
-                        //skip if below minimum nonplanar surface and below the last possible surface layer
-                        if (nonplanar_surface.stats.min.z-layer->height-distance_to_top > layer->slice_z) continue;
-                        //break if above home layer
-                        if (home_layer->slice_z < layer->slice_z) break;
-                        //skip if bottom layer because we dont want to project the bottom layers up
-                        if (layer->lower_layer == NULL) continue;
-
-                        BOOST_LOG_TRIVIAL(trace) << "detect_nonplanar_surfaces for region " << region_id << " and layer " << layer->print_z;
-
-                        Surfaces layerm_slices_surfaces = layerm.slices().surfaces;
-                        SurfaceCollection topNonplanar;
-                        if (layer->upper_layer != NULL) {
-                            //append layers where nothing is above
-                            Layer* upper_layer = layer->upper_layer;
-                            LayerRegion &upper_layerm = *upper_layer->m_regions[region_id];
-                            Surfaces upper_surfaces = upper_layerm.slices().surfaces;
-                            topNonplanar.append(
-                                intersection_ex(
-                                    nonplanar_surface.horizontal_projection(),
-                                    union_ex(
-                                        diff_ex(
-                                            layerm_slices_surfaces, 
-                                            upper_surfaces, 
-                                            ApplySafetyOffset::No)), 
-                                    ApplySafetyOffset::No),
-                                (shell_thickness == 0 ? stTopNonplanar : stInternalSolidNonplanar),
-                                distance_to_top
-                            );
+                //it is the topmost layer not above the maximum height of nonplanar_surface - the desired distance to the top of the surface for more than one top solid layer
+                auto home_layer_it = std::find_if(m_layers.rbegin(), m_layers.rend(),
+                    [&nonplanar_surface, distance_to_top](const Layer *layer) { return layer->slice_z <= nonplanar_surface.stats.max.z - distance_to_top; });
+                if (home_layer_it == m_layers.rend())
+                    continue;
+                const size_t  home_layer_idx = m_layers.rend() - home_layer_it - 1;
+                Layer        *home_layer     = *home_layer_it;
+                LayerRegion  &home_layerm    = *home_layer->m_regions[region_id];
+
+                //process layers up to the home layer
+                auto layer_end = std::find_if(m_layers.begin(), m_layers.end(),
+                    [home_layer](const Layer *layer) { return home_layer->slice_z < layer->slice_z; });
+                const size_t num_layers = layer_end - m_layers.begin();
+                auto layer_active = [this, &nonplanar_surface, distance_to_top](size_t layer_idx) {
+                    const Layer *layer = m_layers[layer_idx];
+                    //skip if below minimum nonplanar surface and below the last possible surface layer
+                    //skip if bottom layer because we dont want to project the bottom layers up
+                    return nonplanar_surface.stats.min.z - layer->height - distance_to_top <= layer->slice_z && layer->lower_layer != nullptr;
+                };
+                // Collect the part of the projection on a layer, which is not covered by its upper layer.
+                auto top_nonplanar = [this, region_id, &projection, surface_type, distance_to_top](size_t layer_idx) {
+                    const Layer       *layer  = m_layers[layer_idx];
+                    const LayerRegion &layerm = *layer->m_regions[region_id];
+                    BOOST_LOG_TRIVIAL(trace) << "assign_nonplanar_surfaces for region " << region_id << " and layer " << layer->print_z;
+
+                    const Surfaces &layerm_slices_surfaces = layerm.slices().surfaces;
+                    SurfaceCollection topNonplanar;
+                    if (layer->upper_layer != NULL) {
+                        //append layers where nothing is above
+                        const Surfaces &upper_surfaces = layer->upper_layer->m_regions[region_id]->slices().surfaces;
+                        topNonplanar.append(
+                            intersection_ex(
+                                projection,
+                                union_ex(
+                                    diff_ex(
+                                        layerm_slices_surfaces, 
+                                        upper_surfaces, 
+                                        ApplySafetyOffset::No)), 
+                                ApplySafetyOffset::No),
+                            surface_type,
+                            distance_to_top
+                        );
 
-                            // append layers where nonplanar areas with a lower distance_to_top are above
-                            SurfaceCollection upper_nonplanar;
-                            for (auto& s : upper_surfaces){
-                                if (s.is_nonplanar() && s.distance_to_top < distance_to_top) {
-                                    upper_nonplanar.surfaces.push_back(s);
-                                }
+                        // append layers where nonplanar areas with a lower distance_to_top are above
+                        SurfaceCollection upper_nonplanar;
+                        for (const Surface &s : upper_surfaces){
+                            if (s.is_nonplanar() && s.distance_to_top < distance_to_top) {
+                                upper_nonplanar.surfaces.push_back(s);
                             }
-                            if (upper_nonplanar.size() > 0)
-                                topNonplanar.append(
-                                    intersection_ex(
-                                        nonplanar_surface.horizontal_projection(),
-                                        to_expolygons(upper_nonplanar.surfaces),
-                                        ApplySafetyOffset::No),
-                                    (shell_thickness == 0 ? stTopNonplanar : stInternalSolidNonplanar),
-                                    distance_to_top
-                                );
                         }
-                        else {
+                        if (upper_nonplanar.size() > 0)
                             topNonplanar.append(
                                 intersection_ex(
-                                    nonplanar_surface.horizontal_projection(),
-                                    union_ex(to_expolygons(layerm_slices_surfaces)),
+                                    projection,
+                                    to_expolygons(upper_nonplanar.surfaces),
                                     ApplySafetyOffset::No),
-                                (shell_thickness == 0 ? stTopNonplanar : stInternalSolidNonplanar),
+                                surface_type,
                                 distance_to_top
                             );
-                        }
-
-                        if (topNonplanar.size() > 0) {
-                            // layerm.export_region_slices_to_svg_debug("home_layer_append-layerm");
-                            // home_layerm.export_region_slices_to_svg_debug("home_layer_append-home_layerm");
-
-                            BOOST_LOG_TRIVIAL(trace) << "Removing " << topNonplanar.size() << " nonplanar surfaces from layer " << layer->print_z;
-
-                            layerm.remove_nonplanar_slices(topNonplanar);
-
-                            BOOST_LOG_TRIVIAL(trace) << "Adding " << topNonplanar.size() << " nonplanar surfaces to layer " << home_layer->print_z;
-
-                            // move nonplanar surfaces to home layer
-                            home_layerm.append_top_nonplanar_slices(topNonplanar);
-
-                            //save nonplanar_surface to home_layers nonplanar_surface list
-                            home_layerm.append_nonplanar_surface(nonplanar_surface);
-
-                            moved_surfaces = true;
+                    }
+                    else {
+                        topNonplanar.append(
+                            intersection_ex(
+                                projection,
+                                union_ex(to_expolygons(layerm_slices_surfaces)),
+                                ApplySafetyOffset::No),
+                            surface_type,
+                            distance_to_top
+                        );
+                    }
+                    return topNonplanar;
+                };
+                // Move the nonplanar surfaces of a layer to the home layer.
+                auto move_to_home_layer = [home_layer, &home_layerm, &nonplanar_surface, &moved_surfaces](SurfaceCollection &&topNonplanar) {
+                    BOOST_LOG_TRIVIAL(trace) << "Adding " << topNonplanar.size() << " nonplanar surfaces to layer " << home_layer->print_z;
+                    home_layerm.append_top_nonplanar_slices(std::move(topNonplanar));
+                    //save nonplanar_surface to home_layers nonplanar_surface list
+                    home_layerm.append_nonplanar_surface(nonplanar_surface);
+                    moved_surfaces = true;
+                };
+
+                // Layers below the home layer only read their own slices and the slices of the layer above, which are
+                // not modified before being read unless one of them is the home layer. Process them in parallel.
+                auto independent = [home_layer_idx](size_t layer_idx) { return layer_idx != home_layer_idx && layer_idx + 1 != home_layer_idx; };
+                std::vector<SurfaceCollection> top_nonplanar_per_layer(num_layers);
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, num_layers),
+                    [this, &layer_active, &independent, &top_nonplanar, &top_nonplanar_per_layer](const tbb::blocked_range<size_t> &range) {
+                        PRINT_OBJECT_TIME_LIMIT_MILLIS(PRINT_OBJECT_TIME_LIMIT_DEFAULT);
+                        for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+                            if (layer_active(layer_idx) && independent(layer_idx)) {
+                                m_print->throw_if_canceled();
+                                top_nonplanar_per_layer[layer_idx] = top_nonplanar(layer_idx);
+                            }
+                    });
+                // Only now the layers may be modified, as the layer below may have been reading them.
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, num_layers),
+                    [this, region_id, &top_nonplanar_per_layer](const tbb::blocked_range<size_t> &range) {
+                        for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+                            if (const SurfaceCollection &topNonplanar = top_nonplanar_per_layer[layer_idx]; topNonplanar.size() > 0) {
+                                m_print->throw_if_canceled();
+                                BOOST_LOG_TRIVIAL(trace) << "Removing " << topNonplanar.size() << " nonplanar surfaces from layer " << m_layers[layer_idx]->print_z;
+                                m_layers[layer_idx]->m_regions[region_id]->remove_nonplanar_slices(topNonplanar);
+                            }
+                    });
+                // Merge into the home layer in the order of layers to produce the same result as a serial pass.
+                for (SurfaceCollection &topNonplanar : top_nonplanar_per_layer)
+                    if (topNonplanar.size() > 0)
+                        move_to_home_layer(std::move(topNonplanar));
+
+                // The layer below the home layer and the home layer itself see the surfaces moved to the home layer.
+                for (size_t layer_idx = home_layer_idx == 0 ? 0 : home_layer_idx - 1; layer_idx < num_layers; ++ layer_idx)
+                    if (layer_active(layer_idx) && ! independent(layer_idx)) {
+                        m_print->throw_if_canceled();
+                        if (SurfaceCollection topNonplanar = top_nonplanar(layer_idx); topNonplanar.size() > 0) {
+                            BOOST_LOG_TRIVIAL(trace) << "Removing " << topNonplanar.size() << " nonplanar surfaces from layer " << m_layers[layer_idx]->print_z;
+                            m_layers[layer_idx]->m_regions[region_id]->remove_nonplanar_slices(topNonplanar);
+                            move_to_home_layer(std::move(topNonplanar));
                         }
                     }
 
-                    //increase distance to the top layer
-                    distance_to_top += home_layer->height;
-                    break;
-                }
+                //increase distance to the top layer
+                distance_to_top += home_layer->height;
             }
         }
     }
@@ -1356,8 +1475,8 @@ PrintObject::detect_nonplanar_surfaces()
     for (size_t region_id = 0; region_id < this->num_printing_regions(); ++ region_id) {
         for (const Layer *layer : m_layers) {
             LayerRegion *layerm = layer->m_regions[region_id];
-            layerm->export_region_slices_to_svg_debug("0_detect_nonplanar_surfaces");
-            layerm->export_region_fill_surfaces_to_svg_debug("0_detect_nonplanar_surfaces");
+            layerm->export_region_slices_to_svg_debug("0_assign_nonplanar_surfaces");
+            layerm->export_region_fill_surfaces_to_svg_debug("0_assign_nonplanar_surfaces");
         } // for each layer
     } // for each region
 #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
@@ -1374,6 +1493,7 @@ PrintObject::project_nonplanar_surfaces()
     //TODO check when steps should be invalidated
     if (is_step_done(posNonplanarProjection)) return;
     set_started(posNonplanarProjection);
+    SLIC3R_TRACE_SCOPE("PrintObject", "project_nonplanar_surfaces");
 
 	for (size_t region_id = 0; region_id < this->num_printing_regions(); ++region_id) {
         BOOST_LOG_TRIVIAL(debug) << "Processing nonplanar surfaces for region " << region_id << " in parallel - start";
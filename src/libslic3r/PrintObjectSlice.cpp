@@ -5,9 +5,11 @@
 #include "MultiMaterialSegmentation.hpp"
 #include "Print.hpp"
 #include "ShortestPath.hpp"
-#include "AABBMesh.hpp"
+#include "Trace.hpp"
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/log/trivial.hpp>
+#include <boost/nowide/cstdio.hpp>
 
 #include <tbb/parallel_for.h>
 
@@ -40,21 +42,52 @@ LayerPtrs new_layers(
 }
 
 // Slice single triangle mesh.
+// Meshes with at least slicing_cache_min_facets facets are sliced out of core through a temporary mesh slicing cache file,
+// unless slicing_cache_min_facets is zero.
 static std::vector<ExPolygons> slice_volume(
     const ModelVolume             &volume,
     const std::vector<float>      &zs, 
     const MeshSlicingParamsEx     &params,
+    size_t                         slicing_cache_min_facets,
     const std::function<void()>   &throw_on_cancel_callback)
 {
     std::vector<ExPolygons> layers;
     if (! zs.empty()) {
-        indexed_triangle_set its = volume.mesh().its;
+        const indexed_triangle_set &its = volume.mesh().its;
         if (its.indices.size() > 0) {
             MeshSlicingParamsEx params2 { params };
             params2.trafo = params2.trafo * volume.get_matrix();
-            if (params2.trafo.rotation().determinant() < 0.)
-                its_flip_triangles(its);
-            layers = slice_mesh_ex(its, zs, params2, throw_on_cancel_callback);
+            if (params2.trafo.rotation().determinant() < 0.) {
+                indexed_triangle_set its_flipped = its;
+                its_flip_triangles(its_flipped);
+                layers = slice_mesh_ex(its_flipped, zs, params2, throw_on_cancel_callback);
+            } else if (slicing_cache_min_facets > 0 && its.indices.size() >= slicing_cache_min_facets) {
+                // Neither the mesh is copied nor the intersection lines of all the layers are kept in memory.
+                // If the cache could not be written or read, for example with the temp directory full, the mesh is sliced in memory.
+                std::string path;
+                bool        sliced = false;
+                try {
+                    path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slicingcache-%%%%-%%%%-%%%%.bin")).string();
+                    write_mesh_slicing_cache(its, params2.trafo, path, throw_on_cancel_callback);
+                    MeshSlicingParamsEx params_cache { params2 };
+                    params_cache.trafo = Transform3d::Identity();
+                    layers = slice_mesh_ex_from_cache(path, zs, params_cache, mesh_slicing_cache_layers_per_band, throw_on_cancel_callback);
+                    sliced = true;
+                } catch (const CanceledException &) {
+                    if (! path.empty())
+                        boost::nowide::remove(path.c_str());
+                    throw;
+                } catch (const Slic3r::FileIOError &ex) {
+                    BOOST_LOG_TRIVIAL(error) << "Slicing volume " << volume.name << " through the slicing cache " << path << " failed, slicing it in memory: " << ex.what();
+                } catch (const std::exception &ex) {
+                    BOOST_LOG_TRIVIAL(error) << "Slicing volume " << volume.name << " through the slicing cache failed, slicing it in memory: " << ex.what();
+                }
+                if (! path.empty())
+                    boost::nowide::remove(path.c_str());
+                if (! sliced)
+                    layers = slice_mesh_ex(its, zs, params2, throw_on_cancel_callback);
+            } else
+                layers = slice_mesh_ex(its, zs, params2, throw_on_cancel_callback);
             throw_on_cancel_callback();
         }
     }
@@ -68,13 +101,14 @@ static std::vector<ExPolygons> slice_volume(
     const std::vector<float>                    &z,
     const std::vector<t_layer_height_range>     &ranges,
     const MeshSlicingParamsEx                   &params,
+    size_t                                       slicing_cache_min_facets,
     const std::function<void()>                 &throw_on_cancel_callback)
 {
     std::vector<ExPolygons> out;
     if (! z.empty() && ! ranges.empty()) {
         if (ranges.size() == 1 && z.front() >= ranges.front().first && z.back() < ranges.front().second) {
             // All layers fit into a single range.
-            out = slice_volume(volume, z, params, throw_on_cancel_callback);
+            out = slice_volume(volume, z, params, slicing_cache_min_facets, throw_on_cancel_callback);
         } else {
             std::vector<float>                     z_filtered;
             std::vector<std::pair<size_t, size_t>> n_filtered;
@@ -90,7 +124,7 @@ static std::vector<ExPolygons> slice_volume(
                     n_filtered.emplace_back(std::make_pair(first, i));
             }
             if (! n_filtered.empty()) {
-                std::vector<ExPolygons> layers = slice_volume(volume, z_filtered, params, throw_on_cancel_callback);
+                std::vector<ExPolygons> layers = slice_volume(volume, z_filtered, params, slicing_cache_min_facets, throw_on_cancel_callback);
                 out.assign(z.size(), ExPolygons());
                 i = 0;
                 for (const std::pair<size_t, size_t> &span : n_filtered)
@@ -153,6 +187,7 @@ static std::vector<VolumeSlices> slice_volumes_inner(
     const size_t num_extruders = print_config.nozzle_diameter.size();
     const bool   is_mm_painted = num_extruders > 1 && std::any_of(model_volumes.cbegin(), model_volumes.cend(), [](const ModelVolume *mv) { return mv->is_mm_painted(); });
     const auto   extra_offset  = is_mm_painted ? 0.f : std::max(0.f, float(print_object_config.xy_size_compensation.value));
+    const auto   slicing_cache_min_facets = size_t(print_object_config.slicing_cache_min_facets.value);
 
     for (const ModelVolume *model_volume : model_volumes)
         if (model_volume_needs_slicing(*model_volume)) {
@@ -174,7 +209,7 @@ static std::vector<VolumeSlices> slice_volumes_inner(
                     }
                     out.push_back({
                         model_volume->id(), 
-                        slice_volume(*model_volume, zs, params, throw_on_cancel_callback)
+                        slice_volume(*model_volume, zs, params, slicing_cache_min_facets, throw_on_cancel_callback)
                     });
                 }
             } else {
@@ -186,7 +221,7 @@ static std::vector<VolumeSlices> slice_volumes_inner(
                 if (! slicing_ranges.empty())
                     out.push_back({ 
                         model_volume->id(), 
-                        slice_volume(*model_volume, zs, slicing_ranges, params, throw_on_cancel_callback)
+                        slice_volume(*model_volume, zs, slicing_ranges, params, slicing_cache_min_facets, throw_on_cancel_callback)
                     });
             }
             if (! out.empty() && out.back().slices.empty())
@@ -498,11 +533,13 @@ void PrintObject::slice()
 {
     if (! this->set_started(posSlice))
         return;
+    SLIC3R_TRACE_SCOPE("PrintObject", "slice");
     m_print->set_status(10, _u8L("Processing triangulated mesh"));
     std::vector<coordf_t> layer_height_profile;
     this->update_layer_height_profile(*this->model_object(), m_slicing_params, layer_height_profile);
     m_print->throw_if_canceled();
     m_typed_slices = false;
+    m_planar_slices_backed_up = false;
     this->clear_layers();
     m_layers = new_layers(this, generate_object_layers(m_slicing_params, layer_height_profile));
     this->slice_volumes();
@@ -746,8 +783,6 @@ void PrintObject::slice_volumes()
         apply_mm_segmentation(*this, [print]() { print->throw_if_canceled(); });
     }
 
-    this->find_nonplanar_surfaces();
-
     this->make_slices();
 
     BOOST_LOG_TRIVIAL(debug) << "Slicing volumes - end";
@@ -855,37 +890,24 @@ PrintObject::find_nonplanar_surfaces()
         //only check non modifier volumes
         if (! (*it)->is_modifier()) {
             const TriangleMesh tmesh = (*it)->mesh();
-            AABBMesh mesh(tmesh, true);
-            std::map<int, NonplanarFacet> facets;
+            const indexed_triangle_set &its = tmesh.its;
+            std::vector<Vec3i> face_neighbors = its_face_neighbors(its);
+            std::vector<Vec3f> face_normals(its.indices.size());
+            std::vector<int> facets;
 
-            // store all meshes with slope <= nonplanar_layers_angle in map. Map is necessary to keep facet ID
-            for (int face_id = 0; face_id < mesh.indices().size(); ++ face_id) {
-                auto &face = mesh.indices(face_id); // unused findout why
-                Vec3d normal = mesh.normal_by_face_id(face_id);
+            // collect all facets with slope <= nonplanar_layers_angle
+            for (int face_id = 0; face_id < int(its.indices.size()); ++ face_id) {
+                Vec3d normal = its_unnormalized_normal(its, face_id).cast<double>().normalized();
 
                 //TODO check if normals exist
                 if (normal.z() >= std::cos(m_config.nonplanar_layers_angle.value * 3.14159265/180.0)) {
-                    //copy facet
-                    NonplanarFacet new_facet;
-                    new_facet.normal.x = normal.x();
-                    new_facet.normal.y = normal.y();
-                    new_facet.normal.z = normal.z();
-
-                    Vec3i neighbor = mesh.face_neighbor_index()[face_id];
-                    its_triangle vertex = its_triangle_vertices(*mesh.get_triangle_mesh(), face_id);
-                    for (int j=0; j<=2 ;j++) {
-                        new_facet.vertex[j].x = vertex[j].x();
-                        new_facet.vertex[j].y = vertex[j].y();
-                        new_facet.vertex[j].z = vertex[j].z();
-                        new_facet.neighbor[j] = neighbor[j];
-                    }
-                    new_facet.calculate_stats();
-                    facets[face_id] = new_facet;
+                    face_normals[face_id] = normal.cast<float>();
+                    facets.emplace_back(face_id);
                 }
             }
 
             // create nonplanar surface from facets
-            NonplanarSurface nf = NonplanarSurface(facets);
+            NonplanarSurface nf(its, face_normals, face_neighbors, facets);
             BOOST_LOG_TRIVIAL(debug) << "Find nonplanar surfaces - moving surfaces by z=" << -tmesh.stats().min.z();
             nf.translate(0, 0, -tmesh.stats().min.z());
 
@@ -942,6 +964,10 @@ PrintObject::find_nonplanar_surfaces()
                 }
             }
 
+            // build the spatial index used by LayerRegion::project_nonplanar_path()
+            for (NonplanarSurface &surface : m_nonplanar_surfaces)
+                surface.build_aabb_tree();
+
             //nf.debug_output();
 
             BOOST_LOG_TRIVIAL(info) << "Find nonplanar surfaces - found " << m_nonplanar_surfaces.size() << " in " << (*it)->name;
@@ -980,7 +1006,7 @@ std::vector<Polygons> PrintObject::slice_support_volumes(const ModelVolumeType m
         params.trafo = this->trafo_centered();
         for (; it_volume != it_volume_end; ++ it_volume)
             if ((*it_volume)->type() == model_volume_type) {
-                std::vector<ExPolygons> slices2 = slice_volume(*(*it_volume), zs, params, throw_on_cancel_callback);
+                std::vector<ExPolygons> slices2 = slice_volume(*(*it_volume), zs, params, size_t(this->config().slicing_cache_min_facets.value), throw_on_cancel_callback);
                 if (slices.empty()) {
                     slices.reserve(slices2.size());
                     for (ExPolygons &src : slices2)
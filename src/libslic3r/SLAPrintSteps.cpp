@@ -4,6 +4,7 @@
 #include <libslic3r/SLAPrintSteps.hpp>
 #include <libslic3r/MeshBoolean.hpp>
 #include <libslic3r/TriangleMeshSlicer.hpp>
+#include <libslic3r/Trace.hpp>
 
 // Need the cylinder method for the the drainholes in hollowing step
 #include <libslic3r/SLA/SupportTreeBuilder.hpp>
@@ -1201,6 +1202,9 @@ double SLAPrint::Steps::progressrange(SLAPrintStep step) const
 
 void SLAPrint::Steps::execute(SLAPrintObjectStep step, SLAPrintObject &obj)
 {
+    static const char *trace_names[] = { "mesh_assembly", "hollow_model", "drill_holes", "slice_model", "support_points", "support_tree", "generate_pad", "slice_supports" };
+    static_assert(std::size(trace_names) == slaposCount, "trace_names shall match SLAPrintObjectStep");
+    SLIC3R_TRACE_SCOPE("SLAPrintObject", step < slaposCount ? trace_names[step] : "unknown");
     switch(step) {
     case slaposAssembly: mesh_assembly(obj); break;
     case slaposHollowing: hollow_model(obj); break;
@@ -1216,6 +1220,9 @@ void SLAPrint::Steps::execute(SLAPrintObjectStep step, SLAPrintObject &obj)
 
 void SLAPrint::Steps::execute(SLAPrintStep step)
 {
+    static const char *trace_names[] = { "merge_slices_and_eval_stats", "rasterize" };
+    static_assert(std::size(trace_names) == slapsCount, "trace_names shall match SLAPrintStep");
+    SLIC3R_TRACE_SCOPE("SLAPrint", step < slapsCount ? trace_names[step] : "unknown");
     switch (step) {
     case slapsMergeSlicesAndEval: merge_slices_and_eval_stats(); break;
     case slapsRasterize: rasterize(); break;
@@ -6,6 +6,7 @@
 #include "../Polygon.hpp"
 #include "../Polyline.hpp"
 #include "../MutablePolygon.hpp"
+#include "../Trace.hpp"
 #include "../TriangleMeshSlicer.hpp"
 
 #include <cassert>
@@ -1020,6 +1021,7 @@ void organic_draw_branches(
 
     std::function<void()>            throw_on_cancel)
 {
+    SLIC3R_TRACE_SCOPE("TreeSupport", "organic_draw_branches");
     // All SupportElements are put into a layer independent storage to improve parallelization.
     std::vector<std::pair<SupportElement*, int>> elements_with_link_down;
     std::vector<size_t>                          linear_data_layers;
@@ -11,11 +11,13 @@
 
 #include "../BuildVolume.hpp"
 #include "../ClipperUtils.hpp"
+#include "../Exception.hpp"
 #include "../Flow.hpp"
 #include "../Layer.hpp"
 #include "../Point.hpp"
 #include "../Print.hpp"
 #include "../PrintConfig.hpp"
+#include "../Trace.hpp"
 #include "../Utils.hpp"
 #include "../format.hpp"
 
@@ -24,6 +26,7 @@
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 #include <tbb/task_group.h>
 
 namespace Slic3r::FFFTreeSupport
@@ -102,6 +105,7 @@ TreeModelVolumes::TreeModelVolumes(
         m_radius_0 = config.getRadius(0);
         m_raft_layers = config.raft_layers;
         m_current_outline_idx = 0;
+        m_pathing_cache_memory_limit = size_t(std::max(0, print_object.config().support_tree_cache_memory_limit.value)) << 20;
 
         m_layer_outlines.emplace_back(mesh_settings, std::vector<Polygons>{});
         std::vector<Polygons> &outlines = m_layer_outlines.front().second;
@@ -155,6 +159,7 @@ TreeModelVolumes::TreeModelVolumes(
 
 void TreeModelVolumes::precalculate(const PrintObject& print_object, const coord_t max_layer, std::function<void()> throw_on_cancel)
 {
+    SLIC3R_TRACE_SCOPE("TreeSupport", "TreeModelVolumes::precalculate");
     auto t_start = std::chrono::high_resolution_clock::now();
     m_precalculated = true;
 
@@ -221,6 +226,8 @@ void TreeModelVolumes::precalculate(const PrintObject& print_object, const coord
 
     // Calculate the relevant collisions
     calculateCollision(relevant_collision_radiis, throw_on_cancel);
+    // The parallel calculations published the areas of a layer radius by radius, each time replacing the layer entries.
+    this->release_replaced_cache_entries();
 
     // calculate a separate Collisions with all holes removed. These are relevant for some avoidances that try to avoid holes (called safe)
     std::vector<RadiusLayerPair> relevant_hole_collision_radiis;
@@ -228,11 +235,32 @@ void TreeModelVolumes::precalculate(const PrintObject& print_object, const coord
         if (key.first < m_increase_until_radius + m_current_min_xy_dist_delta)
             relevant_hole_collision_radiis.emplace_back(key);
 
-    // Calculate collisions without holes, built from regular collision
-    calculateCollisionHolefree(relevant_hole_collision_radiis, throw_on_cancel);
+    // With the memory limit, the avoidances are kept by windows only if they would not fit into the limit.
+    // They are estimated from the collisions, which they are built of: An avoidance of a radius takes about the memory of the collision
+    // of that radius. Each avoidance radius needs an avoidance per type and target, a wall restriction (two with the minimum xy distance)
+    // and for the small radii a collision without holes.
+    m_pathing_windows               = false;
+    m_pathing_cache_memory_estimate = 0;
+    if (! relevant_collision_radiis.empty()) {
+        const size_t memory_per_radius = m_collision_cache.memory_used() / relevant_collision_radiis.size();
+        const size_t num_areas         = relevant_avoidance_radiis.size() * (size_t(AvoidanceType::Count) * (m_support_rests_on_model ? 2 : 1) + (m_current_min_xy_dist_delta > 0 ? 2 : 1)) +
+            relevant_hole_collision_radiis.size();
+        m_pathing_cache_memory_estimate = memory_per_radius * num_areas;
+    }
+    if (m_pathing_cache_memory_limit > 0 && ! relevant_collision_radiis.empty()) {
+        m_pathing_windows = m_pathing_cache_memory_estimate > m_pathing_cache_memory_limit;
+        BOOST_LOG_TRIVIAL(debug) << "Tree support caches estimated to " << (m_pathing_cache_memory_estimate >> 20) << " MB, memory limit " << (m_pathing_cache_memory_limit >> 20) << 
+            " MB, " << (m_pathing_windows ? "keeping the avoidances by windows" : "keeping all the avoidances");
+    }
+
+    // Calculate collisions without holes, built from regular collision.
+    // With the avoidances kept by windows, the collisions without holes are calculated by the avoidance windows without caching them.
+    if (! this->pathing_windows())
+        calculateCollisionHolefree(relevant_hole_collision_radiis, throw_on_cancel);
     // Let placables be calculated from calculateAvoidance() for better parallelization.
     if (m_support_rests_on_model)
         calculatePlaceables(relevant_avoidance_radiis, throw_on_cancel);
+    this->release_replaced_cache_entries();
 
     auto t_coll = std::chrono::high_resolution_clock::now();
 
@@ -240,9 +268,12 @@ void TreeModelVolumes::precalculate(const PrintObject& print_object, const coord
     {
         tbb::task_group task_group;
         task_group.run([this, relevant_avoidance_radiis, throw_on_cancel]{ calculateAvoidance(relevant_avoidance_radiis, true, m_support_rests_on_model, throw_on_cancel); });
-        task_group.run([this, relevant_avoidance_radiis, throw_on_cancel]{ calculateWallRestrictions(relevant_avoidance_radiis, throw_on_cancel); });
+        // With the avoidances kept by windows, the wall restrictions are calculated on demand, see getWallRestriction().
+        if (! this->pathing_windows())
+            task_group.run([this, relevant_avoidance_radiis, throw_on_cancel]{ calculateWallRestrictions(relevant_avoidance_radiis, throw_on_cancel); });
         task_group.wait();
     }
+    this->release_replaced_cache_entries();
     auto t_end = std::chrono::high_resolution_clock::now();
     auto dur_col = 0.001 * std::chrono::duration_cast<std::chrono::microseconds>(t_coll - t_start).count();
     auto dur_avo = 0.001 * std::chrono::duration_cast<std::chrono::microseconds>(t_end - t_coll).count();
@@ -324,6 +355,16 @@ const Polygons& TreeModelVolumes::getCollisionHolefree(coord_t radius, LayerInde
     return getCollisionHolefree(radius, layer_idx);
 }
 
+// One calculation fills all the avoidances of the same radius and target, or both the wall restrictions of the same radius,
+// for a window of layers. Different windows or radii are calculated concurrently unless they happen to share a stripe.
+std::mutex& TreeModelVolumes::pathing_window_mutex(PathingWindowCache cache, coord_t radius, LayerIndex layer_idx) const
+{
+    size_t seed = size_t(cache);
+    boost::hash_combine(seed, radius);
+    boost::hash_combine(seed, pathing_window_begin(layer_idx));
+    return m_pathing_window_mutexes[seed % pathing_window_mutex_stripes];
+}
+
 const Polygons& TreeModelVolumes::getAvoidance(const coord_t orig_radius, LayerIndex layer_idx, AvoidanceType type, bool to_model, bool min_xy_dist) const
 {
     if (layer_idx == 0) // What on the layer directly above buildplate do i have to avoid to reach the buildplate ...
@@ -339,6 +380,20 @@ const Polygons& TreeModelVolumes::getAvoidance(const coord_t orig_radius, LayerI
         result)
         return (*result).get();
 
+    if (this->pathing_windows()) {
+        // Only the first layer of each window is kept, calculate the window up to layer_idx from it.
+        // The other threads of the propagation likely request the same window, let them wait for it instead of calculating it again.
+        std::lock_guard<std::mutex> lock(this->pathing_window_mutex(
+            to_model ? PathingWindowCache::AvoidanceToModel : PathingWindowCache::AvoidanceToBuildPlate, radius, layer_idx));
+        if (std::optional<std::reference_wrapper<const Polygons>> result = this->avoidance_cache(type, to_model).getArea({ radius, layer_idx }); result)
+            return (*result).get();
+        // Don't pick up other tasks of the propagation while holding the lock, they may request a window as well.
+        tbb::this_task_arena::isolate([this, radius, layer_idx, to_model]{
+            const_cast<TreeModelVolumes*>(this)->calculateAvoidance({ radius, layer_idx }, ! to_model, to_model);
+        });
+        return getAvoidance(orig_radius, layer_idx, type, to_model, min_xy_dist);
+    }
+
     if (m_precalculated) {
         if (to_model) {
             BOOST_LOG_TRIVIAL(error_level_not_in_cache) << "Had to calculate Avoidance to model at radius " << radius << " and layer " << layer_idx << ", but precalculate was called. Performance may suffer!";
@@ -385,6 +440,17 @@ const Polygons& TreeModelVolumes::getWallRestriction(const coord_t orig_radius,
         (min_xy_dist ? m_wall_restrictions_cache_min : m_wall_restrictions_cache).getArea({ radius, layer_idx });
         result)
         return (*result).get();
+    if (this->pathing_windows()) {
+        // Wall restrictions are calculated on demand by windows, see getAvoidance().
+        std::lock_guard<std::mutex> lock(this->pathing_window_mutex(PathingWindowCache::WallRestrictions, radius, layer_idx));
+        if (std::optional<std::reference_wrapper<const Polygons>> result = 
+                (min_xy_dist ? m_wall_restrictions_cache_min : m_wall_restrictions_cache).getArea({ radius, layer_idx }); result)
+            return (*result).get();
+        tbb::this_task_arena::isolate([this, radius, layer_idx]{
+            const_cast<TreeModelVolumes*>(this)->calculateWallRestrictions({ radius, layer_idx });
+        });
+        return getWallRestriction(orig_radius, layer_idx, min_xy_dist);
+    }
     if (m_precalculated) {
         BOOST_LOG_TRIVIAL(error_level_not_in_cache) << "Had to calculate Wall restricions at radius " << radius << " and layer " << layer_idx << ", but precalculate was called. Performance may suffer!";
         tree_supports_show_error(
@@ -586,17 +652,7 @@ void TreeModelVolumes::calculateCollisionHolefree(const std::vector<RadiusLayerP
         for (LayerIndex layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
             for (RadiusLayerPair key : keys)
                 if (layer_idx <= key.second) {
-                    // Logically increase the collision by m_increase_until_radius
-                    coord_t radius = key.first;
-                    assert(radius == this->ceilRadius(radius));
-                    assert(radius < m_increase_until_radius + m_current_min_xy_dist_delta);
-                    coord_t increase_radius_ceil = ceilRadius(m_increase_until_radius, false) - radius;
-                    assert(increase_radius_ceil > 0);
-                    // this union is important as otherwise holes(in form of lines that will increase to holes in a later step) can get unioned onto the area.
-                    data.emplace_back(RadiusLayerPair(radius, layer_idx), polygons_simplify(
-                        offset(union_ex(this->getCollision(m_increase_until_radius, layer_idx, false)),
-                            5 - increase_radius_ceil, ClipperLib::jtRound, m_min_resolution),
-                        m_min_resolution, polygons_strictly_simple));
+                    data.emplace_back(RadiusLayerPair(key.first, layer_idx), this->calculateCollisionHolefreeLayer(key.first, layer_idx));
                     throw_on_cancel();
                 }
         }
@@ -604,6 +660,20 @@ void TreeModelVolumes::calculateCollisionHolefree(const std::vector<RadiusLayerP
     });
 }
 
+Polygons TreeModelVolumes::calculateCollisionHolefreeLayer(coord_t radius, LayerIndex layer_idx) const
+{
+    // Logically increase the collision by m_increase_until_radius
+    assert(radius == this->ceilRadius(radius));
+    assert(radius < m_increase_until_radius + m_current_min_xy_dist_delta);
+    coord_t increase_radius_ceil = ceilRadius(m_increase_until_radius, false) - radius;
+    assert(increase_radius_ceil > 0);
+    // this union is important as otherwise holes(in form of lines that will increase to holes in a later step) can get unioned onto the area.
+    return polygons_simplify(
+        offset(union_ex(this->getCollision(m_increase_until_radius, layer_idx, false)),
+            5 - increase_radius_ceil, ClipperLib::jtRound, m_min_resolution),
+        m_min_resolution, polygons_strictly_simple);
+}
+
 void TreeModelVolumes::calculateAvoidance(const std::vector<RadiusLayerPair> &keys, bool to_build_plate, bool to_model, std::function<void()> throw_on_cancel)
 {
     // For every RadiusLayer pair there are 3 avoidances that have to be calculated.
@@ -630,7 +700,7 @@ void TreeModelVolumes::calculateAvoidance(const std::vector<RadiusLayerPair> &ke
             ((iter_idx / 3) & 1) != 0  // to_model
         };
         // Ensure start_layer is at least 1 as if no avoidance was calculated yet getMaxCalculatedLayer() returns -1.
-        task.start_layer = std::max<LayerIndex>(1, 1 + avoidance_cache(task.type, task.to_model).getMaxCalculatedLayer(task.radius));
+        task.start_layer = std::max<LayerIndex>(1, 1 + avoidance_cache(task.type, task.to_model).getMaxCalculatedLayer(task.radius, task.max_required_layer));
         if (task.start_layer > task.max_required_layer) {
             BOOST_LOG_TRIVIAL(debug) << "Calculation requested for value already calculated?";
             continue;
@@ -671,10 +741,15 @@ void TreeModelVolumes::calculateAvoidance(const std::vector<RadiusLayerPair> &ke
             // minDist as the delta was already added, also avoidance for layer 0 will return the collision.
             Polygons    latest_avoidance   = getAvoidance(task.radius, task.start_layer - 1, task.type, task.to_model, true);
             std::vector<std::pair<RadiusLayerPair, Polygons>> data;
-            data.reserve(task.max_required_layer + 1 - task.start_layer);
+            data.reserve(this->pathing_windows() ? 
+                (task.max_required_layer + 1 - task.start_layer) / pathing_window_layers + pathing_window_layers : 
+                task.max_required_layer + 1 - task.start_layer);
+            Polygons    holefree_collisions;
             for (LayerIndex layer_idx = task.start_layer; layer_idx <= task.max_required_layer; ++ layer_idx) {
                 // Merge current layer collisions with shrunk last_avoidance.
-                const Polygons &current_layer_collisions = collision_holefree ? getCollisionHolefree(task.radius, layer_idx) : getCollision(task.radius, layer_idx, true);
+                const Polygons &current_layer_collisions = ! collision_holefree ? getCollision(task.radius, layer_idx, true) :
+                    this->pathing_windows() ? (holefree_collisions = this->calculateCollisionHolefreeLayer(task.radius, layer_idx)) : 
+                    getCollisionHolefree(task.radius, layer_idx);
                 // For mildly steep branch angles only one step will be taken.
                 for (int istep = 0; istep < move_steps; ++ istep)
                     latest_avoidance = union_(current_layer_collisions,
@@ -684,7 +759,10 @@ void TreeModelVolumes::calculateAvoidance(const std::vector<RadiusLayerPair> &ke
                 if (task.to_model)
                     latest_avoidance = diff(latest_avoidance, getPlaceableAreas(task.radius, layer_idx, throw_on_cancel));
                 latest_avoidance = polygons_simplify(latest_avoidance, m_min_resolution, polygons_strictly_simple);
-                data.emplace_back(RadiusLayerPair{task.radius, layer_idx}, latest_avoidance);
+                // With the avoidances kept by windows, keep just the first layer of each window to continue the calculation from
+                // and the topmost layers requested first by the propagation. A window calculated on demand is kept completely.
+                if (! this->pathing_windows() || layer_idx % pathing_window_layers == 0 || layer_idx + pathing_window_layers > task.max_required_layer)
+                    data.emplace_back(RadiusLayerPair{task.radius, layer_idx}, latest_avoidance);
                 throw_on_cancel();
             }
 #ifdef SLIC3R_TREESUPPORTS_PROGRESS
@@ -792,7 +870,9 @@ void TreeModelVolumes::calculateWallRestrictions(const std::vector<RadiusLayerPa
         for (size_t key_idx = range.begin(); key_idx < range.end(); ++ key_idx) {
             const coord_t    radius             = keys[key_idx].first;
             const LayerIndex max_required_layer = keys[key_idx].second;
-            const coord_t    min_layer_bottom   = std::max(1, m_wall_restrictions_cache.getMaxCalculatedLayer(radius));
+            // With the avoidances kept by windows, calculate the window up to max_required_layer.
+            const coord_t    min_layer_bottom   = std::max(1, this->pathing_windows() ? 
+                pathing_window_begin(max_required_layer) : m_wall_restrictions_cache.getMaxCalculatedLayer(radius));
             const size_t     buffer_size        = max_required_layer + 1 - min_layer_bottom;
             std::vector<Polygons> data(buffer_size, Polygons{});
             std::vector<Polygons> data_min;
@@ -849,24 +929,250 @@ coord_t TreeModelVolumes::ceilRadius(const coord_t radius) const
     return out;
 }
 
-void TreeModelVolumes::RadiusLayerPolygonCache::allocate_layers(size_t num_layers)
+size_t TreeModelVolumes::pathing_cache_memory_used() const
+{
+    size_t out = 0;
+    for (const RadiusLayerPolygonCache *cache : { &m_collision_cache_holefree, &m_avoidance_cache, &m_avoidance_cache_slow, &m_avoidance_cache_to_model, 
+            &m_avoidance_cache_to_model_slow, &m_avoidance_cache_holefree, &m_avoidance_cache_holefree_to_model, &m_wall_restrictions_cache, &m_wall_restrictions_cache_min })
+        out += cache->memory_used();
+    return out;
+}
+
+void TreeModelVolumes::release_pathing_caches_above(LayerIndex layer_idx)
+{
+    // No lookup is running between the layers of the propagation.
+    this->release_replaced_cache_entries();
+    // Windows above layer_idx are kept while the caches fit into the limit, they may still be requested by the propagation.
+    // Otherwise the propagation proceeding top down will not request them again, they are the least recently used ones.
+    if (! this->pathing_windows())
+        return;
+    const size_t memory = this->pathing_cache_memory_used();
+    if (memory <= m_pathing_cache_memory_limit)
+        return;
+    // Keep the window of layer_idx and the first layers of the windows below, the windows are calculated from them on demand.
+    for (RadiusLayerPolygonCache *cache : { &m_collision_cache_holefree, &m_avoidance_cache, &m_avoidance_cache_slow, &m_avoidance_cache_to_model, 
+            &m_avoidance_cache_to_model_slow, &m_avoidance_cache_holefree, &m_avoidance_cache_holefree_to_model, &m_wall_restrictions_cache, &m_wall_restrictions_cache_min })
+        cache->release_layers_above(layer_idx);
+    if (const size_t memory_after = this->pathing_cache_memory_used(); memory_after > m_pathing_cache_memory_limit)
+        BOOST_LOG_TRIVIAL(warning) << "Tree support caches exceeded the memory limit at layer " << layer_idx << ", " << (memory >> 20) << " MB before release, " << 
+            (memory_after >> 20) << " MB after";
+}
+
+void TreeModelVolumes::release_pathing_windows()
+{
+    this->release_replaced_cache_entries();
+    if (! this->pathing_windows() || this->pathing_cache_memory_used() <= m_pathing_cache_memory_limit)
+        return;
+    for (RadiusLayerPolygonCache *cache : { &m_collision_cache_holefree, &m_avoidance_cache, &m_avoidance_cache_slow, &m_avoidance_cache_to_model, 
+            &m_avoidance_cache_to_model_slow, &m_avoidance_cache_holefree, &m_avoidance_cache_holefree_to_model, &m_wall_restrictions_cache, &m_wall_restrictions_cache_min })
+        cache->release_all_but_first_layer_of_shards();
+}
+
+void TreeModelVolumes::release_pathing_caches()
+{
+    m_collision_cache_holefree.clear();
+    m_avoidance_cache.clear();
+    m_avoidance_cache_slow.clear();
+    m_avoidance_cache_to_model.clear();
+    m_avoidance_cache_to_model_slow.clear();
+    m_avoidance_cache_holefree.clear();
+    m_avoidance_cache_holefree_to_model.clear();
+    m_wall_restrictions_cache.clear();
+    m_wall_restrictions_cache_min.clear();
+}
+
+void TreeModelVolumes::release_replaced_cache_entries()
+{
+    for (RadiusLayerPolygonCache *cache : { &m_collision_cache, &m_collision_cache_holefree, &m_avoidance_cache, &m_avoidance_cache_slow,
+            &m_avoidance_cache_to_model, &m_avoidance_cache_to_model_slow, &m_placeable_areas_cache, &m_avoidance_cache_holefree,
+            &m_avoidance_cache_holefree_to_model, &m_wall_restrictions_cache, &m_wall_restrictions_cache_min })
+        cache->release_replaced();
+}
+
+static size_t polygons_memory(const Polygons &polygons)
+{
+    size_t out = sizeof(Polygon) * polygons.capacity();
+    for (const Polygon &polygon : polygons)
+        out += sizeof(Point) * polygon.points.capacity();
+    return out;
+}
+
+TreeModelVolumes::RadiusLayerPolygonCache::Shard& TreeModelVolumes::RadiusLayerPolygonCache::ShardLock::lock(size_t shard_idx)
 {
-    if (num_layers > m_data.size()) {
-        if (num_layers > m_data.capacity())
-            reserve_power_of_2(m_data, num_layers);
-        m_data.resize(num_layers, {});
+    assert(shard_idx < m_cache.num_shards());
+    std::atomic<Shard*> &slot  = m_cache.m_shards[shard_idx];
+    Shard               *shard = slot.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+        // Publish a new shard. If another thread was faster, use its shard.
+        auto new_shard = std::make_unique<Shard>();
+        if (slot.compare_exchange_strong(shard, new_shard.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+            shard = new_shard.release();
     }
+    if (shard_idx != m_shard_idx) {
+        if (m_lock.owns_lock())
+            m_lock.unlock();
+        m_lock = std::unique_lock<std::mutex>(shard->mutex, std::try_to_lock);
+        if (! m_lock.owns_lock()) {
+            auto t_start = std::chrono::steady_clock::now();
+            m_lock.lock();
+            m_cache.m_lock_wait_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t_start).count(), std::memory_order_relaxed);
+        }
+        m_shard_idx = shard_idx;
+    }
+    return *shard;
+}
+
+void TreeModelVolumes::RadiusLayerPolygonCache::insert(std::vector<std::pair<RadiusLayerPair, Polygons>> &&in)
+{
+    std::sort(in.begin(), in.end(), [](const auto &l, const auto &r) { return l.first.second < r.first.second || (l.first.second == r.first.second && l.first.first < r.first.first); });
+    ShardLock                   lock(*this);
+    std::vector<RadiusPolygons> layer;
+    for (auto it = in.begin(); it != in.end();) {
+        const LayerIndex layer_idx = it->first.second;
+        layer.clear();
+        for (; it != in.end() && it->first.second == layer_idx; ++ it)
+            layer.emplace_back(it->first.first, std::move(it->second));
+        this->insert(lock, layer_idx, layer.data(), layer.data() + layer.size());
+    }
+}
+
+static size_t layer_entries_memory(const std::vector<std::pair<coord_t, Polygons*>> &entries)
+{
+    return sizeof(std::pair<coord_t, Polygons*>) * entries.capacity();
+}
+
+void TreeModelVolumes::RadiusLayerPolygonCache::insert(ShardLock &lock, LayerIndex layer_idx, RadiusPolygons *begin, RadiusPolygons *end)
+{
+    assert(std::is_sorted(begin, end, [](const RadiusPolygons &l, const RadiusPolygons &r) { return l.first < r.first; }));
+    if (layer_idx < 0 || size_t(layer_idx) >= layers_per_shard * max_shards)
+        throw RuntimeError(format("Tree support: Layer %1% is out of the range of the support areas cache, which holds %2% layers.", layer_idx, layers_per_shard * max_shards));
+    Shard              &shard = lock.lock(size_t(layer_idx) / layers_per_shard);
+    LayerData          &layer = shard.layers[size_t(layer_idx) % layers_per_shard];
+    static const LayerEntries no_entries;
+    const LayerEntries &old   = layer.storage ? *layer.storage : no_entries;
+    auto                entries = std::make_unique<LayerEntries>();
+    entries->reserve(old.size() + (end - begin));
+    size_t              memory  = 0;
+    auto                it_old  = old.begin();
+    for (RadiusPolygons *it = begin; it != end; ++ it) {
+        for (; it_old != old.end() && it_old->first < it->first; ++ it_old)
+            entries->emplace_back(*it_old);
+        if ((it_old != old.end() && it_old->first == it->first) || (! entries->empty() && entries->back().first == it->first))
+            // Publish once, keep the areas other threads may already reference.
+            continue;
+        Polygons &stored = shard.polygons.emplace_back(std::move(it->second));
+        memory += polygons_memory(stored);
+        entries->emplace_back(it->first, &stored);
+    }
+    if (entries->size() + (old.end() - it_old) == old.size())
+        // All the areas were already cached.
+        return;
+    entries->insert(entries->end(), it_old, old.end());
+    memory += layer_entries_memory(*entries);
+    layer.entries.store(entries.get(), std::memory_order_release);
+    if (layer.storage)
+        shard.replaced.emplace_back(std::move(layer.storage));
+    layer.storage = std::move(entries);
+    shard.memory += memory;
+    m_memory.fetch_add(memory, std::memory_order_relaxed);
+    for (size_t num_layers = m_num_layers.load(std::memory_order_relaxed); 
+         num_layers <= size_t(layer_idx) && ! m_num_layers.compare_exchange_weak(num_layers, size_t(layer_idx) + 1, std::memory_order_release, std::memory_order_relaxed);) ;
+}
+
+void TreeModelVolumes::RadiusLayerPolygonCache::clear()
+{
+    for (size_t shard_idx = 0; shard_idx < this->num_shards(); ++ shard_idx)
+        delete m_shards[shard_idx].exchange(nullptr);
+    m_num_layers = 0;
+    m_memory     = 0;
+}
+
+void TreeModelVolumes::RadiusLayerPolygonCache::release_layers_above(LayerIndex layer_idx)
+{
+    const size_t first_released = layer_idx < 0 ? 0 : size_t(layer_idx) / layers_per_shard + 1;
+    for (size_t shard_idx = first_released; shard_idx < this->num_shards(); ++ shard_idx)
+        if (Shard *shard = m_shards[shard_idx].exchange(nullptr); shard) {
+            m_memory -= shard->memory;
+            delete shard;
+        }
+    if (m_num_layers > first_released * layers_per_shard)
+        m_num_layers = first_released * layers_per_shard;
+}
+
+void TreeModelVolumes::RadiusLayerPolygonCache::clear_all_but_radius0()
+{
+    // Keep just the areas of the smallest radius, release the rest including the replaced LayerEntries.
+    for (size_t shard_idx = 0; shard_idx < this->num_shards(); ++ shard_idx)
+        if (Shard *shard = m_shards[shard_idx].load(); shard) {
+            std::deque<Polygons> polygons;
+            size_t               memory = 0;
+            for (LayerData &layer : shard->layers)
+                if (layer.storage) {
+                    assert(! layer.storage->empty());
+                    Polygons &stored = polygons.emplace_back(std::move(*layer.storage->front().second));
+                    auto      entries = std::make_unique<LayerEntries>(LayerEntries{ { layer.storage->front().first, &stored } });
+                    memory += polygons_memory(stored) + layer_entries_memory(*entries);
+                    layer.entries = entries.get();
+                    layer.storage = std::move(entries);
+                }
+            m_memory       -= shard->memory - memory;
+            shard->polygons = std::move(polygons);
+            shard->replaced.clear();
+            shard->replaced.shrink_to_fit();
+            shard->memory   = memory;
+        }
+}
+
+void TreeModelVolumes::RadiusLayerPolygonCache::release_all_but_first_layer_of_shards()
+{
+    for (size_t shard_idx = 0; shard_idx < this->num_shards(); ++ shard_idx)
+        if (Shard *shard = m_shards[shard_idx].load(); shard) {
+            std::deque<Polygons> polygons;
+            size_t               memory = 0;
+            for (size_t i = 0; i < layers_per_shard; ++ i)
+                if (LayerData &layer = shard->layers[i]; layer.storage) {
+                    if (i == 0) {
+                        for (std::pair<coord_t, Polygons*> &entry : *layer.storage) {
+                            Polygons &stored = polygons.emplace_back(std::move(*entry.second));
+                            entry.second = &stored;
+                            memory += polygons_memory(stored);
+                        }
+                        memory += layer_entries_memory(*layer.storage);
+                    } else {
+                        layer.entries = nullptr;
+                        layer.storage.reset();
+                    }
+                }
+            m_memory       -= shard->memory - memory;
+            shard->polygons = std::move(polygons);
+            shard->replaced.clear();
+            shard->replaced.shrink_to_fit();
+            shard->memory   = memory;
+        }
+}
+
+void TreeModelVolumes::RadiusLayerPolygonCache::release_replaced()
+{
+    for (size_t shard_idx = 0; shard_idx < this->num_shards() && shard_idx * layers_per_shard < m_num_layers; ++ shard_idx)
+        if (Shard *shard = m_shards[shard_idx].load(); shard && ! shard->replaced.empty()) {
+            size_t memory = 0;
+            for (const std::unique_ptr<LayerEntries> &entries : shard->replaced)
+                memory += layer_entries_memory(*entries);
+            shard->replaced.clear();
+            shard->replaced.shrink_to_fit();
+            shard->memory -= memory;
+            m_memory      -= memory;
+        }
 }
 
 // For debugging purposes, sorted by layer index, then by radius.
 std::vector<std::pair<TreeModelVolumes::RadiusLayerPair, std::reference_wrapper<const Polygons>>> TreeModelVolumes::RadiusLayerPolygonCache::sorted() const
 {
     std::vector<std::pair<RadiusLayerPair, std::reference_wrapper<const Polygons>>> out;
-    for (auto &layer : m_data) {
-        auto layer_idx = LayerIndex(&layer - m_data.data());
-        for (auto &radius_polygons : layer)
-            out.emplace_back(std::make_pair(radius_polygons.first, layer_idx), radius_polygons.second);
-    }
+    for (LayerIndex layer_idx = 0; layer_idx < LayerIndex(m_num_layers.load()); ++ layer_idx)
+        if (const LayerEntries *layer = this->layer_entries(layer_idx); layer)
+            for (auto &radius_polygons : *layer)
+                out.emplace_back(std::make_pair(radius_polygons.first, layer_idx), *radius_polygons.second);
     assert(std::is_sorted(out.begin(), out.end(), [](auto &l, auto &r){ return l.first.second < r.first.second || (l.first.second == r.first.second) && l.first.first < r.first.first; }));
     return out;
 }
@@ -9,6 +9,12 @@
 #ifndef slic3r_TreeModelVolumes_hpp
 #define slic3r_TreeModelVolumes_hpp
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 
@@ -70,6 +76,36 @@ public:
         m_wall_restrictions_cache_min.clear();
     }
 
+    // Approximate memory occupied by the avoidance, holefree collision and wall restriction caches in bytes.
+    // These are only needed until the influence areas are propagated down to the bed.
+    size_t pathing_cache_memory_used() const;
+    // Called by the propagation of the influence areas after it finished layer_idx, thus the layers above layer_idx are not needed anymore:
+    // With the avoidances kept by windows, release the layers of the caches needed for propagation above layer_idx
+    // once the caches exceed support_tree_cache_memory_limit.
+    void   release_pathing_caches_above(LayerIndex layer_idx);
+    // With the avoidances kept by windows, release the windows of layers calculated on demand while placing the tips
+    // once the caches exceed support_tree_cache_memory_limit, keeping just the first layer of each window for the propagation to continue from.
+    void   release_pathing_windows();
+    // Whether precalculate() decided to keep the avoidances by windows, as they would not fit into support_tree_cache_memory_limit.
+    bool   pathing_windows() const { return m_pathing_windows; }
+    // Memory of the caches needed for propagation of the influence areas as estimated by precalculate(), which pathing_windows() is decided by.
+    size_t pathing_cache_memory_estimate() const { return m_pathing_cache_memory_estimate; }
+    // Release the caches needed for propagation of the influence areas only.
+    void   release_pathing_caches();
+    // Release the per layer entries of all caches replaced by insertion. Not to be called concurrently with any cache lookup,
+    // thus it is called once a parallel calculation finished.
+    void   release_replaced_cache_entries();
+
+    // Total time the threads spent waiting for the locks of the caches, to monitor contention.
+    std::chrono::nanoseconds cache_lock_wait_time() const {
+        std::chrono::nanoseconds out { 0 };
+        for (const RadiusLayerPolygonCache *cache : { &m_collision_cache, &m_collision_cache_holefree, &m_avoidance_cache, &m_avoidance_cache_slow,
+                &m_avoidance_cache_to_model, &m_avoidance_cache_to_model_slow, &m_placeable_areas_cache, &m_avoidance_cache_holefree,
+                &m_avoidance_cache_holefree_to_model, &m_wall_restrictions_cache, &m_wall_restrictions_cache_min })
+            out += cache->lock_wait_time();
+        return out;
+    }
+
     enum class AvoidanceType : int8_t
     {
         Slow,
@@ -195,43 +231,74 @@ private:
      * \brief Convenience typedef for the keys to the caches
      */
     using RadiusLayerPair             = std::pair<coord_t, LayerIndex>;
+
+    // If the avoidances would not fit into the memory limit, they are kept just for the first layer of each window of pathing_window_layers,
+    // the other layers are calculated on demand for the whole window, see getAvoidance().
+    static constexpr const LayerIndex pathing_window_layers = 16;
+    static LayerIndex                 pathing_window_begin(LayerIndex layer_idx) { return layer_idx - layer_idx % pathing_window_layers; }
+
     class RadiusLayerPolygonCache {
-        // Map from radius to Polygons. Cache of one layer collision regions.
-        using LayerData = std::map<coord_t, Polygons>;
-        // Vector of layers, at each layer map of radius to Polygons.
-        // Reference to Polygons returned shall be stable to insertion.
-        using Layers = std::vector<LayerData>;
+        // Polygons of a layer sorted by radius. Once published, a vector of entries is never modified,
+        // a new vector is published when entries are inserted.
+        using LayerEntries   = std::vector<std::pair<coord_t, Polygons*>>;
+        using RadiusPolygons = std::pair<coord_t, Polygons>;
+        struct LayerData {
+            std::atomic<const LayerEntries*> entries { nullptr };
+            // Owner of the published entries, accessed with the shard mutex locked only.
+            std::unique_ptr<LayerEntries>    storage;
+        };
+        // The layers are sharded by layer index. Lookups are lock free, only insertion into a shard locks its mutex.
+        // A shard holds a window of layers, so that the windows are released as a whole.
+        static constexpr const size_t layers_per_shard = size_t(pathing_window_layers);
+        static constexpr const size_t max_shards       = 16384;
+        struct Shard {
+            std::array<LayerData, layers_per_shard>    layers;
+            // Storage of the Polygons, stable to insertion.
+            std::deque<Polygons>                       polygons;
+            // LayerEntries replaced by insertion. Lookups running concurrently may still read them,
+            // thus they are released by release_replaced() once no lookup may be running.
+            std::vector<std::unique_ptr<LayerEntries>> replaced;
+            // Memory occupied by polygons and by the LayerEntries including the replaced ones.
+            size_t                                     memory { 0 };
+            std::mutex                                 mutex;
+        };
     public:
-        RadiusLayerPolygonCache() = default;
-        RadiusLayerPolygonCache(RadiusLayerPolygonCache &&rhs) : m_data(std::move(rhs.m_data)) {}
-        RadiusLayerPolygonCache& operator=(RadiusLayerPolygonCache &&rhs) { m_data = std::move(rhs.m_data); return *this; }
+        RadiusLayerPolygonCache() : m_shards(std::make_unique<std::atomic<Shard*>[]>(max_shards)) {}
+        ~RadiusLayerPolygonCache() { this->clear(); }
+        // The moved-from cache is left without a shard table, it may only be looked up, cleared, assigned to or destroyed.
+        RadiusLayerPolygonCache(RadiusLayerPolygonCache &&rhs) :
+            m_shards(std::move(rhs.m_shards)), m_num_layers(rhs.m_num_layers.exchange(0)), m_memory(rhs.m_memory.exchange(0)), m_lock_wait_ns(rhs.m_lock_wait_ns.load()) {}
+        RadiusLayerPolygonCache& operator=(RadiusLayerPolygonCache &&rhs) { 
+            this->clear();
+            std::swap(m_shards, rhs.m_shards);
+            m_num_layers   = rhs.m_num_layers.exchange(0);
+            m_memory       = rhs.m_memory.exchange(0);
+            m_lock_wait_ns = rhs.m_lock_wait_ns.load();
+            return *this;
+        }
 
         RadiusLayerPolygonCache(const RadiusLayerPolygonCache&) = delete;
         RadiusLayerPolygonCache& operator=(const RadiusLayerPolygonCache&) = delete;
 
-        void insert(std::vector<std::pair<RadiusLayerPair, Polygons>> &&in) {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            for (auto &d : in)
-                this->get_allocate_layer_data(d.first.second).emplace(d.first.first, std::move(d.second));
-        }
+        // Areas already cached for a (radius, layer) pair are not replaced.
+        // All the radii of a layer are published at once.
+        void insert(std::vector<std::pair<RadiusLayerPair, Polygons>> &&in);
         // by layer
         void insert(std::vector<std::pair<coord_t, Polygons>> &&in, coord_t radius) {
-            std::lock_guard<std::mutex> guard(m_mutex);
+            ShardLock lock(*this);
             for (auto &d : in)
-                this->get_allocate_layer_data(d.first).emplace(radius, std::move(d.second));
+                this->insert(lock, d.first, radius, std::move(d.second));
         }
         void insert(std::vector<Polygons> &&in, coord_t first_layer_idx, coord_t radius) {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            allocate_layers(first_layer_idx + in.size());
+            ShardLock lock(*this);
             for (auto &d : in)
-                m_data[first_layer_idx ++].emplace(radius, std::move(d));
+                this->insert(lock, first_layer_idx ++, radius, std::move(d));
         }
         void insert(LayerPolygonCache &&in, coord_t radius) {
-            std::lock_guard<std::mutex> guard(m_mutex);
+            ShardLock lock(*this);
             LayerIndex i = in.begin();
-            allocate_layers(i + LayerIndex(in.size()));
             for (auto &d : in.polygons_mutable())
-                m_data[i ++].emplace(radius, std::move(d));
+                this->insert(lock, i ++, radius, std::move(d));
         }
         /*!
          * \brief Checks a cache for a given RadiusLayerPair and returns it if it is found
@@ -239,43 +306,41 @@ private:
          * \return A wrapped optional reference of the requested area (if it was found, an empty optional if nothing was found)
          */
         std::optional<std::reference_wrapper<const Polygons>> getArea(const TreeModelVolumes::RadiusLayerPair &key) const {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            if (key.second >= LayerIndex(m_data.size()))
+            const LayerEntries *layer = this->layer_entries(key.second);
+            if (layer == nullptr)
                 return std::optional<std::reference_wrapper<const Polygons>>{};
-            const auto &layer = m_data[key.second];
-            auto it = layer.find(key.first);
-            return it == layer.end() ? 
-                std::optional<std::reference_wrapper<const Polygons>>{} : std::optional<std::reference_wrapper<const Polygons>>{ it->second };
+            auto it = lower_bound_radius(*layer, key.first);
+            return it == layer->end() || it->first != key.first ?
+                std::optional<std::reference_wrapper<const Polygons>>{} : std::optional<std::reference_wrapper<const Polygons>>{ *it->second };
         }
         // Get a collision area at a given layer for a radius that is a lower or equial to the key radius.
         std::optional<std::pair<coord_t, std::reference_wrapper<const Polygons>>> get_lower_bound_area(const TreeModelVolumes::RadiusLayerPair &key) const {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            if (key.second >= LayerIndex(m_data.size()))
-                return {};
-            const auto &layer = m_data[key.second];
-            if (layer.empty())
+            const LayerEntries *layer = this->layer_entries(key.second);
+            if (layer == nullptr || layer->empty())
                 return {};
-            auto it = layer.lower_bound(key.first);
-            if (it == layer.end() || it->first != key.first) {
-                if (it == layer.begin())
+            auto it = lower_bound_radius(*layer, key.first);
+            if (it == layer->end() || it->first != key.first) {
+                if (it == layer->begin())
                     return {};
                 -- it;
             }
-            return std::make_pair(it->first, std::reference_wrapper<const Polygons>(it->second));
+            return std::make_pair(it->first, std::reference_wrapper<const Polygons>(*it->second));
         }
         /*!
          * \brief Get the highest already calculated layer in the cache.
          * \param radius The radius for which the highest already calculated layer has to be found.
-         * \param map The cache in which the lookup is performed.
+         * \param max_layer_idx The highest layer to consider. With the avoidances kept by windows, the cached layers are not a contiguous range.
          *
          * \return A wrapped optional reference of the requested area (if it was found, an empty optional if nothing was found)
          */
-        LayerIndex getMaxCalculatedLayer(coord_t radius) const {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            auto layer_idx = LayerIndex(m_data.size()) - 1;
+        LayerIndex getMaxCalculatedLayer(coord_t radius, LayerIndex max_layer_idx = std::numeric_limits<LayerIndex>::max()) const {
+            auto layer_idx = std::min(LayerIndex(m_num_layers.load(std::memory_order_acquire)) - 1, max_layer_idx);
             for (; layer_idx > 0; -- layer_idx)
-                if (const auto &layer = m_data[layer_idx]; layer.find(radius) != layer.end())
-                    break;
+                if (const LayerEntries *layer = this->layer_entries(layer_idx); layer) {
+                    auto it = lower_bound_radius(*layer, radius);
+                    if (it != layer->end() && it->first == radius)
+                        break;
+                }
             // The placeable on model areas do not exist on layer 0, as there can not be model below it. As such it may be possible that layer 1 is available, but layer 0 does not exist.
             return layer_idx == 0 ? -1 : layer_idx;
         }
@@ -283,25 +348,59 @@ private:
         // For debugging purposes, sorted by layer index, then by radius.
         [[nodiscard]] std::vector<std::pair<RadiusLayerPair, std::reference_wrapper<const Polygons>>> sorted() const;
 
-        void clear() { m_data.clear(); }
-        void clear_all_but_radius0() { 
-            for (LayerData &l : m_data) {
-                auto begin = l.begin();
-                auto end = l.end();
-                if (begin != end && ++ begin != end)
-                    l.erase(begin, end);
-            }
-        }
+        // Total time the insertions spent waiting for the shard locks held by other threads.
+        std::chrono::nanoseconds lock_wait_time() const { return std::chrono::nanoseconds(m_lock_wait_ns.load(std::memory_order_relaxed)); }
+
+        // Approximate memory occupied by the cached areas in bytes.
+        size_t memory_used() const { return m_memory.load(std::memory_order_relaxed); }
+
+        // Neither clear(), clear_all_but_radius0(), release_layers_above(), release_all_but_first_layer_of_shards() nor release_replaced()
+        // shall be called concurrently with any other method.
+        void clear();
+        void clear_all_but_radius0();
+        // Release the LayerEntries replaced by insertion.
+        void release_replaced();
+        // Release the areas of the shards starting above layer_idx. The calculations continuing from getMaxCalculatedLayer()
+        // recalculate the released layers if they are requested again.
+        void release_layers_above(LayerIndex layer_idx);
+        // Keep just the areas of the first layer of each shard.
+        void release_all_but_first_layer_of_shards();
 
     private:
-        LayerData&          get_allocate_layer_data(LayerIndex layer_idx) {
-            allocate_layers(layer_idx + 1);
-            return m_data[layer_idx];
+        // Holds the lock of the shard of the last inserted layer, so that consecutive layers are inserted with a single lock.
+        class ShardLock {
+        public:
+            ShardLock(RadiusLayerPolygonCache &cache) : m_cache(cache) {}
+            Shard& lock(size_t shard_idx);
+        private:
+            RadiusLayerPolygonCache      &m_cache;
+            size_t                        m_shard_idx { max_shards };
+            std::unique_lock<std::mutex>  m_lock;
+        };
+
+        static LayerEntries::const_iterator lower_bound_radius(const LayerEntries &layer, coord_t radius) {
+            return std::lower_bound(layer.begin(), layer.end(), radius, [](const auto &l, coord_t r) { return l.first < r; });
         }
-        void                allocate_layers(size_t num_layers);
-
-        Layers              m_data;
-        mutable std::mutex  m_mutex;
+        // Number of the shard slots, zero for a moved-from cache.
+        size_t              num_shards() const { return m_shards ? max_shards : 0; }
+        const LayerEntries* layer_entries(LayerIndex layer_idx) const {
+            if (layer_idx < 0 || size_t(layer_idx) >= layers_per_shard * this->num_shards())
+                return nullptr;
+            const Shard *shard = m_shards[size_t(layer_idx) / layers_per_shard].load(std::memory_order_acquire);
+            return shard ? shard->layers[size_t(layer_idx) % layers_per_shard].entries.load(std::memory_order_acquire) : nullptr;
+        }
+        void                insert(ShardLock &lock, LayerIndex layer_idx, coord_t radius, Polygons &&polygons) {
+            RadiusPolygons radius_polygons { radius, std::move(polygons) };
+            this->insert(lock, layer_idx, &radius_polygons, &radius_polygons + 1);
+        }
+        // Publish areas of a single layer, [begin, end) sorted by radius.
+        void                insert(ShardLock &lock, LayerIndex layer_idx, RadiusPolygons *begin, RadiusPolygons *end);
+
+        std::unique_ptr<std::atomic<Shard*>[]> m_shards;
+        // One more than the highest layer index inserted.
+        std::atomic<size_t>                    m_num_layers { 0 };
+        std::atomic<size_t>                    m_memory { 0 };
+        std::atomic<int64_t>                   m_lock_wait_ns { 0 };
     };
 
 
@@ -318,6 +417,8 @@ private:
      * \return Polygons object
      */
     const Polygons& getCollisionHolefree(coord_t radius, LayerIndex layer_idx) const;
+    // Calculate the collision without holes of a single layer without caching it.
+    Polygons calculateCollisionHolefreeLayer(coord_t radius, LayerIndex layer_idx) const;
 
     /*!
      * \brief Round \p radius upwards to either a multiple of m_radius_sample_resolution or a exponentially increasing value
@@ -428,6 +529,18 @@ private:
     coord_t m_min_resolution;
 
     bool m_precalculated = false;
+    /*!
+     * \brief Memory limit of the caches needed for propagation of the influence areas in bytes, zero for no limit.
+     */
+    size_t m_pathing_cache_memory_limit = 0;
+    /*!
+     * \brief Whether the avoidances are kept by windows of pathing_window_layers, set by precalculate() if the estimated caches exceed the memory limit.
+     */
+    bool m_pathing_windows = false;
+    /*!
+     * \brief Estimated memory of the caches needed for propagation of the influence areas in bytes, set by precalculate().
+     */
+    size_t m_pathing_cache_memory_estimate = 0;
     /*!
      * \brief The index to access the outline corresponding with the currently processing mesh
      */
@@ -543,6 +656,18 @@ private:
     // restriction would be slower.    
     RadiusLayerPolygonCache     m_wall_restrictions_cache_min;
 
+    // Caches calculated on demand by windows. A single calculation fills all the caches of a group.
+    enum class PathingWindowCache : unsigned char {
+        AvoidanceToBuildPlate,
+        AvoidanceToModel,
+        WallRestrictions,
+    };
+    // Held while calculating a window of layers on demand, striped by the cache, radius and window,
+    // so that the calculations of different windows do not wait for each other.
+    static constexpr const size_t  pathing_window_mutex_stripes = 64;
+    std::mutex&                    pathing_window_mutex(PathingWindowCache cache, coord_t radius, LayerIndex layer_idx) const;
+    std::unique_ptr<std::mutex[]>  m_pathing_window_mutexes { std::make_unique<std::mutex[]>(pathing_window_mutex_stripes) };
+
 #ifdef SLIC3R_TREESUPPORTS_PROGRESS
     std::unique_ptr<std::mutex> m_critical_progress { std::make_unique<std::mutex>() };
 #endif // SLIC3R_TREESUPPORTS_PROGRESS
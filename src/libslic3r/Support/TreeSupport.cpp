@@ -21,6 +21,7 @@
 #include "../MultiPoint.hpp"
 #include "../Polygon.hpp"
 #include "../Polyline.hpp"
+#include "../Trace.hpp"
 #include "../MutablePolygon.hpp"
 
 #include <cassert>
@@ -191,6 +192,7 @@ static std::vector<std::pair<TreeSupportSettings, std::vector<size_t>>> group_me
 
 [[nodiscard]] static const std::vector<Polygons> generate_overhangs(const TreeSupportSettings &settings, const PrintObject &print_object, std::function<void()> throw_on_cancel)
 {
+    SLIC3R_TRACE_SCOPE("TreeSupport", "generate_overhangs");
     const size_t num_raft_layers   = settings.raft_layers.size();
     const size_t num_object_layers = print_object.layer_count();
     const size_t num_layers        = num_object_layers + num_raft_layers;
@@ -1215,6 +1217,7 @@ static void generate_initial_areas(
     InterfacePlacer                 &interface_placer,
     std::function<void()>            throw_on_cancel)
 {
+    SLIC3R_TRACE_SCOPE("TreeSupport", "generate_initial_areas");
     using                           AvoidanceType = TreeModelVolumes::AvoidanceType;
     TreeSupportMeshGroupSettings    mesh_group_settings(print_object);
 
@@ -2402,8 +2405,9 @@ static void merge_influence_areas(
  *
  * \param move_bounds[in,out] All currently existing influence areas
  */
-static void create_layer_pathing(const TreeModelVolumes &volumes, const TreeSupportSettings &config, std::vector<SupportElements> &move_bounds, std::function<void()> throw_on_cancel)
+static void create_layer_pathing(TreeModelVolumes &volumes, const TreeSupportSettings &config, std::vector<SupportElements> &move_bounds, std::function<void()> throw_on_cancel)
 {
+    SLIC3R_TRACE_SCOPE("TreeSupport", "create_layer_pathing");
 #ifdef SLIC3R_TREESUPPORTS_PROGRESS
     const double data_size_inverse = 1 / double(move_bounds.size());
     double progress_total = TREE_PROGRESS_PRECALC_AVO + TREE_PROGRESS_PRECALC_COLL + TREE_PROGRESS_GENERATE_NODES;
@@ -2489,6 +2493,9 @@ static void create_layer_pathing(const TreeModelVolumes &volumes, const TreeSupp
                     this_layer.emplace_back(elem.state, std::move(elem.parents), std::move(new_area));
                 }
 
+            // The layers above layer_idx - 1 will not be visited anymore.
+            volumes.release_pathing_caches_above(layer_idx - 1);
+
     #ifdef SLIC3R_TREESUPPORTS_PROGRESS
             progress_total += data_size_inverse * TREE_PROGRESS_AREA_CALC;
             Progress::messageProgress(Progress::Stage::SUPPORT, progress_total * m_progress_multiplier + m_progress_offset, TREE_PROGRESS_TOTAL);
@@ -2650,6 +2657,7 @@ static void create_nodes_from_area(
     std::vector<SupportElements> &move_bounds,
     std::function<void()>         throw_on_cancel)
 {
+    SLIC3R_TRACE_SCOPE("TreeSupport", "create_nodes_from_area");
     // Initialize points on layer 0, with a "random" point in the influence area. 
     // Point is chosen based on an inaccurate estimate where the branches will split into two, but every point inside the influence area would produce a valid result.
     {
@@ -3248,6 +3256,7 @@ static void draw_areas(
     SupportGeneratorLayerStorage    &layer_storage,
     std::function<void()>            throw_on_cancel)
 {
+    SLIC3R_TRACE_SCOPE("TreeSupport", "draw_areas");
     std::vector<Polygons> support_layer_storage(move_bounds.size());
     std::vector<Polygons> support_roof_storage(move_bounds.size());
     // All SupportElements are put into a layer independent storage to improve parallelization.
@@ -3500,6 +3509,8 @@ static void generate_support_areas(Print &print, const BuildVolume &build_volume
             for (size_t mesh_idx : processing.second)
                 generate_initial_areas(*print.get_object(mesh_idx), volumes, config, overhangs, 
                     move_bounds, interface_placer, throw_on_cancel);
+            // The tips requested the avoidances of their layers, keep just what the propagation continues from.
+            volumes.release_pathing_windows();
             auto t_gen = std::chrono::high_resolution_clock::now();
 
     #ifdef TREESUPPORT_DEBUG_SVG
@@ -3517,6 +3528,8 @@ static void generate_support_areas(Print &print, const BuildVolume &build_volume
 
             // ### Propagate the influence areas downwards. This is an inherently serial operation.
             create_layer_pathing(volumes, config, move_bounds, throw_on_cancel);
+            // Only the collision and placeable areas are needed from now on.
+            volumes.release_pathing_caches();
             auto t_path = std::chrono::high_resolution_clock::now();
 
             // ### Set a point in each influence area
@@ -3554,7 +3567,8 @@ static void generate_support_areas(Print &print, const BuildVolume &build_volume
                 "Creating inital influence areas: " << dur_gen << " ms "
                 "Influence area creation: " << dur_path << "ms "
                 "Placement of Points in InfluenceAreas: " << dur_place << "ms "
-                "Drawing result as support " << dur_draw << " ms";
+                "Drawing result as support " << dur_draw << " ms "
+                "Waiting for the cache locks " << 1e-6 * double(volumes.cache_lock_wait_time().count()) << " ms";
     //        if (config.branch_radius==2121)
     //            BOOST_LOG_TRIVIAL(error) << "Why ask questions when you already know the answer twice.\n (This is not a real bug, please dont report it.)";
             
@@ -3617,6 +3631,7 @@ static void generate_support_areas(Print &print, const BuildVolume &build_volume
 
 void fff_tree_support_generate(PrintObject &print_object, std::function<void()> throw_on_cancel)
 {
+    SLIC3R_TRACE_SCOPE("TreeSupport", "fff_tree_support_generate");
     size_t idx = 0;
     for (const PrintObject *po : print_object.print()->objects()) {
         if (po == &print_object)
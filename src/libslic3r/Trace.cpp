@@ -0,0 +1,154 @@
+#include "Trace.hpp"
+#include "Thread.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/nowide/cstdio.hpp>
+
+namespace Slic3r::Trace {
+
+namespace detail {
+    std::atomic<bool> enabled { false };
+}
+
+namespace {
+
+struct Event
+{
+    const char *category;
+    const char *name;
+    int64_t     begin_ns;
+    int64_t     end_ns;
+};
+
+// Events are stored in fixed size blocks chained into a list, so that the recording thread never moves
+// the events already written and it never needs to synchronize with other recording threads.
+struct EventBlock
+{
+    static constexpr const size_t   capacity = 4096;
+    std::array<Event, capacity>     events;
+    std::atomic<size_t>             size { 0 };
+    std::atomic<EventBlock*>        next { nullptr };
+};
+
+struct ThreadBuffer
+{
+    ThreadBuffer(int tid, std::string name) : tid(tid), name(std::move(name)) {}
+    ~ThreadBuffer() { this->clear(); }
+
+    // Called by the owning thread only.
+    void push(const Event &event) {
+        size_t n = last->size.load(std::memory_order_relaxed);
+        if (n == EventBlock::capacity) {
+            auto *block = new EventBlock;
+            last->next.store(block, std::memory_order_release);
+            last = block;
+            n    = 0;
+        }
+        last->events[n] = event;
+        last->size.store(n + 1, std::memory_order_release);
+    }
+
+    // Called while no event is being recorded.
+    void clear() {
+        for (EventBlock *block = first.next.exchange(nullptr); block;) {
+            EventBlock *next = block->next.load();
+            delete block;
+            block = next;
+        }
+        first.size = 0;
+        last       = &first;
+    }
+
+    const int          tid;
+    const std::string  name;
+    EventBlock         first;
+    EventBlock        *last { &first };
+};
+
+// Buffers of all threads that ever recorded an event. The buffers are only released at exit,
+// as the TBB worker threads live until then anyway.
+std::mutex                                  buffers_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>>  buffers;
+int64_t                                     start_ns = 0;
+
+ThreadBuffer& thread_buffer()
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        int tid = int(buffers.size()) + 1;
+        buffers.emplace_back(std::make_unique<ThreadBuffer>(tid, get_current_thread_name().value_or("thread " + std::to_string(tid))));
+        buffer = buffers.back().get();
+    }
+    return *buffer;
+}
+
+std::string json_escape(const std::string &s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20)
+            out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+void detail::record(const char *category, const char *name, int64_t begin_ns, int64_t end_ns)
+{
+    thread_buffer().push({ category, name, begin_ns, end_ns });
+}
+
+void start()
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        for (std::unique_ptr<ThreadBuffer> &buffer : buffers)
+            buffer->clear();
+        start_ns = now_ns();
+    }
+    detail::enabled.store(true, std::memory_order_release);
+}
+
+void stop()
+{
+    detail::enabled.store(false, std::memory_order_release);
+}
+
+bool save(const std::string &path)
+{
+    FILE *file = boost::nowide::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first_event = true;
+    auto separator = [&first_event]() { const char *s = first_event ? "" : ",\n"; first_event = false; return s; };
+    for (const std::unique_ptr<ThreadBuffer> &buffer : buffers) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            separator(), buffer->tid, json_escape(buffer->name).c_str());
+        for (const EventBlock *block = &buffer->first; block; block = block->next.load(std::memory_order_acquire)) {
+            size_t size = block->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < size; ++ i) {
+                const Event &event = block->events[i];
+                // Complete events, time stamps in microseconds.
+                fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    separator(), event.name, event.category, buffer->tid, double(event.begin_ns - start_ns) * 0.001, double(event.end_ns - event.begin_ns) * 0.001);
+            }
+        }
+    }
+    fprintf(file, "\n]}\n");
+    bool ok = ! ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+} // namespace Slic3r::Trace
@@ -0,0 +1,59 @@
+#ifndef libslic3r_Trace_hpp_
+#define libslic3r_Trace_hpp_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Slic3r {
+
+// Scoped tracing of the slicing pipeline to find out where the worker threads wait.
+// Events are recorded into per thread buffers without locking and saved in the Chrome trace event format,
+// which could be opened by chrome://tracing or https://ui.perfetto.dev.
+// Recording is off by default, then a traced scope costs a single relaxed atomic load.
+namespace Trace {
+
+namespace detail {
+    extern std::atomic<bool> enabled;
+    void record(const char *category, const char *name, int64_t begin_ns, int64_t end_ns);
+}
+
+inline bool    enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+inline int64_t now_ns() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+// Clear the events recorded so far and start recording.
+// Neither start() nor save() shall be called while a traced scope is active on another thread.
+void start();
+// Stop recording, the events recorded are kept.
+void stop();
+// Save the events recorded into a Chrome trace JSON file. Returns false if the file could not be written.
+bool save(const std::string &path);
+
+// Records the life time of this object as a single event on the current thread.
+// The category and name are not copied, thus they shall be string literals.
+class Scope
+{
+public:
+    Scope(const char *category, const char *name) : m_category(category), m_name(name), m_begin(enabled() ? now_ns() : -1) {}
+    ~Scope() { if (m_begin >= 0) detail::record(m_category, m_name, m_begin, now_ns()); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char *m_category;
+    const char *m_name;
+    int64_t     m_begin;
+};
+
+} // namespace Trace
+
+#define SLIC3R_TRACE_CONCAT_IMPL(a, b) a##b
+#define SLIC3R_TRACE_CONCAT(a, b) SLIC3R_TRACE_CONCAT_IMPL(a, b)
+// Traces the rest of the enclosing block.
+#define SLIC3R_TRACE_SCOPE(category, name) ::Slic3r::Trace::Scope SLIC3R_TRACE_CONCAT(slic3r_trace_scope_, __LINE__)(category, name)
+
+} // namespace Slic3r
+
+#endif // libslic3r_Trace_hpp_
@@ -15,18 +15,27 @@
 #include <libqhullcpp/QhullVertexSet.h>
 
 #include <cmath>
+#include <cstring>
 #include <deque>
+#include <limits>
+#include <numeric>
 #include <queue>
 #include <vector>
 #include <utility>
 #include <algorithm>
+#include <atomic>
 #include <type_traits>
 
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/nowide/convert.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/cstdio.hpp>
 #include <boost/predef/other/endian.h>
 
 #include <tbb/concurrent_vector.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
@@ -179,10 +188,78 @@ static void trianglemesh_repair_on_import(stl_file &stl)
     BOOST_LOG_TRIVIAL(debug) << "TriangleMesh::repair() finished";
 }
 
+// Signed volumes of the disconnected patches of a mesh, as many as its_number_of_patches(its, face_neighbors).
+static std::vector<float> its_patches_volumes(const indexed_triangle_set &its, const std::vector<Vec3i> &face_neighbors)
+{
+    meshsplit_detail::NeighborVisitor visitor(its, face_neighbors);
+    std::vector<float> volumes;
+    for (;;) {
+        bool  has_some = false;
+        Vec3f p0;
+        float volume   = 0.f;
+        // Traverse the next patch fully, the volume is calculated the same way as by its_volume() relative to a point of the patch.
+        visitor.visit([&its, &has_some, &p0, &volume](size_t idx) {
+            const its_triangle triangle = its_triangle_vertices(its, idx);
+            if (! has_some) {
+                p0       = triangle[0];
+                has_some = true;
+            }
+            const Vec3f C = (triangle[1] - triangle[0]).cross(triangle[2] - triangle[0]);
+            volume += (0.5f * C.norm() * C.normalized().dot(triangle[0] - p0)) / 3.0f;
+            return true;
+        });
+        if (! has_some)
+            break;
+        volumes.emplace_back(volume);
+    }
+    return volumes;
+}
+
 bool TriangleMesh::ReadSTLFile(const char* input_file, bool repair)
 { 
+    // Binary STLs are loaded into the indexed triangle set straight from the memory mapped file.
+    indexed_triangle_set its;
+    const bool           its_loaded = repair && its_read_stl_binary(input_file, its) && ! its.empty();
+    if (its_loaded && its_num_degenerate_faces(its) == 0) {
+        // If all the parts of the mesh are closed, consistently oriented with positive volume and without degenerate faces,
+        // then the admesh repair would not modify them, thus the intermediate stl_file is skipped.
+        const std::vector<Vec3i> face_neighbors = its_face_neighbors_par(its);
+        if (its_num_open_edges(face_neighbors) == 0) {
+            const std::vector<float> volumes = its_patches_volumes(its, face_neighbors);
+            if (std::all_of(volumes.begin(), volumes.end(), [](float volume) { return volume > 0.f; })) {
+                this->its                       = std::move(its);
+                m_stats.clear();
+                m_stats.number_of_facets        = this->its.indices.size();
+                m_stats.volume                  = std::accumulate(volumes.begin(), volumes.end(), 0.f);
+                m_stats.number_of_parts         = volumes.size();
+                m_stats.open_edges              = 0;
+                update_bounding_box(this->its, m_stats);
+                return true;
+            }
+        }
+    }
+
     stl_file stl;
-    if (! stl_open(&stl, input_file))
+    if (its_loaded) {
+        // To be repaired by admesh: Don't read the file again, build the stl_file from the faces already loaded.
+        // The normals stored in the file were dropped by its_read_stl_binary(), they are recalculated from the vertices.
+        stl.stats.type                = binary;
+        stl.stats.number_of_facets    = uint32_t(its.indices.size());
+        stl.stats.original_num_facets = int(stl.stats.number_of_facets);
+        stl_allocate(&stl);
+        bool first = true;
+        for (size_t i = 0; i < its.indices.size(); ++ i) {
+            stl_facet &facet = stl.facet_start[i];
+            for (int j = 0; j < 3; ++ j)
+                facet.vertex[j] = its.vertices[its.indices[i][j]];
+            stl_calculate_normal(facet.normal, &facet);
+            stl_normalize_vector(facet.normal);
+            stl_facet_stats(&stl, facet, first);
+        }
+        stl.stats.size              = stl.stats.max - stl.stats.min;
+        stl.stats.bounding_diameter = stl.stats.size.norm();
+        its.clear();
+    } else if (! stl_open(&stl, input_file))
         return false;
     if (repair)
         trianglemesh_repair_on_import(stl);
@@ -1548,6 +1625,136 @@ static inline void big_endian_reverse_quads(char *buf, size_t cnt)
 }
 #endif // BOOST_ENDIAN_LITTLE_BYTE
 
+MappedBinarySTL::MappedBinarySTL() = default;
+MappedBinarySTL::~MappedBinarySTL() = default;
+
+bool MappedBinarySTL::open(const char *file)
+{
+    this->close();
+#if BOOST_ENDIAN_BIG_BYTE
+    // Keep the admesh loader for big endian machines, it byte swaps the facets.
+    return false;
+#else // BOOST_ENDIAN_BIG_BYTE
+    m_mapping = std::make_unique<boost::iostreams::mapped_file_source>();
+    try {
+        // The path is UTF-8 encoded, Windows needs a wide path to open files with non-ASCII names.
+#ifdef _WIN32
+        const boost::filesystem::path path(boost::nowide::widen(file));
+#else
+        const boost::filesystem::path path(file);
+#endif
+        if (boost::filesystem::file_size(path) < STL_MIN_FILE_SIZE)
+            return false;
+        m_mapping->open(path);
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(error) << "MappedBinarySTL: Couldn't map " << file << ": " << ex.what();
+        return false;
+    }
+    if (! m_mapping->is_open())
+        return false;
+
+    // Same file type detection as stl_open(): A binary STL has a non-ASCII character right after the header
+    // and its size is given by the number of facets.
+    const size_t  file_size = m_mapping->size();
+    const auto   *data      = reinterpret_cast<const unsigned char*>(m_mapping->data());
+    if (file_size < STL_MIN_FILE_SIZE || (file_size - HEADER_SIZE) % SIZEOF_STL_FACET != 0 ||
+        std::none_of(data + HEADER_SIZE, data + HEADER_SIZE + 128, [](unsigned char c) { return c > 127; })) {
+        this->close();
+        return false;
+    }
+    m_facets     = data + HEADER_SIZE;
+    m_num_facets = (file_size - HEADER_SIZE) / SIZEOF_STL_FACET;
+    return true;
+#endif // BOOST_ENDIAN_BIG_BYTE
+}
+
+void MappedBinarySTL::close()
+{
+    m_mapping.reset();
+    m_facets     = nullptr;
+    m_num_facets = 0;
+}
+
+stl_vertex MappedBinarySTL::vertex(size_t facet_idx, size_t i) const
+{
+    assert(facet_idx < m_num_facets && i < 3);
+    stl_vertex v;
+    // Skip the normal, the facet is not aligned.
+    memcpy(v.data(), m_facets + facet_idx * SIZEOF_STL_FACET + (i + 1) * 3 * sizeof(float), 3 * sizeof(float));
+    // Switch negative zeros to positive zeros, so that they are merged the same way stl_check_facets_exact() merges them.
+    for (size_t j = 0; j < 3; ++ j)
+        if (v[j] == 0.f)
+            v[j] = 0.f;
+    return v;
+}
+
+bool its_read_stl_binary(const char *file, indexed_triangle_set &its)
+{
+    its.clear();
+
+    MappedBinarySTL stl;
+    if (! stl.open(file))
+        return false;
+    const size_t num_facets  = stl.num_facets();
+    const size_t num_corners = 3 * num_facets;
+    if (num_corners >= size_t(std::numeric_limits<int>::max()))
+        return false;
+
+    // Vertices of all the facets, the corner index is stored to make the sort stable.
+    struct Corner {
+        stl_vertex  v;
+        uint32_t    idx;
+    };
+    std::vector<Corner> corners(num_corners);
+    // A corrupted file may contain NaNs or infinities, which the sort below could not order.
+    // Such a file is left to the admesh loader.
+    std::atomic<bool>   all_finite { true };
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_facets), [&stl, &corners, &all_finite](const tbb::blocked_range<size_t> &range) {
+        for (size_t facet_idx = range.begin(); facet_idx < range.end() && all_finite.load(std::memory_order_relaxed); ++ facet_idx) {
+            for (size_t j = 0; j < 3; ++ j) {
+                Corner &c = corners[3 * facet_idx + j];
+                c.v = stl.vertex(facet_idx, j);
+                if (! c.v.allFinite())
+                    all_finite.store(false, std::memory_order_relaxed);
+                c.idx = uint32_t(3 * facet_idx + j);
+            }
+        }
+    });
+    stl.close();
+    if (! all_finite) {
+        BOOST_LOG_TRIVIAL(warning) << "its_read_stl_binary: " << file << " contains non-finite vertex coordinates";
+        return false;
+    }
+
+    // Bit identical vertices are merged by sorting the corners lexicographically.
+    tbb::parallel_sort(corners.begin(), corners.end(), [](const Corner &l, const Corner &r) {
+        return l.v.x() < r.v.x() || (l.v.x() == r.v.x() && (l.v.y() < r.v.y() || (l.v.y() == r.v.y() && (l.v.z() < r.v.z() || (l.v.z() == r.v.z() && l.idx < r.idx)))));
+    });
+
+    // Index of a group of equal vertices for each corner and the position of the group in the sorted corners.
+    std::vector<int>    corner_group(num_corners);
+    std::vector<size_t> group_begin;
+    for (size_t i = 0; i < num_corners; ++ i) {
+        if (i == 0 || corners[i].v != corners[i - 1].v)
+            group_begin.emplace_back(i);
+        corner_group[corners[i].idx] = int(group_begin.size() - 1);
+    }
+
+    // Number the vertices in the order of their first occurence in the file, as stl_generate_shared_vertices() does.
+    std::vector<int> group_vertex(group_begin.size(), -1);
+    its.vertices.reserve(group_begin.size());
+    its.indices.assign(num_facets, stl_triangle_vertex_indices(-1, -1, -1));
+    for (size_t i = 0; i < num_corners; ++ i) {
+        int &vertex_idx = group_vertex[corner_group[i]];
+        if (vertex_idx == -1) {
+            vertex_idx = int(its.vertices.size());
+            its.vertices.emplace_back(corners[group_begin[corner_group[i]]].v);
+        }
+        its.indices[i / 3][i % 3] = vertex_idx;
+    }
+    return true;
+}
+
 bool its_write_stl_ascii(const char *file, const char *label, const std::vector<stl_triangle_vertex_indices> &indices, const std::vector<stl_vertex> &vertices)
 {
     FILE *fp = boost::nowide::fopen(file, "w");
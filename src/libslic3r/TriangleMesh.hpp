@@ -4,6 +4,7 @@
 #include "libslic3r.h"
 #include <admesh/stl.h>
 #include <functional>
+#include <memory>
 #include <vector>
 #include "BoundingBox.hpp"
 #include "Line.hpp"
@@ -11,6 +12,8 @@
 #include "Polygon.hpp"
 #include "ExPolygon.hpp"
 
+namespace boost { namespace iostreams { class mapped_file_source; } }
+
 namespace Slic3r {
 
 class TriangleMesh;
@@ -332,6 +335,31 @@ inline TriangleMesh     make_cone(double r, double h, double fa=(2*PI/360))
 inline TriangleMesh     make_pyramid(float base, float height)                  { return TriangleMesh(its_make_pyramid(base, height)); }
 inline TriangleMesh     make_sphere(double rho, double fa=(2*PI/360))           { return TriangleMesh(its_make_sphere(rho, fa)); }
 
+// Binary STL file memory mapped for reading, shared by its_read_stl_binary() and write_mesh_slicing_cache_from_stl().
+class MappedBinarySTL
+{
+public:
+    MappedBinarySTL();
+    ~MappedBinarySTL();
+
+    // Returns false if the file could not be mapped or if it is not a binary STL, for example an ASCII STL.
+    // Always returns false on big endian machines.
+    bool        open(const char *file);
+    void        close();
+    size_t      num_facets() const { return m_num_facets; }
+    // i-th vertex of a facet with negative zeros switched to positive zeros, so that the bit identical vertices
+    // are the vertices stl_check_facets_exact() merges.
+    stl_vertex  vertex(size_t facet_idx, size_t i) const;
+
+private:
+    std::unique_ptr<boost::iostreams::mapped_file_source> m_mapping;
+    const unsigned char                                  *m_facets { nullptr };
+    size_t                                                m_num_facets { 0 };
+};
+
+// Load a binary STL by memory mapping it, merging bit identical vertices with a parallel sort.
+// Returns false if the file could not be mapped or if it is not a binary STL, for example an ASCII STL.
+bool        its_read_stl_binary(const char *file, indexed_triangle_set &its);
 bool        its_write_stl_ascii(const char *file, const char *label, const std::vector<stl_triangle_vertex_indices> &indices, const std::vector<stl_vertex> &vertices);
 inline bool its_write_stl_ascii(const char *file, const char *label, const indexed_triangle_set &its) { return its_write_stl_ascii(file, label, its.indices, its.vertices); }
 bool        its_write_stl_binary(const char *file, const char *label, const std::vector<stl_triangle_vertex_indices> &indices, const std::vector<stl_vertex> &vertices);
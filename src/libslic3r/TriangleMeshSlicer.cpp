@@ -1,4 +1,5 @@
 #include "ClipperUtils.hpp"
+#include "Exception.hpp"
 #include "Geometry.hpp"
 #include "Tesselate.hpp"
 #include "TriangleMesh.hpp"
@@ -7,16 +8,25 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <deque>
+#include <limits>
 #include <queue>
 #include <mutex>
 #include <new>
+#include <numeric>
 #include <utility>
 
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/log/trivial.hpp>
+#include <boost/nowide/convert.hpp>
 
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
 #include <tbb/scalable_allocator.h>
+#include <tbb/task_arena.h>
 
 #include <ankerl/unordered_dense.h>
 
@@ -436,6 +446,159 @@ static inline std::vector<IntersectionLines> slice_make_lines(
     return lines;
 }
 
+// Vertices transformed for slicing stored as a structure of arrays, so that bucketing the facets by their Z span
+// only streams the Z coordinates through the cache.
+struct SlicingVertices
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    stl_vertex operator[](size_t idx) const { return { x[idx], y[idx], z[idx] }; }
+};
+
+// SlicingVertices stored elsewhere, for example in a memory mapped file.
+struct SlicingVerticesView
+{
+    const float *x;
+    const float *y;
+    const float *z;
+
+    stl_vertex operator[](size_t idx) const { return { x[idx], y[idx], z[idx] }; }
+};
+
+template<typename TransformVertex>
+static SlicingVertices transform_vertices_for_slicing_soa(const std::vector<stl_vertex> &vertices, const TransformVertex &transform_vertex_fn)
+{
+    SlicingVertices out;
+    out.x.assign(vertices.size(), 0.f);
+    out.y.assign(vertices.size(), 0.f);
+    out.z.assign(vertices.size(), 0.f);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, vertices.size()),
+        [&vertices, &transform_vertex_fn, &out](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                const stl_vertex v = transform_vertex_fn(vertices[i]);
+                out.x[i] = v.x();
+                out.y[i] = v.y();
+                out.z[i] = v.z();
+            }
+        });
+    return out;
+}
+
+// Cache blocked variant of slice_make_lines() for many layers:
+// 1) The range of layers crossed by each facet is calculated from the Z coordinates only.
+// 2) The layers are split into bands of consecutive layers, and the facets are bucketed by the bands they cross
+//    with a parallel counting sort.
+// 3) The bands are sliced in parallel. A band owns the lines of its layers, thus no locking is needed,
+//    and a band only touches the facets crossing it. The lines of a layer are sorted by the facet index,
+//    thus the result does not depend on the thread scheduling.
+template<typename Vertices, typename ThrowOnCancel>
+static std::vector<IntersectionLines> slice_make_lines_banded(
+    // SlicingVertices or SlicingVerticesView
+    const Vertices                                  &vertices,
+    const std::vector<stl_triangle_vertex_indices>  &indices,
+    const std::vector<Vec3i>                        &face_edge_ids,
+    const std::vector<float>                        &zs,
+    const ThrowOnCancel                              throw_on_cancel_fn)
+{
+    assert(indices.size() < size_t(std::numeric_limits<uint32_t>::max()));
+    const size_t num_layers = zs.size();
+    const size_t num_faces  = indices.size();
+    std::vector<IntersectionLines> lines(num_layers, IntersectionLines{});
+    if (num_layers == 0 || num_faces == 0)
+        return lines;
+
+    const size_t threads   = size_t(std::max(1, tbb::this_task_arena::max_concurrency()));
+    // Several bands per thread to balance the load, as the facets are rarely distributed evenly along Z.
+    const size_t num_bands = std::min(num_layers, 8 * threads);
+    auto band_first_layer  = [num_layers, num_bands](size_t band) { return (band * num_layers + num_bands - 1) / num_bands; };
+    std::vector<uint32_t> band_of_layer(num_layers);
+    for (size_t band = 0; band < num_bands; ++ band)
+        std::fill(band_of_layer.begin() + band_first_layer(band), band_of_layer.begin() + band_first_layer(band + 1), uint32_t(band));
+
+    // 1) Range of layers [first, last) sliced by each facet. Horizontal facets are not sliced, their range is empty.
+    std::vector<std::pair<uint32_t, uint32_t>> face_layers(num_faces);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_faces),
+        [&vertices, &indices, &zs, &face_layers, throw_on_cancel_fn](const tbb::blocked_range<size_t> &range) {
+            throw_on_cancel_fn();
+            for (size_t face_idx = range.begin(); face_idx < range.end(); ++ face_idx) {
+                const stl_triangle_vertex_indices &face = indices[face_idx];
+                const float z0    = vertices.z[face(0)];
+                const float z1    = vertices.z[face(1)];
+                const float z2    = vertices.z[face(2)];
+                const float min_z = fminf(z0, fminf(z1, z2));
+                const float max_z = fmaxf(z0, fmaxf(z1, z2));
+                if (min_z == max_z) {
+                    face_layers[face_idx] = { 0, 0 };
+                } else {
+                    auto min_layer = std::lower_bound(zs.begin(), zs.end(), min_z);
+                    auto max_layer = std::upper_bound(min_layer, zs.end(), max_z);
+                    face_layers[face_idx] = { uint32_t(min_layer - zs.begin()), uint32_t(max_layer - zs.begin()) };
+                }
+            }
+        });
+
+    // 2) Bucket the facets by bands: Count the facets crossing each band per chunk of facets, then scatter the facet indices
+    // into a single array. A facet crossing multiple bands is stored with each of them.
+    const size_t num_chunks = std::min(num_faces, 4 * threads);
+    auto chunk_begin = [num_faces, num_chunks](size_t chunk) { return chunk * num_faces / num_chunks; };
+    std::vector<size_t> offsets(num_chunks * num_bands + 1, 0);
+    auto for_each_band = [&face_layers, &band_of_layer](size_t face_idx, auto fn) {
+        const std::pair<uint32_t, uint32_t> &range = face_layers[face_idx];
+        if (range.first < range.second)
+            for (size_t band = band_of_layer[range.first], band_last = band_of_layer[range.second - 1]; band <= band_last; ++ band)
+                fn(band);
+    };
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_chunks, 1),
+        [&offsets, &chunk_begin, &for_each_band, num_chunks](const tbb::blocked_range<size_t> &range) {
+            for (size_t chunk = range.begin(); chunk < range.end(); ++ chunk)
+                for (size_t face_idx = chunk_begin(chunk); face_idx < chunk_begin(chunk + 1); ++ face_idx)
+                    // Counts stored band major, chunk minor, so that the prefix sum orders the facets of a band by their index.
+                    for_each_band(face_idx, [&offsets, num_chunks, chunk](size_t band) { ++ offsets[band * num_chunks + chunk + 1]; });
+        }, tbb::simple_partitioner());
+    for (size_t i = 1; i < offsets.size(); ++ i)
+        offsets[i] += offsets[i - 1];
+    std::vector<uint32_t> band_faces(offsets.back());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_chunks, 1),
+        [&offsets, &band_faces, &chunk_begin, &for_each_band, num_chunks](const tbb::blocked_range<size_t> &range) {
+            for (size_t chunk = range.begin(); chunk < range.end(); ++ chunk)
+                for (size_t face_idx = chunk_begin(chunk); face_idx < chunk_begin(chunk + 1); ++ face_idx)
+                    for_each_band(face_idx, [&offsets, &band_faces, num_chunks, chunk, face_idx](size_t band) { band_faces[offsets[band * num_chunks + chunk] ++] = uint32_t(face_idx); });
+        }, tbb::simple_partitioner());
+    // Now offsets[band * num_chunks + chunk] points to the end of the chunk's facets. The facets of a band end where the next band starts.
+    throw_on_cancel_fn();
+
+    // 3) Slice the bands.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_bands, 1),
+        [&](const tbb::blocked_range<size_t> &range) {
+            for (size_t band = range.begin(); band < range.end(); ++ band) {
+                throw_on_cancel_fn();
+                const uint32_t layer_begin = uint32_t(band_first_layer(band));
+                const uint32_t layer_end   = uint32_t(band_first_layer(band + 1));
+                const size_t   begin       = band == 0 ? 0 : offsets[band * num_chunks - 1];
+                const size_t   end         = offsets[(band + 1) * num_chunks - 1];
+                for (size_t i = begin; i < end; ++ i) {
+                    const uint32_t                     face_idx = band_faces[i];
+                    const stl_triangle_vertex_indices &face     = indices[face_idx];
+                    const stl_vertex facet_vertices[3] { vertices[face(0)], vertices[face(1)], vertices[face(2)] };
+                    const float      min_z             = fminf(facet_vertices[0].z(), fminf(facet_vertices[1].z(), facet_vertices[2].z()));
+                    const int        idx_vertex_lowest = (facet_vertices[1].z() == min_z) ? 1 : ((facet_vertices[2].z() == min_z) ? 2 : 0);
+                    const uint32_t   layer_first       = std::max(face_layers[face_idx].first, layer_begin);
+                    const uint32_t   layer_last        = std::min(face_layers[face_idx].second, layer_end);
+                    for (uint32_t layer = layer_first; layer < layer_last; ++ layer) {
+                        IntersectionLine il;
+                        if (slice_facet(zs[layer], facet_vertices, face, face_edge_ids[face_idx], idx_vertex_lowest, false, il) == FacetSliceType::Slicing) {
+                            assert(il.edge_type != IntersectionLine::FacetEdgeType::Horizontal);
+                            lines[layer].emplace_back(il);
+                        }
+                    }
+                }
+            }
+        });
+    return lines;
+}
+
 template<typename TransformVertex, typename FaceFilter>
 static inline IntersectionLines slice_make_lines(
     const std::vector<stl_vertex>                   &mesh_vertices,
@@ -1796,9 +1959,15 @@ std::vector<Polygons> slice_mesh(
             }
         } else {
             // Copy and scale vertices in XY, don't scale in Z. Possibly apply the transformation.
-            lines = slice_make_lines(
-                transform_mesh_vertices_for_slicing(mesh, params.trafo), 
-                [](const Vec3f &p) { return p; },  mesh.indices, face_edge_ids, zs, throw_on_cancel);
+            SlicingVertices vertices;
+            if (is_identity(params.trafo)) {
+                static constexpr const float s = float(1. / SCALING_FACTOR);
+                vertices = transform_vertices_for_slicing_soa(mesh.vertices, [](const Vec3f &p) { return Vec3f(p.x() * s, p.y() * s, p.z()); });
+            } else {
+                Transform3f tf = make_trafo_for_slicing(params.trafo);
+                vertices = transform_vertices_for_slicing_soa(mesh.vertices, [tf](const Vec3f &p) { return tf * p; });
+            }
+            lines = slice_make_lines_banded(vertices, mesh.indices, face_edge_ids, zs, throw_on_cancel);
         }
     }
 
@@ -1842,6 +2011,24 @@ std::vector<Polygons> slice_mesh(
     return layers;
 }
 
+namespace detail {
+
+std::vector<Polygons> slice_mesh_unbanded(
+    const indexed_triangle_set       &mesh,
+    // Unscaled Zs
+    const std::vector<float>         &zs,
+    const MeshSlicingParams          &params,
+    std::function<void()>             throw_on_cancel)
+{
+    std::vector<IntersectionLines> lines = slice_make_lines(
+        transform_mesh_vertices_for_slicing(mesh, params.trafo),
+        [](const Vec3f &p) { return p; }, mesh.indices, its_face_edge_ids(mesh), zs, throw_on_cancel);
+    throw_on_cancel();
+    return make_loops(lines, params, throw_on_cancel);
+}
+
+} // namespace detail
+
 // Specialized version for a single slicing plane only, running on a single thread.
 Polygons slice_mesh(
     const indexed_triangle_set       &mesh,
@@ -1905,27 +2092,30 @@ Polygons slice_mesh(
     return layers.front();
 }
 
-std::vector<ExPolygons> slice_mesh_ex(
-    const indexed_triangle_set       &mesh,
-    const std::vector<float>         &zs,
+// Slicing parameters of slice_mesh() producing the input of make_expolygons_layers().
+static MeshSlicingParams slicing_params_for_expolygons(const MeshSlicingParamsEx &params)
+{
+    MeshSlicingParams slicing_params(params);
+    if (params.mode == MeshSlicingParams::SlicingMode::PositiveLargestContour)
+        slicing_params.mode = MeshSlicingParams::SlicingMode::Positive;
+    if (params.mode_below == MeshSlicingParams::SlicingMode::PositiveLargestContour)
+        slicing_params.mode_below = MeshSlicingParams::SlicingMode::Positive;
+    return slicing_params;
+}
+
+// Convert layers_p produced by slice_mesh() into ExPolygons, storing them into layers starting with first_layer_id.
+// first_layer_id is the index of layers_p.front() in the sequence of all layers sliced.
+static void make_expolygons_layers(
+    const std::vector<Polygons>      &layers_p,
     const MeshSlicingParamsEx        &params,
+    const size_t                      first_layer_id,
+    std::vector<ExPolygons>          &layers,
     std::function<void()>             throw_on_cancel)
 {
-    std::vector<Polygons> layers_p;
-    {
-        MeshSlicingParams slicing_params(params);
-        if (params.mode == MeshSlicingParams::SlicingMode::PositiveLargestContour)
-            slicing_params.mode = MeshSlicingParams::SlicingMode::Positive;
-        if (params.mode_below == MeshSlicingParams::SlicingMode::PositiveLargestContour)
-            slicing_params.mode_below = MeshSlicingParams::SlicingMode::Positive;
-        layers_p = slice_mesh(mesh, zs, slicing_params, throw_on_cancel);
-    }
-    
 //    BOOST_LOG_TRIVIAL(debug) << "slice_mesh make_expolygons in parallel - start";
-    std::vector<ExPolygons> layers(layers_p.size(), ExPolygons{});
     tbb::parallel_for(
-        tbb::blocked_range<size_t>(0, layers_p.size()),
-        [&layers_p, &params, &layers, throw_on_cancel]
+        tbb::blocked_range<size_t>(first_layer_id, first_layer_id + layers_p.size()),
+        [&layers_p, &params, first_layer_id, &layers, throw_on_cancel]
         (const tbb::blocked_range<size_t>& range) {
             auto resolution = scaled<float>(params.resolution);
             for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
@@ -1933,7 +2123,7 @@ std::vector<ExPolygons> slice_mesh_ex(
                 ExPolygons &expolygons = layers[layer_id];
                 const auto this_mode = layer_id < params.slicing_mode_normal_below_layer ? params.mode_below : params.mode;
                 Slic3r::make_expolygons(
-                    layers_p[layer_id], params.closing_radius, params.extra_offset,
+                    layers_p[layer_id - first_layer_id], params.closing_radius, params.extra_offset,
                     this_mode == MeshSlicingParams::SlicingMode::EvenOdd ? ClipperLib::pftEvenOdd : 
                     this_mode == MeshSlicingParams::SlicingMode::PositiveLargestContour ? ClipperLib::pftPositive : ClipperLib::pftNonZero,
                     &expolygons);
@@ -1980,7 +2170,490 @@ std::vector<ExPolygons> slice_mesh_ex(
             }
         });
 //    BOOST_LOG_TRIVIAL(debug) << "slice_mesh make_expolygons in parallel - end";
+}
+
+std::vector<ExPolygons> slice_mesh_ex(
+    const indexed_triangle_set       &mesh,
+    const std::vector<float>         &zs,
+    const MeshSlicingParamsEx        &params,
+    std::function<void()>             throw_on_cancel)
+{
+    std::vector<Polygons>   layers_p = slice_mesh(mesh, zs, slicing_params_for_expolygons(params), throw_on_cancel);
+    std::vector<ExPolygons> layers(layers_p.size(), ExPolygons{});
+    make_expolygons_layers(layers_p, params, 0, layers, throw_on_cancel);
+    return layers;
+}
+
+namespace {
+
+// Layout of the mesh slicing cache file:
+//   MeshSlicingCacheHeader
+//   float x[num_vertices], y[num_vertices], z[num_vertices]  transformed vertices, scaled in XY, unscaled in Z
+//   MeshSlicingCacheFacet facets[num_facets]                 sorted by min_z, then by face_idx
+struct MeshSlicingCacheHeader
+{
+    static constexpr const char     magic_value[8] = { 'P', 'S', 'S', 'L', 'C', 'A', 'C', 'H' };
+    static constexpr const uint32_t version_value  = 1;
+
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t num_vertices;
+    uint64_t num_facets;
+};
+
+struct MeshSlicingCacheFacet
+{
+    stl_triangle_vertex_indices indices;
+    Vec3i                       edge_ids;
+    // Index of the facet in the source mesh.
+    uint32_t                    face_idx;
+    float                       min_z;
+    float                       max_z;
+};
+
+static_assert(sizeof(MeshSlicingCacheHeader) == 32, "MeshSlicingCacheHeader shall not be padded");
+static_assert(sizeof(MeshSlicingCacheFacet) == 36 && alignof(MeshSlicingCacheFacet) == 4, "MeshSlicingCacheFacet shall not be padded");
+
+} // namespace
+
+// The path is UTF-8 encoded, Windows needs a wide path to open files with non-ASCII names.
+static boost::filesystem::path mesh_slicing_cache_path(const std::string &path)
+{
+#ifdef _WIN32
+    return boost::filesystem::path(boost::nowide::widen(path));
+#else
+    return boost::filesystem::path(path);
+#endif
+}
+
+namespace {
+
+// New file of a given size memory mapped for reading and writing. The OS pages the data in and out on demand,
+// thus the arrays the out of core cache writer keeps in such files do not occupy the process memory.
+// The file is deleted when closed, unless keep() is called.
+class MappedOutputFile
+{
+public:
+    MappedOutputFile(const std::string &path, size_t size) : m_path(mesh_slicing_cache_path(path)) {
+        boost::iostreams::basic_mapped_file_params<boost::filesystem::path> params(m_path);
+        params.flags         = boost::iostreams::mapped_file::readwrite;
+        // An empty file could not be mapped.
+        params.new_file_size = std::max<size_t>(size, 1);
+        try {
+            m_mapping.open(params);
+        } catch (const std::exception &ex) {
+            throw Slic3r::FileIOError(std::string("write_mesh_slicing_cache: Cannot map file ") + path + ": " + ex.what());
+        }
+    }
+    MappedOutputFile(const MappedOutputFile &) = delete;
+    MappedOutputFile& operator=(const MappedOutputFile &) = delete;
+    ~MappedOutputFile() {
+        m_mapping.close();
+        if (! m_keep) {
+            boost::system::error_code ec;
+            boost::filesystem::remove(m_path, ec);
+        }
+    }
 
+    template<typename T>
+    T*   data() { return reinterpret_cast<T*>(m_mapping.data()); }
+    void keep() { m_keep = true; }
+
+private:
+    boost::filesystem::path         m_path;
+    boost::iostreams::mapped_file   m_mapping;
+    bool                            m_keep { false };
+};
+
+// Number of buckets of an out of core sort, so that a single bucket takes at most 64MB.
+static size_t out_of_core_num_buckets(size_t num_records, size_t record_size)
+{
+    static constexpr const size_t bucket_size = 64 << 20;
+    return std::clamp<size_t>(num_records * record_size / bucket_size + 1, 1, 4096);
+}
+
+// Out of core counting sort of records into buckets stored consecutively at out, usually a memory mapped file.
+// emit_records(emit) calls emit(record) for all the records. It is called twice, first to count the records of each bucket,
+// then to distribute the records, thus the records are never held in memory all at once.
+// Then process_bucket(begin, end) is called for the buckets in their order, thus just a single bucket is paged in at a time.
+template<typename Record, typename EmitRecords, typename BucketOf, typename ProcessBucket>
+static void out_of_core_bucket_sort(
+    Record                      *out,
+    size_t                       num_buckets,
+    EmitRecords                  emit_records,
+    BucketOf                     bucket_of,
+    ProcessBucket                process_bucket,
+    const std::function<void()> &throw_on_cancel)
+{
+    std::vector<size_t> bucket_begin(num_buckets + 1, 0);
+    emit_records([&bucket_begin, &bucket_of](const Record &record) { ++ bucket_begin[bucket_of(record) + 1]; });
+    std::partial_sum(bucket_begin.begin(), bucket_begin.end(), bucket_begin.begin());
+    throw_on_cancel();
+    std::vector<size_t> bucket_end(bucket_begin.begin(), bucket_begin.end() - 1);
+    emit_records([out, &bucket_end, &bucket_of](const Record &record) { out[bucket_end[bucket_of(record)] ++] = record; });
+    for (size_t bucket = 0; bucket < num_buckets; ++ bucket) {
+        throw_on_cancel();
+        process_bucket(out + bucket_begin[bucket], out + bucket_begin[bucket + 1]);
+    }
+}
+
+// Same transformation of the vertices as slice_mesh() does.
+struct SlicingVertexTransform
+{
+    explicit SlicingVertexTransform(const Transform3d &trafo) : identity(is_identity(trafo)), tf(make_trafo_for_slicing(trafo)) {}
+    Vec3f operator()(const Vec3f &p) const {
+        static constexpr const float s = float(1. / SCALING_FACTOR);
+        return identity ? Vec3f(p.x() * s, p.y() * s, p.z()) : Vec3f(tf * p);
+    }
+
+    bool        identity;
+    Transform3f tf;
+};
+
+} // namespace
+
+static size_t mesh_slicing_cache_size(size_t num_vertices, size_t num_faces)
+{
+    return sizeof(MeshSlicingCacheHeader) + num_vertices * 3 * sizeof(float) + num_faces * sizeof(MeshSlicingCacheFacet);
+}
+
+static void write_mesh_slicing_cache_header(MappedOutputFile &cache, size_t num_vertices, size_t num_faces)
+{
+    MeshSlicingCacheHeader &header = *cache.data<MeshSlicingCacheHeader>();
+    memcpy(header.magic, MeshSlicingCacheHeader::magic_value, sizeof(header.magic));
+    header.version      = MeshSlicingCacheHeader::version_value;
+    header.reserved     = 0;
+    header.num_vertices = num_vertices;
+    header.num_facets   = num_faces;
+}
+
+// Having the transformed vertices of the cache written, calculate the edge IDs of the facets the same way its_face_edge_ids() does
+// and write the facets sorted by their lowest Z, both with out of core bucket sorts.
+// face_vertices(face_idx) returns the vertex indices of a facet.
+template<typename FaceVertices>
+static void write_mesh_slicing_cache_facets(
+    MappedOutputFile            &cache,
+    const std::string           &path,
+    FaceVertices                 face_vertices,
+    const std::function<void()> &throw_on_cancel)
+{
+    const MeshSlicingCacheHeader &header       = *cache.data<MeshSlicingCacheHeader>();
+    const size_t                  num_vertices = header.num_vertices;
+    const size_t                  num_faces    = header.num_facets;
+    float                        *vertices     = cache.data<float>() + sizeof(header) / sizeof(float);
+    const float                  *z            = vertices + 2 * num_vertices;
+    auto                         *facets       = reinterpret_cast<MeshSlicingCacheFacet*>(vertices + 3 * num_vertices);
+    if (num_faces == 0)
+        return;
+
+    MappedOutputFile edge_ids_file(path + ".edges", num_faces * sizeof(Vec3i));
+    Vec3i           *edge_ids = edge_ids_file.data<Vec3i>();
+    {
+        // Same as EdgeToFace of its_face_edge_ids().
+        struct Edge {
+            int vertex_low;
+            int vertex_high;
+            int face;
+            // Index of edge in the face, starting with 1. Negative indices if the edge was stored reverse in (vertex_low, vertex_high).
+            int face_edge;
+        };
+        MappedOutputFile records(path + ".records", 3 * num_faces * sizeof(Edge));
+        const size_t     num_buckets = out_of_core_num_buckets(3 * num_faces, sizeof(Edge));
+        int              num_edges   = 0;
+        // The buckets split the range of vertex_low, thus the edge IDs are numbered in the order of (vertex_low, vertex_high) as by its_face_edge_ids().
+        out_of_core_bucket_sort(records.data<Edge>(), num_buckets,
+            [num_faces, &face_vertices, &throw_on_cancel](auto emit) {
+                for (size_t face_idx = 0; face_idx < num_faces; ++ face_idx) {
+                    const stl_triangle_vertex_indices face = face_vertices(face_idx);
+                    for (int i = 0; i < 3; ++ i) {
+                        Edge edge { face(i), face(next_idx_modulo(i, 3)), int(face_idx), i + 1 };
+                        if (edge.vertex_low > edge.vertex_high) {
+                            std::swap(edge.vertex_low, edge.vertex_high);
+                            edge.face_edge = - edge.face_edge;
+                        }
+                        emit(edge);
+                    }
+                    if ((face_idx & 0x0ffff) == 0)
+                        throw_on_cancel();
+                }
+            },
+            [num_buckets, num_vertices](const Edge &edge) { return size_t(edge.vertex_low) * num_buckets / num_vertices; },
+            [edge_ids, &num_edges](Edge *begin, Edge *end) {
+                tbb::parallel_sort(begin, end, [](const Edge &l, const Edge &r) {
+                    return l.vertex_low < r.vertex_low || (l.vertex_low == r.vertex_low && (l.vertex_high < r.vertex_high ||
+                        (l.vertex_high == r.vertex_high && (l.face < r.face || (l.face == r.face && l.face_edge < r.face_edge)))));
+                });
+                for (Edge *edge_i = begin; edge_i != end; ++ edge_i) {
+                    if (edge_i->face == -1)
+                        // This edge has been connected to some neighbor already.
+                        continue;
+                    Edge *group_end = std::find_if(edge_i + 1, end, [edge_i](const Edge &e) { return e.vertex_low != edge_i->vertex_low || e.vertex_high != edge_i->vertex_high; });
+                    // Find a neighbor not connected yet, with the opposite orientation first, then with the same orientation.
+                    Edge *edge_j    = std::find_if(edge_i + 1, group_end, [edge_i](const Edge &e) { return edge_i->face_edge * e.face_edge < 0 && e.face != -1; });
+                    if (edge_j == group_end)
+                        edge_j = std::find_if(edge_i + 1, group_end, [](const Edge &e) { return e.face != -1; });
+                    edge_ids[edge_i->face](std::abs(edge_i->face_edge) - 1) = num_edges;
+                    if (edge_j != group_end) {
+                        edge_ids[edge_j->face](std::abs(edge_j->face_edge) - 1) = num_edges;
+                        // Mark the edge as connected.
+                        edge_j->face = -1;
+                    }
+                    ++ num_edges;
+                }
+            }, throw_on_cancel);
+    }
+
+    // The facets are bucketed by their lowest Z straight into the cache file.
+    const auto   z_range      = std::minmax_element(z, z + num_vertices);
+    const double z_min        = *z_range.first;
+    const double z_max        = *z_range.second;
+    const size_t num_buckets  = out_of_core_num_buckets(num_faces, sizeof(MeshSlicingCacheFacet));
+    const double bucket_scale = z_max > z_min ? double(num_buckets) / (z_max - z_min) : 0.;
+    out_of_core_bucket_sort(facets, num_buckets,
+        [num_faces, z, edge_ids, &face_vertices, &throw_on_cancel](auto emit) {
+            for (size_t face_idx = 0; face_idx < num_faces; ++ face_idx) {
+                MeshSlicingCacheFacet facet;
+                facet.indices  = face_vertices(face_idx);
+                facet.edge_ids = edge_ids[face_idx];
+                facet.face_idx = uint32_t(face_idx);
+                facet.min_z    = std::min(z[facet.indices(0)], std::min(z[facet.indices(1)], z[facet.indices(2)]));
+                facet.max_z    = std::max(z[facet.indices(0)], std::max(z[facet.indices(1)], z[facet.indices(2)]));
+                emit(facet);
+                if ((face_idx & 0x0ffff) == 0)
+                    throw_on_cancel();
+            }
+        },
+        [num_buckets, z_min, bucket_scale](const MeshSlicingCacheFacet &facet) {
+            return std::min(num_buckets - 1, size_t((double(facet.min_z) - z_min) * bucket_scale));
+        },
+        [](MeshSlicingCacheFacet *begin, MeshSlicingCacheFacet *end) {
+            tbb::parallel_sort(begin, end, [](const MeshSlicingCacheFacet &l, const MeshSlicingCacheFacet &r) {
+                return l.min_z < r.min_z || (l.min_z == r.min_z && l.face_idx < r.face_idx);
+            });
+        }, throw_on_cancel);
+}
+
+void write_mesh_slicing_cache(
+    const indexed_triangle_set       &mesh,
+    const Transform3d                &trafo,
+    const std::string                &path,
+    std::function<void()>             throw_on_cancel)
+{
+    if (mesh.indices.size() >= size_t(std::numeric_limits<uint32_t>::max()))
+        throw Slic3r::InvalidArgument("write_mesh_slicing_cache: Too many facets");
+
+    MappedOutputFile cache(path, mesh_slicing_cache_size(mesh.vertices.size(), mesh.indices.size()));
+    write_mesh_slicing_cache_header(cache, mesh.vertices.size(), mesh.indices.size());
+    {
+        const SlicingVertexTransform transform(trafo);
+        float *x = cache.data<float>() + sizeof(MeshSlicingCacheHeader) / sizeof(float);
+        float *y = x + mesh.vertices.size();
+        float *z = y + mesh.vertices.size();
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, mesh.vertices.size()),
+            [&mesh, &transform, x, y, z](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    const Vec3f v = transform(mesh.vertices[i]);
+                    x[i] = v.x();
+                    y[i] = v.y();
+                    z[i] = v.z();
+                }
+            });
+    }
+    throw_on_cancel();
+    write_mesh_slicing_cache_facets(cache, path, [&mesh](size_t face_idx) { return mesh.indices[face_idx]; }, throw_on_cancel);
+    cache.keep();
+}
+
+bool write_mesh_slicing_cache_from_stl(
+    const std::string                &stl_path,
+    const Transform3d                &trafo,
+    const std::string                &path,
+    std::function<void()>             throw_on_cancel)
+{
+    MappedBinarySTL stl;
+    if (! stl.open(stl_path.c_str()))
+        return false;
+    const size_t num_faces   = stl.num_facets();
+    const size_t num_corners = 3 * num_faces;
+    if (num_corners >= size_t(std::numeric_limits<int>::max()))
+        return false;
+    for (size_t corner = 0; corner < num_corners; ++ corner)
+        if (! stl.vertex(corner / 3, corner % 3).allFinite()) {
+            BOOST_LOG_TRIVIAL(warning) << "write_mesh_slicing_cache_from_stl: " << stl_path << " contains non-finite vertex coordinates";
+            return false;
+        }
+
+    // For each corner the first corner with a bit identical vertex, then the index of its vertex.
+    MappedOutputFile corner_vertices_file(path + ".vertices", num_corners * sizeof(uint32_t));
+    uint32_t        *corner_vertices = corner_vertices_file.data<uint32_t>();
+    size_t           num_vertices    = 0;
+    {
+        struct Corner {
+            stl_vertex  v;
+            uint32_t    idx;
+        };
+        MappedOutputFile records(path + ".records", num_corners * sizeof(Corner));
+        const size_t     num_buckets = out_of_core_num_buckets(num_corners, sizeof(Corner));
+        // Bit identical vertices fall into the same bucket, where they are merged by sorting the corners as its_read_stl_binary() does.
+        out_of_core_bucket_sort(records.data<Corner>(), num_buckets,
+            [&stl, num_corners, &throw_on_cancel](auto emit) {
+                for (size_t corner = 0; corner < num_corners; ++ corner) {
+                    emit(Corner{ stl.vertex(corner / 3, corner % 3), uint32_t(corner) });
+                    if ((corner & 0x0ffff) == 0)
+                        throw_on_cancel();
+                }
+            },
+            [num_buckets](const Corner &c) {
+                uint32_t bits[3];
+                memcpy(bits, c.v.data(), sizeof(bits));
+                const uint64_t hash = uint64_t(bits[0]) * 0x9E3779B97F4A7C15ull ^ uint64_t(bits[1]) * 0xC2B2AE3D27D4EB4Full ^ uint64_t(bits[2]) * 0x165667B19E3779F9ull;
+                return size_t((hash >> 32) % num_buckets);
+            },
+            [corner_vertices, &num_vertices](Corner *begin, Corner *end) {
+                tbb::parallel_sort(begin, end, [](const Corner &l, const Corner &r) {
+                    return l.v.x() < r.v.x() || (l.v.x() == r.v.x() && (l.v.y() < r.v.y() || (l.v.y() == r.v.y() && (l.v.z() < r.v.z() || (l.v.z() == r.v.z() && l.idx < r.idx)))));
+                });
+                for (Corner *group = begin; group != end; ++ num_vertices) {
+                    Corner *group_end = std::find_if(group + 1, end, [group](const Corner &c) { return c.v != group->v; });
+                    for (Corner *c = group; c != group_end; ++ c)
+                        corner_vertices[c->idx] = group->idx;
+                    group = group_end;
+                }
+            }, throw_on_cancel);
+    }
+
+    MappedOutputFile cache(path, mesh_slicing_cache_size(num_vertices, num_faces));
+    write_mesh_slicing_cache_header(cache, num_vertices, num_faces);
+    {
+        // Number the vertices in the order of their first occurence in the file, as its_read_stl_binary() does.
+        const SlicingVertexTransform transform(trafo);
+        float   *x           = cache.data<float>() + sizeof(MeshSlicingCacheHeader) / sizeof(float);
+        float   *y           = x + num_vertices;
+        float   *z           = y + num_vertices;
+        uint32_t next_vertex = 0;
+        for (size_t corner = 0; corner < num_corners; ++ corner) {
+            if (const uint32_t first = corner_vertices[corner]; first == corner) {
+                const Vec3f v = transform(stl.vertex(corner / 3, corner % 3));
+                x[next_vertex] = v.x();
+                y[next_vertex] = v.y();
+                z[next_vertex] = v.z();
+                corner_vertices[corner] = next_vertex ++;
+            } else
+                // The first corner has already been numbered.
+                corner_vertices[corner] = corner_vertices[first];
+        }
+        assert(next_vertex == num_vertices);
+    }
+    stl.close();
+    throw_on_cancel();
+    write_mesh_slicing_cache_facets(cache, path,
+        [corner_vertices](size_t face_idx) {
+            const uint32_t *c = corner_vertices + 3 * face_idx;
+            return stl_triangle_vertex_indices(int(c[0]), int(c[1]), int(c[2]));
+        }, throw_on_cancel);
+    cache.keep();
+    return true;
+}
+
+// Slice the mesh slicing cache in bands of layers_per_band layers, calling consume_band(first_layer_id, band_layers) for each band.
+// Only the facets crossing the active band are copied out of the memory mapped file.
+template<typename ConsumeBand>
+static void slice_mesh_cache_in_bands(
+    const std::string                &path,
+    const std::vector<float>         &zs,
+    const MeshSlicingParams          &params,
+    size_t                            layers_per_band,
+    ConsumeBand                       consume_band,
+    std::function<void()>             throw_on_cancel)
+{
+    assert(is_identity(params.trafo));
+    assert(std::is_sorted(zs.begin(), zs.end()));
+    layers_per_band = std::max<size_t>(1, layers_per_band);
+
+    boost::iostreams::mapped_file_source mapping;
+    try {
+        mapping.open(mesh_slicing_cache_path(path));
+    } catch (const std::exception &ex) {
+        throw Slic3r::FileIOError(std::string("slice_mesh_from_cache: Cannot map file ") + path + ": " + ex.what());
+    }
+
+    const char *data = mapping.data();
+    MeshSlicingCacheHeader header;
+    if (mapping.size() < sizeof(header))
+        throw Slic3r::FileIOError(std::string("slice_mesh_from_cache: Invalid file ") + path);
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, MeshSlicingCacheHeader::magic_value, sizeof(header.magic)) != 0 || header.version != MeshSlicingCacheHeader::version_value ||
+        mapping.size() != mesh_slicing_cache_size(header.num_vertices, header.num_facets))
+        throw Slic3r::FileIOError(std::string("slice_mesh_from_cache: Invalid file ") + path);
+
+    const auto *vertex_data = reinterpret_cast<const float*>(data + sizeof(header));
+    SlicingVerticesView vertices { vertex_data, vertex_data + header.num_vertices, vertex_data + 2 * header.num_vertices };
+    const auto *facets      = reinterpret_cast<const MeshSlicingCacheFacet*>(vertex_data + 3 * header.num_vertices);
+    const auto *facets_end  = facets + header.num_facets;
+
+    // Facets crossing the active band, sorted by face_idx, thus the intersection lines of a layer
+    // are ordered the same way as if the whole mesh was sliced by slice_mesh().
+    std::vector<MeshSlicingCacheFacet>       active;
+    std::vector<stl_triangle_vertex_indices> band_indices;
+    std::vector<Vec3i>                       band_edge_ids;
+    auto                                     face_idx_lower = [](const MeshSlicingCacheFacet &l, const MeshSlicingCacheFacet &r) { return l.face_idx < r.face_idx; };
+    for (size_t first_layer_id = 0; first_layer_id < zs.size(); first_layer_id += layers_per_band) {
+        throw_on_cancel();
+        const size_t last_layer_id = std::min(first_layer_id + layers_per_band, zs.size());
+        const float  z_first       = zs[first_layer_id];
+        const float  z_last        = zs[last_layer_id - 1];
+        // A facet is sliced at layers min_z <= z <= max_z, see slice_facet_at_zs().
+        active.erase(std::remove_if(active.begin(), active.end(), [z_first](const MeshSlicingCacheFacet &f) { return f.max_z < z_first; }), active.end());
+        const size_t num_active_old = active.size();
+        for (; facets != facets_end && facets->min_z <= z_last; ++ facets)
+            // Horizontal facets are not sliced.
+            if (facets->min_z != facets->max_z && facets->max_z >= z_first)
+                active.emplace_back(*facets);
+        std::sort(active.begin() + num_active_old, active.end(), face_idx_lower);
+        std::inplace_merge(active.begin(), active.begin() + num_active_old, active.end(), face_idx_lower);
+
+        band_indices.clear();
+        band_edge_ids.clear();
+        for (const MeshSlicingCacheFacet &facet : active) {
+            band_indices.emplace_back(facet.indices);
+            band_edge_ids.emplace_back(facet.edge_ids);
+        }
+        std::vector<float>             band_zs(zs.begin() + first_layer_id, zs.begin() + last_layer_id);
+        std::vector<IntersectionLines> lines = slice_make_lines_banded(vertices, band_indices, band_edge_ids, band_zs, throw_on_cancel);
+        MeshSlicingParams              band_params(params);
+        band_params.slicing_mode_normal_below_layer = params.slicing_mode_normal_below_layer > first_layer_id ? params.slicing_mode_normal_below_layer - first_layer_id : 0;
+        consume_band(first_layer_id, make_loops(lines, band_params, throw_on_cancel));
+    }
+}
+
+std::vector<Polygons> slice_mesh_from_cache(
+    const std::string                &path,
+    const std::vector<float>         &zs,
+    const MeshSlicingParams          &params,
+    size_t                            layers_per_band,
+    std::function<void()>             throw_on_cancel)
+{
+    std::vector<Polygons> layers(zs.size(), Polygons{});
+    slice_mesh_cache_in_bands(path, zs, params, layers_per_band,
+        [&layers](size_t first_layer_id, std::vector<Polygons> &&band) {
+            std::move(band.begin(), band.end(), layers.begin() + first_layer_id);
+        }, throw_on_cancel);
+    return layers;
+}
+
+std::vector<ExPolygons> slice_mesh_ex_from_cache(
+    const std::string                &path,
+    const std::vector<float>         &zs,
+    const MeshSlicingParamsEx        &params,
+    size_t                            layers_per_band,
+    std::function<void()>             throw_on_cancel)
+{
+    std::vector<ExPolygons> layers(zs.size(), ExPolygons{});
+    slice_mesh_cache_in_bands(path, zs, slicing_params_for_expolygons(params), layers_per_band,
+        [&params, &layers, &throw_on_cancel](size_t first_layer_id, std::vector<Polygons> &&band) {
+            make_expolygons_layers(band, params, first_layer_id, layers, throw_on_cancel);
+        }, throw_on_cancel);
     return layers;
 }
 
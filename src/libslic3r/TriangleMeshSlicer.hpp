@@ -2,6 +2,7 @@
 #define slic3r_TriangleMeshSlicer_hpp_
 
 #include <functional>
+#include <string>
 #include <vector>
 #include "Polygon.hpp"
 #include "ExPolygon.hpp"
@@ -63,6 +64,17 @@ std::vector<Polygons>           slice_mesh(
     const MeshSlicingParams          &params,
     std::function<void()>             throw_on_cancel = []{});
 
+namespace detail {
+    // Same result as slice_mesh(), produced the way slice_mesh() did before it sliced in bands of layers:
+    // all facets are sliced in a single parallel loop, pushing the lines into the layers under mutexes.
+    // Kept as a reference for the unit tests and the benchmark of slice_mesh() only, not to be used by the slicing.
+    std::vector<Polygons>       slice_mesh_unbanded(
+        const indexed_triangle_set       &mesh,
+        const std::vector<float>         &zs,
+        const MeshSlicingParams          &params,
+        std::function<void()>             throw_on_cancel = []{});
+} // namespace detail
+
 // Specialized version for a single slicing plane only, running on a single thread.
 Polygons                        slice_mesh(
     const indexed_triangle_set       &mesh,
@@ -94,6 +106,46 @@ inline std::vector<ExPolygons>  slice_mesh_ex(
     return slice_mesh_ex(mesh, zs, params, throw_on_cancel);
 }
 
+// Out of core slicing of meshes, which are too large to be kept in memory together with the slicing data structures.
+// write_mesh_slicing_cache() stores the mesh transformed by trafo into a binary file with its facets sorted by their lowest Z.
+// The file is memory mapped while written and the edge IDs and the facets are bucket sorted through memory mapped scratch files
+// next to it, thus the memory the writer allocates does not grow with the mesh.
+// write_mesh_slicing_cache_from_stl() streams the facets of a memory mapped binary STL instead, merging bit identical vertices
+// the same way its_read_stl_binary() does, without loading the mesh at all. It returns false if the file is not a binary STL
+// or if it contains non-finite coordinates.
+// slice_mesh_from_cache() and slice_mesh_ex_from_cache() memory map the file and slice it in bands of layers_per_band layers,
+// holding in memory just the facets and the intersection lines of the active band. The vertices are paged in by the OS on demand.
+// The result is the same as of slice_mesh() resp. slice_mesh_ex() with params.trafo set to the trafo the cache was written with,
+// while params.trafo of the *_from_cache() functions shall be identity. zs shall be sorted.
+// Throws FileIOError if the file could not be written or read.
+constexpr const size_t          mesh_slicing_cache_layers_per_band = 256;
+
+void                            write_mesh_slicing_cache(
+    const indexed_triangle_set       &mesh,
+    const Transform3d                &trafo,
+    const std::string                &path,
+    std::function<void()>             throw_on_cancel = []{});
+
+bool                            write_mesh_slicing_cache_from_stl(
+    const std::string                &stl_path,
+    const Transform3d                &trafo,
+    const std::string                &path,
+    std::function<void()>             throw_on_cancel = []{});
+
+std::vector<Polygons>           slice_mesh_from_cache(
+    const std::string                &path,
+    const std::vector<float>         &zs,
+    const MeshSlicingParams          &params,
+    size_t                            layers_per_band = mesh_slicing_cache_layers_per_band,
+    std::function<void()>             throw_on_cancel = []{});
+
+std::vector<ExPolygons>         slice_mesh_ex_from_cache(
+    const std::string                &path,
+    const std::vector<float>         &zs,
+    const MeshSlicingParamsEx        &params,
+    size_t                            layers_per_band = mesh_slicing_cache_layers_per_band,
+    std::function<void()>             throw_on_cancel = []{});
+
 // Slice a triangle set with a set of Z slabs (thick layers).
 // The effect is similar to producing the usual top / bottom layers from a sliced mesh by 
 // subtracting layer[i] from layer[i - 1] for the top surfaces resp.
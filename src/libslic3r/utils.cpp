@@ -781,7 +781,8 @@ bool is_idx_file(const boost::filesystem::directory_entry &dir_entry)
 bool is_gcode_file(const std::string &path)
 {
 	return boost::iends_with(path, ".gcode") || boost::iends_with(path, ".gco") ||
-		   boost::iends_with(path, ".g")     || boost::iends_with(path, ".ngc");
+		   boost::iends_with(path, ".g")     || boost::iends_with(path, ".ngc")  ||
+		   boost::iends_with(path, ".sbgc");
 }
 
 bool is_img_file(const std::string &path)
@@ -1065,6 +1066,45 @@ std::string format_memsize_MB(size_t n)
     return out + "MB";
 }
 
+#ifdef WIN32
+#ifndef PROCESS_MEMORY_COUNTERS_EX
+    // MingW32 doesn't have this struct in psapi.h
+    typedef struct _PROCESS_MEMORY_COUNTERS_EX {
+      DWORD  cb;
+      DWORD  PageFaultCount;
+      SIZE_T PeakWorkingSetSize;
+      SIZE_T WorkingSetSize;
+      SIZE_T QuotaPeakPagedPoolUsage;
+      SIZE_T QuotaPagedPoolUsage;
+      SIZE_T QuotaPeakNonPagedPoolUsage;
+      SIZE_T QuotaNonPagedPoolUsage;
+      SIZE_T PagefileUsage;
+      SIZE_T PeakPagefileUsage;
+      SIZE_T PrivateUsage;
+    } PROCESS_MEMORY_COUNTERS_EX, *PPROCESS_MEMORY_COUNTERS_EX;
+#endif /* PROCESS_MEMORY_COUNTERS_EX */
+
+// Memory counters of this process, shared by log_memory_info() and peak_process_memory().
+static bool get_process_memory_counters(PROCESS_MEMORY_COUNTERS_EX &pmc)
+{
+    return GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc)) != 0;
+}
+#elif defined(__linux__) or defined(__APPLE__)
+// Peak resident memory of this process in bytes as reported by getrusage(), 0 if not available.
+// Shared by log_memory_info() and peak_process_memory().
+static size_t getrusage_peak_memory()
+{
+    rusage memory_info;
+    if (getrusage(RUSAGE_SELF, &memory_info) != 0)
+        return 0;
+    size_t peak_mem_usage = (size_t)memory_info.ru_maxrss;
+#ifdef __linux__
+    peak_mem_usage *= 1024; // getrusage returns the value in kB on linux
+#endif
+    return peak_mem_usage;
+}
+#endif
+
 // Returns platform-specific string to be used as log output or parsed in SysInfoDialog.
 // The latter parses the string with (semi)colons as separators, it should look about as
 // "desc1: value1; desc2: value2" or similar (spaces should not matter).
@@ -1073,25 +1113,8 @@ std::string log_memory_info(bool ignore_loglevel)
     std::string out;
     if (ignore_loglevel || logSeverity <= boost::log::trivial::info) {
 #ifdef WIN32
-    #ifndef PROCESS_MEMORY_COUNTERS_EX
-        // MingW32 doesn't have this struct in psapi.h
-        typedef struct _PROCESS_MEMORY_COUNTERS_EX {
-          DWORD  cb;
-          DWORD  PageFaultCount;
-          SIZE_T PeakWorkingSetSize;
-          SIZE_T WorkingSetSize;
-          SIZE_T QuotaPeakPagedPoolUsage;
-          SIZE_T QuotaPagedPoolUsage;
-          SIZE_T QuotaPeakNonPagedPoolUsage;
-          SIZE_T QuotaNonPagedPoolUsage;
-          SIZE_T PagefileUsage;
-          SIZE_T PeakPagefileUsage;
-          SIZE_T PrivateUsage;
-        } PROCESS_MEMORY_COUNTERS_EX, *PPROCESS_MEMORY_COUNTERS_EX;
-    #endif /* PROCESS_MEMORY_COUNTERS_EX */
-
         PROCESS_MEMORY_COUNTERS_EX pmc;
-        if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc)))
+        if (get_process_memory_counters(pmc))
             out = " WorkingSet: " + format_memsize_MB(pmc.WorkingSetSize) + "; PrivateBytes: " + format_memsize_MB(pmc.PrivateUsage) + "; Pagefile(peak): " + format_memsize_MB(pmc.PagefileUsage) + "(" + format_memsize_MB(pmc.PeakPagefileUsage) + ")";
         else
             out += " Used memory: N/A";
@@ -1120,15 +1143,8 @@ std::string log_memory_info(bool ignore_loglevel)
     #endif
         // Now get peak memory usage.
         out += "; Peak memory usage: ";
-        rusage memory_info;
-        if (getrusage(RUSAGE_SELF, &memory_info) == 0)
-        {
-            size_t peak_mem_usage = (size_t)memory_info.ru_maxrss;
-            #ifdef __linux__
-                peak_mem_usage *= 1024;// getrusage returns the value in kB on linux
-            #endif
+        if (size_t peak_mem_usage = getrusage_peak_memory(); peak_mem_usage > 0)
             out += format_memsize_MB(peak_mem_usage);
-        }
         else
             out += "N/A";
 #endif
@@ -1136,6 +1152,21 @@ std::string log_memory_info(bool ignore_loglevel)
     return out;
 }
 
+// Returns the peak resident memory (working set) of this process in bytes, or 0 if not available.
+size_t peak_process_memory()
+{
+#ifdef WIN32
+    PROCESS_MEMORY_COUNTERS_EX pmc;
+    if (get_process_memory_counters(pmc))
+        return (size_t)pmc.PeakWorkingSetSize;
+    return 0;
+#elif defined(__linux__) or defined(__APPLE__)
+    return getrusage_peak_memory();
+#else
+    return 0;
+#endif
+}
+
 // Returns the size of physical memory (RAM) in bytes.
 // http://nadeausoftware.com/articles/2012/09/c_c_tip_how_get_physical_memory_size_system
 size_t total_physical_memory()
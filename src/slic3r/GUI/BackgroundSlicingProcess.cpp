@@ -20,6 +20,7 @@
 #include "libslic3r/SLAPrint.hpp"
 #include "libslic3r/Utils.hpp"
 #include "libslic3r/GCode/PostProcessor.hpp"
+#include "libslic3r/GCode/BinaryGCode.hpp"
 #include "libslic3r/Format/SL1.hpp"
 #include "libslic3r/Thread.hpp"
 #include "libslic3r/libslic3r.h"
@@ -660,7 +661,7 @@ void BackgroundSlicingProcess::finalize_gcode()
 	// is calculated for the unprocessed G-code and it references lines in the memory mapped G-code file by line numbers.
 	// export_path may be changed by the post-processing script as well if the post processing script decides so, see GH #6042.
 	bool post_processed = run_post_process_scripts(output_path, true, "File", export_path, m_fff_print->full_print_config());
-	auto remove_post_processed_temp_file = [post_processed, &output_path]() {
+	auto remove_post_processed_temp_file = [&post_processed, &output_path]() {
 		if (post_processed)
 			try {
 				boost::filesystem::remove(output_path);
@@ -668,6 +669,20 @@ void BackgroundSlicingProcess::finalize_gcode()
 				BOOST_LOG_TRIVIAL(error) << "Failed to remove temp file " << output_path << ": " << ex.what();
 			}
 	};
+	if (m_fff_print->config().binary_gcode) {
+		// Convert into another temp file, the G-code viewer keeps the text G-code mapped.
+		std::string binary_path = m_temp_output_path + ".sbgc";
+		try {
+			BinaryGCode::convert_to_binary(output_path, binary_path);
+		} catch (...) {
+			remove_post_processed_temp_file();
+			throw;
+		}
+		remove_post_processed_temp_file();
+		// The binary temp file is to be removed after copying, the same as the post-processed copy.
+		output_path    = std::move(binary_path);
+		post_processed = true;
+	}
 
 	//FIXME localize the messages
 	std::string error_message;
@@ -727,6 +742,7 @@ void BackgroundSlicingProcess::prepare_upload()
         std::string output_name_str = m_upload_job.upload_data.upload_path.string();
 		if (run_post_process_scripts(source_path_str, false, m_upload_job.printhost->get_name(), output_name_str, m_fff_print->full_print_config()))
 			m_upload_job.upload_data.upload_path = output_name_str;
+		// The text G-code is uploaded even if binary_gcode is set, the print hosts cannot print the binary G-code (.sbgc).
     } else {
         m_upload_job.upload_data.upload_path = m_sla_print->print_statistics().finalize_output_path(m_upload_job.upload_data.upload_path.string());
         
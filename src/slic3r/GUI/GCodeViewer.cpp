@@ -364,8 +364,8 @@ void GCodeViewer::SequentialView::Marker::render()
 
 void GCodeViewer::SequentialView::GCodeWindow::load_gcode(const std::string& filename, const std::vector<size_t>& lines_ends)
 {
-    assert(! m_file.is_open());
-    if (m_file.is_open())
+    assert(! m_file.is_open() && ! m_binary_file);
+    if (m_file.is_open() || m_binary_file)
         return;
 
     m_filename   = filename;
@@ -376,7 +376,10 @@ void GCodeViewer::SequentialView::GCodeWindow::load_gcode(const std::string& fil
 
     try
     {
-        m_file.open(boost::filesystem::path(m_filename));
+        if (BinaryGCode::is_binary_file(m_filename))
+            m_binary_file = std::make_unique<BinaryGCode::File>(m_filename);
+        else
+            m_file.open(boost::filesystem::path(m_filename));
     }
     catch (...)
     {
@@ -394,7 +397,7 @@ void GCodeViewer::SequentialView::GCodeWindow::render(float top, float bottom, u
             // read line from file
             const size_t start = id == 1 ? 0 : m_lines_ends[id - 2];
             const size_t len   = m_lines_ends[id - 1] - start;
-            std::string gline(m_file.data() + start, len);
+            std::string gline = m_binary_file ? m_binary_file->read(start, len) : std::string(m_file.data() + start, len);
 
             std::string command;
             std::string parameters;
@@ -551,6 +554,7 @@ void GCodeViewer::SequentialView::GCodeWindow::stop_mapping_file()
 {
     if (m_file.is_open())
         m_file.close();
+    m_binary_file.reset();
 }
 
 void GCodeViewer::SequentialView::render(float legend_height)
@@ -1541,7 +1545,7 @@ void GCodeViewer::load_toolpaths(const GCodeProcessorResult& gcode_result)
 
 #if ENABLE_GCODE_VIEWER_STATISTICS
     auto start_time = std::chrono::high_resolution_clock::now();
-    m_statistics.results_size = SLIC3R_STDVEC_MEMSIZE(gcode_result.moves, GCodeProcessorResult::MoveVertex);
+    m_statistics.results_size = gcode_result.moves.memsize();
     m_statistics.results_time = gcode_result.time;
 #endif // ENABLE_GCODE_VIEWER_STATISTICS
 
@@ -1788,9 +1792,9 @@ void GCodeViewer::load_toolpaths(const GCodeProcessorResult& gcode_result)
             for (size_t j = 1; j < path_vertices_count - 1; ++j) {
                 const size_t curr_s_id = path.sub_paths.front().first.s_id + j;
                 const size_t move_id = extract_move_id(curr_s_id);
-                const Vec3f& prev = gcode_result.moves[move_id - 1].position;
-                const Vec3f& curr = gcode_result.moves[move_id].position;
-                const Vec3f& next = gcode_result.moves[move_id + 1].position;
+                const Vec3f prev = gcode_result.moves.position(move_id - 1);
+                const Vec3f curr = gcode_result.moves.position(move_id);
+                const Vec3f next = gcode_result.moves.position(move_id + 1);
 
                 // select the subpaths which contains the previous/next segments
                 if (!path.sub_paths[prev_sub_path_id].contains(curr_s_id))
@@ -1979,9 +1983,12 @@ void GCodeViewer::load_toolpaths(const GCodeProcessorResult& gcode_result)
             continue;
 
         const GCodeProcessorResult::MoveVertex& prev = gcode_result.moves[i - 1];
+        GCodeProcessorResult::MoveVertex next_move;
         const GCodeProcessorResult::MoveVertex* next = nullptr;
-        if (i < m_moves_count - 1)
-            next = &gcode_result.moves[i + 1];
+        if (i < m_moves_count - 1) {
+            next_move = gcode_result.moves[i + 1];
+            next = &next_move;
+        }
 
         ++progress_count;
         if (progress_dialog != nullptr && progress_count % progress_threshold == 0) {
@@ -4,6 +4,7 @@
 #include "3DScene.hpp"
 #include "libslic3r/ExtrusionRole.hpp"
 #include "libslic3r/GCode/GCodeProcessor.hpp"
+#include "libslic3r/GCode/BinaryGCode.hpp"
 #include "GLModel.hpp"
 
 #include <boost/iostreams/device/mapped_file.hpp>
@@ -685,6 +686,8 @@ public:
             size_t m_last_lines_size{ 0 };
             std::string m_filename;
             boost::iostreams::mapped_file_source m_file;
+            // A binary G-code is not mapped, its lines are decoded from the G-code blocks on demand.
+            std::unique_ptr<BinaryGCode::File> m_binary_file;
             // map for accessing data in file by line number
             std::vector<size_t> m_lines_ends;
             // current visible lines
@@ -6843,6 +6843,9 @@ void Plater::send_gcode()
         return;
     }
     default_output_file = fs::path(Slic3r::fold_utf8_to_ascii(default_output_file.string()));
+    // The print hosts receive the text G-code, see BackgroundSlicingProcess::prepare_upload().
+    if (boost::iequals(default_output_file.extension().string(), ".sbgc"))
+        default_output_file.replace_extension(".gcode");
 
     // Repetier specific: Query the server for the list of file groups.
     wxArrayString groups;
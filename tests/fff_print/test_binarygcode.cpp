@@ -0,0 +1,185 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/beast/core/detail/base64.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include "libslic3r/GCode/BinaryGCode.hpp"
+#include "libslic3r/GCode/GCodeProcessor.hpp"
+#include "libslic3r/Exception.hpp"
+
+#include "test_data.hpp"
+
+using namespace Slic3r;
+using namespace Slic3r::Test;
+
+// Thumbnail comment block as written by GCodeThumbnails::export_thumbnails_to_file().
+static std::string thumbnail_comments(const std::string &tag, int width, int height, const std::string &image)
+{
+    namespace base64 = boost::beast::detail::base64;
+    std::string encoded(base64::encoded_size(image.size()), '\0');
+    encoded.resize(base64::encode(encoded.data(), image.data(), image.size()));
+    std::string out = "\n;\n; " + tag + " begin " + std::to_string(width) + "x" + std::to_string(height) + " " + std::to_string(encoded.size()) + "\n";
+    for (size_t i = 0; i < encoded.size(); i += 78)
+        out += "; " + encoded.substr(i, 78) + "\n";
+    return out + "; " + tag + " end\n;\n";
+}
+
+// Sliced G-code with two thumbnails inserted after the first line.
+static std::string gcode_with_thumbnails(const std::string &png)
+{
+    std::string gcode = Slic3r::Test::slice({ TestMesh::cube_20x20x20 }, {
+        { "gcode_comments", true }
+    });
+    gcode.insert(gcode.find('\n') + 1, thumbnail_comments("thumbnail", 16, 16, png) + thumbnail_comments("thumbnail_QOI", 32, 24, png.substr(0, 100)));
+    return gcode;
+}
+
+static std::string test_png()
+{
+    std::string png(300, '\0');
+    for (size_t i = 0; i < png.size(); ++ i)
+        png[i] = char(i * 7 + 3);
+    return png;
+}
+
+static void save(const std::string &data, const boost::filesystem::path &path)
+{
+    boost::nowide::ofstream out(path.string(), std::ios::binary);
+    out << data;
+}
+
+static std::string load(const boost::filesystem::path &path)
+{
+    boost::nowide::ifstream in(path.string(), std::ios::binary);
+    std::stringstream       ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+TEST_CASE("BinaryGCode: round trip of a sliced G-code", "[BinaryGCode]") {
+    const std::string png   = test_png();
+    const std::string gcode = gcode_with_thumbnails(png);
+
+    std::string binary = BinaryGCode::to_binary(gcode);
+    REQUIRE(BinaryGCode::is_binary(binary.data(), binary.size()));
+    REQUIRE(! BinaryGCode::is_binary(gcode.data(), gcode.size()));
+    REQUIRE(binary.size() * 3 < gcode.size());
+    REQUIRE(BinaryGCode::to_text(binary) == gcode);
+
+    BinaryGCode::FileInfo info = BinaryGCode::read_info(binary);
+    REQUIRE(info.thumbnails.size() == 2);
+    REQUIRE(info.thumbnails.front().format == BinaryGCode::ThumbnailFormat::PNG);
+    REQUIRE(info.thumbnails.front().data == png);
+    REQUIRE(info.thumbnails.back().format == BinaryGCode::ThumbnailFormat::QOI);
+    REQUIRE(info.thumbnails.back().width == 32);
+    REQUIRE(info.thumbnails.back().height == 24);
+    auto has_key = [](const BinaryGCode::Metadata &metadata, const std::string &key) {
+        return std::find_if(metadata.begin(), metadata.end(), [&key](const auto &kvp) { return kvp.first == key; }) != metadata.end();
+    };
+    REQUIRE(has_key(info.print_metadata, "estimated printing time (normal mode)"));
+    REQUIRE(has_key(info.slicer_metadata, "layer_height"));
+    REQUIRE(has_key(info.printer_metadata, "nozzle_diameter"));
+    REQUIRE(has_key(info.printer_metadata, "filament used [mm]"));
+}
+
+TEST_CASE("BinaryGCode: arbitrary text round trip", "[BinaryGCode]") {
+    // Not a G-code produced by PrusaSlicer, a broken thumbnail is kept as text.
+    std::string gcode = "G1 X1 Y2\n; thumbnail begin 2x2 8\n; QUJD\n; thumbnail end\nG1 X3";
+    for (const std::string &text : { std::string(), gcode, std::string(3 << 20, 'x') + "\n" + gcode }) {
+        std::string binary = BinaryGCode::to_binary(text);
+        REQUIRE(BinaryGCode::to_text(binary) == text);
+        REQUIRE(BinaryGCode::read_info(binary).thumbnails.empty());
+    }
+}
+
+TEST_CASE("BinaryGCode: corrupted file is rejected", "[BinaryGCode]") {
+    std::string binary = BinaryGCode::to_binary("G1 X1 Y2\nG1 X3 Y4\n");
+    binary[binary.size() - 6] ^= 1;
+    REQUIRE_THROWS_AS(BinaryGCode::to_text(binary), Slic3r::RuntimeError);
+    REQUIRE_THROWS_AS(BinaryGCode::to_text(binary.substr(0, binary.size() - 1)), Slic3r::RuntimeError);
+    REQUIRE_THROWS_AS(BinaryGCode::to_text("G1 X1 Y2\n"), Slic3r::RuntimeError);
+}
+
+TEST_CASE("BinaryGCode: streamed file conversion and random access", "[BinaryGCode]") {
+    const std::string             gcode  = gcode_with_thumbnails(test_png());
+    const boost::filesystem::path text   = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("binarygcode-%%%%-%%%%.gcode");
+    const boost::filesystem::path binary = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("binarygcode-%%%%-%%%%.sbgc");
+    save(gcode, text);
+
+    BinaryGCode::convert_to_binary(text.string(), binary.string());
+    REQUIRE(BinaryGCode::is_binary_file(binary.string()));
+    REQUIRE(load(binary) == BinaryGCode::to_binary(gcode));
+    REQUIRE(BinaryGCode::read_file_info(binary.string()).thumbnails.size() == 2);
+    {
+        BinaryGCode::File file(binary.string());
+        REQUIRE(file.size() == gcode.size());
+        // Ranges overlapping the thumbnails, crossing the end of the text and past the end.
+        for (size_t offset : { size_t(0), size_t(50), gcode.size() / 2, gcode.size() - 10, gcode.size() + 10 })
+            for (size_t len : { size_t(1), size_t(1000), size_t(100000) })
+                REQUIRE(file.read(offset, len) == (offset < gcode.size() ? gcode.substr(offset, len) : std::string()));
+
+        // The decoded lines span the text G-code, the moves are decoded into their axis values.
+        size_t offset    = 0;
+        size_t num_moves = 0;
+        file.for_each_line([&gcode, &offset, &num_moves](const BinaryGCode::Line &line) {
+            const std::string text = gcode.substr(offset, line.length);
+            if (line.type == BinaryGCode::Line::Type::Text)
+                REQUIRE(text == std::string(line.text) + "\n");
+            else {
+                REQUIRE(text.substr(0, 3) == (line.type == BinaryGCode::Line::Type::G1 ? "G1 " : "G0 "));
+                if (line.axes & (1 << int(X)))
+                    REQUIRE(line.values[X] == std::stod(text.substr(text.find(" X") + 2)));
+                ++ num_moves;
+            }
+            offset += line.length;
+            return true;
+        });
+        REQUIRE(offset == gcode.size());
+        REQUIRE(num_moves > 1000);
+    }
+
+    // Convert in place.
+    BinaryGCode::convert_to_text(binary.string(), binary.string());
+    REQUIRE(load(binary) == gcode);
+    BinaryGCode::convert_to_binary(binary.string(), binary.string());
+    REQUIRE(BinaryGCode::is_binary_file(binary.string()));
+    BinaryGCode::convert_to_text(binary.string(), text.string());
+    REQUIRE(load(text) == gcode);
+
+    boost::filesystem::remove(text);
+    boost::filesystem::remove(binary);
+}
+
+TEST_CASE("BinaryGCode: GCodeProcessor loads a binary G-code", "[BinaryGCode]") {
+    const std::string             gcode  = gcode_with_thumbnails(test_png());
+    const boost::filesystem::path text   = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("binarygcode-%%%%-%%%%.gcode");
+    const boost::filesystem::path binary = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("binarygcode-%%%%-%%%%.sbgc");
+    save(gcode, text);
+    save(BinaryGCode::to_binary(gcode), binary);
+
+    GCodeProcessor text_processor;
+    text_processor.process_file(text.string());
+    GCodeProcessor binary_processor;
+    binary_processor.process_file(binary.string());
+    using ETimeMode = PrintEstimatedStatistics::ETimeMode;
+    REQUIRE(binary_processor.get_time(ETimeMode::Normal) > 0.f);
+    REQUIRE(binary_processor.get_time(ETimeMode::Normal) == text_processor.get_time(ETimeMode::Normal));
+    GCodeProcessorResult text_result   = text_processor.extract_result();
+    GCodeProcessorResult binary_result = binary_processor.extract_result();
+    REQUIRE(binary_result.filename == binary.string());
+    REQUIRE(binary_result.moves.size() == text_result.moves.size());
+    // The line ends index the decoded text, which is read by the G-code window of the viewer.
+    REQUIRE(binary_result.lines_ends == text_result.lines_ends);
+
+    // The binary G-code of the Prusa printers is rejected.
+    save(std::string("GCDE\1\0\0\0\1\0", 10), binary);
+    GCodeProcessor processor;
+    REQUIRE_THROWS_AS(processor.process_file(binary.string()), Slic3r::RuntimeError);
+
+    boost::filesystem::remove(text);
+    boost::filesystem::remove(binary);
+}
@@ -3,6 +3,8 @@
 #include <numeric>
 #include <sstream>
 
+#include <tbb/parallel_for.h>
+
 #include "test_data.hpp" // get access to init_print, etc
 
 #include "libslic3r/Config.hpp"
@@ -273,3 +275,52 @@ SCENARIO("Cooling integration tests", "[Cooling]") {
         }
     }
 }
+
+TEST_CASE("Cooling: layers prepared in parallel produce the same G-code", "[Cooling]") {
+    auto config = DynamicPrintConfig::full_print_config_with({
+        { "cooling",                     "1, 1" },
+        { "fan_below_layer_time",        "60, 60" },
+        { "slowdown_below_layer_time",   "30, 30" },
+        { "min_print_speed",             "10, 10" },
+        { "disable_fan_first_layers",    "0, 0" }
+    });
+    // Layers of G-code and whether the cooling buffer is flushed after them, support layers are not flushed.
+    const std::vector<std::pair<std::string, bool>> layers {
+        { "G1 X10 Y10 F6000\nG1 F3000;_EXTRUDE_SET_SPEED\nG1 X100 E1\nG1 Y50 E2\n;_EXTRUDE_END\n", true },
+        { "G92 E0\nG1 X50 F3000;_EXTRUDE_SET_SPEED;_EXTERNAL_PERIMETER\nG1 X0 E1\n;_EXTRUDE_END\n", false },
+        { "T1\nG1 X20 E1 F1800\nG4 S1\n;_SET_FAN_SPEED50\nG1 X40 E2\n;_RESET_FAN_SPEED\n", true },
+        // F failing to parse, the feedrate is kept and converted to mm/sec again.
+        { "G1 X60 E1 F\nT0\n;_BRIDGE_FAN_START\nG1 F2400;_EXTRUDE_SET_SPEED\nG1 X80 E2\n;_EXTRUDE_END\n;_BRIDGE_FAN_END\n", false },
+        // The last line is not terminated, thus it is merged with the first line of the following layer.
+        { "G1 X10 E1 F1500", false },
+        { " Y20\nG1 X30 E2\n", true },
+        { "G1 X0 Y0 E1 F3000\nT1\nT1\nG1 X5 E2\n", true }
+    };
+
+    // Reference: the G-code collected until a flush is parsed at once.
+    GCode gcodegen_reference;
+    auto  reference = make_cooling_buffer(gcodegen_reference, config, { 0, 1 });
+    std::string gcode_reference;
+    std::string collected;
+    for (size_t layer_id = 0; layer_id < layers.size(); ++ layer_id) {
+        collected += layers[layer_id].first;
+        if (layers[layer_id].second) {
+            gcode_reference += reference->process_layer(std::move(collected), layer_id, true);
+            collected.clear();
+        }
+    }
+
+    // Layers prepared in parallel, then processed in order.
+    GCode gcodegen;
+    auto  buffer = make_cooling_buffer(gcodegen, config, { 0, 1 });
+    std::vector<CoolingPreparedLayer> prepared(layers.size());
+    tbb::parallel_for(size_t(0), layers.size(), [&buffer, &layers, &prepared](size_t layer_id) {
+        prepared[layer_id] = buffer->prepare_layer(layers[layer_id].first);
+    });
+    std::string gcode;
+    for (size_t layer_id = 0; layer_id < layers.size(); ++ layer_id)
+        gcode += buffer->process_layer(std::string(layers[layer_id].first), std::move(prepared[layer_id]), layer_id, layers[layer_id].second);
+
+    REQUIRE(! gcode.empty());
+    REQUIRE(gcode == gcode_reference);
+}
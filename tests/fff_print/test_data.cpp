@@ -354,6 +354,19 @@ std::string slice(std::initializer_list<TriangleMesh> meshes, std::initializer_l
 	return gcode(print);
 }
 
+std::string strip_header(std::string gcode)
+{
+    if (size_t pos = gcode.find("; generated by"); pos != std::string::npos)
+        gcode.erase(pos, gcode.find('\n', pos) - pos);
+    return gcode;
+}
+
+std::pair<std::string, std::string> slice_parallel_and_serial(std::initializer_list<TestMesh> meshes, std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> config_items)
+{
+    auto [parallel, serial] = run_parallel_and_serial([meshes, config_items]() { return slice(meshes, config_items); });
+    return { strip_header(std::move(parallel)), strip_header(std::move(serial)) };
+}
+
 bool contains(const std::string &data, const std::string &pattern)
 {
     return data.find(pattern) != data.npos;    
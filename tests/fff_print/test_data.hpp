@@ -9,6 +9,9 @@
 #include "libslic3r/TriangleMesh.hpp"
 
 #include <unordered_map>
+#include <utility>
+
+#include <tbb/task_arena.h>
 
 namespace Slic3r { namespace Test {
 
@@ -81,6 +84,23 @@ std::string slice(std::initializer_list<TriangleMesh> meshes, const DynamicPrint
 std::string slice(std::initializer_list<TestMesh> meshes, std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> config_items, bool comments = false);
 std::string slice(std::initializer_list<TriangleMesh> meshes, std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> config_items, bool comments = false);
 
+// Removes the line with the time stamp from the G-code header, so that the G-codes of two runs could be compared.
+std::string strip_header(std::string gcode);
+
+// Runs fn with the default number of threads and then in a single thread task arena.
+// Returns both results as { parallel, serial } to check that the parallel processing matches the serial one.
+template<typename Fn>
+auto run_parallel_and_serial(Fn &&fn)
+{
+    auto parallel = fn();
+    decltype(parallel) serial;
+    tbb::task_arena(1).execute([&serial, &fn]() { serial = fn(); });
+    return std::make_pair(std::move(parallel), std::move(serial));
+}
+
+// G-codes without the time stamp of slicing the meshes with the default number of threads and in a single thread: { parallel, serial }.
+std::pair<std::string, std::string> slice_parallel_and_serial(std::initializer_list<TestMesh> meshes, std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> config_items);
+
 bool contains(const std::string &data, const std::string &pattern);
 bool contains_regex(const std::string &data, const std::string &pattern);
 
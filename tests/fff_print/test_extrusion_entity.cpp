@@ -1,10 +1,13 @@
 #include <catch2/catch.hpp>
 
 #include <cstdlib>
+#include <functional>
 
 #include "libslic3r/ExtrusionEntityCollection.hpp"
 #include "libslic3r/ExtrusionEntity.hpp"
+#include "libslic3r/Layer.hpp"
 #include "libslic3r/Point.hpp"
+#include "libslic3r/Print.hpp"
 #include "libslic3r/ShortestPath.hpp"
 #include "libslic3r/libslic3r.h"
 
@@ -407,3 +410,125 @@ TEST_CASE("ExtrusionEntityCollection: Chained path with no explicit starting poi
     auto chained   = chain_polylines(polylines);
     REQUIRE(chained == target);
 }
+
+SCENARIO("ExtrusionPath: nonplanar Z", "[ExtrusionEntity]")
+{
+    GIVEN("Nonplanar path") {
+        ExtrusionPath path = new_extrusion_path(Polyline { { 0, 0 }, { 1000, 0 }, { 2000, 0 }, { 3000, 0 } }, ExtrusionRole::TopSolidInfillNonplanar, 1.);
+        path.nonplanar_z = { 100, 200, 300, 400 };
+        WHEN("reversed") {
+            path.reverse();
+            THEN("Z follows the points") {
+                REQUIRE(path.first_point() == Point(3000, 0));
+                REQUIRE(path.nonplanar_z == std::vector<coord_t>{ 400, 300, 200, 100 });
+            }
+        }
+        WHEN("end clipped") {
+            path.clip_end(1500.);
+            THEN("Z is clipped with the points, the new end point takes Z of its predecessor") {
+                REQUIRE(path.polyline.points == Points{ { 0, 0 }, { 1000, 0 }, { 1500, 0 } });
+                REQUIRE(path.nonplanar_z == std::vector<coord_t>{ 100, 200, 200 });
+            }
+        }
+        WHEN("simplified") {
+            path.simplify(10.);
+            THEN("points defining the nonplanar profile are kept") {
+                REQUIRE(path.size() == 4);
+                REQUIRE(path.nonplanar_z.size() == 4);
+            }
+        }
+        WHEN("simplified with a constant Z") {
+            path.nonplanar_z = { 500, 500, 500, 500 };
+            path.simplify(10.);
+            THEN("the path is simplified in 2D") {
+                REQUIRE(path.polyline.points == Points{ { 0, 0 }, { 3000, 0 } });
+                REQUIRE(path.nonplanar_z == std::vector<coord_t>{ 500, 500 });
+            }
+        }
+    }
+    GIVEN("Nonplanar loop made of two paths") {
+        ExtrusionLoop loop;
+        loop.paths.emplace_back(new_extrusion_path(Polyline { { 0, 0 }, { 1000, 0 }, { 1000, 1000 } }, ExtrusionRole::ExternalPerimeter, 1.));
+        loop.paths.back().nonplanar_z = { 10, 20, 30 };
+        loop.paths.emplace_back(new_extrusion_path(Polyline { { 1000, 1000 }, { 0, 1000 }, { 0, 0 } }, ExtrusionRole::ExternalPerimeter, 1.));
+        loop.paths.back().nonplanar_z = { 30, 40, 10 };
+        WHEN("split at a vertex") {
+            loop.split_at_vertex(Point(1000, 0));
+            THEN("Z stays attached to the points") {
+                for (const ExtrusionPath &path : loop.paths)
+                    REQUIRE(path.nonplanar_z.size() == path.size());
+                REQUIRE(loop.paths.front().first_point() == Point(1000, 0));
+                REQUIRE(loop.paths.front().first_z() == 20);
+                REQUIRE(loop.paths.back().last_point() == Point(1000, 0));
+                REQUIRE(loop.paths.back().last_z() == 20);
+            }
+        }
+        WHEN("split inside a segment") {
+            loop.split_at(Point(500, 0), false, 0.);
+            THEN("the new split point takes Z of the segment end") {
+                for (const ExtrusionPath &path : loop.paths)
+                    REQUIRE(path.nonplanar_z.size() == path.size());
+                REQUIRE(loop.paths.front().first_point() == Point(500, 0));
+                REQUIRE(loop.paths.front().first_z() == 20);
+                REQUIRE(loop.paths.front().z(1) == 20);
+                REQUIRE(loop.paths.back().last_point() == Point(500, 0));
+                REQUIRE(loop.paths.back().last_z() == 20);
+                REQUIRE(loop.paths.back().z(loop.paths.back().size() - 2) == 10);
+            }
+        }
+    }
+}
+
+// Visit all extrusion paths of a collection, including the paths of loops and multi-paths.
+static void visit_paths(const ExtrusionEntityCollection &collection, const std::function<void(const ExtrusionPath&)> &visitor)
+{
+    for (const ExtrusionEntity *entity : collection.entities)
+        if (auto *sub_collection = dynamic_cast<const ExtrusionEntityCollection*>(entity))
+            visit_paths(*sub_collection, visitor);
+        else if (auto *path = dynamic_cast<const ExtrusionPath*>(entity))
+            visitor(*path);
+        else if (auto *loop = dynamic_cast<const ExtrusionLoop*>(entity))
+            for (const ExtrusionPath &p : loop->paths)
+                visitor(p);
+        else if (auto *multi_path = dynamic_cast<const ExtrusionMultiPath*>(entity))
+            for (const ExtrusionPath &p : multi_path->paths)
+                visitor(p);
+}
+
+TEST_CASE("Nonplanar Z side channel memory on a sliced object", "[.][ExtrusionEntity][Benchmark]")
+{
+    // Point is a plain Vec2crd, the nonplanar Z is only paid for by the projected extrusion paths.
+    static_assert(sizeof(Point) == sizeof(Vec2crd), "Point shall not carry any data besides its XY coordinates");
+
+    Print print;
+    Test::init_and_process_print({ Test::TestMesh::slopy_cube }, print, {
+        { "use_nonplanar_layers",    1 },
+        { "nonplanar_layers_angle",  30 },
+        { "nonplanar_layers_height", 10 },
+        { "top_solid_layers",        3 }
+    });
+
+    // Heap memory of the extruded points, of the nonplanar Z side channel and of a Z stored with each point.
+    size_t num_points = 0, num_nonplanar_paths = 0, points_bytes = 0, nonplanar_z_bytes = 0;
+    auto   account = [&](const ExtrusionPath &path) {
+        num_points        += path.polyline.points.size();
+        points_bytes      += path.polyline.points.capacity() * sizeof(Point);
+        nonplanar_z_bytes += path.nonplanar_z.capacity() * sizeof(coord_t);
+        if (path.is_nonplanar()) {
+            ++ num_nonplanar_paths;
+            REQUIRE(path.nonplanar_z.size() == path.polyline.points.size());
+        }
+    };
+    for (const PrintObject *object : print.objects())
+        for (const Layer *layer : object->layers())
+            for (const LayerRegion *layerm : layer->regions()) {
+                visit_paths(layerm->perimeters(), account);
+                visit_paths(layerm->fills(), account);
+            }
+
+    const size_t per_point_z_bytes = num_points * sizeof(Vec3crd);
+    INFO(num_points << " points in " << num_nonplanar_paths << " nonplanar paths: " << points_bytes + nonplanar_z_bytes <<
+         " bytes with the Z side channel, " << per_point_z_bytes << " bytes with a Z stored with each point");
+    REQUIRE(num_nonplanar_paths > 0);
+    REQUIRE(points_bytes + nonplanar_z_bytes < per_point_z_bytes);
+}
@@ -7,6 +7,8 @@
 
 #include "libslic3r/ClipperUtils.hpp"
 #include "libslic3r/Fill/Fill.hpp"
+#include "libslic3r/Fill/Lightning/Generator.hpp"
+#include "libslic3r/Fill/Lightning/TreeNode.hpp"
 #include "libslic3r/Flow.hpp"
 #include "libslic3r/Layer.hpp"
 #include "libslic3r/Geometry.hpp"
@@ -17,6 +19,8 @@
 
 #include "test_data.hpp"
 
+#include <tbb/task_arena.h>
+
 using namespace Slic3r;
 using namespace std::literals;
 
@@ -664,6 +668,124 @@ SCENARIO("Infill density zero", "[Fill]")
 }
 */
 
+// Lightning trees of the layers of a generator as text, one line per tree.
+// The trees are compared, not the G-code, as Node::convertToPolylines() starts with a random child.
+static std::string lightning_trees(const FillLightning::Generator &generator, size_t num_layers)
+{
+    std::string out;
+    for (size_t layer_id = 0; layer_id < num_layers; ++ layer_id) {
+        out += "layer " + std::to_string(layer_id) + "\n";
+        for (const FillLightning::NodeSPtr &root : generator.getTreesForLayer(layer_id).tree_roots) {
+            root->visitBranches([&out](const Point &from, const Point &to) {
+                out += std::to_string(from.x()) + "," + std::to_string(from.y()) + " " + std::to_string(to.x()) + "," + std::to_string(to.y()) + " ";
+            });
+            out += "\n";
+        }
+    }
+    return out;
+}
+
+SCENARIO("Lightning infill reuses the trees of unchanged layers", "[Fill]")
+{
+    auto throw_on_cancel = []() {};
+
+    GIVEN("20mm cube with lightning infill") {
+        auto config = Slic3r::DynamicPrintConfig::full_print_config_with({
+            { "fill_pattern",           "lightning" },
+            { "fill_density",           "15%" },
+            { "bottom_solid_layers",    3 },
+            { "layer_height",           0.2 },
+            { "first_layer_height",     0.2 }
+        });
+        Print print;
+        Model model;
+        Slic3r::Test::init_print({ Slic3r::Test::TestMesh::cube_20x20x20 }, print, model, config);
+        print.process();
+        const PrintObject              &object = *print.objects().front();
+        const size_t                    num_layers = object.layer_count();
+        const FillLightning::Generator  previous(object, 15., throw_on_cancel);
+        const std::string               previous_trees = lightning_trees(previous, num_layers);
+        REQUIRE(previous_trees.size() > num_layers * 16);
+        WHEN("the bottom layers change") {
+            config.set_deserialize_strict({ { "bottom_solid_layers", 5 } });
+            print.apply(model, config);
+            print.process();
+            const FillLightning::Generator generator(object, 15., throw_on_cancel, &previous);
+            THEN("the trees of the top layers are taken over") {
+                const size_t num_reused = generator.numReusedLayers();
+                REQUIRE(num_reused > 0);
+                REQUIRE(num_reused < num_layers);
+                for (size_t layer_id = num_layers - num_reused; layer_id < num_layers; ++ layer_id)
+                    REQUIRE(generator.getTreesForLayer(layer_id).tree_roots == previous.getTreesForLayer(layer_id).tree_roots);
+            }
+            THEN("the trees match the trees generated from scratch") {
+                REQUIRE(lightning_trees(generator, num_layers) == lightning_trees(FillLightning::Generator(object, 15., throw_on_cancel), num_layers));
+            }
+        }
+        WHEN("the infill does not change") {
+            print.apply(model, config);
+            print.process();
+            const FillLightning::Generator generator(object, 15., throw_on_cancel, &previous);
+            THEN("all the trees are taken over") {
+                REQUIRE(generator.numReusedLayers() == num_layers);
+                for (size_t layer_id = 0; layer_id < num_layers; ++ layer_id)
+                    REQUIRE(generator.getTreesForLayer(layer_id).tree_roots == previous.getTreesForLayer(layer_id).tree_roots);
+                REQUIRE(lightning_trees(generator, num_layers) == previous_trees);
+            }
+        }
+    }
+}
+
+SCENARIO("Lightning infill of separate islands does not depend on the number of threads", "[Fill]")
+{
+    auto trees = [](const PrintObject &object, int num_threads) {
+        std::string out;
+        tbb::task_arena arena(num_threads);
+        arena.execute([&object, &out]() {
+            out = lightning_trees(FillLightning::Generator(object, 20., []() {}), object.layer_count());
+        });
+        return out;
+    };
+
+    GIVEN("Object of two 20mm cubes 20mm apart with lightning infill") {
+        TriangleMesh mesh = Slic3r::Test::mesh(Slic3r::Test::TestMesh::cube_20x20x20);
+        mesh.merge(Slic3r::Test::mesh(Slic3r::Test::TestMesh::cube_20x20x20, Vec3d(40., 0., 0.), Vec3d::Ones()));
+        Print print;
+        Slic3r::Test::init_and_process_print({ mesh }, print, {
+            { "fill_pattern",           "lightning" },
+            { "fill_density",           "20%" }
+        });
+        const PrintObject &object = *print.objects().front();
+
+        const std::string serial = trees(object, 1);
+        THEN("the islands have trees") {
+            REQUIRE(serial.size() > object.layer_count() * 16);
+        }
+        THEN("the trees processed by two threads match the serial processing") {
+            REQUIRE(trees(object, 2) == serial);
+        }
+        THEN("the trees processed by four threads match the serial processing") {
+            REQUIRE(trees(object, 4) == serial);
+        }
+    }
+    GIVEN("Object of two 20mm cubes 20mm apart bridged by a 5mm slab with lightning infill") {
+        // The trees supporting the slab are propagated into both cubes, a tree may span both of them.
+        TriangleMesh mesh = Slic3r::Test::mesh(Slic3r::Test::TestMesh::cube_20x20x20);
+        mesh.merge(Slic3r::Test::mesh(Slic3r::Test::TestMesh::cube_20x20x20, Vec3d(40., 0., 0.), Vec3d::Ones()));
+        mesh.merge(Slic3r::Test::mesh(Slic3r::Test::TestMesh::cube_20x20x20, Vec3d(0., 0., 80.), Vec3d(3., 1., 0.25)));
+        Print print;
+        Slic3r::Test::init_and_process_print({ mesh }, print, {
+            { "fill_pattern",           "lightning" },
+            { "fill_density",           "20%" }
+        });
+        const PrintObject &object = *print.objects().front();
+
+        THEN("the trees processed by four threads match the serial processing") {
+            REQUIRE(trees(object, 4) == trees(object, 1));
+        }
+    }
+}
+
 bool test_if_solid_surface_filled(const ExPolygon& expolygon, double flow_spacing, double angle, double density)
 {
     std::unique_ptr<Slic3r::Fill> filler(Slic3r::Fill::new_from_type("rectilinear"));
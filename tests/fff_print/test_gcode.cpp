@@ -1,10 +1,18 @@
 #include <catch2/catch.hpp>
 
+#include <algorithm>
 #include <memory>
 
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
+
 #include "libslic3r/GCode.hpp"
+#include "libslic3r/GCode/GCodeProcessor.hpp"
+
+#include "test_data.hpp"
 
 using namespace Slic3r;
+using namespace Slic3r::Test;
 
 SCENARIO("Origin manipulation", "[GCode]") {
 	Slic3r::GCode gcodegen;
@@ -20,3 +28,176 @@ SCENARIO("Origin manipulation", "[GCode]") {
     	}
     }
 }
+
+TEST_CASE("GCodeProcessorResult::MoveVertices stores the moves up to the quantization", "[GCode]") {
+    auto make_move = [](size_t i) {
+        GCodeProcessorResult::MoveVertex move;
+        move.gcode_id       = (unsigned int)(3 * i);
+        move.type           = (i % 3 == 0) ? EMoveType::Travel : EMoveType::Extrude;
+        move.extrusion_role = (i % 3 == 0) ? GCodeExtrusionRole::None : GCodeExtrusionRole::Perimeter;
+        move.extruder_id    = (unsigned char)(i / 50);
+        move.position       = Vec3f(float(i), 0.5f * float(i), 0.2f * float(i / 10));
+        move.delta_extruder = (i % 3 == 0) ? 0.f : 0.01f * float(i);
+        move.feedrate       = (i % 3 == 0) ? 150.f : 40.f;
+        move.width          = 0.45f;
+        move.height         = 0.2f;
+        move.mm3_per_mm     = (i % 3 == 0) ? 0.f : 0.08f;
+        move.fan_speed      = (i < 10) ? 0.f : 100.f;
+        move.temperature    = 215.f;
+        move.internal_only  = i == 7;
+        return move;
+    };
+    using MoveVertices = GCodeProcessorResult::MoveVertices;
+    auto same = [](const GCodeProcessorResult::MoveVertex &a, const GCodeProcessorResult::MoveVertex &b) {
+        return a.gcode_id == b.gcode_id && a.type == b.type && a.extrusion_role == b.extrusion_role && a.extruder_id == b.extruder_id &&
+            a.cp_color_id == b.cp_color_id && (a.position - b.position).cwiseAbs().maxCoeff() <= 0.5 * MoveVertices::Position_Quantum + EPSILON &&
+            std::abs(a.delta_extruder - b.delta_extruder) <= 0.5 * MoveVertices::Extrusion_Quantum + EPSILON &&
+            (a.delta_extruder > 0.f) == (b.delta_extruder > 0.f) && (a.delta_extruder < 0.f) == (b.delta_extruder < 0.f) && a.feedrate == b.feedrate &&
+            a.width == b.width && a.height == b.height && a.mm3_per_mm == b.mm3_per_mm && a.fan_speed == b.fan_speed &&
+            a.temperature == b.temperature && a.internal_only == b.internal_only;
+    };
+
+    GCodeProcessorResult::MoveVertices moves;
+    for (size_t i = 0; i < 200; ++ i)
+        moves.push_back(make_move(i));
+    REQUIRE(moves.size() == 200);
+    // Travel and extrusion, 4 extruders, fan off and on, one internal only move.
+    REQUIRE(moves.attributes_count() == 2 * 4 + 2 + 1);
+    for (size_t i = 0; i < moves.size(); ++ i)
+        REQUIRE(same(moves[i], make_move(i)));
+    REQUIRE(std::all_of(moves.begin(), moves.end(), [](const GCodeProcessorResult::MoveVertex &move) { return move.width == 0.45f; }));
+    REQUIRE(moves.end() - moves.begin() == 200);
+
+    moves.shrink_to_fit();
+    moves.set_gcode_id(5, 1000);
+    moves.erase(0);
+    // The attributes are deduplicated against the released map too.
+    moves.push_back(make_move(1));
+    REQUIRE(moves.attributes_count() == 2 * 4 + 2 + 1);
+    REQUIRE(moves.size() == 200);
+    REQUIRE(moves[4].gcode_id == 1000);
+    REQUIRE(same(moves[10], make_move(11)));
+    REQUIRE(same(moves.back(), make_move(1)));
+}
+
+TEST_CASE("GCodeProcessorResult::MoveVertices stores the moves not fitting the deltas in full", "[GCode]") {
+    using MoveVertices = GCodeProcessorResult::MoveVertices;
+    auto make_move = [](size_t i) {
+        GCodeProcessorResult::MoveVertex move;
+        // Every 5th move jumps 100mm, every 7th move follows a long custom G-code block.
+        move.gcode_id       = (unsigned int)(10 * i + 100000 * (i / 7));
+        move.type           = EMoveType::Extrude;
+        move.extrusion_role = GCodeExtrusionRole::Perimeter;
+        move.position       = Vec3f(0.1f * float(i) + 100.f * float(i / 5), 20.f, 0.2f);
+        // Extrusions too long or too short for the deltas.
+        move.delta_extruder = (i % 11 == 0) ? 10.f : (i % 13 == 0) ? 1e-6f : 0.05f;
+        move.feedrate       = 40.f;
+        return move;
+    };
+    auto same = [](const GCodeProcessorResult::MoveVertex &a, const GCodeProcessorResult::MoveVertex &b) {
+        return a.gcode_id == b.gcode_id && (a.position - b.position).cwiseAbs().maxCoeff() <= 0.5 * MoveVertices::Position_Quantum + EPSILON &&
+            std::abs(a.delta_extruder - b.delta_extruder) <= 0.5 * MoveVertices::Extrusion_Quantum + EPSILON && (a.delta_extruder > 0.f) == (b.delta_extruder > 0.f);
+    };
+
+    MoveVertices moves;
+    for (size_t i = 0; i < 300; ++ i)
+        moves.push_back(make_move(i));
+    REQUIRE(moves.escaped_count() > 0);
+    REQUIRE(moves.escaped_count() < moves.size());
+    for (size_t i = 0; i < moves.size(); ++ i) {
+        REQUIRE(same(moves[i], make_move(i)));
+        REQUIRE(moves.position(i) == moves[i].position);
+        REQUIRE(moves.gcode_id(i) == moves[i].gcode_id);
+    }
+
+    // G-code line ids of a block too far apart.
+    const size_t escaped_count = moves.escaped_count();
+    moves.set_gcode_id(33, 1000);
+    moves.set_gcode_id(34, 4000000);
+    REQUIRE(moves.escaped_count() > escaped_count);
+    REQUIRE(moves.gcode_id(33) == 1000);
+    REQUIRE(moves.gcode_id(34) == 4000000);
+    for (size_t i = 0; i < moves.size(); ++ i)
+        if (i != 33 && i != 34)
+            REQUIRE(same(moves[i], make_move(i)));
+
+    moves.erase(40);
+    REQUIRE(moves.size() == 299);
+    REQUIRE(same(moves[39], make_move(39)));
+    REQUIRE(same(moves[40], make_move(41)));
+    REQUIRE(same(moves.back(), make_move(299)));
+}
+
+TEST_CASE("GCodeProcessorResult::MoveVertices widens the attribute indices", "[GCode]") {
+    GCodeProcessorResult::MoveVertices moves;
+    GCodeProcessorResult::MoveVertex   move;
+    move.type = EMoveType::Extrude;
+    for (size_t i = 0; i < 70000; ++ i) {
+        move.feedrate = float(i % 66000);
+        move.position = Vec3f(0.01f * float(i % 1000), 0.f, 0.2f);
+        moves.push_back(move);
+    }
+    REQUIRE(moves.attributes_count() == 66000);
+    for (size_t i = 0; i < moves.size(); i += 997)
+        REQUIRE(moves[i].feedrate == float(i % 66000));
+    REQUIRE(moves[69999].feedrate == float(69999 % 66000));
+}
+
+TEST_CASE("GCodeProcessorResult::MoveVertices takes at most 14 bytes per move", "[GCode]") {
+    GCodeProcessorResult::MoveVertices moves;
+    GCodeProcessorResult::MoveVertex   move;
+    move.type           = EMoveType::Extrude;
+    move.extrusion_role = GCodeExtrusionRole::ExternalPerimeter;
+    move.feedrate       = 25.f;
+    // Perimeters of a 10mm cylinder.
+    for (size_t i = 0; i < 100000; ++ i) {
+        const double angle = 2. * M_PI * double(i % 360) / 360.;
+        move.gcode_id       = (unsigned int)(i + 1);
+        move.position       = Vec3f(float(100. + 10. * cos(angle)), float(100. + 10. * sin(angle)), 0.2f * float(i / 360 + 1));
+        move.delta_extruder = 0.00577f;
+        moves.push_back(move);
+    }
+    moves.shrink_to_fit();
+    REQUIRE(moves.escaped_count() == 0);
+    REQUIRE(moves.memsize() <= 14 * moves.size());
+}
+
+TEST_CASE("GCodeProcessor estimates the same times with the time machines processed concurrently", "[GCode]") {
+    // Small gyroid segments on a sphere accumulate many time blocks, the stealth mode enables the second time machine.
+    const std::string gcode = Slic3r::Test::slice({ TestMesh::sphere_50mm }, {
+        { "gcode_flavor",         "marlin2" },
+        { "machine_limits_usage", "time_estimate_only" },
+        { "silent_mode",          1 },
+        { "fill_pattern",         "gyroid" },
+        { "fill_density",         "20%" }
+    });
+    const boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcodeprocessor-%%%%-%%%%.gcode");
+    {
+        boost::nowide::ofstream out(path.string());
+        out << gcode;
+    }
+    auto process = [&path](bool deferred_time_refresh) {
+        auto processor = std::make_unique<GCodeProcessor>();
+        processor->enable_deferred_time_refresh(deferred_time_refresh);
+        processor->process_file(path.string());
+        return processor;
+    };
+    auto [parallel, serial] = Slic3r::Test::run_parallel_and_serial([&process]() { return process(true); });
+    // Each planner window calculated as soon as it is complete, as before the windows were deferred to be processed concurrently.
+    std::unique_ptr<GCodeProcessor> reference = process(false);
+    boost::filesystem::remove(path);
+
+    using ETimeMode = PrintEstimatedStatistics::ETimeMode;
+    auto same_times = [](const GCodeProcessor &lhs, const GCodeProcessor &rhs, ETimeMode mode) {
+        return lhs.get_time(mode) == rhs.get_time(mode) && lhs.get_travel_time(mode) == rhs.get_travel_time(mode) &&
+            lhs.get_moves_time(mode) == rhs.get_moves_time(mode) && lhs.get_roles_time(mode) == rhs.get_roles_time(mode) &&
+            lhs.get_layers_time(mode) == rhs.get_layers_time(mode);
+    };
+    REQUIRE(parallel->get_time(ETimeMode::Normal) > 0.f);
+    REQUIRE(parallel->get_time(ETimeMode::Stealth) > 0.f);
+    REQUIRE(parallel->get_time(ETimeMode::Normal) != parallel->get_time(ETimeMode::Stealth));
+    for (ETimeMode mode : { ETimeMode::Normal, ETimeMode::Stealth }) {
+        REQUIRE(same_times(*parallel, *serial, mode));
+        REQUIRE(same_times(*parallel, *reference, mode));
+    }
+}
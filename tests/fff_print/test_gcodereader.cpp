@@ -0,0 +1,110 @@
+#include <catch2/catch.hpp>
+
+#include <random>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+#include "libslic3r/GCodeReader.hpp"
+
+using namespace Slic3r;
+
+// Parse the G-code from a file and from a buffer, collect the lines and the reader positions reported to the callback.
+struct ParsedGCode {
+    std::vector<std::string>    lines;
+    std::vector<float>          positions;
+    std::vector<size_t>         lines_ends;
+
+    void add(const GCodeReader &reader, const GCodeReader::GCodeLine &line) {
+        lines.emplace_back(line.raw());
+        positions.insert(positions.end(), { reader.x(), reader.y(), reader.e(), line.has_e() ? line.e() : -1.f, float(line.has_unknown_axis()) });
+    }
+};
+
+static ParsedGCode parse_file(const std::string &gcode, bool relative_e)
+{
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcodereader-%%%%-%%%%.gcode");
+    FILE *f = boost::nowide::fopen(temp.string().c_str(), "wb");
+    REQUIRE(f != nullptr);
+    fwrite(gcode.data(), 1, gcode.size(), f);
+    fclose(f);
+
+    ParsedGCode out;
+    GCodeReader reader;
+    DynamicPrintConfig config;
+    config.set_deserialize_strict({ { "use_relative_e_distances", relative_e } });
+    reader.apply_config(config);
+    bool ok = reader.parse_file(temp.string(), [&out](GCodeReader &reader, const GCodeReader::GCodeLine &line) { out.add(reader, line); }, out.lines_ends);
+    boost::nowide::remove(temp.string().c_str());
+    REQUIRE(ok);
+    return out;
+}
+
+static ParsedGCode parse_buffer(const std::string &gcode, bool relative_e)
+{
+    ParsedGCode out;
+    GCodeReader reader;
+    DynamicPrintConfig config;
+    config.set_deserialize_strict({ { "use_relative_e_distances", relative_e } });
+    reader.apply_config(config);
+    reader.parse_buffer(gcode, [&out](GCodeReader &reader, const GCodeReader::GCodeLine &line) { out.add(reader, line); });
+    for (size_t i = 0; i < gcode.size(); ++ i)
+        if (gcode[i] == '\n')
+            out.lines_ends.emplace_back(i + 1);
+    return out;
+}
+
+static std::string random_gcode(size_t size, bool terminated)
+{
+    std::mt19937 rng(size);
+    const char *line_ends[] = { "\n", "\r\n", "\r", "\n\n" };
+    std::string gcode;
+    char buf[128];
+    while (gcode.size() < size) {
+        switch (rng() % 6) {
+        case 0:  snprintf(buf, sizeof(buf), "G1 X%.3f Y%.3f E%.5f", (rng() % 20000) / 100., (rng() % 20000) / 100., (rng() % 1000) / 1000.); break;
+        case 1:  snprintf(buf, sizeof(buf), "G92 E0"); break;
+        case 2:  snprintf(buf, sizeof(buf), ";TYPE:Perimeter %u", unsigned(rng())); break;
+        case 3:  snprintf(buf, sizeof(buf), "  G0 Z%.2f F%d ; travel", (rng() % 200) / 10., int(rng() % 9000)); break;
+        case 4:  snprintf(buf, sizeof(buf), "G1 Xbad Y1.5 Q7"); break;
+        default: buf[0] = 0;
+        }
+        gcode += buf;
+        gcode += line_ends[rng() % 4];
+    }
+    if (! terminated)
+        gcode += "G1 X7 Y8 E1";
+    return gcode;
+}
+
+TEST_CASE("GCodeReader: parsing a file matches parsing a buffer", "[GCodeReader]") {
+    for (bool relative_e : { false, true })
+        // Small files and files split into several batches tokenized in parallel.
+        for (size_t size : { size_t(0), size_t(100), size_t(9000000) })
+            for (bool terminated : { true, false }) {
+                std::string gcode       = random_gcode(size, terminated);
+                ParsedGCode from_file   = parse_file(gcode, relative_e);
+                ParsedGCode from_buffer = parse_buffer(gcode, relative_e);
+                REQUIRE(from_file.lines == from_buffer.lines);
+                REQUIRE(from_file.positions == from_buffer.positions);
+                REQUIRE(from_file.lines_ends == from_buffer.lines_ends);
+            }
+}
+
+TEST_CASE("GCodeReader: parsing a file stops on request", "[GCodeReader]") {
+    std::string gcode = random_gcode(9000000, true);
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcodereader-%%%%-%%%%.gcode");
+    FILE *f = boost::nowide::fopen(temp.string().c_str(), "wb");
+    REQUIRE(f != nullptr);
+    fwrite(gcode.data(), 1, gcode.size(), f);
+    fclose(f);
+
+    size_t num_lines = 0;
+    GCodeReader reader;
+    reader.parse_file(temp.string(), [&num_lines](GCodeReader &reader, const GCodeReader::GCodeLine &) {
+        if (++ num_lines == 300000)
+            reader.quit_parsing();
+    });
+    boost::nowide::remove(temp.string().c_str());
+    REQUIRE(num_lines == 300000);
+}
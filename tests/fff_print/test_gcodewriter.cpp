@@ -1,9 +1,17 @@
 #include <catch2/catch.hpp>
 
+#include <chrono>
+#include <charconv>
+#include <cmath>
+#include <cstring>
 #include <memory>
+#include <random>
 
+#include "libslic3r/GCodeReader.hpp"
 #include "libslic3r/GCodeWriter.hpp"
 
+#include "test_data.hpp"
+
 using namespace Slic3r;
 
 SCENARIO("lift() is not ignored after unlift() at normal values of Z", "[GCodeWriter]") {
@@ -94,3 +102,117 @@ SCENARIO("set_speed emits values with fixed-point output.", "[GCodeWriter]") {
         }
     }
 }
+
+// The former GCodeFormatter::emit_axis() formatting: std::to_chars of the scaled integer,
+// followed by shifting the digits to insert the decimal point and trimming the trailing zeros.
+static char* format_fixed_reference(char *dst, double v, size_t digits)
+{
+    static constexpr const std::array<int, 10> pow_10{1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+    char *base_ptr = dst;
+    char *ptr      = dst;
+    auto  v_int    = int64_t(std::round(v * pow_10[digits]));
+    ptr = std::to_chars(ptr, dst + 31, v_int).ptr;
+    size_t writen_digits = (ptr - base_ptr) - (v_int < 0 ? 1 : 0);
+    if (writen_digits < digits) {
+        size_t remaining_digits = digits - writen_digits;
+        for (char *from_ptr = ptr - 1, *to_ptr = from_ptr + remaining_digits; from_ptr >= ptr - writen_digits; --to_ptr, --from_ptr)
+            *to_ptr = *from_ptr;
+        memset(ptr - writen_digits, '0', remaining_digits);
+        ptr += remaining_digits;
+    }
+    for (char *to_ptr = ptr, *from_ptr = to_ptr - 1; from_ptr >= ptr - digits; --to_ptr, --from_ptr)
+        *to_ptr = *from_ptr;
+    *(ptr - digits) = '.';
+    for (size_t i = 0; i < digits; ++i) {
+        if (*ptr != '0')
+            break;
+        ptr--;
+    }
+    if (*ptr == '.')
+        ptr--;
+    if ((ptr + 1) == base_ptr || *ptr == '-')
+        *(++ptr) = '0';
+    return ++ptr;
+}
+
+static std::string format_fixed(double v, size_t digits)
+{
+    char buf[32];
+    return std::string(buf, GCodeFormatter::format_fixed(buf, v, digits));
+}
+
+TEST_CASE("GCodeFormatter::format_fixed", "[GCodeWriter]") {
+    SECTION("Trailing zeros and the leading zero are trimmed") {
+        REQUIRE(format_fixed(0., 3) == "0");
+        REQUIRE(format_fixed(-0.0004, 3) == "0");
+        REQUIRE(format_fixed(12., 3) == "12");
+        REQUIRE(format_fixed(-12., 5) == "-12");
+        REQUIRE(format_fixed(0.5, 3) == ".5");
+        REQUIRE(format_fixed(-0.5, 3) == "-.5");
+        REQUIRE(format_fixed(0.00123, 5) == ".00123");
+        REQUIRE(format_fixed(203.200522, 3) == "203.201");
+        REQUIRE(format_fixed(99999.123, 3) == "99999.123");
+        REQUIRE(format_fixed(1.25, 0) == "1");
+        REQUIRE(format_fixed(123456789.123456789, 9) == "123456789.123456789");
+    }
+    SECTION("Output matches the former formatter") {
+        std::mt19937                           rng(1);
+        std::uniform_real_distribution<double> big(-100000., 100000.);
+        std::uniform_real_distribution<double> small(-2., 2.);
+        for (size_t i = 0; i < 200000; ++ i) {
+            double v      = (i & 1) ? big(rng) : small(rng);
+            size_t digits = i % 10;
+            char   buf_ref[32];
+            std::string ref(buf_ref, format_fixed_reference(buf_ref, v, digits));
+            REQUIRE(format_fixed(v, digits) == ref);
+        }
+    }
+}
+
+// Record the axis values of all moves of a sliced model together with their export precision.
+static std::vector<std::pair<double, size_t>> record_moves()
+{
+    std::vector<std::pair<double, size_t>> moves;
+    GCodeReader reader;
+    reader.parse_buffer(Test::slice({ TestMesh::cube_20x20x20 }, { { "fill_density", 0.4 } }),
+        [&moves](GCodeReader &, const GCodeReader::GCodeLine &line) {
+            if (line.cmd_is("G1"))
+                for (Axis axis : { X, Y, Z, E, F })
+                    if (line.has(axis))
+                        moves.emplace_back(line.value(axis), axis == E ? GCodeFormatter::E_EXPORT_DIGITS : GCodeFormatter::XYZF_EXPORT_DIGITS);
+        });
+    return moves;
+}
+
+// Format the moves num_iterations times, return the formatted text and the time taken in milliseconds.
+template<typename Format>
+static std::pair<std::string, double> format_moves(const std::vector<std::pair<double, size_t>> &moves, Format format, size_t num_iterations)
+{
+    std::vector<char> out(moves.size() * 32);
+    size_t            len = 0;
+    auto              t0  = std::chrono::steady_clock::now();
+    for (size_t iter = 0; iter < num_iterations; ++ iter) {
+        char *ptr = out.data();
+        for (const std::pair<double, size_t> &m : moves)
+            ptr = format(ptr, m.first, m.second);
+        len = ptr - out.data();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return std::make_pair(std::string(out.data(), len), ms);
+}
+
+TEST_CASE("GCodeFormatter::format_fixed on a recorded move stream", "[GCodeWriter]") {
+    std::vector<std::pair<double, size_t>> moves = record_moves();
+    REQUIRE(! moves.empty());
+    REQUIRE(format_moves(moves, GCodeFormatter::format_fixed, 1).first == format_moves(moves, format_fixed_reference, 1).first);
+}
+
+TEST_CASE("GCodeFormatter::format_fixed benchmark on a recorded move stream", "[.][GCodeWriter][Benchmark]") {
+    std::vector<std::pair<double, size_t>> moves = record_moves();
+    REQUIRE(! moves.empty());
+    auto reference = format_moves(moves, format_fixed_reference, 20);
+    auto optimized = format_moves(moves, GCodeFormatter::format_fixed, 20);
+    WARN("Formatting " << moves.size() << " axis values 20x: former formatter " << reference.second <<
+        " ms, format_fixed " << optimized.second << " ms");
+    REQUIRE(optimized.first == reference.first);
+}
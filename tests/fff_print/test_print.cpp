@@ -185,3 +185,47 @@ SCENARIO("Ported from Perl", "[Print]") {
         }
     }
 }
+
+// Objects not sharing their regions are processed as independent chains of a TBB flow graph,
+// while a single thread processes them step by step in the order of Print::objects().
+static const std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> multi_object_config {
+    { "support_material",    1 },
+    { "fill_density",        "20%" },
+    { "ironing",             1 }
+};
+
+TEST_CASE("Print: objects processed concurrently produce the G-code of the serial processing", "[Print]") {
+    auto [gcode_parallel, gcode_serial] = Slic3r::Test::slice_parallel_and_serial({ TestMesh::cube_20x20x20, TestMesh::overhang, TestMesh::pyramid }, multi_object_config);
+    REQUIRE(! gcode_parallel.empty());
+    REQUIRE(gcode_parallel == gcode_serial);
+}
+
+TEST_CASE("Print: canceling the concurrent processing of objects and resuming it", "[Print]") {
+    Print print;
+    Model model;
+    Slic3r::Test::init_print({ TestMesh::cube_20x20x20, TestMesh::overhang, TestMesh::pyramid }, print, model, multi_object_config);
+    // Cancel once the first object starts preparing the infill after its perimeters are done, while the other objects are being processed.
+    const PrintObject *first_object = print.objects().front();
+    print.set_step_callback([&print, first_object](const PrintObjectBase *print_object, int step, bool finished) {
+        if (! finished && print_object == first_object && step == posPrepareInfill)
+            print.cancel();
+    });
+    REQUIRE_THROWS_AS(print.process(), CanceledException);
+    REQUIRE(print.canceled());
+    REQUIRE(first_object->is_step_done(posPerimeters));
+    REQUIRE(! first_object->is_step_done(posPrepareInfill));
+    bool all_done = true;
+    for (const PrintObject *object : print.objects())
+        all_done &= object->is_step_done(posSupportMaterial);
+    REQUIRE(! all_done);
+
+    // Clean up the same way the background slicing process does and resume the processing.
+    print.finalize();
+    print.cleanup();
+    print.restart();
+    print.set_step_callback(nullptr);
+    std::string gcode_resumed = Slic3r::Test::gcode(print);
+    std::string gcode_fresh   = Slic3r::Test::slice({ TestMesh::cube_20x20x20, TestMesh::overhang, TestMesh::pyramid }, multi_object_config);
+    REQUIRE(! gcode_resumed.empty());
+    REQUIRE(Slic3r::Test::strip_header(gcode_resumed) == Slic3r::Test::strip_header(gcode_fresh));
+}
@@ -2,11 +2,16 @@
 
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/GCodeReader.hpp"
+#include "libslic3r/GCode/GCodeProcessor.hpp"
 
 #include "test_data.hpp"
 
 #include <algorithm>
 #include <boost/regex.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/cstdio.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 using namespace Slic3r;
 using namespace Slic3r::Test;
@@ -269,3 +274,115 @@ SCENARIO( "PrintGCode basic functionality", "[PrintGCode]") {
         }
     }
 }
+
+TEST_CASE("PrintGCode: memory limited export produces the same G-code", "[PrintGCode]") {
+    // Strip the header with the time stamp and the configuration block, which contains the memory limit itself.
+    auto gcode_body = [](const std::string &gcode) {
+        size_t begin = gcode.find('\n');
+        size_t end   = gcode.find("; prusaslicer_config = begin");
+        REQUIRE(begin != std::string::npos);
+        REQUIRE(end != std::string::npos);
+        return gcode.substr(begin, end - begin);
+    };
+    for (bool pressure_equalizer : { false, true }) {
+        std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> config {
+            { "layer_height",                                   0.2 },
+            { "max_volumetric_extrusion_rate_slope_positive",   pressure_equalizer ? 2. : 0. },
+            { "gcode_substitutions",                            "\"perimeter\";\"wall\";\"\";\"\"" },
+            { "gcode_comments",                                 true }
+        };
+        std::string unlimited = Slic3r::Test::slice({ TestMesh::cube_20x20x20, TestMesh::pyramid }, config);
+        std::string limited;
+        {
+            DynamicPrintConfig limited_config = DynamicPrintConfig::full_print_config();
+            limited_config.set_deserialize_strict(config);
+            // A tight limit, the pipeline is run in several rounds with a reduced number of layers in flight.
+            limited_config.set_deserialize_strict({ { "gcode_export_memory_limit", 1 } });
+            limited = Slic3r::Test::slice({ TestMesh::cube_20x20x20, TestMesh::pyramid }, limited_config);
+        }
+        REQUIRE(gcode_body(limited) == gcode_body(unlimited));
+    }
+}
+
+TEST_CASE("PrintGCode: time estimate placeholders are replaced with and without M73", "[PrintGCode]") {
+    // Drop the M73 lines and the configuration block, which contains the remaining_times option itself.
+    auto strip_m73 = [](const std::string &gcode) {
+        std::string out;
+        size_t end = gcode.find("; prusaslicer_config = begin");
+        REQUIRE(end != std::string::npos);
+        for (size_t begin = gcode.find('\n') + 1; begin < end;) {
+            size_t eol = std::min(gcode.find('\n', begin), end);
+            if (! boost::starts_with(gcode.c_str() + begin, "M73 "))
+                out.append(gcode, begin, eol + 1 - begin);
+            begin = eol + 1;
+        }
+        return out;
+    };
+    std::string gcode[2];
+    for (bool remaining_times : { false, true }) {
+        gcode[remaining_times] = Slic3r::Test::slice({ TestMesh::cube_20x20x20 }, {
+            { "gcode_flavor",       "marlin2" },
+            { "remaining_times",    remaining_times }
+        });
+        const std::string &out = gcode[remaining_times];
+        REQUIRE(out.find(GCodeProcessor::reserved_tag(GCodeProcessor::ETags::Estimated_Printing_Time_Placeholder)) == std::string::npos);
+        REQUIRE(out.find("; estimated printing time (normal mode) = ") != std::string::npos);
+        REQUIRE(out.find("; filament used [mm] = ") != std::string::npos);
+        REQUIRE((out.find("\nM73 P") != std::string::npos) == remaining_times);
+    }
+    // Apart from the M73 lines, the G-code does not depend on the remaining times being exported.
+    REQUIRE(strip_m73(gcode[0]) == strip_m73(gcode[1]));
+}
+
+TEST_CASE("PrintGCode: M73 lines inserted during the export are patched in place", "[PrintGCode]") {
+    Slic3r::Print print;
+    Slic3r::Model model;
+    Slic3r::Test::init_print({ TestMesh::cube_20x20x20 }, print, model, {
+        { "gcode_flavor",       "marlin2" },
+        { "remaining_times",    true }
+    });
+    print.set_status_silent();
+    print.process();
+    boost::filesystem::path temp = boost::filesystem::unique_path();
+    GCodeProcessorResult result;
+    print.export_gcode(temp.string(), &result, nullptr);
+    std::string gcode;
+    {
+        boost::nowide::ifstream t(temp.string(), std::ios::binary);
+        gcode.assign(std::istreambuf_iterator<char>(t), std::istreambuf_iterator<char>());
+    }
+    boost::nowide::remove(temp.string().c_str());
+
+    std::vector<size_t> lines_ends;
+    std::vector<std::pair<int, int>> M73_lines;
+    for (size_t begin = 0; begin < gcode.size();) {
+        size_t eol = gcode.find('\n', begin);
+        REQUIRE(eol != std::string::npos);
+        lines_ends.emplace_back(eol + 1);
+        int percent, remaining;
+        if (sscanf(gcode.c_str() + begin, "M73 P%d R%d", &percent, &remaining) == 2)
+            M73_lines.push_back({ percent, remaining });
+        // No M73 placeholder was left without its value.
+        REQUIRE(! (gcode[begin] == ';' && eol > begin + 1 && gcode.find_first_not_of(' ', begin + 1) == eol));
+        begin = eol + 1;
+    }
+    REQUIRE(M73_lines.size() > 2);
+    REQUIRE(M73_lines.front() == std::make_pair(0, M73_lines.front().second));
+    REQUIRE(M73_lines.back() == std::make_pair(100, 0));
+    for (size_t i = 1; i < M73_lines.size(); ++ i) {
+        REQUIRE(M73_lines[i].first >= M73_lines[i - 1].first);
+        REQUIRE(M73_lines[i].second <= M73_lines[i - 1].second);
+    }
+
+    // The line ends and the G-code lines of the moves refer to the exported G-code.
+    REQUIRE(result.lines_ends == lines_ends);
+    size_t extrusions = 0;
+    for (const GCodeProcessorResult::MoveVertex &move : result.moves)
+        if (move.type == EMoveType::Extrude) {
+            REQUIRE(move.gcode_id > 0);
+            REQUIRE(move.gcode_id <= lines_ends.size());
+            REQUIRE(boost::starts_with(gcode.c_str() + (move.gcode_id > 1 ? lines_ends[move.gcode_id - 2] : 0), "G1 "));
+            ++ extrusions;
+        }
+    REQUIRE(extrusions > 0);
+}
@@ -87,3 +87,58 @@ SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
 #endif
     }
 }
+
+TEST_CASE("PrintObject: nonplanar surface detection is deterministic", "[PrintObject]") {
+    std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> config {
+        { "use_nonplanar_layers",    1 },
+        { "nonplanar_layers_angle",  30 },
+        { "nonplanar_layers_height", 10 },
+        { "top_solid_layers",        3 }
+    };
+    auto [gcode_parallel, gcode_serial] = Slic3r::Test::slice_parallel_and_serial({ TestMesh::slopy_cube }, config);
+    REQUIRE(! gcode_parallel.empty());
+    REQUIRE(gcode_parallel == gcode_serial);
+}
+
+TEST_CASE("PrintObject: changing nonplanar options does not reslice", "[PrintObject]") {
+    auto config = Slic3r::DynamicPrintConfig::full_print_config_with({
+        { "use_nonplanar_layers",    1 },
+        { "nonplanar_layers_angle",  30 },
+        { "nonplanar_layers_height", 10 },
+        { "top_solid_layers",        3 }
+    });
+    Print print;
+    Model model;
+    Slic3r::Test::init_print({ TestMesh::slopy_cube }, print, model, config);
+    REQUIRE(! Slic3r::Test::gcode(print).empty());
+
+    config.set_deserialize_strict("nonplanar_layers_angle", "20");
+    print.apply(model, config);
+    const PrintObject &object = *print.objects().front();
+    REQUIRE(object.is_step_done(posSlice));
+    REQUIRE(! object.is_step_done(posNonplanarDetect));
+    REQUIRE(! object.is_step_done(posPerimeters));
+    std::string gcode_reconfigured = Slic3r::Test::gcode(print);
+
+    Print print_fresh;
+    Model model_fresh;
+    Slic3r::Test::init_print({ TestMesh::slopy_cube }, print_fresh, model_fresh, config);
+    REQUIRE(Slic3r::Test::strip_header(gcode_reconfigured) == Slic3r::Test::strip_header(Slic3r::Test::gcode(print_fresh)));
+}
+
+TEST_CASE("PrintObject: out of core slicing produces the same G-code", "[PrintObject]") {
+    auto gcode_with_slicing_cache_min_facets = [](int min_facets) {
+        Print print;
+        Model model;
+        Slic3r::Test::init_print({ TestMesh::sphere_50mm, TestMesh::overhang }, print, model, {
+            { "slicing_cache_min_facets", min_facets },
+            { "top_solid_layers",         3 }
+        });
+        return Slic3r::Test::strip_header(Slic3r::Test::gcode(print));
+    };
+    // With the threshold of 1000 facets just the sphere is sliced out of core, with the threshold of 1 both the objects are.
+    std::string gcode = gcode_with_slicing_cache_min_facets(0);
+    REQUIRE(! gcode.empty());
+    REQUIRE(gcode_with_slicing_cache_min_facets(1000) == gcode);
+    REQUIRE(gcode_with_slicing_cache_min_facets(1) == gcode);
+}
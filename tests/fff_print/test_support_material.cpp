@@ -1,7 +1,9 @@
 #include <catch2/catch.hpp>
 
+#include "libslic3r/BuildVolume.hpp"
 #include "libslic3r/GCodeReader.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/Support/TreeModelVolumes.hpp"
 
 #include "test_data.hpp" // get access to init_print, etc
 
@@ -119,6 +121,84 @@ SCENARIO("SupportMaterial: support_layers_z and contact_distance", "[SupportMate
     }
 }
 
+SCENARIO("SupportMaterial: tree support caches follow the memory limit", "[SupportMaterial]")
+{
+    using AvoidanceType = FFFTreeSupport::TreeModelVolumes::AvoidanceType;
+    using LayerIndex    = FFFTreeSupport::LayerIndex;
+    // Route the areas of a single branch top down as the propagation of the influence areas does,
+    // collect the areas requested, the memory of the caches estimated by precalculate() and their peak memory.
+    auto route = [](int memory_limit_mb, size_t &memory_estimate, size_t &peak_memory, bool &pathing_windows, std::vector<Polygons> &areas) {
+        Slic3r::Print print;
+        Slic3r::Test::init_and_process_print({ TestMesh::sphere_50mm }, print, {
+            { "layer_height",                       0.2 },
+            { "first_layer_height",                 0.2 },
+            { "support_tree_cache_memory_limit",    memory_limit_mb }
+        });
+        const PrintObject &object = *print.objects().front();
+        const FFFTreeSupport::TreeSupportSettings config{ FFFTreeSupport::TreeSupportMeshGroupSettings(object), object.slicing_parameters() };
+        FFFTreeSupport::TreeModelVolumes volumes{ object, BuildVolume(Pointfs{ Vec2d{ -300., -300. }, Vec2d{ -300., +300. }, Vec2d{ +300., +300. }, Vec2d{ +300., -300. } }, 0.),
+            config.maximum_move_distance, config.maximum_move_distance_slow, 0 };
+        const LayerIndex max_layer = LayerIndex(object.layer_count()) - 1;
+        volumes.precalculate(object, max_layer, []{});
+        pathing_windows = volumes.pathing_windows();
+        memory_estimate = volumes.pathing_cache_memory_estimate();
+        peak_memory = volumes.pathing_cache_memory_used();
+        volumes.release_pathing_windows();
+        for (LayerIndex layer_idx = max_layer; layer_idx > 0; -- layer_idx) {
+            const coord_t radius = config.getRadius(max_layer - layer_idx);
+            for (AvoidanceType type : { AvoidanceType::Slow, AvoidanceType::FastSafe, AvoidanceType::Fast })
+                for (bool to_model : { false, true })
+                    if (! to_model || config.support_rests_on_model)
+                        areas.emplace_back(volumes.getAvoidance(radius, layer_idx - 1, type, to_model, true));
+            areas.emplace_back(volumes.getWallRestriction(radius, layer_idx, true));
+            peak_memory = std::max(peak_memory, volumes.pathing_cache_memory_used());
+            volumes.release_pathing_caches_above(layer_idx - 1);
+        }
+    };
+    GIVEN("A sphere routed without a memory limit") {
+        size_t                memory_estimate_unlimited;
+        size_t                peak_memory_unlimited;
+        bool                  pathing_windows_unlimited;
+        std::vector<Polygons> areas_unlimited;
+        route(0, memory_estimate_unlimited, peak_memory_unlimited, pathing_windows_unlimited, areas_unlimited);
+        REQUIRE(! pathing_windows_unlimited);
+        // The limit is set in whole megabytes, thus the caches have to take several megabytes for half of them to be a limit below them.
+        REQUIRE(memory_estimate_unlimited >= (size_t(4) << 20));
+        REQUIRE(peak_memory_unlimited >= (size_t(4) << 20));
+        WHEN("Routed with the memory limit set to half of the estimated and of the measured memory") {
+            // precalculate() decides the windows by the estimate, while the caches are released by their measured memory.
+            const int             memory_limit_mb = int(std::min(memory_estimate_unlimited, peak_memory_unlimited) >> 20) / 2;
+            size_t                memory_estimate;
+            size_t                peak_memory;
+            bool                  pathing_windows;
+            std::vector<Polygons> areas;
+            route(memory_limit_mb, memory_estimate, peak_memory, pathing_windows, areas);
+            THEN("The avoidances are kept by windows, using less memory") {
+                REQUIRE(pathing_windows);
+                REQUIRE(peak_memory < peak_memory_unlimited);
+            }
+            THEN("The areas are the same") {
+                REQUIRE(areas == areas_unlimited);
+            }
+        }
+        WHEN("Routed with a memory limit far above that") {
+            const int             memory_limit_mb = int(std::max(memory_estimate_unlimited, peak_memory_unlimited) >> 20) * 2 + 1;
+            size_t                memory_estimate;
+            size_t                peak_memory;
+            bool                  pathing_windows;
+            std::vector<Polygons> areas;
+            route(memory_limit_mb, memory_estimate, peak_memory, pathing_windows, areas);
+            THEN("All the avoidances are kept as without the limit") {
+                REQUIRE(! pathing_windows);
+                REQUIRE(peak_memory == peak_memory_unlimited);
+            }
+            THEN("The areas are the same") {
+                REQUIRE(areas == areas_unlimited);
+            }
+        }
+    }
+}
+
 #if 0
 // Test 8.
 TEST_CASE("SupportMaterial: forced support is generated", "[SupportMaterial]")
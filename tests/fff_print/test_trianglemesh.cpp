@@ -5,12 +5,16 @@
 #include "libslic3r/Point.hpp"
 #include "libslic3r/Config.hpp"
 #include "libslic3r/Model.hpp"
+#include "libslic3r/Geometry.hpp"
 #include "libslic3r/libslic3r.h"
 
 #include <algorithm>
 #include <future>
 #include <chrono>
 
+#include <boost/filesystem.hpp>
+#include <boost/nowide/cstdio.hpp>
+
 //#include "test_options.hpp"
 #include "test_data.hpp"
 
@@ -177,6 +181,130 @@ SCENARIO( "TriangleMesh: slice behavior.") {
     }
 }
 
+// A sphere merged with a box sticking out of it and sorted slicing planes spaced by a layer height not dividing
+// the dimensions of the mesh, with the box corners and the sphere poles falling exactly onto slicing planes.
+static std::pair<indexed_triangle_set, std::vector<float>> sphere_and_box_with_layers()
+{
+    indexed_triangle_set mesh = its_make_sphere(10., 2. * PI / 90.);
+    its_merge(mesh, its_make_cube(5., 8., 25.));
+    std::vector<float> zs;
+    for (float z = -12.f; z < 27.f; z += 0.13f)
+        zs.emplace_back(z);
+    zs.insert(zs.end(), { -10.f, 0.f, 10.f, 25.f });
+    std::sort(zs.begin(), zs.end());
+    return { std::move(mesh), std::move(zs) };
+}
+
+// Start each polygon at its smallest point and sort the polygons, so that slices chained from the same lines
+// in a different order compare equal.
+static Polygons canonical_polygons(Polygons polygons)
+{
+    for (Polygon &polygon : polygons)
+        std::rotate(polygon.points.begin(), std::min_element(polygon.points.begin(), polygon.points.end()), polygon.points.end());
+    std::sort(polygons.begin(), polygons.end(), [](const Polygon &l, const Polygon &r) { return l.points < r.points; });
+    return polygons;
+}
+
+TEST_CASE("slice_mesh over many layers matches slicing layer by layer", "[TriangleMeshSlicer]") {
+    // Slicing a single layer does not bucket the facets by layer bands, thus it serves as a reference.
+    const auto                   sphere_and_box = sphere_and_box_with_layers();
+    const indexed_triangle_set  &mesh           = sphere_and_box.first;
+    const std::vector<float>    &zs             = sphere_and_box.second;
+
+    auto check = [&mesh, &zs](const MeshSlicingParams &params) {
+        std::vector<Polygons> layers = slice_mesh(mesh, zs, params);
+        REQUIRE(layers.size() == zs.size());
+        for (size_t i = 0; i < zs.size(); ++ i) {
+            Polygons reference = slice_mesh(mesh, std::vector<float>{ zs[i] }, params).front();
+            REQUIRE(layers[i].size() == reference.size());
+            REQUIRE(area(layers[i]) == Approx(area(reference)));
+        }
+        std::vector<Polygons> unbanded = detail::slice_mesh_unbanded(mesh, zs, params);
+        REQUIRE(unbanded.size() == zs.size());
+        for (size_t i = 0; i < zs.size(); ++ i)
+            REQUIRE(canonical_polygons(layers[i]) == canonical_polygons(unbanded[i]));
+    };
+    SECTION("identity") {
+        check(MeshSlicingParams{});
+    }
+    SECTION("transformed") {
+        MeshSlicingParams params;
+        params.trafo = Geometry::assemble_transform(Vec3d(3., -2., 1.), Vec3d(0.3, 0.2, 0.1), Vec3d(1.2, 0.9, 1.1));
+        check(params);
+    }
+}
+
+TEST_CASE("slice_mesh_from_cache matches slice_mesh", "[TriangleMeshSlicer]") {
+    auto [mesh, zs] = sphere_and_box_with_layers();
+    const Transform3d trafo = Geometry::assemble_transform(Vec3d(3., -2., 1.), Vec3d(0.3, 0.2, 0.1), Vec3d(1.2, 0.9, 1.1));
+
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slicingcache-%%%%-%%%%.bin");
+    write_mesh_slicing_cache(mesh, trafo, temp.string());
+
+    MeshSlicingParamsEx params;
+    params.trafo = trafo;
+    params.mode_below = MeshSlicingParams::SlicingMode::EvenOdd;
+    params.slicing_mode_normal_below_layer = 40;
+    std::vector<Polygons>   reference    = slice_mesh(mesh, zs, params);
+    std::vector<ExPolygons> reference_ex = slice_mesh_ex(mesh, zs, params);
+    params.trafo = Transform3d::Identity();
+    // Bands of a single layer, bands not dividing the layer count and a single band.
+    for (size_t layers_per_band : { size_t(1), size_t(7), zs.size() }) {
+        std::vector<Polygons>   layers    = slice_mesh_from_cache(temp.string(), zs, params, layers_per_band);
+        std::vector<ExPolygons> layers_ex = slice_mesh_ex_from_cache(temp.string(), zs, params, layers_per_band);
+        REQUIRE(layers == reference);
+        REQUIRE(layers_ex.size() == reference_ex.size());
+        for (size_t i = 0; i < zs.size(); ++ i)
+            REQUIRE(to_polygons(layers_ex[i]) == to_polygons(reference_ex[i]));
+    }
+    boost::nowide::remove(temp.string().c_str());
+}
+
+TEST_CASE("write_mesh_slicing_cache_from_stl matches slicing the loaded STL", "[TriangleMeshSlicer]") {
+    auto [mesh, zs] = sphere_and_box_with_layers();
+    const Transform3d trafo = Geometry::assemble_transform(Vec3d(3., -2., 1.), Vec3d(0.3, 0.2, 0.1), Vec3d(1.2, 0.9, 1.1));
+
+    boost::filesystem::path stl   = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slicingcache-%%%%-%%%%.stl");
+    boost::filesystem::path cache = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slicingcache-%%%%-%%%%.bin");
+    REQUIRE(its_write_stl_binary(stl.string().c_str(), "", mesh));
+    indexed_triangle_set loaded;
+    REQUIRE(its_read_stl_binary(stl.string().c_str(), loaded));
+    REQUIRE(write_mesh_slicing_cache_from_stl(stl.string(), trafo, cache.string()));
+
+    MeshSlicingParams params;
+    params.trafo = trafo;
+    std::vector<Polygons> reference = slice_mesh(loaded, zs, params);
+    params.trafo = Transform3d::Identity();
+    REQUIRE(slice_mesh_from_cache(cache.string(), zs, params, 7) == reference);
+    // An ASCII STL is refused.
+    REQUIRE(its_write_stl_ascii(stl.string().c_str(), "", mesh));
+    REQUIRE(! write_mesh_slicing_cache_from_stl(stl.string(), trafo, cache.string()));
+    boost::nowide::remove(stl.string().c_str());
+    boost::nowide::remove(cache.string().c_str());
+}
+
+TEST_CASE("slice_mesh benchmark on a finely tessellated mesh", "[.][TriangleMeshSlicer][Benchmark]") {
+    // A sphere of a few million facets stands in for a large scanned mesh.
+    indexed_triangle_set mesh = its_make_sphere(50., 2. * PI / 2000.);
+    std::vector<float> zs;
+    for (float z = -50.f; z < 50.f; z += 0.05f)
+        zs.emplace_back(z);
+    auto time_ms = [](auto &&fn) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    };
+    std::vector<Polygons> unbanded, banded;
+    double unbanded_ms = time_ms([&]() { unbanded = detail::slice_mesh_unbanded(mesh, zs, MeshSlicingParams{}); });
+    double banded_ms   = time_ms([&]() { banded   = slice_mesh(mesh, zs, MeshSlicingParams{}); });
+    WARN("slicing " << mesh.indices.size() << " facets at " << zs.size() << " layers: unbanded " << unbanded_ms << " ms, banded " <<
+        banded_ms << " ms, speedup " << unbanded_ms / banded_ms);
+    REQUIRE(banded.size() == zs.size());
+    REQUIRE(unbanded.size() == zs.size());
+    for (size_t i = 0; i < zs.size(); ++ i)
+        REQUIRE(canonical_polygons(banded[i]) == canonical_polygons(unbanded[i]));
+}
+
 SCENARIO( "make_xxx functions produce meshes.") {
     GIVEN("make_cube() function") {
         WHEN("make_cube() is called with arguments 20,20,20") {
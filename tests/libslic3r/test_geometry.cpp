@@ -18,6 +18,7 @@
 #include "../libnest2d/printer_parts.hpp"
 
 #include <unordered_set>
+#include <random>
 
 using namespace Slic3r;
 
@@ -788,3 +789,58 @@ TEST_CASE("Euler angles roundtrip", "[Geometry]") {
         REQUIRE(trafo1.isApprox(trafo2));
     }
 }
+
+TEST_CASE("Batch triangle kernels match the scalar functions", "[Geometry]") {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coord(0.f, 10.f);
+    Geometry::TrianglesSoA triangles;
+    std::vector<std::array<Vec3f, 3>> vertices;
+    std::vector<Vec3f> normals;
+    for (size_t i = 0; i < 1000; ++ i) {
+        std::array<Vec3f, 3> v { Vec3f(coord(rng), coord(rng), coord(rng)), Vec3f(coord(rng), coord(rng), coord(rng)), Vec3f(coord(rng), coord(rng), coord(rng)) };
+        Vec3f n = (v[1] - v[0]).cross(v[2] - v[0]).normalized();
+        triangles.push_back(v[0], v[1], v[2], n);
+        vertices.emplace_back(v);
+        normals.emplace_back(n);
+    }
+    REQUIRE(triangles.size() == 1000);
+
+    const Point point = Point::new_scale(4.2, 5.7);
+    const Vec2f pt    = Vec2f(unscale<float>(point.x()), unscale<float>(point.y()));
+    std::vector<uint8_t> mask(triangles.size());
+    std::vector<float>   plane_z(triangles.size());
+    Geometry::points_in_triangles(pt, triangles, mask.data());
+    Geometry::project_point_on_planes(pt, triangles, plane_z.data());
+    size_t num_inside = 0;
+    for (size_t i = 0; i < triangles.size(); ++ i) {
+        const std::array<Vec3f, 3> &v = vertices[i];
+        bool inside = Geometry::Point_in_triangle(pt, v[0].head<2>(), v[1].head<2>(), v[2].head<2>());
+        REQUIRE(bool(mask[i]) == inside);
+        num_inside += inside;
+        REQUIRE(coord_t(scale_(plane_z[i])) == Geometry::Project_point_on_plane(v[0], normals[i], point));
+    }
+    REQUIRE(num_inside > 0);
+
+    const Point p3 = Point::new_scale(1., 2.);
+    const Point p4 = Point::new_scale(9., 7.);
+    std::vector<double> xs(3 * triangles.size()), ys(3 * triangles.size()), zs(3 * triangles.size());
+    mask.resize(3 * triangles.size());
+    Geometry::line_intersections(triangles, p3, p4, xs.data(), ys.data(), zs.data(), mask.data());
+    size_t num_intersections = 0;
+    for (size_t i = 0; i < triangles.size(); ++ i)
+        for (int j = 0; j < 3; ++ j) {
+            const Vec3f &a = vertices[i][j];
+            const Vec3f &b = vertices[i][(j + 1) % 3];
+            std::optional<Vec3d> p = Geometry::Line_intersection(
+                Vec3d(scale_(a.x()), scale_(a.y()), scale_(a.z())), Vec3d(scale_(b.x()), scale_(b.y()), scale_(b.z())), p3, p4);
+            const size_t k = 3 * i + j;
+            REQUIRE(bool(mask[k]) == p.has_value());
+            if (p) {
+                ++ num_intersections;
+                REQUIRE(xs[k] == p->x());
+                REQUIRE(ys[k] == p->y());
+                REQUIRE(zs[k] == p->z());
+            }
+        }
+    REQUIRE(num_intersections > 0);
+}
@@ -0,0 +1,102 @@
+#include <catch2/catch.hpp>
+#include <test_utils.hpp>
+
+#include <numeric>
+
+#include <libslic3r/NonplanarSurface.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+
+using namespace Slic3r;
+
+// Regular grid of nx * ny quads split into two facets each, heights taken from a ramp.
+// Facets are numbered row by row, neighbors across the quad diagonals and the shared grid edges.
+static NonplanarSurface make_grid_surface(int nx, int ny, float x0 = 0.f)
+{
+    indexed_triangle_set its;
+    for (int y = 0; y <= ny; ++ y)
+        for (int x = 0; x <= nx; ++ x)
+            its.vertices.emplace_back(x0 + float(x), float(y), 0.1f * float(x + y));
+    auto vertex = [nx](int x, int y) { return y * (nx + 1) + x; };
+    for (int y = 0; y < ny; ++ y)
+        for (int x = 0; x < nx; ++ x) {
+            its.indices.emplace_back(vertex(x, y), vertex(x + 1, y), vertex(x + 1, y + 1));
+            its.indices.emplace_back(vertex(x, y), vertex(x + 1, y + 1), vertex(x, y + 1));
+        }
+    std::vector<Vec3f> normals(its.indices.size(), Vec3f(0.f, 0.f, 1.f));
+    std::vector<int>   facets(its.indices.size());
+    std::iota(facets.begin(), facets.end(), 0);
+    return NonplanarSurface(its, normals, its_face_neighbors(its), facets);
+}
+
+TEST_CASE("NonplanarSurface AABB tree query matches brute force", "[NonplanarSurface]")
+{
+    NonplanarSurface surface = make_grid_surface(10, 7);
+    surface.build_aabb_tree();
+    REQUIRE(surface.facets_count() == 140);
+
+    auto brute_force = [&surface](const BoundingBoxf &bbox) {
+        std::vector<size_t> out;
+        for (size_t facet_idx = 0; facet_idx < surface.facets_count(); ++ facet_idx) {
+            BoundingBoxf3 facet_bbox;
+            for (const Vec3f &v : its_triangle_vertices(surface.its, facet_idx))
+                facet_bbox.merge(v.cast<double>());
+            if (facet_bbox.max.x() >= bbox.min.x() && facet_bbox.min.x() <= bbox.max.x() &&
+                facet_bbox.max.y() >= bbox.min.y() && facet_bbox.min.y() <= bbox.max.y())
+                out.emplace_back(facet_idx);
+        }
+        return out;
+    };
+
+    std::vector<size_t> found;
+    for (const BoundingBoxf &bbox : { BoundingBoxf(Vec2d(2.5, 3.5), Vec2d(2.5, 3.5)),
+                                      BoundingBoxf(Vec2d(0., 0.), Vec2d(0., 0.)),
+                                      BoundingBoxf(Vec2d(1.2, 0.3), Vec2d(6.7, 4.1)),
+                                      BoundingBoxf(Vec2d(-5., -5.), Vec2d(-1., -1.)) }) {
+        surface.facets_in_bbox(bbox, found);
+        REQUIRE(found == brute_force(bbox));
+    }
+}
+
+TEST_CASE("NonplanarSurface AABB tree is dropped on transformation", "[NonplanarSurface]")
+{
+    NonplanarSurface surface = make_grid_surface(3, 3);
+    surface.build_aabb_tree();
+    REQUIRE(! surface.tree.empty());
+    surface.translate(1.f, 0.f, 0.f);
+    REQUIRE(surface.tree.empty());
+}
+
+TEST_CASE("NonplanarSurface grouping into connected components", "[NonplanarSurface]")
+{
+    // Two disjoint grids merged into a single surface.
+    NonplanarSurface a = make_grid_surface(4, 3);
+    NonplanarSurface b = make_grid_surface(2, 5, 10.f);
+    indexed_triangle_set its = a.its;
+    its_merge(its, b.its);
+    std::vector<Vec3f> normals(its.indices.size(), Vec3f(0.f, 0.f, 1.f));
+    std::vector<int>   facets(its.indices.size());
+    std::iota(facets.begin(), facets.end(), 0);
+    NonplanarSurface merged(its, normals, its_face_neighbors(its), facets);
+
+    NonplanarSurfaces groups = merged.group_surfaces();
+    REQUIRE(groups.size() == 2);
+    // The component holding the first facet is returned last.
+    REQUIRE(groups.back().facets_count() == a.facets_count());
+    REQUIRE(groups.back().its.vertices.size() == a.its.vertices.size());
+    REQUIRE(groups.back() == a);
+    REQUIRE(groups.front().facets_count() == b.facets_count());
+    REQUIRE(groups.front() == b);
+    for (const NonplanarSurface &group : groups)
+        for (const Vec3i &neighbor : group.neighbors)
+            for (int j = 0; j < 3; ++ j)
+                REQUIRE(neighbor(j) < int(group.facets_count()));
+}
+
+TEST_CASE("NonplanarSurface grouping of a large surface", "[NonplanarSurface]")
+{
+    // Large enough to overflow the stack with a recursive flood fill.
+    NonplanarSurface surface = make_grid_surface(400, 400);
+    NonplanarSurfaces groups = surface.group_surfaces();
+    REQUIRE(groups.size() == 1);
+    REQUIRE(groups.front().facets_count() == surface.facets_count());
+}
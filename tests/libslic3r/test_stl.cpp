@@ -2,6 +2,10 @@
 
 #include "libslic3r/Model.hpp"
 #include "libslic3r/Format/STL.hpp"
+#include "libslic3r/TriangleMesh.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/cstdio.hpp>
 
 using namespace Slic3r;
 
@@ -55,3 +59,81 @@ SCENARIO("Reading an STL file", "[stl]") {
 		}
 	}
 }
+
+TEST_CASE("its_read_stl_binary merges the vertices of a binary STL", "[stl]") {
+	indexed_triangle_set mesh = its_make_sphere(10., 2. * PI / 60.);
+	its_merge(mesh, its_make_cube(5., 8., 25.));
+	boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("stl-%%%%-%%%%.stl");
+	REQUIRE(its_write_stl_binary(temp.string().c_str(), "", mesh));
+
+	indexed_triangle_set its;
+	REQUIRE(its_read_stl_binary(temp.string().c_str(), its));
+	REQUIRE(its.indices.size() == mesh.indices.size());
+	// The sphere and the cube do not share any vertex.
+	REQUIRE(its.vertices.size() == mesh.vertices.size());
+	for (size_t i = 0; i < its.indices.size(); ++ i)
+		for (int j = 0; j < 3; ++ j)
+			REQUIRE(its.vertices[its.indices[i](j)] == mesh.vertices[mesh.indices[i](j)]);
+
+	// The fast path of ReadSTLFile() is taken for a mesh of two closed and positively oriented parts.
+	TriangleMesh tm;
+	REQUIRE(tm.ReadSTLFile(temp.string().c_str()));
+	REQUIRE(tm.facets_count() == mesh.indices.size());
+	REQUIRE(tm.stats().number_of_parts == 2);
+	REQUIRE(tm.stats().volume == Approx(its_volume(mesh)));
+	REQUIRE(! tm.stats().repaired());
+
+	// A NaN coordinate of a corrupted file leaves the file to the admesh loader.
+	mesh.vertices.front().y() = std::numeric_limits<float>::quiet_NaN();
+	REQUIRE(its_write_stl_binary(temp.string().c_str(), "", mesh));
+	REQUIRE(! its_read_stl_binary(temp.string().c_str(), its));
+	boost::nowide::remove(temp.string().c_str());
+
+	REQUIRE(! its_read_stl_binary(stl_path("ASCII/20mmbox-LF.stl").c_str(), its));
+}
+
+TEST_CASE("ReadSTLFile repairs a binary STL loaded by its_read_stl_binary like the admesh import", "[stl]") {
+	// A sphere with a hole and an inverted cube are left to the admesh repair.
+	indexed_triangle_set mesh = its_make_sphere(10., 2. * PI / 60.);
+	mesh.indices.pop_back();
+	indexed_triangle_set cube = its_make_cube(5., 8., 25.);
+	for (Vec3f &v : cube.vertices)
+		v.x() += 20.f;
+	its_flip_triangles(cube);
+	its_merge(mesh, cube);
+	boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("stl-%%%%-%%%%.stl");
+	REQUIRE(its_write_stl_binary(temp.string().c_str(), "", mesh));
+	TriangleMesh binary;
+	REQUIRE(binary.ReadSTLFile(temp.string().c_str()));
+	// The same mesh stored as an ASCII STL is read by stl_open().
+	REQUIRE(its_write_stl_ascii(temp.string().c_str(), "", mesh));
+	TriangleMesh ascii;
+	REQUIRE(ascii.ReadSTLFile(temp.string().c_str()));
+	boost::nowide::remove(temp.string().c_str());
+
+	REQUIRE(binary.facets_count() == ascii.facets_count());
+	REQUIRE(binary.stats().number_of_parts == ascii.stats().number_of_parts);
+	REQUIRE(binary.stats().open_edges == ascii.stats().open_edges);
+	REQUIRE(binary.stats().repaired_errors.facets_reversed == ascii.stats().repaired_errors.facets_reversed);
+	REQUIRE(binary.stats().volume == Approx(ascii.stats().volume));
+	REQUIRE(binary.stats().size == ascii.stats().size);
+}
+
+TEST_CASE("ReadSTLFile of a closed binary STL matches the admesh import", "[stl]") {
+	const std::string path = stl_path("Geräte/20mmbox-čřšřěá.stl");
+	// The memory mapped fast path has to open a file with non-ASCII characters in its path.
+	indexed_triangle_set its;
+	REQUIRE(its_read_stl_binary(path.c_str(), its));
+	REQUIRE(its.indices.size() == 12);
+	REQUIRE(its.vertices.size() == 8);
+	TriangleMesh fast;
+	REQUIRE(fast.ReadSTLFile(path.c_str()));
+	TriangleMesh admesh;
+	REQUIRE(admesh.ReadSTLFile(path.c_str(), false));
+	REQUIRE(fast.facets_count() == admesh.facets_count());
+	REQUIRE(fast.stats().number_of_parts == 1);
+	REQUIRE(fast.stats().open_edges == 0);
+	REQUIRE(! fast.stats().repaired());
+	REQUIRE(fast.volume() == Approx(20. * 20. * 20.));
+	REQUIRE(fast.stats().size == admesh.stats().size);
+}
@@ -0,0 +1,59 @@
+#include <catch2/catch.hpp>
+
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "libslic3r/Trace.hpp"
+
+using namespace Slic3r;
+
+TEST_CASE("Trace records scopes of all threads into a Chrome trace", "[Trace]") {
+    {
+        SLIC3R_TRACE_SCOPE("test", "not_recorded");
+    }
+    Trace::start();
+    {
+        SLIC3R_TRACE_SCOPE("test", "outer");
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++ i)
+            threads.emplace_back([]() {
+                // More events than fit into a single block of a thread buffer.
+                for (int j = 0; j < 5000; ++ j) {
+                    SLIC3R_TRACE_SCOPE("test", "inner");
+                }
+            });
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+    Trace::stop();
+    {
+        SLIC3R_TRACE_SCOPE("test", "not_recorded");
+    }
+
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("trace-%%%%-%%%%.json");
+    REQUIRE(Trace::save(path.string()));
+    boost::property_tree::ptree tree;
+    boost::property_tree::read_json(path.string(), tree);
+    boost::filesystem::remove(path);
+
+    size_t outer = 0, inner = 0, other = 0;
+    for (const auto &event : tree.get_child("traceEvents")) {
+        if (event.second.get<std::string>("ph") != "X")
+            continue;
+        std::string name = event.second.get<std::string>("name");
+        if (name == "outer")
+            ++ outer;
+        else if (name == "inner")
+            ++ inner;
+        else
+            ++ other;
+        REQUIRE(event.second.get<double>("dur") >= 0.);
+    }
+    REQUIRE(outer == 1);
+    REQUIRE(inner == 4 * 5000);
+    REQUIRE(other == 0);
+}